@@ -45,6 +45,14 @@ echo Compiling cpio_util.c...
 cl %CFLAGS% /c src\cpio_util.c
 if %ERRORLEVEL% NEQ 0 goto error
 
+echo Compiling cpio_source.c...
+cl %CFLAGS% /c src\cpio_source.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_writer.c...
+cl %CFLAGS% /c src\cpio_writer.c
+if %ERRORLEVEL% NEQ 0 goto error
+
 echo Compiling cpio_newc.c...
 cl %CFLAGS% /c src\cpio_newc.c
 if %ERRORLEVEL% NEQ 0 goto error
@@ -53,12 +61,92 @@ echo Compiling cpio_odc.c...
 cl %CFLAGS% /c src\cpio_odc.c
 if %ERRORLEVEL% NEQ 0 goto error
 
+echo Compiling cpio_reader.c...
+cl %CFLAGS% /c src\cpio_reader.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_toc.c...
+cl %CFLAGS% /c src\cpio_toc.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_scan.c...
+cl %CFLAGS% /c src\cpio_scan.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_fs.c...
+cl %CFLAGS% /c src\cpio_fs.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_batch.c...
+cl %CFLAGS% /c src\cpio_batch.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_dircache.c...
+cl %CFLAGS% /c src\cpio_dircache.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_match.c...
+cl %CFLAGS% /c src\cpio_match.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_hash.c...
+cl %CFLAGS% /c src\cpio_hash.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_manifest.c...
+cl %CFLAGS% /c src\cpio_manifest.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_hasher.c...
+cl %CFLAGS% /c src\cpio_hasher.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_bom.c...
+cl %CFLAGS% /c src\cpio_bom.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_convert.c...
+cl %CFLAGS% /c src\cpio_convert.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_links.c...
+cl %CFLAGS% /c src\cpio_links.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_dedupe.c...
+cl %CFLAGS% /c src\cpio_dedupe.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_deflate.c...
+cl %CFLAGS% /c src\cpio_deflate.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_gzip.c...
+cl %CFLAGS% /c src\cpio_gzip.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_lzma.c...
+cl %CFLAGS% /c src\cpio_lzma.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_pbzx.c...
+cl %CFLAGS% /c src\cpio_pbzx.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_zstd.c...
+cl %CFLAGS% /c src\cpio_zstd.c
+if %ERRORLEVEL% NEQ 0 goto error
+
+echo Compiling cpio_zstdstream.c...
+cl %CFLAGS% /c src\cpio_zstdstream.c
+if %ERRORLEVEL% NEQ 0 goto error
+
 echo Compiling cpio_tool.c...
 cl %CFLAGS% /c src\cpio_tool.c
 if %ERRORLEVEL% NEQ 0 goto error
 
 echo Linking cpio.exe...
-link %LDFLAGS% /OUT:cpio.exe obj\cpio_util.obj obj\cpio_newc.obj obj\cpio_odc.obj obj\cpio_tool.obj %LIBS%
+link %LDFLAGS% /OUT:cpio.exe obj\cpio_util.obj obj\cpio_source.obj obj\cpio_writer.obj obj\cpio_newc.obj obj\cpio_odc.obj obj\cpio_reader.obj obj\cpio_toc.obj obj\cpio_scan.obj obj\cpio_fs.obj obj\cpio_batch.obj obj\cpio_dircache.obj obj\cpio_match.obj obj\cpio_hash.obj obj\cpio_manifest.obj obj\cpio_hasher.obj obj\cpio_bom.obj obj\cpio_convert.obj obj\cpio_links.obj obj\cpio_dedupe.obj obj\cpio_deflate.obj obj\cpio_gzip.obj obj\cpio_lzma.obj obj\cpio_pbzx.obj obj\cpio_zstd.obj obj\cpio_zstdstream.obj obj\cpio_tool.obj %LIBS%
 if %ERRORLEVEL% NEQ 0 goto error
 
 echo.
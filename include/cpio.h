@@ -16,6 +16,12 @@ void CpioZeroMemory(void* ptr, SIZE_T size);
 void CpioCopyMemory(void* dest, const void* src, SIZE_T size);
 int CpioCompareMemory(const void* ptr1, const void* ptr2, SIZE_T size);
 
+#define CPIO_POOL_BUFFER_SIZE (1024 * 1024)
+#define CPIO_POOL_MAX_FREE 64
+
+BYTE* CpioBufferPoolAcquire(void);
+void CpioBufferPoolRelease(BYTE* buffer);
+
 typedef struct {
     char* data;
     SIZE_T length;
@@ -58,6 +64,31 @@ void CpioHashSetDestroy(CpioHashSet* set);
 BOOL CpioHashSetContains(CpioHashSet* set, const char* key);
 BOOL CpioHashSetInsert(CpioHashSet* set, const char* key);
 
+typedef struct CpioLink {
+    UINT64 id;
+    UINT32 dev;
+    UINT32 inode;
+    UINT32 expected;
+    WCHAR* path;
+    CpioStringList* names;
+    struct CpioLink* next;
+    struct CpioLink* nextInOrder;
+} CpioLink;
+
+typedef struct {
+    CpioLink** buckets;
+    SIZE_T bucketCount;
+    SIZE_T count;
+    SIZE_T deferred;
+    CpioLink* first;
+    CpioLink* last;
+} CpioLinkTable;
+
+CpioLinkTable* CpioLinkTableCreate(void);
+void CpioLinkTableDestroy(CpioLinkTable* table);
+CpioLink* CpioLinkTableFind(CpioLinkTable* table, UINT32 dev, UINT64 id, BOOL create);
+void CpioLinkReset(CpioLink* link);
+
 typedef enum {
     CPIO_SUCCESS = 0,
     CPIO_ERROR_IO,
@@ -69,7 +100,9 @@ typedef enum {
     CPIO_ERROR_NOT_A_FILE,
     CPIO_ERROR_INVALID_HANDLE,
     CPIO_ERROR_ALLOCATION_FAILED,
-    CPIO_ERROR_INVALID_PARAMETER
+    CPIO_ERROR_INVALID_PARAMETER,
+    CPIO_ERROR_NOT_FOUND,
+    CPIO_ERROR_CHECKSUM
 } CpioErrorCode;
 
 typedef struct {
@@ -84,16 +117,548 @@ const char* CpioErrorGetMessage(const CpioError* error);
 typedef enum {
     CPIO_FORMAT_UNKNOWN,
     CPIO_FORMAT_NEWC,
-    CPIO_FORMAT_ODC
+    CPIO_FORMAT_ODC,
+    CPIO_FORMAT_GZIP,
+    CPIO_FORMAT_PBZX,
+    CPIO_FORMAT_ZSTD,
+    CPIO_FORMAT_CRC,
+    CPIO_FORMAT_USTAR,
+    CPIO_FORMAT_PAX
 } CpioFormat;
 
+CpioFormat CpioReadFormat(HANDLE hFile, BYTE* magic, CpioError* error);
 CpioFormat CpioDetectFormat(HANDLE hFile, CpioError* error);
 
+#define CPIO_SOURCE_BUFFER_SIZE CPIO_POOL_BUFFER_SIZE
+
+typedef struct {
+    HANDLE hFile;
+    HANDLE hMapping;
+    const BYTE* view;
+    UINT64 viewSize;
+    BYTE* buffer;
+    SIZE_T bufferSize;
+    SIZE_T bufferPos;
+    SIZE_T bufferLength;
+    UINT64 position;
+    BOOL seekable;
+    BOOL atEnd;
+    BOOL headersOnly;
+    BOOL summing;
+    UINT32 sum;
+} CpioSource;
+
+BOOL CpioSourceInit(CpioSource* source, HANDLE hFile);
+BOOL CpioSourceInitMemory(CpioSource* source, const void* data, SIZE_T size);
+void CpioSourceRelease(CpioSource* source);
+const BYTE* CpioSourcePeek(CpioSource* source, SIZE_T size, SIZE_T* available, CpioError* error);
+void CpioSourceConsume(CpioSource* source, SIZE_T size);
+BOOL CpioSourceRead(CpioSource* source, void* buffer, SIZE_T size, SIZE_T* bytesRead, CpioError* error);
+BOOL CpioSourceSkip(CpioSource* source, UINT64 count, CpioError* error);
+BOOL CpioSourceCopyToHandle(CpioSource* source, HANDLE hOutFile, UINT64 count, UINT64* copied, CpioError* error);
+UINT64 CpioSourceTell(const CpioSource* source);
+UINT64 CpioSourceGetSize(const CpioSource* source);
+void CpioSourceSetHeadersOnly(CpioSource* source, BOOL headersOnly);
+BOOL CpioSourceSeek(CpioSource* source, UINT64 offset, CpioError* error);
+
+#define CPIO_WRITER_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    HANDLE hFile;
+    BYTE* buffer;
+    SIZE_T bufferSize;
+    SIZE_T bufferLength;
+    UINT64 totalWritten;
+    BOOL failed;
+} CpioWriter;
+
+BOOL CpioWriterInit(CpioWriter* writer, HANDLE hFile, SIZE_T bufferSize);
+void CpioWriterRelease(CpioWriter* writer);
+BOOL CpioWriterWrite(CpioWriter* writer, const void* data, SIZE_T size, CpioError* error);
+BOOL CpioWriterWriteString(CpioWriter* writer, const char* str, CpioError* error);
+BOOL CpioWriterFlush(CpioWriter* writer, CpioError* error);
+
+#define CPIO_SHA256_SIZE 32
+
+typedef void (*CpioDataCallback)(void* context, const void* data, SIZE_T length);
+typedef BOOL (*CpioPullCallback)(void* context, void* buffer, DWORD size, DWORD* bytesRead);
+
+typedef struct {
+    UINT32 state[8];
+    UINT64 length;
+    BYTE block[64];
+    SIZE_T blockLength;
+} CpioSha256;
+
+void CpioSha256Init(CpioSha256* sha);
+void CpioSha256Update(CpioSha256* sha, const void* data, SIZE_T length);
+void CpioSha256Final(CpioSha256* sha, BYTE* digest);
+void CpioSha256Callback(void* context, const void* data, SIZE_T length);
+BOOL CpioSha256File(const WCHAR* path, BYTE* digest, CpioError* error);
+
+UINT32 CpioCrc32Update(UINT32 crc, const void* data, SIZE_T length);
+UINT32 CpioCrc32Combine(UINT32 crc1, UINT32 crc2, UINT64 length2);
+UINT64 CpioCrc64Update(UINT64 crc, const void* data, SIZE_T length);
+UINT32 CpioCrc32cUpdate(UINT32 crc, const void* data, SIZE_T length);
+UINT32 CpioCksumUpdate(UINT32 crc, const void* data, SIZE_T length);
+UINT32 CpioCksumFinal(UINT32 crc, UINT64 length);
+UINT32 CpioByteSumUpdate(UINT32 sum, const void* data, SIZE_T length);
+UINT32 CpioByteSumCopy(UINT32 sum, void* dest, const void* src, SIZE_T length);
+
+typedef struct {
+    UINT64 v[4];
+    UINT64 seed;
+    UINT64 total;
+    BYTE buffer[32];
+    SIZE_T bufferLength;
+} CpioXxh64;
+
+void CpioXxh64Init(CpioXxh64* xxh, UINT64 seed);
+void CpioXxh64Update(CpioXxh64* xxh, const void* data, SIZE_T length);
+UINT64 CpioXxh64Digest(const CpioXxh64* xxh);
+
+#define CPIO_DEFLATE_WINDOW_SIZE (32 * 1024)
+#define CPIO_DEFLATE_MAX_BLOCK (128 * 1024)
+#define CPIO_INFLATE_OUTPUT_SIZE (1024 * 1024)
+#define CPIO_INFLATE_FAST_BITS 10
+
+typedef struct {
+    int level;
+    UINT32* head;
+    UINT32* prev;
+    UINT32* symbols;
+    SIZE_T symbolCount;
+    UINT32 litFreq[286];
+    UINT32 distFreq[30];
+    BYTE lengthCode[259];
+    BYTE distCode[512];
+    BYTE* output;
+    SIZE_T outputLength;
+    UINT64 bitBuffer;
+    UINT32 bitCount;
+} CpioDeflater;
+
+CpioDeflater* CpioDeflaterCreate(int level);
+void CpioDeflaterDestroy(CpioDeflater* deflater);
+SIZE_T CpioDeflateBound(SIZE_T length);
+SIZE_T CpioDeflaterCompress(CpioDeflater* deflater, const BYTE* data, SIZE_T dictLength, SIZE_T length,
+                            BYTE* output);
+
+typedef struct {
+    UINT16 fast[1 << CPIO_INFLATE_FAST_BITS];
+    UINT16 count[16];
+    UINT16 symbols[288];
+} CpioHuffman;
+
+typedef struct {
+    HANDLE hInput;
+    HANDLE hOutput;
+    BYTE* input;
+    SIZE_T inputPos;
+    SIZE_T inputLength;
+    BOOL inputEnd;
+    UINT64 bitBuffer;
+    UINT32 bitCount;
+    BYTE* window;
+    SIZE_T windowPos;
+    SIZE_T flushedPos;
+    UINT32 crc;
+    UINT64 totalOut;
+    CpioHuffman litLen;
+    CpioHuffman dist;
+} CpioInflater;
+
+CpioInflater* CpioInflaterCreate(HANDLE hInput, HANDLE hOutput);
+void CpioInflaterDestroy(CpioInflater* inflater);
+BOOL CpioInflaterPrime(CpioInflater* inflater, const BYTE* data, SIZE_T length);
+void CpioInflaterReset(CpioInflater* inflater);
+BOOL CpioInflaterReadBytes(CpioInflater* inflater, BYTE* data, SIZE_T length, SIZE_T* bytesRead,
+                           CpioError* error);
+BOOL CpioInflaterRun(CpioInflater* inflater, CpioError* error);
+
+#define CPIO_GZIP_DEFAULT_LEVEL 6
+#define CPIO_GZIP_MAX_THREADS 64
+
+typedef struct {
+    BYTE* input;
+    SIZE_T dictLength;
+    SIZE_T length;
+    BYTE* output;
+    SIZE_T outputLength;
+    UINT32 crc;
+    BOOL done;
+} CpioGzipBlock;
+
+typedef struct {
+    HANDLE hOutput;
+    HANDLE hInput;
+    HANDLE hPipe;
+    HANDLE dispatcher;
+    HANDLE threads[CPIO_GZIP_MAX_THREADS];
+    CpioDeflater* deflaters[CPIO_GZIP_MAX_THREADS];
+    UINT32 threadCount;
+    UINT32 started;
+    LONG volatile nextDeflater;
+    CpioGzipBlock* blocks;
+    UINT32 blockCount;
+    SRWLOCK lock;
+    CONDITION_VARIABLE workReady;
+    CONDITION_VARIABLE workDone;
+    UINT64 submitted;
+    UINT64 taken;
+    BOOL shutdown;
+    int level;
+    BOOL failed;
+    CpioError error;
+} CpioGzipWriter;
+
+CpioGzipWriter* CpioGzipWriterCreate(HANDLE hOutput, int level, UINT32 threadCount, CpioError* error);
+HANDLE CpioGzipWriterGetHandle(const CpioGzipWriter* writer);
+BOOL CpioGzipWriterFinish(CpioGzipWriter* writer, CpioError* error);
+void CpioGzipWriterDestroy(CpioGzipWriter* writer);
+
+typedef struct {
+    HANDLE hInput;
+    BOOL ownsInput;
+    HANDLE hPipe;
+    HANDLE hWrite;
+    HANDLE thread;
+    CpioInflater* inflater;
+    UINT64 members;
+    BOOL failed;
+    CpioError error;
+} CpioGzipReader;
+
+CpioGzipReader* CpioGzipReaderCreate(HANDLE hInput, BOOL takeOwnership, const BYTE* prefix, SIZE_T prefixLength,
+                                     CpioError* error);
+HANDLE CpioGzipReaderGetHandle(const CpioGzipReader* gzip);
+BOOL CpioGzipReaderFinish(CpioGzipReader* gzip, CpioError* error);
+void CpioGzipReaderDestroy(CpioGzipReader* gzip);
+
+#define CPIO_LZMA_DICT_SIZE (4 * 1024 * 1024)
+#define CPIO_LZMA_DICT_PROP 20
+#define CPIO_LZMA_HASH_BITS 18
+#define CPIO_LZMA_MAX_MATCH 273
+
+typedef struct {
+    UINT16 choice;
+    UINT16 choice2;
+    UINT16 low[16][8];
+    UINT16 mid[16][8];
+    UINT16 high[256];
+} CpioLzmaLengthModel;
+
+typedef struct {
+    UINT16 isMatch[12][16];
+    UINT16 isRep[12];
+    UINT16 isRepG0[12];
+    UINT16 isRepG1[12];
+    UINT16 isRepG2[12];
+    UINT16 isRep0Long[12][16];
+    UINT16 posSlot[4][64];
+    UINT16 posSpecial[114];
+    UINT16 align[16];
+    CpioLzmaLengthModel matchLength;
+    CpioLzmaLengthModel repLength;
+    UINT16 literal[16][0x300];
+    UINT32 lc;
+    UINT32 lp;
+    UINT32 pb;
+    UINT32 state;
+    UINT32 reps[4];
+} CpioLzmaModel;
+
+typedef struct {
+    UINT32 length;
+    UINT32 back;
+} CpioLzmaMatch;
+
+typedef struct {
+    UINT32* head;
+    UINT32* prev;
+    BYTE* chunk;
+    CpioLzmaModel model;
+    CpioLzmaMatch matches[2][CPIO_LZMA_MAX_MATCH];
+    UINT32 matchCount[2];
+    SIZE_T matchPos[2];
+    SIZE_T nextInsert;
+} CpioLzmaEncoder;
+
+CpioLzmaEncoder* CpioLzmaEncoderCreate(void);
+void CpioLzmaEncoderDestroy(CpioLzmaEncoder* encoder);
+SIZE_T CpioXzBound(SIZE_T length);
+SIZE_T CpioXzCompress(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T length, BYTE* output, SIZE_T outputSize);
+BOOL CpioXzDecompress(const BYTE* input, SIZE_T inputLength, BYTE* output, SIZE_T outputSize,
+                      SIZE_T* outputLength, CpioError* error);
+
+#define CPIO_PBZX_MAGIC "pbzx"
+#define CPIO_PBZX_CHUNK_SIZE (16 * 1024 * 1024)
+#define CPIO_PBZX_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+#define CPIO_PBZX_MAX_THREADS 64
+
+typedef struct {
+    BYTE* input;
+    SIZE_T inputLength;
+    BYTE* output;
+    SIZE_T outputLength;
+    UINT64 flags;
+    BOOL stored;
+    BOOL done;
+} CpioPbzxChunk;
+
+typedef struct {
+    HANDLE hOutput;
+    HANDLE hInput;
+    HANDLE hPipe;
+    HANDLE dispatcher;
+    HANDLE threads[CPIO_PBZX_MAX_THREADS];
+    CpioLzmaEncoder* encoders[CPIO_PBZX_MAX_THREADS];
+    UINT32 threadCount;
+    UINT32 started;
+    LONG volatile nextEncoder;
+    CpioPbzxChunk* chunks;
+    UINT32 chunkCount;
+    SRWLOCK lock;
+    CONDITION_VARIABLE workReady;
+    CONDITION_VARIABLE workDone;
+    UINT64 submitted;
+    UINT64 taken;
+    BOOL shutdown;
+    BOOL failed;
+    CpioError error;
+} CpioPbzxWriter;
+
+CpioPbzxWriter* CpioPbzxWriterCreate(HANDLE hOutput, UINT32 threadCount, CpioError* error);
+HANDLE CpioPbzxWriterGetHandle(const CpioPbzxWriter* writer);
+BOOL CpioPbzxWriterFinish(CpioPbzxWriter* writer, CpioError* error);
+void CpioPbzxWriterDestroy(CpioPbzxWriter* writer);
+
+typedef struct {
+    HANDLE hInput;
+    BOOL ownsInput;
+    HANDLE hPipe;
+    HANDLE hWrite;
+    HANDLE dispatcher;
+    HANDLE threads[CPIO_PBZX_MAX_THREADS];
+    UINT32 threadCount;
+    UINT32 started;
+    CpioPbzxChunk* chunks;
+    UINT32 chunkCount;
+    SIZE_T chunkSize;
+    SRWLOCK lock;
+    CONDITION_VARIABLE workReady;
+    CONDITION_VARIABLE workDone;
+    UINT64 submitted;
+    UINT64 taken;
+    BOOL shutdown;
+    BOOL failed;
+    CpioError error;
+} CpioPbzxReader;
+
+CpioPbzxReader* CpioPbzxReaderCreate(HANDLE hInput, BOOL takeOwnership, const BYTE* prefix, SIZE_T prefixLength,
+                                     UINT32 threadCount, CpioError* error);
+HANDLE CpioPbzxReaderGetHandle(const CpioPbzxReader* pbzx);
+BOOL CpioPbzxReaderFinish(CpioPbzxReader* pbzx, CpioError* error);
+void CpioPbzxReaderDestroy(CpioPbzxReader* pbzx);
+
+#define CPIO_ZSTD_DEFAULT_LEVEL 3
+#define CPIO_ZSTD_MAX_LEVEL 9
+#define CPIO_ZSTD_BLOCK_SIZE (128 * 1024)
+#define CPIO_ZSTD_JOB_SIZE (4 * 1024 * 1024)
+#define CPIO_ZSTD_HASH_BITS 17
+#define CPIO_ZSTD_CHAIN_LOG 20
+#define CPIO_ZSTD_MAX_WINDOW_LOG 27
+#define CPIO_ZSTD_MAX_THREADS 64
+
+typedef struct {
+    UINT32 litLength;
+    UINT32 matchLength;
+    UINT32 offBase;
+} CpioZstdSequence;
+
+typedef struct {
+    UINT32 position;
+    UINT32 length;
+    UINT32 offset;
+} CpioZstdMatch;
+
+typedef struct {
+    UINT32 chainLength;
+    UINT32 niceLength;
+    BOOL lazy;
+    UINT32* head;
+    UINT32* prev;
+    SIZE_T nextInsert;
+    CpioZstdSequence* sequences;
+    SIZE_T sequenceCount;
+    BYTE* literals;
+    SIZE_T literalCount;
+    BYTE* codes;
+} CpioZstdEncoder;
+
+CpioZstdEncoder* CpioZstdEncoderCreate(int level);
+void CpioZstdEncoderDestroy(CpioZstdEncoder* encoder);
+SIZE_T CpioZstdBound(SIZE_T length);
+SIZE_T CpioZstdCompressBlocks(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length,
+                              const CpioZstdMatch* matches, SIZE_T matchCount, UINT32* reps, BOOL last,
+                              BYTE* output, SIZE_T outputSize);
+SIZE_T CpioZstdCompressFrame(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length, BYTE* output,
+                             SIZE_T outputSize);
+
+typedef struct {
+    BYTE symbol;
+    BYTE bits;
+    UINT16 base;
+} CpioZstdFseEntry;
+
+typedef struct {
+    BYTE symbol;
+    BYTE bits;
+} CpioZstdHufEntry;
+
+typedef struct {
+    HANDLE hInput;
+    HANDLE hOutput;
+    BYTE* input;
+    SIZE_T inputPos;
+    SIZE_T inputLength;
+    BOOL inputEnd;
+    BYTE* window;
+    SIZE_T windowCapacity;
+    SIZE_T windowPos;
+    UINT64 windowSize;
+    BYTE* block;
+    BYTE* literals;
+    CpioZstdHufEntry huffman[2048];
+    UINT32 huffmanLog;
+    CpioZstdFseEntry tables[3][512];
+    UINT32 tableLogs[3];
+    BOOL tableValid[3];
+    UINT32 reps[3];
+    CpioXxh64 checksum;
+    UINT64 frameOut;
+    UINT64 frames;
+} CpioZstdDecoder;
+
+CpioZstdDecoder* CpioZstdDecoderCreate(HANDLE hInput, HANDLE hOutput);
+void CpioZstdDecoderDestroy(CpioZstdDecoder* decoder);
+BOOL CpioZstdDecoderPrime(CpioZstdDecoder* decoder, const BYTE* data, SIZE_T length);
+void CpioZstdDecoderReset(CpioZstdDecoder* decoder, HANDLE hOutput);
+BOOL CpioZstdDecoderRun(CpioZstdDecoder* decoder, CpioError* error);
+
+typedef enum {
+    CPIO_ZSTD_FRAMED,
+    CPIO_ZSTD_LONG,
+    CPIO_ZSTD_SEEKABLE
+} CpioZstdMode;
+
+typedef struct {
+    BYTE* input;
+    SIZE_T inputLength;
+    SIZE_T available;
+    BYTE* output;
+    SIZE_T outputLength;
+    CpioZstdMatch* matches;
+    SIZE_T matchCount;
+    UINT32 reps[3];
+    BOOL done;
+} CpioZstdJob;
+
+typedef struct {
+    UINT64 position;
+    UINT64 checksum;
+} CpioZstdLdmEntry;
+
+typedef struct {
+    UINT32 compressedSize;
+    UINT32 decompressedSize;
+    UINT32 checksum;
+} CpioZstdSeekEntry;
+
+typedef struct {
+    HANDLE hOutput;
+    HANDLE hInput;
+    HANDLE hPipe;
+    HANDLE dispatcher;
+    HANDLE threads[CPIO_ZSTD_MAX_THREADS];
+    CpioZstdEncoder* encoders[CPIO_ZSTD_MAX_THREADS];
+    UINT32 threadCount;
+    UINT32 started;
+    LONG volatile nextEncoder;
+    CpioZstdMode mode;
+    CpioZstdJob* jobs;
+    UINT32 jobCount;
+    BYTE* ring;
+    UINT32 segmentCount;
+    CpioZstdLdmEntry* ldm;
+    UINT64 gear[256];
+    UINT64 rolling;
+    CpioXxh64 checksum;
+    UINT64* boundaries;
+    SIZE_T boundaryCount;
+    SIZE_T boundaryCapacity;
+    SIZE_T boundaryTaken;
+    CpioZstdSeekEntry* seekEntries;
+    SIZE_T seekCount;
+    SIZE_T seekCapacity;
+    SRWLOCK lock;
+    CONDITION_VARIABLE workReady;
+    CONDITION_VARIABLE workDone;
+    UINT64 submitted;
+    UINT64 taken;
+    BOOL shutdown;
+    BOOL failed;
+    CpioError error;
+} CpioZstdWriter;
+
+CpioZstdWriter* CpioZstdWriterCreate(HANDLE hOutput, int level, UINT32 threadCount, CpioZstdMode mode,
+                                     CpioError* error);
+HANDLE CpioZstdWriterGetHandle(const CpioZstdWriter* writer);
+BOOL CpioZstdWriterMarkBoundary(CpioZstdWriter* writer, UINT64 offset);
+BOOL CpioZstdWriterFinish(CpioZstdWriter* writer, CpioError* error);
+void CpioZstdWriterDestroy(CpioZstdWriter* writer);
+
+typedef struct {
+    UINT64 compressedOffset;
+    UINT64 decompressedOffset;
+} CpioZstdFrame;
+
+typedef struct {
+    HANDLE hInput;
+    BOOL ownsInput;
+    HANDLE hPipe;
+    HANDLE hWrite;
+    HANDLE thread;
+    CpioZstdDecoder* decoder;
+    CpioZstdFrame* frames;
+    UINT32 frameCount;
+    BOOL failed;
+    CpioError error;
+} CpioZstdReader;
+
+CpioZstdReader* CpioZstdReaderCreate(HANDLE hInput, BOOL takeOwnership, const BYTE* prefix, SIZE_T prefixLength,
+                                     CpioError* error);
+HANDLE CpioZstdReaderGetHandle(const CpioZstdReader* zstd);
+UINT64 CpioZstdReaderFrameStart(const CpioZstdReader* zstd, UINT64 offset);
+BOOL CpioZstdReaderRestart(CpioZstdReader* zstd, UINT64 offset, UINT64* frameStart, CpioError* error);
+BOOL CpioZstdReaderFinish(CpioZstdReader* zstd, CpioError* error);
+void CpioZstdReaderDestroy(CpioZstdReader* zstd);
+
 #define CPIO_MAGIC_SIZE 6
 #define CPIO_MAX_NAME_LENGTH 4096
+#define CPIO_HEADER_MAX_SIZE (110 + CPIO_MAX_NAME_LENGTH + 3)
 
+#define CPIO_S_IFMT  0xF000
+#define CPIO_S_IFIFO 0x1000
+#define CPIO_S_IFCHR 0x2000
 #define CPIO_S_IFDIR 0x4000
+#define CPIO_S_IFBLK 0x6000
 #define CPIO_S_IFREG 0x8000
+#define CPIO_S_IFLNK 0xA000
+#define CPIO_S_IFSOCK 0xC000
+#define CPIO_S_ISUID 0x0800
+#define CPIO_S_ISGID 0x0400
+#define CPIO_S_ISVTX 0x0200
 #define CPIO_S_IRUSR 0x0100
 #define CPIO_S_IWUSR 0x0080
 #define CPIO_S_IXUSR 0x0040
@@ -104,6 +669,13 @@ CpioFormat CpioDetectFormat(HANDLE hFile, CpioError* error);
 #define CPIO_S_IWOTH 0x0002
 #define CPIO_S_IXOTH 0x0001
 
+typedef struct {
+    UINT32 mode;
+    UINT32 uid;
+    UINT32 gid;
+    UINT32 mtime;
+} CpioEntryMetadata;
+
 typedef struct {
     UINT32 inode;
     UINT32 mode;
@@ -117,28 +689,103 @@ typedef struct {
     UINT32 rdevMajor;
     UINT32 rdevMinor;
     UINT32 checksum;
+    BOOL crc;
     char name[CPIO_MAX_NAME_LENGTH];
 } CpioNewcHeader;
 
 BOOL CpioNewcHeaderRead(HANDLE hFile, CpioNewcHeader* header, CpioError* error);
 UINT64 CpioNewcHeaderWrite(HANDLE hFile, const CpioNewcHeader* header, CpioError* error);
+SIZE_T CpioNewcHeaderEncode(const CpioNewcHeader* header, BYTE* output);
+BOOL CpioNewcHeaderDecode(const BYTE* data, SIZE_T size, BOOL strict, CpioNewcHeader* header,
+                          SIZE_T* consumed, CpioError* error);
 
 typedef struct {
     HANDLE hFile;
     BOOL ownsHandle;
+    CpioSource source;
     UINT64 currentEntrySize;
     UINT64 currentEntryRead;
     SIZE_T entryDataPad;
     BOOL seenTrailer;
     BOOL firstEntry;
+    BOOL crc;
+    BOOL verify;
+    UINT32 expectedSum;
+    const char* nameView;
+    SIZE_T nameLength;
+    CpioNewcHeader current;
 } CpioNewcReader;
 
+typedef struct {
+    UINT32 inode;
+    UINT32 mode;
+    UINT32 uid;
+    UINT32 gid;
+    UINT32 nlink;
+    UINT32 mtime;
+    UINT64 fileSize;
+    UINT32 devMajor;
+    UINT32 devMinor;
+    UINT32 rdevMajor;
+    UINT32 rdevMinor;
+    UINT32 checksum;
+    const char* name;
+    SIZE_T nameLength;
+} CpioNewcEntryView;
+
 CpioNewcReader* CpioNewcReaderCreate(HANDLE hFile, BOOL takeOwnership);
+CpioNewcReader* CpioNewcReaderCreateFromMemory(const void* data, SIZE_T size, CpioError* error);
 void CpioNewcReaderDestroy(CpioNewcReader* reader);
 BOOL CpioNewcReaderReadNext(CpioNewcReader* reader, CpioNewcHeader* header, CpioError* error);
 DWORD CpioNewcReaderRead(CpioNewcReader* reader, void* buffer, DWORD bufferSize, CpioError* error);
+BOOL CpioNewcReaderCopyToHandle(CpioNewcReader* reader, HANDLE hOutFile, CpioError* error);
 BOOL CpioNewcReaderFinish(CpioNewcReader* reader, CpioError* error);
+BOOL CpioNewcReaderSeek(CpioNewcReader* reader, UINT64 headerOffset, CpioError* error);
 BOOL CpioNewcReaderIsAtEnd(const CpioNewcReader* reader);
+const char* CpioNewcReaderNameView(const CpioNewcReader* reader, SIZE_T* length);
+const BYTE* CpioNewcReaderDataView(CpioNewcReader* reader, UINT64* length, CpioError* error);
+BOOL CpioNewcReaderAdvance(CpioNewcReader* reader, CpioNewcEntryView* entry, CpioError* error);
+BOOL CpioNewcReaderNextSpan(CpioNewcReader* reader, const BYTE** data, SIZE_T* length, CpioError* error);
+
+#define CPIO_BOM_LEAF_ENTRIES 256
+#define CPIO_BOM_BLOCK_SIZE 4096
+
+typedef struct {
+    char* path;
+    const char* name;
+    UINT32 hash;
+    UINT32 next;
+    UINT32 parent;
+    UINT32 mode;
+    UINT32 uid;
+    UINT32 gid;
+    UINT32 mtime;
+    UINT32 nlink;
+    UINT64 inode;
+    UINT64 size;
+    UINT32 checksum;
+    UINT32 rdev;
+    char* linkTarget;
+    SIZE_T linkLength;
+} CpioBomEntry;
+
+typedef struct {
+    CpioBomEntry* entries;
+    UINT32 count;
+    UINT32 capacity;
+    UINT32* buckets;
+    UINT32 bucketCount;
+    UINT32 current;
+    UINT32 crc;
+    UINT64 length;
+    BOOL failed;
+} CpioBomWriter;
+
+CpioBomWriter* CpioBomWriterCreate(void);
+void CpioBomWriterDestroy(CpioBomWriter* bom);
+void CpioBomWriterAdd(CpioBomWriter* bom, const CpioNewcHeader* header);
+void CpioBomWriterUpdate(CpioBomWriter* bom, const void* data, SIZE_T length);
+BOOL CpioBomWriterFinish(CpioBomWriter* bom, HANDLE hFile, CpioError* error);
 
 typedef struct {
     HANDLE hFile;
@@ -149,16 +796,46 @@ typedef struct {
     UINT32 defaultModeFile;
     UINT32 defaultModeDir;
     BOOL autoWriteDirs;
+    BOOL writeToc;
+    BOOL crc;
     CpioHashSet* seenDirs;
+    BOOL detectLinks;
+    CpioLinkTable* links;
     UINT32 entryCount;
+    UINT64 offset;
+    CpioString* toc;
+    CpioDataCallback dataCallback;
+    void* dataContext;
+    CpioBomWriter* bom;
+    BYTE* memory;
+    SIZE_T memoryLength;
+    SIZE_T memoryCapacity;
+    BOOL inMemory;
+    BOOL growMemory;
     BOOL finished;
 } CpioNewcBuilder;
 
 CpioNewcBuilder* CpioNewcBuilderCreate(HANDLE hFile, BOOL takeOwnership);
+CpioNewcBuilder* CpioNewcBuilderCreateMemory(void* storage, SIZE_T capacity);
+const BYTE* CpioNewcBuilderGetMemory(const CpioNewcBuilder* builder, SIZE_T* length);
+BYTE* CpioNewcBuilderDetachMemory(CpioNewcBuilder* builder, SIZE_T* length);
+CpioNewcBuilder* CpioNewcBuilderCreateAppend(HANDLE hFile, BOOL takeOwnership, CpioError* error);
 void CpioNewcBuilderDestroy(CpioNewcBuilder* builder);
 void CpioNewcBuilderNextHeader(CpioNewcBuilder* builder, CpioNewcHeader* header);
 UINT64 CpioNewcBuilderAppendFileFromPath(CpioNewcBuilder* builder, const char* archivePath, 
-                                          const WCHAR* filePath, CpioError* error);
+                                          const WCHAR* filePath, BOOL* deferred, CpioError* error);
+UINT64 CpioNewcBuilderAppendLink(CpioNewcBuilder* builder, const char* archivePath, const WCHAR* filePath,
+                                 UINT32 dev, UINT64 id, UINT32 linkCount, BOOL* deferred, CpioError* error);
+UINT64 CpioNewcBuilderAppendData(CpioNewcBuilder* builder, const char* archivePath,
+                                 const CpioEntryMetadata* metadata, const void* data, SIZE_T length,
+                                 CpioError* error);
+UINT64 CpioNewcBuilderAppendStream(CpioNewcBuilder* builder, const char* archivePath,
+                                   const CpioEntryMetadata* metadata, UINT64 size, CpioPullCallback pull,
+                                   void* context, CpioError* error);
+UINT64 CpioNewcBuilderAppendDirectory(CpioNewcBuilder* builder, const char* archivePath,
+                                      const CpioEntryMetadata* metadata, CpioError* error);
+UINT64 CpioNewcBuilderAppendSymlink(CpioNewcBuilder* builder, const char* archivePath, const char* target,
+                                    const CpioEntryMetadata* metadata, CpioError* error);
 UINT64 CpioNewcBuilderEmitRootDirectory(CpioNewcBuilder* builder, CpioError* error);
 UINT64 CpioNewcBuilderFinish(CpioNewcBuilder* builder, CpioError* error);
 
@@ -177,10 +854,14 @@ typedef struct {
 
 BOOL CpioOdcHeaderRead(HANDLE hFile, CpioOdcHeader* header, CpioError* error);
 UINT64 CpioOdcHeaderWrite(HANDLE hFile, const CpioOdcHeader* header, CpioError* error);
+SIZE_T CpioOdcHeaderEncode(const CpioOdcHeader* header, BYTE* output);
+BOOL CpioOdcHeaderDecode(const BYTE* data, SIZE_T size, BOOL strict, CpioOdcHeader* header,
+                         SIZE_T* consumed, CpioError* error);
 
 typedef struct {
     HANDLE hFile;
     BOOL ownsHandle;
+    CpioSource source;
     UINT64 currentEntrySize;
     UINT64 currentEntryRead;
     BOOL seenTrailer;
@@ -191,7 +872,9 @@ CpioOdcReader* CpioOdcReaderCreate(HANDLE hFile, BOOL takeOwnership);
 void CpioOdcReaderDestroy(CpioOdcReader* reader);
 BOOL CpioOdcReaderReadNext(CpioOdcReader* reader, CpioOdcHeader* header, CpioError* error);
 DWORD CpioOdcReaderRead(CpioOdcReader* reader, void* buffer, DWORD bufferSize, CpioError* error);
+BOOL CpioOdcReaderCopyToHandle(CpioOdcReader* reader, HANDLE hOutFile, CpioError* error);
 BOOL CpioOdcReaderFinish(CpioOdcReader* reader, CpioError* error);
+BOOL CpioOdcReaderSeek(CpioOdcReader* reader, UINT64 headerOffset, CpioError* error);
 BOOL CpioOdcReaderIsAtEnd(const CpioOdcReader* reader);
 
 typedef struct {
@@ -204,18 +887,406 @@ typedef struct {
     UINT32 defaultModeDir;
     BOOL autoWriteDirs;
     CpioHashSet* seenDirs;
+    BOOL detectLinks;
+    CpioLinkTable* links;
     UINT32 entryCount;
+    CpioDataCallback dataCallback;
+    void* dataContext;
     BOOL finished;
 } CpioOdcBuilder;
 
 CpioOdcBuilder* CpioOdcBuilderCreate(HANDLE hFile, BOOL takeOwnership);
+CpioOdcBuilder* CpioOdcBuilderCreateAppend(HANDLE hFile, BOOL takeOwnership, CpioError* error);
 void CpioOdcBuilderDestroy(CpioOdcBuilder* builder);
 void CpioOdcBuilderNextHeader(CpioOdcBuilder* builder, CpioOdcHeader* header);
 UINT64 CpioOdcBuilderAppendFileFromPath(CpioOdcBuilder* builder, const char* archivePath,
-                                         const WCHAR* filePath, CpioError* error);
+                                         const WCHAR* filePath, BOOL* deferred, CpioError* error);
+UINT64 CpioOdcBuilderAppendLink(CpioOdcBuilder* builder, const char* archivePath, const WCHAR* filePath,
+                                UINT32 dev, UINT64 id, UINT32 linkCount, BOOL* deferred, CpioError* error);
+UINT64 CpioOdcBuilderAppendData(CpioOdcBuilder* builder, const char* archivePath,
+                                const CpioEntryMetadata* metadata, const void* data, SIZE_T length,
+                                CpioError* error);
+UINT64 CpioOdcBuilderAppendStream(CpioOdcBuilder* builder, const char* archivePath,
+                                  const CpioEntryMetadata* metadata, UINT64 size, CpioPullCallback pull,
+                                  void* context, CpioError* error);
+UINT64 CpioOdcBuilderAppendDirectory(CpioOdcBuilder* builder, const char* archivePath,
+                                     const CpioEntryMetadata* metadata, CpioError* error);
+UINT64 CpioOdcBuilderAppendSymlink(CpioOdcBuilder* builder, const char* archivePath, const char* target,
+                                   const CpioEntryMetadata* metadata, CpioError* error);
 UINT64 CpioOdcBuilderEmitRootDirectory(CpioOdcBuilder* builder, CpioError* error);
 UINT64 CpioOdcBuilderFinish(CpioOdcBuilder* builder, CpioError* error);
 
+typedef struct {
+    UINT32 inode;
+    UINT32 mode;
+    UINT32 uid;
+    UINT32 gid;
+    UINT32 nlink;
+    UINT32 mtime;
+    UINT64 fileSize;
+    UINT32 devMajor;
+    UINT32 devMinor;
+    UINT32 rdevMajor;
+    UINT32 rdevMinor;
+    UINT32 checksum;
+    UINT64 headerOffset;
+    UINT64 dataOffset;
+    char name[CPIO_MAX_NAME_LENGTH];
+} CpioEntry;
+
+typedef struct {
+    CpioFormat format;
+    CpioNewcReader* newc;
+    CpioOdcReader* odc;
+    CpioFormat compression;
+    CpioGzipReader* gzip;
+    CpioPbzxReader* pbzx;
+    CpioZstdReader* zstd;
+    UINT64 headerOffset;
+} CpioReader;
+
+void CpioEntryFromNewc(CpioEntry* entry, const CpioNewcHeader* header);
+void CpioEntryFromOdc(CpioEntry* entry, const CpioOdcHeader* header);
+CpioReader* CpioReaderCreate(HANDLE hFile, BOOL takeOwnership, CpioError* error);
+void CpioReaderDestroy(CpioReader* reader);
+CpioFormat CpioReaderGetFormat(const CpioReader* reader);
+CpioSource* CpioReaderGetSource(CpioReader* reader);
+BOOL CpioReaderReadNext(CpioReader* reader, CpioEntry* entry, CpioError* error);
+DWORD CpioReaderRead(CpioReader* reader, void* buffer, DWORD bufferSize, CpioError* error);
+BOOL CpioReaderCopyToHandle(CpioReader* reader, HANDLE hOutFile, CpioError* error);
+BOOL CpioReaderFinish(CpioReader* reader, CpioError* error);
+BOOL CpioReaderFinishStream(CpioReader* reader, CpioError* error);
+BOOL CpioReaderSeek(CpioReader* reader, UINT64 headerOffset, CpioError* error);
+UINT64 CpioReaderTell(CpioReader* reader, CpioError* error);
+BOOL CpioReaderIsAtEnd(const CpioReader* reader);
+BOOL CpioReaderIsSeekable(const CpioReader* reader);
+
+BOOL CpioLinkTableResolve(CpioLinkTable* table, const CpioEntry* entry, const WCHAR* path,
+                          BOOL* handled, CpioError* error);
+BOOL CpioLinkTableCommit(CpioLinkTable* table, const CpioEntry* entry, const WCHAR* path, CpioError* error);
+BOOL CpioLinkTableFinish(CpioLinkTable* table, CpioError* error);
+
+#define CPIO_TOC_NAME "TABLE-OF-CONTENTS!!!"
+#define CPIO_TOC_MAGIC "CPIOTOC2"
+#define CPIO_TOC_LOCATOR_MAGIC "CPIOTOCL"
+#define CPIO_TOC_LOCATOR_SIZE 32
+
+typedef struct {
+    UINT64 headerOffset;
+    UINT64 dataOffset;
+    UINT64 fileSize;
+    UINT32 mode;
+    UINT32 inode;
+    UINT32 devMajor;
+    UINT32 devMinor;
+    UINT32 nlink;
+    const char* name;
+} CpioTocEntry;
+
+typedef struct {
+    CpioTocEntry* entries;
+    SIZE_T count;
+    SIZE_T capacity;
+    CpioString* names;
+    UINT32* slots;
+    SIZE_T slotCount;
+    BOOL embedded;
+} CpioToc;
+
+typedef BOOL (*CpioScanCallback)(void* context, const CpioEntry* entry);
+
+BOOL CpioScanArchive(CpioReader* reader, UINT32 threadCount, CpioScanCallback callback,
+                     void* context, CpioError* error);
+BOOL CpioReaderResync(CpioReader* reader, UINT64* skippedStart, UINT64* skippedEnd, CpioError* error);
+
+BOOL CpioTocAppendRecord(CpioString* toc, const CpioTocEntry* record);
+void CpioTocBuildLocator(BYTE* locator, const CpioString* toc, UINT64 tocHeaderOffset, UINT64 locatorOffset);
+CpioToc* CpioTocCreate(CpioReader* reader, UINT32 threadCount, CpioError* error);
+void CpioTocDestroy(CpioToc* toc);
+SIZE_T CpioTocGetCount(const CpioToc* toc);
+const CpioTocEntry* CpioTocGetEntry(const CpioToc* toc, SIZE_T index);
+const CpioTocEntry* CpioTocFind(const CpioToc* toc, const char* name);
+BOOL CpioReaderOpenEntry(CpioReader* reader, const CpioTocEntry* tocEntry, CpioEntry* entry, CpioError* error);
+BOOL CpioReaderOpenByName(CpioReader* reader, const CpioToc* toc, const char* name,
+                          CpioEntry* entry, CpioError* error);
+
+typedef struct {
+    UINT64 offset;
+    UINT32 nextInode;
+    BOOL hasToc;
+} CpioAppendPoint;
+
+BOOL CpioReaderFindAppendPoint(CpioReader* reader, CpioHashSet* seenDirs, CpioString* toc,
+                               CpioAppendPoint* point, CpioError* error);
+
+#define CPIO_TAR_BLOCK_SIZE 512
+
+BOOL CpioConvert(CpioReader* reader, HANDLE hOutput, CpioFormat format, CpioError* error);
+
+#define CPIO_FS_BLOCK_SIZE (64 * 1024)
+#define CPIO_FS_DEFAULT_CACHE_SIZE (64 * 1024 * 1024)
+
+typedef struct CpioFsBlock {
+    UINT64 index;
+    DWORD length;
+    BYTE* data;
+    struct CpioFsBlock* hashNext;
+    struct CpioFsBlock* prev;
+    struct CpioFsBlock* next;
+} CpioFsBlock;
+
+typedef struct {
+    char* path;
+    UINT32 entryIndex;
+    UINT32* children;
+    SIZE_T childCount;
+    SIZE_T childCapacity;
+} CpioFsDir;
+
+typedef struct {
+    CpioReader* reader;
+    CpioToc* toc;
+    HANDLE hFile;
+    const BYTE* view;
+    UINT64 archiveSize;
+    CpioFsDir* dirs;
+    SIZE_T dirCount;
+    SIZE_T dirCapacity;
+    UINT32* dirSlots;
+    SIZE_T dirSlotCount;
+    UINT32* linkData;
+    SRWLOCK cacheLock;
+    CpioFsBlock** blockBuckets;
+    SIZE_T blockBucketCount;
+    CpioFsBlock* lruHead;
+    CpioFsBlock* lruTail;
+    SIZE_T blockCount;
+    SIZE_T maxBlocks;
+} CpioArchiveFs;
+
+typedef struct {
+    CpioArchiveFs* fs;
+    const CpioTocEntry* entry;
+    const CpioTocEntry* data;
+} CpioFsFile;
+
+typedef BOOL (*CpioFsReadDirCallback)(void* context, const char* name, const CpioTocEntry* entry);
+
+CpioArchiveFs* CpioArchiveFsCreate(HANDLE hFile, BOOL takeOwnership, SIZE_T cacheSize, CpioError* error);
+void CpioArchiveFsDestroy(CpioArchiveFs* fs);
+BOOL CpioArchiveFsStat(CpioArchiveFs* fs, const char* path, CpioEntry* entry, CpioError* error);
+BOOL CpioArchiveFsReadDir(CpioArchiveFs* fs, const char* path, CpioFsReadDirCallback callback,
+                          void* context, CpioError* error);
+BOOL CpioArchiveFsOpen(CpioArchiveFs* fs, const char* path, CpioFsFile* file, CpioError* error);
+DWORD CpioArchiveFsRead(const CpioFsFile* file, void* buffer, DWORD size, UINT64 offset, CpioError* error);
+BOOL CpioArchiveFsReadAt(CpioArchiveFs* fs, void* buffer, DWORD size, UINT64 offset, CpioError* error);
+
+#define CPIO_BATCH_MAX_THREADS 64
+#define CPIO_CLONE_CHUNK_SIZE (1024ULL * 1024 * 1024)
+
+typedef enum {
+    CPIO_JOB_CREATE,
+    CPIO_JOB_EXTRACT,
+    CPIO_JOB_LIST,
+    CPIO_JOB_COPY
+} CpioJobType;
+
+typedef struct CpioJob {
+    CpioJobType type;
+    CpioFormat format;
+    BOOL preserveMtime;
+    WCHAR* archivePath;
+    WCHAR* path;
+    BOOL succeeded;
+    CpioError error;
+    struct CpioJob* next;
+} CpioJob;
+
+typedef struct {
+    HANDLE threads[CPIO_BATCH_MAX_THREADS];
+    UINT32 threadCount;
+    SRWLOCK lock;
+    CONDITION_VARIABLE workReady;
+    CONDITION_VARIABLE workDone;
+    CpioJob* head;
+    CpioJob* tail;
+    SIZE_T outstanding;
+    SIZE_T failed;
+    BOOL shutdown;
+} CpioBatch;
+
+BOOL CpioJobRun(CpioJob* job);
+CpioBatch* CpioBatchCreate(UINT32 threadCount, CpioError* error);
+BOOL CpioBatchSubmit(CpioBatch* batch, CpioJob* job);
+SIZE_T CpioBatchWait(CpioBatch* batch);
+void CpioBatchDestroy(CpioBatch* batch);
+
+typedef struct CpioDirCacheEntry {
+    char* path;
+    UINT32 hash;
+    UINT64 fileSize;
+    UINT32 mtime;
+    DWORD attributes;
+    struct CpioDirCacheEntry* next;
+} CpioDirCacheEntry;
+
+typedef struct {
+    CpioDirCacheEntry** buckets;
+    SIZE_T bucketCount;
+    SIZE_T count;
+    CpioHashSet* loadedDirs;
+} CpioDirCache;
+
+CpioDirCache* CpioDirCacheCreate(void);
+void CpioDirCacheDestroy(CpioDirCache* cache);
+const CpioDirCacheEntry* CpioDirCacheLookup(CpioDirCache* cache, const char* path);
+
+typedef struct CpioManifestRecord {
+    char* path;
+    UINT32 hash;
+    UINT64 fileSize;
+    UINT32 mtime;
+    UINT64 inode;
+    BYTE digest[CPIO_SHA256_SIZE];
+    UINT32 crc32c;
+    BOOL hasCrc32c;
+    struct CpioManifestRecord* next;
+    struct CpioManifestRecord* nextInOrder;
+} CpioManifestRecord;
+
+typedef struct {
+    CpioManifestRecord** buckets;
+    SIZE_T bucketCount;
+    SIZE_T count;
+    CpioManifestRecord* first;
+    CpioManifestRecord* last;
+} CpioManifest;
+
+CpioManifest* CpioManifestCreate(void);
+void CpioManifestDestroy(CpioManifest* manifest);
+BOOL CpioManifestLoad(CpioManifest* manifest, const WCHAR* path, CpioError* error);
+BOOL CpioManifestSave(const CpioManifest* manifest, const WCHAR* path, CpioError* error);
+BOOL CpioManifestWrite(const CpioManifest* manifest, HANDLE hFile, CpioError* error);
+const CpioManifestRecord* CpioManifestFind(const CpioManifest* manifest, const char* path);
+BOOL CpioManifestAdd(CpioManifest* manifest, const char* path, UINT64 fileSize, UINT32 mtime,
+                     UINT64 inode, const BYTE* digest, const UINT32* crc32c);
+
+#define CPIO_HASHER_MAX_THREADS 64
+#define CPIO_HASHER_CHUNK_SIZE (256 * 1024)
+
+typedef struct CpioHashMember {
+    char* path;
+    UINT64 fileSize;
+    UINT32 mtime;
+    UINT64 inode;
+    BOOL linked;
+    UINT32 linkDev;
+    UINT64 linkId;
+    WCHAR* source;
+    CpioSha256 sha;
+    UINT32 crc32c;
+    BYTE digest[CPIO_SHA256_SIZE];
+    BOOL busy;
+    BOOL discarded;
+    struct CpioHashMember* next;
+} CpioHashMember;
+
+typedef struct {
+    CpioHashMember* member;
+    BYTE* data;
+    SIZE_T length;
+    BOOL last;
+    BOOL running;
+    BOOL done;
+} CpioHashChunk;
+
+typedef struct {
+    HANDLE threads[CPIO_HASHER_MAX_THREADS];
+    UINT32 started;
+    CpioHashChunk* chunks;
+    UINT32 chunkCount;
+    UINT64 submitted;
+    UINT64 retired;
+    BOOL filling;
+    CpioHashMember* first;
+    CpioHashMember* last;
+    CpioHashMember* open;
+    SRWLOCK lock;
+    CONDITION_VARIABLE workReady;
+    CONDITION_VARIABLE workDone;
+    BOOL shutdown;
+    BOOL failed;
+} CpioHasher;
+
+CpioHasher* CpioHasherCreate(UINT32 threadCount, CpioError* error);
+void CpioHasherBegin(CpioHasher* hasher, const char* path, UINT32 mtime, UINT64 inode);
+void CpioHasherLink(CpioHasher* hasher, UINT32 dev, UINT64 id, const WCHAR* source);
+void CpioHasherUpdate(CpioHasher* hasher, const void* data, SIZE_T length);
+void CpioHasherCallback(void* context, const void* data, SIZE_T length);
+void CpioHasherEnd(CpioHasher* hasher, BOOL keep);
+BOOL CpioHasherFinish(CpioHasher* hasher, CpioManifest* manifest, CpioError* error);
+void CpioHasherDestroy(CpioHasher* hasher);
+
+#define CPIO_DEDUPE_PREFIX_SIZE (64 * 1024)
+#define CPIO_DEDUPE_MAX_THREADS 64
+#define CPIO_DEDUPE_DEV 0xFFFFFFFF
+
+typedef struct {
+    WCHAR* path;
+    UINT64 fileSize;
+    UINT64 prefixHash;
+    BYTE digest[CPIO_SHA256_SIZE];
+    UINT32 group;
+    UINT32 groupSize;
+    BOOL candidate;
+} CpioDedupeFile;
+
+typedef struct {
+    CpioDedupeFile* files;
+    SIZE_T count;
+    SIZE_T capacity;
+    UINT32* slots;
+    SIZE_T slotCount;
+    UINT32* work;
+    SIZE_T workCount;
+    LONG volatile nextWork;
+    int phase;
+} CpioDedupe;
+
+CpioDedupe* CpioDedupeCreate(void);
+void CpioDedupeDestroy(CpioDedupe* dedupe);
+BOOL CpioDedupeAdd(CpioDedupe* dedupe, const WCHAR* path);
+BOOL CpioDedupeRun(CpioDedupe* dedupe, UINT32 threadCount, CpioError* error);
+
+typedef struct {
+    BYTE type;
+    BYTE literal;
+    UINT32 argument;
+} CpioMatchState;
+
+typedef struct {
+    CpioMatchState* states;
+    SIZE_T stateCount;
+    SIZE_T stateCapacity;
+    BYTE* classes;
+    SIZE_T classCount;
+    UINT32* starts;
+    SIZE_T startCount;
+    SIZE_T includeCount;
+    SIZE_T excludeCount;
+    UINT32* current;
+    UINT32* next;
+    UINT32* marks;
+    SIZE_T scratchCapacity;
+    UINT32 generation;
+} CpioMatcher;
+
+CpioMatcher* CpioMatcherCreate(void);
+void CpioMatcherDestroy(CpioMatcher* matcher);
+BOOL CpioMatcherAddPattern(CpioMatcher* matcher, const char* pattern, BOOL exclude, CpioError* error);
+BOOL CpioMatcherIsEmpty(const CpioMatcher* matcher);
+BOOL CpioMatcherMatch(CpioMatcher* matcher, const char* name);
+
 BOOL CpioNormalizeArchivePath(const char* path, char* output, SIZE_T outputSize);
 WCHAR* CpioStringToWide(const char* str);
 char* CpioWideToString(const WCHAR* wstr);
@@ -0,0 +1,636 @@
+#include "cpio.h"
+
+static WCHAR* JoinPath(const WCHAR* root, const char* relative) {
+    WCHAR* wideRelative = CpioStringToWide(relative);
+    if (!wideRelative) return NULL;
+
+    SIZE_T rootLength = 0;
+    while (root[rootLength]) rootLength++;
+    while (rootLength > 0 && (root[rootLength - 1] == L'\\' || root[rootLength - 1] == L'/')) rootLength--;
+
+    SIZE_T relativeLength = 0;
+    while (wideRelative[relativeLength]) relativeLength++;
+
+    WCHAR* path = (WCHAR*)CpioAlloc((rootLength + relativeLength + 2) * sizeof(WCHAR));
+    if (path) {
+        CpioCopyMemory(path, root, rootLength * sizeof(WCHAR));
+        SIZE_T pos = rootLength;
+
+        if (relativeLength > 0) {
+            path[pos++] = L'\\';
+            for (SIZE_T i = 0; i < relativeLength; i++) {
+                path[pos++] = (wideRelative[i] == L'/') ? L'\\' : wideRelative[i];
+            }
+        }
+        path[pos] = L'\0';
+    }
+
+    CpioFree(wideRelative);
+    return path;
+}
+
+static void CreateDirectoryTree(WCHAR* path, BOOL includeLast) {
+    SIZE_T length = 0;
+    while (path[length]) length++;
+
+    for (SIZE_T i = 1; i < length; i++) {
+        if (path[i] == L'\\' && path[i - 1] != L':') {
+            path[i] = L'\0';
+            CreateDirectoryW(path, NULL);
+            path[i] = L'\\';
+        }
+    }
+
+    if (includeLast) {
+        CreateDirectoryW(path, NULL);
+    }
+}
+
+static BOOL IsSeparator(char c) {
+    return c == '/' || c == '\\';
+}
+
+static const char* MemberPath(const char* name) {
+    while (name[0] == '.' && IsSeparator(name[1])) name += 2;
+    while (IsSeparator(name[0])) name++;
+
+    if (name[0] == '\0' || CpioStringCompare(name, ".") == 0 ||
+        CpioStringCompare(name, CPIO_TOC_NAME) == 0) {
+        return NULL;
+    }
+
+    for (const char* p = name; *p;) {
+        if (p[0] == '.' && p[1] == '.' && (IsSeparator(p[2]) || p[2] == '\0')) return NULL;
+        while (*p && !IsSeparator(*p)) {
+            if (*p == ':') return NULL;
+            p++;
+        }
+        while (IsSeparator(*p)) p++;
+    }
+
+    return name;
+}
+
+static void SetMemberMtime(HANDLE hFile, UINT32 mtime) {
+    ULARGE_INTEGER uli;
+    uli.QuadPart = ((UINT64)mtime + 11644473600ULL) * 10000000ULL;
+
+    FILETIME ft;
+    ft.dwLowDateTime = uli.LowPart;
+    ft.dwHighDateTime = uli.HighPart;
+
+    SetFileTime(hFile, NULL, NULL, &ft);
+}
+
+static BOOL ExtractMember(CpioJob* job, CpioReader* reader, CpioLinkTable* links, const CpioEntry* entry) {
+    const char* name = MemberPath(entry->name);
+    if (!name) return TRUE;
+
+    WCHAR* path = JoinPath(job->path, name);
+    if (!path) {
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    if ((entry->mode & CPIO_S_IFMT) == CPIO_S_IFDIR) {
+        CreateDirectoryTree(path, TRUE);
+        CpioFree(path);
+        return TRUE;
+    }
+
+    CreateDirectoryTree(path, FALSE);
+
+    BOOL linked = FALSE;
+    if (!CpioLinkTableResolve(links, entry, path, &linked, &job->error) || linked) {
+        CpioFree(path);
+        return linked;
+    }
+
+    HANDLE hOutFile = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hOutFile == INVALID_HANDLE_VALUE) {
+        CpioFree(path);
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to create output file");
+        return FALSE;
+    }
+
+    BOOL ok = CpioReaderCopyToHandle(reader, hOutFile, &job->error);
+    if (ok && job->preserveMtime) {
+        SetMemberMtime(hOutFile, entry->mtime);
+    }
+
+    CloseHandle(hOutFile);
+    if (!ok) {
+        DeleteFileW(path);
+    }
+
+    ok = ok && CpioLinkTableCommit(links, entry, path, &job->error);
+    CpioFree(path);
+    return ok;
+}
+
+static HANDLE OpenArchive(CpioJob* job) {
+    HANDLE hArchive = CreateFileW(job->archivePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hArchive == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to open archive");
+    }
+    return hArchive;
+}
+
+static BOOL FinishReading(CpioJob* job, CpioReader* reader, BOOL ok) {
+    if (ok && !CpioReaderIsAtEnd(reader)) {
+        if (job->error.code == CPIO_SUCCESS) {
+            CpioErrorSet(&job->error, CPIO_ERROR_IO, "Archive ended before trailer");
+        }
+        ok = FALSE;
+    }
+
+    CpioReaderDestroy(reader);
+    return ok;
+}
+
+static BOOL RunExtract(CpioJob* job) {
+    HANDLE hArchive = OpenArchive(job);
+    if (hArchive == INVALID_HANDLE_VALUE) return FALSE;
+
+    CpioReader* reader = CpioReaderCreate(hArchive, TRUE, &job->error);
+    if (!reader) {
+        CloseHandle(hArchive);
+        return FALSE;
+    }
+
+    WCHAR* root = JoinPath(job->path, "");
+    if (!root) {
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioReaderDestroy(reader);
+        return FALSE;
+    }
+    CreateDirectoryTree(root, TRUE);
+    CpioFree(root);
+
+    CpioLinkTable* links = CpioLinkTableCreate();
+    if (!links) {
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioReaderDestroy(reader);
+        return FALSE;
+    }
+
+    CpioEntry entry;
+    BOOL ok = TRUE;
+
+    while (ok && CpioReaderReadNext(reader, &entry, &job->error)) {
+        ok = ExtractMember(job, reader, links, &entry);
+    }
+
+    ok = ok && CpioLinkTableFinish(links, &job->error);
+    CpioLinkTableDestroy(links);
+    return FinishReading(job, reader, ok);
+}
+
+static BOOL RunList(CpioJob* job) {
+    HANDLE hArchive = OpenArchive(job);
+    if (hArchive == INVALID_HANDLE_VALUE) return FALSE;
+
+    CpioReader* reader = CpioReaderCreate(hArchive, TRUE, &job->error);
+    if (!reader) {
+        CloseHandle(hArchive);
+        return FALSE;
+    }
+
+    HANDLE hOutput = CreateFileW(job->path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hOutput == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to create listing file");
+        CpioReaderDestroy(reader);
+        return FALSE;
+    }
+
+    CpioWriter writer;
+    if (!CpioWriterInit(&writer, hOutput, 0)) {
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CloseHandle(hOutput);
+        CpioReaderDestroy(reader);
+        return FALSE;
+    }
+
+    CpioSourceSetHeadersOnly(CpioReaderGetSource(reader), TRUE);
+
+    CpioEntry entry;
+    BOOL ok = TRUE;
+
+    while (ok && CpioReaderReadNext(reader, &entry, &job->error)) {
+        if (CpioStringCompare(entry.name, CPIO_TOC_NAME) == 0) continue;
+
+        ok = CpioWriterWriteString(&writer, entry.name, &job->error) &&
+             CpioWriterWrite(&writer, "\r\n", 2, &job->error);
+    }
+
+    ok = FinishReading(job, reader, ok);
+    ok = CpioWriterFlush(&writer, ok ? &job->error : NULL) && ok;
+
+    CpioWriterRelease(&writer);
+    CloseHandle(hOutput);
+    return ok;
+}
+
+static BOOL AppendFile(CpioJob* job, void* builder, const char* archivePath, const WCHAR* filePath) {
+    BOOL deferred = FALSE;
+    UINT64 written = (job->format == CPIO_FORMAT_ODC)
+        ? CpioOdcBuilderAppendFileFromPath((CpioOdcBuilder*)builder, archivePath, filePath, &deferred, &job->error)
+        : CpioNewcBuilderAppendFileFromPath((CpioNewcBuilder*)builder, archivePath, filePath, &deferred, &job->error);
+    return written > 0 || deferred;
+}
+
+static BOOL AppendTree(CpioJob* job, void* builder) {
+    CpioStringList* pending = CpioStringListCreate();
+    if (!pending || !CpioStringListAdd(pending, "")) {
+        CpioStringListDestroy(pending);
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    CpioString* child = CpioStringCreate();
+    BOOL ok = child != NULL;
+
+    for (SIZE_T i = 0; ok && i < pending->count; i++) {
+        const char* directory = pending->items[i];
+
+        CpioStringSet(child, directory, CpioStringLength(directory));
+        if (child->length > 0) CpioStringAppendChar(child, '/');
+        CpioStringAppendChar(child, '*');
+
+        WCHAR* pattern = JoinPath(job->path, child->data);
+        if (!pattern) {
+            ok = FALSE;
+            break;
+        }
+
+        WIN32_FIND_DATAW findData;
+        HANDLE hFind = FindFirstFileW(pattern, &findData);
+        CpioFree(pattern);
+
+        if (hFind == INVALID_HANDLE_VALUE) {
+            CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to enumerate source directory");
+            CpioStringListDestroy(pending);
+            CpioStringDestroy(child);
+            return FALSE;
+        }
+
+        do {
+            const WCHAR* fileName = findData.cFileName;
+            if (fileName[0] == L'.' && (fileName[1] == L'\0' || (fileName[1] == L'.' && fileName[2] == L'\0'))) {
+                continue;
+            }
+
+            char* utf8Name = CpioWideToString(fileName);
+            if (!utf8Name) {
+                ok = FALSE;
+                break;
+            }
+
+            CpioStringSet(child, directory, CpioStringLength(directory));
+            if (child->length > 0) CpioStringAppendChar(child, '/');
+            CpioStringAppend(child, utf8Name, CpioStringLength(utf8Name));
+            CpioFree(utf8Name);
+
+            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                ok = CpioStringListAdd(pending, child->data);
+                continue;
+            }
+
+            WCHAR* filePath = JoinPath(job->path, child->data);
+            if (!filePath) {
+                ok = FALSE;
+                break;
+            }
+
+            if (!AppendFile(job, builder, child->data, filePath)) {
+                CpioFree(filePath);
+                FindClose(hFind);
+                CpioStringListDestroy(pending);
+                CpioStringDestroy(child);
+                return FALSE;
+            }
+            CpioFree(filePath);
+        } while (ok && FindNextFileW(hFind, &findData));
+
+        FindClose(hFind);
+    }
+
+    if (!ok) {
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+    }
+
+    CpioStringListDestroy(pending);
+    CpioStringDestroy(child);
+    return ok;
+}
+
+static BOOL RunCreate(CpioJob* job) {
+    HANDLE hOutput = CreateFileW(job->archivePath, GENERIC_WRITE, 0, NULL,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hOutput == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to create archive");
+        return FALSE;
+    }
+
+    BOOL ok;
+
+    if (job->format == CPIO_FORMAT_ODC) {
+        CpioOdcBuilder* builder = CpioOdcBuilderCreate(hOutput, TRUE);
+        if (!builder) {
+            CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Failed to create ODC builder");
+            CloseHandle(hOutput);
+            return FALSE;
+        }
+
+        ok = CpioOdcBuilderEmitRootDirectory(builder, &job->error) > 0 &&
+             AppendTree(job, builder) &&
+             CpioOdcBuilderFinish(builder, &job->error) > 0;
+        CpioOdcBuilderDestroy(builder);
+    } else {
+        CpioNewcBuilder* builder = CpioNewcBuilderCreate(hOutput, TRUE);
+        if (!builder) {
+            CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Failed to create NewC builder");
+            CloseHandle(hOutput);
+            return FALSE;
+        }
+
+        ok = CpioNewcBuilderEmitRootDirectory(builder, &job->error) > 0 &&
+             AppendTree(job, builder) &&
+             CpioNewcBuilderFinish(builder, &job->error) > 0;
+        CpioNewcBuilderDestroy(builder);
+    }
+
+    return ok;
+}
+
+static BOOL CloneExtents(HANDLE hSource, HANDLE hTarget, UINT64 size) {
+    FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity;
+    DWORD returned;
+
+    if (!DeviceIoControl(hSource, FSCTL_GET_INTEGRITY_INFORMATION, NULL, 0,
+                         &integrity, sizeof(integrity), &returned, NULL) ||
+        integrity.ClusterSizeInBytes == 0) {
+        return FALSE;
+    }
+
+    FSCTL_SET_INTEGRITY_INFORMATION_BUFFER targetIntegrity;
+    targetIntegrity.ChecksumAlgorithm = integrity.ChecksumAlgorithm;
+    targetIntegrity.Reserved = 0;
+    targetIntegrity.Flags = integrity.Flags;
+
+    if (!DeviceIoControl(hTarget, FSCTL_SET_INTEGRITY_INFORMATION, &targetIntegrity,
+                         sizeof(targetIntegrity), NULL, 0, &returned, NULL)) {
+        return FALSE;
+    }
+
+    UINT64 clusterMask = (UINT64)integrity.ClusterSizeInBytes - 1;
+    UINT64 rounded = (size + clusterMask) & ~clusterMask;
+
+    DUPLICATE_EXTENTS_DATA extents;
+    extents.FileHandle = hSource;
+
+    for (UINT64 offset = 0; offset < rounded; offset += CPIO_CLONE_CHUNK_SIZE) {
+        UINT64 count = rounded - offset;
+        if (count > CPIO_CLONE_CHUNK_SIZE) count = CPIO_CLONE_CHUNK_SIZE;
+
+        extents.SourceFileOffset.QuadPart = (LONGLONG)offset;
+        extents.TargetFileOffset.QuadPart = (LONGLONG)offset;
+        extents.ByteCount.QuadPart = (LONGLONG)count;
+
+        if (!DeviceIoControl(hTarget, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &extents, sizeof(extents),
+                             NULL, 0, &returned, NULL)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL CopyExtents(CpioJob* job, HANDLE hSource, HANDLE hTarget) {
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CpioErrorSet(&job->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    LARGE_INTEGER start;
+    start.QuadPart = 0;
+    BOOL ok = SetFilePointerEx(hSource, start, NULL, FILE_BEGIN) &&
+              SetFilePointerEx(hTarget, start, NULL, FILE_BEGIN);
+
+    for (;;) {
+        DWORD bytesRead;
+        if (!ok || !ReadFile(hSource, buffer, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL)) {
+            CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to read source file");
+            ok = FALSE;
+            break;
+        }
+
+        if (bytesRead == 0) break;
+
+        DWORD bytesWritten;
+        if (!WriteFile(hTarget, buffer, bytesRead, &bytesWritten, NULL) || bytesWritten != bytesRead) {
+            CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to write file data");
+            ok = FALSE;
+            break;
+        }
+    }
+
+    CpioBufferPoolRelease(buffer);
+    return ok && SetEndOfFile(hTarget);
+}
+
+static BOOL RunCopy(CpioJob* job) {
+    HANDLE hSource = CreateFileW(job->archivePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                 OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hSource == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to open source file");
+        return FALSE;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(hSource, &info)) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to query source file");
+        CloseHandle(hSource);
+        return FALSE;
+    }
+
+    CreateDirectoryTree(job->path, FALSE);
+
+    HANDLE hTarget = CreateFileW(job->path, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hTarget == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to create output file");
+        CloseHandle(hSource);
+        return FALSE;
+    }
+
+    UINT64 size = ((UINT64)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    DWORD returned;
+
+    if (info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) {
+        DeviceIoControl(hTarget, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &returned, NULL);
+    }
+
+    FILE_END_OF_FILE_INFO endOfFile;
+    endOfFile.EndOfFile.QuadPart = (LONGLONG)size;
+
+    BOOL ok = SetFileInformationByHandle(hTarget, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile));
+    if (!ok) {
+        CpioErrorSet(&job->error, CPIO_ERROR_IO, "Failed to preallocate output file");
+    }
+    else if (size == 0 || !CloneExtents(hSource, hTarget, size)) {
+        ok = CopyExtents(job, hSource, hTarget);
+    }
+
+    if (ok && job->preserveMtime) {
+        SetFileTime(hTarget, NULL, NULL, &info.ftLastWriteTime);
+    }
+
+    CloseHandle(hTarget);
+    CloseHandle(hSource);
+    return ok;
+}
+
+BOOL CpioJobRun(CpioJob* job) {
+    if (!job || !job->archivePath || !job->path) {
+        if (job) CpioErrorSet(&job->error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    CpioZeroMemory(&job->error, sizeof(CpioError));
+
+    switch (job->type) {
+    case CPIO_JOB_CREATE:
+        job->succeeded = RunCreate(job);
+        break;
+    case CPIO_JOB_EXTRACT:
+        job->succeeded = RunExtract(job);
+        break;
+    case CPIO_JOB_LIST:
+        job->succeeded = RunList(job);
+        break;
+    case CPIO_JOB_COPY:
+        job->succeeded = RunCopy(job);
+        break;
+    default:
+        CpioErrorSet(&job->error, CPIO_ERROR_INVALID_PARAMETER, "Unknown job type");
+        job->succeeded = FALSE;
+        break;
+    }
+
+    return job->succeeded;
+}
+
+static DWORD WINAPI BatchWorker(LPVOID parameter) {
+    CpioBatch* batch = (CpioBatch*)parameter;
+
+    AcquireSRWLockExclusive(&batch->lock);
+
+    for (;;) {
+        while (!batch->head && !batch->shutdown) {
+            SleepConditionVariableSRW(&batch->workReady, &batch->lock, INFINITE, 0);
+        }
+
+        CpioJob* job = batch->head;
+        if (!job) break;
+
+        batch->head = job->next;
+        if (!batch->head) batch->tail = NULL;
+        job->next = NULL;
+
+        ReleaseSRWLockExclusive(&batch->lock);
+        BOOL ok = CpioJobRun(job);
+        AcquireSRWLockExclusive(&batch->lock);
+
+        if (!ok) batch->failed++;
+        if (--batch->outstanding == 0) {
+            WakeAllConditionVariable(&batch->workDone);
+        }
+    }
+
+    ReleaseSRWLockExclusive(&batch->lock);
+    return 0;
+}
+
+CpioBatch* CpioBatchCreate(UINT32 threadCount, CpioError* error) {
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    if (threadCount == 0) threadCount = 1;
+    if (threadCount > CPIO_BATCH_MAX_THREADS) threadCount = CPIO_BATCH_MAX_THREADS;
+
+    CpioBatch* batch = (CpioBatch*)CpioAlloc(sizeof(CpioBatch));
+    if (!batch) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    InitializeSRWLock(&batch->lock);
+    InitializeConditionVariable(&batch->workReady);
+    InitializeConditionVariable(&batch->workDone);
+
+    for (UINT32 i = 0; i < threadCount; i++) {
+        HANDLE hThread = CreateThread(NULL, 0, BatchWorker, batch, 0, NULL);
+        if (!hThread) break;
+        batch->threads[batch->threadCount++] = hThread;
+    }
+
+    if (batch->threadCount == 0) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start worker threads");
+        CpioFree(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+BOOL CpioBatchSubmit(CpioBatch* batch, CpioJob* job) {
+    if (!batch || !job) return FALSE;
+
+    job->next = NULL;
+    job->succeeded = FALSE;
+
+    AcquireSRWLockExclusive(&batch->lock);
+
+    if (batch->tail) batch->tail->next = job;
+    else batch->head = job;
+    batch->tail = job;
+    batch->outstanding++;
+
+    ReleaseSRWLockExclusive(&batch->lock);
+    WakeConditionVariable(&batch->workReady);
+    return TRUE;
+}
+
+SIZE_T CpioBatchWait(CpioBatch* batch) {
+    if (!batch) return 0;
+
+    AcquireSRWLockExclusive(&batch->lock);
+    while (batch->outstanding > 0) {
+        SleepConditionVariableSRW(&batch->workDone, &batch->lock, INFINITE, 0);
+    }
+    SIZE_T failed = batch->failed;
+    ReleaseSRWLockExclusive(&batch->lock);
+
+    return failed;
+}
+
+void CpioBatchDestroy(CpioBatch* batch) {
+    if (!batch) return;
+
+    AcquireSRWLockExclusive(&batch->lock);
+    batch->shutdown = TRUE;
+    ReleaseSRWLockExclusive(&batch->lock);
+    WakeAllConditionVariable(&batch->workReady);
+
+    for (UINT32 i = 0; i < batch->threadCount; i++) {
+        WaitForSingleObject(batch->threads[i], INFINITE);
+        CloseHandle(batch->threads[i]);
+    }
+
+    CpioFree(batch);
+}
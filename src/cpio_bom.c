@@ -0,0 +1,477 @@
+#include "cpio.h"
+
+#define BOM_HEADER_SIZE 512
+#define BOM_TREE_SIZE 21
+#define BOM_PATHS_HEADER_SIZE 12
+#define BOM_PATH_INFO_SIZE 31
+
+#define BOM_TYPE_FILE 1
+#define BOM_TYPE_DIR 2
+#define BOM_TYPE_LINK 3
+#define BOM_TYPE_DEVICE 4
+
+typedef struct {
+    CpioWriter writer;
+    UINT32* pointers;
+    UINT32 count;
+    UINT32 capacity;
+    UINT32 offset;
+    CpioError* error;
+    BOOL ok;
+} BomFile;
+
+static void PutBigEndian16(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)(value >> 8);
+    p[1] = (BYTE)value;
+}
+
+static void PutBigEndian32(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)(value >> 24);
+    p[1] = (BYTE)(value >> 16);
+    p[2] = (BYTE)(value >> 8);
+    p[3] = (BYTE)value;
+}
+
+static UINT32 HashPath(const char* path, SIZE_T length) {
+    UINT32 hash = 2166136261u;
+    for (SIZE_T i = 0; i < length; i++) {
+        hash ^= (BYTE)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+CpioBomWriter* CpioBomWriterCreate(void) {
+    CpioBomWriter* bom = (CpioBomWriter*)CpioAlloc(sizeof(CpioBomWriter));
+    if (!bom) return NULL;
+
+    bom->bucketCount = 1024;
+    bom->buckets = (UINT32*)CpioAlloc(sizeof(UINT32) * bom->bucketCount);
+    if (!bom->buckets) {
+        CpioFree(bom);
+        return NULL;
+    }
+
+    return bom;
+}
+
+void CpioBomWriterDestroy(CpioBomWriter* bom) {
+    if (!bom) return;
+
+    for (UINT32 i = 0; i < bom->count; i++) {
+        CpioFree(bom->entries[i].path);
+        if (bom->entries[i].linkTarget) CpioFree(bom->entries[i].linkTarget);
+    }
+
+    if (bom->entries) CpioFree(bom->entries);
+    CpioFree(bom->buckets);
+    CpioFree(bom);
+}
+
+static UINT32 FindEntry(const CpioBomWriter* bom, const char* path, SIZE_T length, UINT32 hash) {
+    UINT32 id = bom->buckets[hash & (bom->bucketCount - 1)];
+
+    while (id) {
+        const CpioBomEntry* entry = &bom->entries[id - 1];
+        if (entry->hash == hash && CpioStringLength(entry->path) == length &&
+            CpioCompareMemory(entry->path, path, length) == 0) {
+            return id;
+        }
+        id = entry->next;
+    }
+    return 0;
+}
+
+static void Grow(CpioBomWriter* bom) {
+    UINT32 newCount = bom->bucketCount * 2;
+    UINT32* newBuckets = (UINT32*)CpioAlloc(sizeof(UINT32) * newCount);
+    if (!newBuckets) return;
+
+    for (UINT32 i = bom->count; i > 0; i--) {
+        CpioBomEntry* entry = &bom->entries[i - 1];
+        UINT32 slot = entry->hash & (newCount - 1);
+        entry->next = newBuckets[slot];
+        newBuckets[slot] = i;
+    }
+
+    CpioFree(bom->buckets);
+    bom->buckets = newBuckets;
+    bom->bucketCount = newCount;
+}
+
+static UINT32 AddPath(CpioBomWriter* bom, const char* path, SIZE_T length);
+
+static UINT32 ParentId(CpioBomWriter* bom, const char* path, SIZE_T length, SIZE_T* nameStart) {
+    SIZE_T slash = length;
+    while (slash > 0 && path[slash - 1] != '/') slash--;
+
+    *nameStart = slash;
+    if (slash <= 1) return 0;
+    return AddPath(bom, path, slash - 1);
+}
+
+static UINT32 AddPath(CpioBomWriter* bom, const char* path, SIZE_T length) {
+    UINT32 hash = HashPath(path, length);
+    UINT32 id = FindEntry(bom, path, length, hash);
+    if (id) return id;
+
+    SIZE_T nameStart;
+    UINT32 parent = ParentId(bom, path, length, &nameStart);
+    if (bom->failed) return 0;
+
+    if (bom->count == bom->capacity) {
+        UINT32 capacity = bom->capacity ? bom->capacity * 2 : 256;
+        CpioBomEntry* entries = (CpioBomEntry*)CpioRealloc(bom->entries, sizeof(CpioBomEntry) * capacity);
+        if (!entries) {
+            bom->failed = TRUE;
+            return 0;
+        }
+        bom->entries = entries;
+        bom->capacity = capacity;
+    }
+
+    char* copy = (char*)CpioAlloc(length + 1);
+    if (!copy) {
+        bom->failed = TRUE;
+        return 0;
+    }
+    CpioCopyMemory(copy, path, length);
+
+    CpioBomEntry* entry = &bom->entries[bom->count++];
+    CpioZeroMemory(entry, sizeof(CpioBomEntry));
+    entry->path = copy;
+    entry->name = copy + nameStart;
+    entry->hash = hash;
+    entry->parent = parent;
+    entry->mode = CPIO_S_IFDIR | 0755;
+    entry->nlink = 1;
+
+    UINT32 slot = hash & (bom->bucketCount - 1);
+    entry->next = bom->buckets[slot];
+    bom->buckets[slot] = bom->count;
+
+    if (bom->count >= bom->bucketCount * 2) {
+        Grow(bom);
+    }
+    return bom->count;
+}
+
+static void CloseCurrent(CpioBomWriter* bom) {
+    if (!bom->current) return;
+
+    CpioBomEntry* entry = &bom->entries[bom->current - 1];
+    if ((entry->mode & CPIO_S_IFMT) == CPIO_S_IFREG || (entry->mode & CPIO_S_IFMT) == CPIO_S_IFLNK) {
+        entry->checksum = CpioCksumFinal(bom->crc, bom->length);
+    }
+    bom->current = 0;
+}
+
+void CpioBomWriterAdd(CpioBomWriter* bom, const CpioNewcHeader* header) {
+    if (!bom || !header) return;
+
+    CloseCurrent(bom);
+
+    UINT32 id = AddPath(bom, header->name, CpioStringLength(header->name));
+    if (!id) return;
+
+    CpioBomEntry* entry = &bom->entries[id - 1];
+    entry->mode = header->mode;
+    entry->uid = header->uid;
+    entry->gid = header->gid;
+    entry->mtime = header->mtime;
+    entry->nlink = header->nlink;
+    entry->inode = header->inode;
+    entry->size = header->fileSize;
+    entry->checksum = 0;
+    entry->rdev = (header->rdevMajor << 24) | (header->rdevMinor & 0xFFFFFF);
+    entry->linkLength = 0;
+
+    bom->current = id;
+    bom->crc = 0;
+    bom->length = 0;
+}
+
+void CpioBomWriterUpdate(CpioBomWriter* bom, const void* data, SIZE_T length) {
+    if (!bom || !bom->current) return;
+
+    CpioBomEntry* entry = &bom->entries[bom->current - 1];
+    bom->crc = CpioCksumUpdate(bom->crc, data, length);
+    bom->length += length;
+
+    if ((entry->mode & CPIO_S_IFMT) == CPIO_S_IFLNK && entry->linkLength + length < CPIO_MAX_NAME_LENGTH) {
+        char* target = (char*)CpioRealloc(entry->linkTarget, entry->linkLength + length + 1);
+        if (!target) {
+            bom->failed = TRUE;
+            return;
+        }
+        CpioCopyMemory(target + entry->linkLength, data, length);
+        entry->linkLength += length;
+        target[entry->linkLength] = '\0';
+        entry->linkTarget = target;
+    }
+}
+
+static void ShareLinkedData(CpioBomWriter* bom) {
+    for (UINT32 i = 0; i < bom->count; i++) {
+        const CpioBomEntry* holder = &bom->entries[i];
+        if ((holder->mode & CPIO_S_IFMT) != CPIO_S_IFREG || holder->nlink < 2 || holder->size == 0) continue;
+
+        UINT32 shared = 1;
+        for (UINT32 j = i; j > 0 && shared < holder->nlink; j--) {
+            CpioBomEntry* entry = &bom->entries[j - 1];
+            if ((entry->mode & CPIO_S_IFMT) != CPIO_S_IFREG) continue;
+            if (entry->inode != holder->inode) break;
+
+            entry->size = holder->size;
+            entry->checksum = holder->checksum;
+            shared++;
+        }
+    }
+}
+
+static UINT32 WriteBlock(BomFile* file, const void* data, UINT32 length) {
+    if (!file->ok) return 0;
+
+    if (file->count == file->capacity) {
+        UINT32 capacity = file->capacity * 2;
+        UINT32* pointers = (UINT32*)CpioRealloc(file->pointers, sizeof(UINT32) * 2 * capacity);
+        if (!pointers) {
+            CpioErrorSet(file->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            file->ok = FALSE;
+            return 0;
+        }
+        file->pointers = pointers;
+        file->capacity = capacity;
+    }
+
+    if (!CpioWriterWrite(&file->writer, data, length, file->error)) {
+        file->ok = FALSE;
+        return 0;
+    }
+
+    file->pointers[file->count * 2] = file->offset;
+    file->pointers[file->count * 2 + 1] = length;
+    file->offset += length;
+    return file->count++;
+}
+
+static UINT32 WriteTree(BomFile* file, UINT32 child, UINT32 blockSize, UINT32 pathCount) {
+    BYTE tree[BOM_TREE_SIZE] = { 't', 'r', 'e', 'e' };
+    PutBigEndian32(tree + 4, 1);
+    PutBigEndian32(tree + 8, child);
+    PutBigEndian32(tree + 12, blockSize);
+    PutBigEndian32(tree + 16, pathCount);
+    return WriteBlock(file, tree, sizeof(tree));
+}
+
+static UINT32 WriteEmptyTree(BomFile* file, UINT32 blockSize) {
+    BYTE leaf[BOM_PATHS_HEADER_SIZE] = { 0 };
+    PutBigEndian16(leaf, 1);
+    return WriteTree(file, WriteBlock(file, leaf, sizeof(leaf)), blockSize, 0);
+}
+
+static UINT32 EntryType(UINT32 mode) {
+    switch (mode & CPIO_S_IFMT) {
+    case CPIO_S_IFDIR: return BOM_TYPE_DIR;
+    case CPIO_S_IFLNK: return BOM_TYPE_LINK;
+    case CPIO_S_IFCHR:
+    case CPIO_S_IFBLK: return BOM_TYPE_DEVICE;
+    default: return BOM_TYPE_FILE;
+    }
+}
+
+static BOOL WriteEntry(BomFile* file, const CpioBomEntry* entry, UINT32 id, UINT32* info, UINT32* name) {
+    BYTE block[BOM_PATH_INFO_SIZE + CPIO_MAX_NAME_LENGTH + 4];
+    UINT32 type = EntryType(entry->mode);
+    UINT32 linkLength = type == BOM_TYPE_LINK ? (UINT32)entry->linkLength + 1 : 0;
+
+    CpioZeroMemory(block, BOM_PATH_INFO_SIZE);
+    block[0] = (BYTE)type;
+    block[1] = 1;
+    PutBigEndian16(block + 2, type == BOM_TYPE_FILE ? 3 : 0);
+    PutBigEndian16(block + 4, entry->mode & 0xFFFF);
+    PutBigEndian32(block + 6, entry->uid);
+    PutBigEndian32(block + 10, entry->gid);
+    PutBigEndian32(block + 14, entry->mtime);
+    PutBigEndian32(block + 18, (UINT32)entry->size);
+    block[22] = 1;
+    PutBigEndian32(block + 23, type == BOM_TYPE_DEVICE ? entry->rdev : entry->checksum);
+    PutBigEndian32(block + 27, linkLength);
+    if (linkLength > 0) {
+        if (entry->linkTarget) CpioCopyMemory(block + BOM_PATH_INFO_SIZE, entry->linkTarget, linkLength - 1);
+        block[BOM_PATH_INFO_SIZE + linkLength - 1] = '\0';
+    }
+    UINT32 pathInfo = WriteBlock(file, block, BOM_PATH_INFO_SIZE + linkLength);
+
+    BYTE pointer[8];
+    PutBigEndian32(pointer, id);
+    PutBigEndian32(pointer + 4, pathInfo);
+    *info = WriteBlock(file, pointer, sizeof(pointer));
+
+    SIZE_T nameLength = CpioStringLength(entry->name) + 1;
+    PutBigEndian32(block, entry->parent);
+    CpioCopyMemory(block + 4, entry->name, nameLength);
+    *name = WriteBlock(file, block, (UINT32)(4 + nameLength));
+
+    return file->ok;
+}
+
+static UINT32 WriteLevel(BomFile* file, const UINT32* keys, const UINT32* values, UINT32 count, BOOL leaf,
+                         UINT32* nodeKeys, UINT32* nodeValues) {
+    BYTE node[BOM_PATHS_HEADER_SIZE + CPIO_BOM_LEAF_ENTRIES * 8];
+    UINT32 nodeCount = (count + CPIO_BOM_LEAF_ENTRIES - 1) / CPIO_BOM_LEAF_ENTRIES;
+    UINT32 first = file->count;
+
+    for (UINT32 n = 0; n < nodeCount; n++) {
+        UINT32 start = n * CPIO_BOM_LEAF_ENTRIES;
+        UINT32 length = count - start < CPIO_BOM_LEAF_ENTRIES ? count - start : CPIO_BOM_LEAF_ENTRIES;
+
+        PutBigEndian16(node, leaf ? 1 : 0);
+        PutBigEndian16(node + 2, length);
+        PutBigEndian32(node + 4, leaf && n + 1 < nodeCount ? first + n + 1 : 0);
+        PutBigEndian32(node + 8, leaf && n > 0 ? first + n - 1 : 0);
+
+        for (UINT32 i = 0; i < length; i++) {
+            PutBigEndian32(node + BOM_PATHS_HEADER_SIZE + i * 8, values[start + i]);
+            PutBigEndian32(node + BOM_PATHS_HEADER_SIZE + i * 8 + 4, keys[start + i]);
+        }
+
+        nodeValues[n] = WriteBlock(file, node, BOM_PATHS_HEADER_SIZE + length * 8);
+        nodeKeys[n] = keys[start + length - 1];
+    }
+
+    return nodeCount;
+}
+
+static UINT32 WritePaths(BomFile* file, CpioBomWriter* bom) {
+    UINT32* keys = (UINT32*)CpioAlloc(sizeof(UINT32) * bom->count * 2 + 2);
+    UINT32* values = (UINT32*)CpioAlloc(sizeof(UINT32) * bom->count * 2 + 2);
+    if (!keys || !values) {
+        if (keys) CpioFree(keys);
+        if (values) CpioFree(values);
+        CpioErrorSet(file->error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        file->ok = FALSE;
+        return 0;
+    }
+
+    for (UINT32 i = 0; i < bom->count && file->ok; i++) {
+        WriteEntry(file, &bom->entries[i], i + 1, &values[i], &keys[i]);
+    }
+
+    UINT32 count = bom->count;
+    BOOL leaf = TRUE;
+    do {
+        UINT32* nodeKeys = keys + bom->count;
+        UINT32* nodeValues = values + bom->count;
+        count = WriteLevel(file, keys, values, count, leaf, nodeKeys, nodeValues);
+        CpioCopyMemory(keys, nodeKeys, sizeof(UINT32) * count);
+        CpioCopyMemory(values, nodeValues, sizeof(UINT32) * count);
+        leaf = FALSE;
+    } while (count > 1 && file->ok);
+
+    UINT32 root = values[0];
+    CpioFree(keys);
+    CpioFree(values);
+    return WriteTree(file, root, CPIO_BOM_BLOCK_SIZE, bom->count);
+}
+
+static BOOL WriteVar(CpioWriter* writer, UINT32 index, const char* name, CpioError* error) {
+    BYTE var[5];
+    SIZE_T length = CpioStringLength(name);
+    PutBigEndian32(var, index);
+    var[4] = (BYTE)length;
+    return CpioWriterWrite(writer, var, sizeof(var), error) && CpioWriterWrite(writer, name, length, error);
+}
+
+BOOL CpioBomWriterFinish(CpioBomWriter* bom, HANDLE hFile, CpioError* error) {
+    if (!bom || hFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid parameter");
+        return FALSE;
+    }
+
+    CloseCurrent(bom);
+    if (bom->count == 0) AddPath(bom, ".", 1);
+    if (bom->failed) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+    ShareLinkedData(bom);
+
+    BomFile file;
+    CpioZeroMemory(&file, sizeof(file));
+    file.capacity = 256;
+    file.pointers = (UINT32*)CpioAlloc(sizeof(UINT32) * 2 * file.capacity);
+    file.count = 1;
+    file.offset = BOM_HEADER_SIZE;
+    file.error = error;
+    file.ok = file.pointers && CpioWriterInit(&file.writer, hFile, 0);
+    if (!file.ok) {
+        if (file.pointers) CpioFree(file.pointers);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    BYTE header[BOM_HEADER_SIZE] = { 'B', 'O', 'M', 'S', 't', 'o', 'r', 'e' };
+    file.ok = CpioWriterWrite(&file.writer, header, sizeof(header), error);
+
+    BYTE info[28] = { 0 };
+    PutBigEndian32(info, 1);
+    PutBigEndian32(info + 4, bom->count);
+    PutBigEndian32(info + 8, 1);
+    UINT32 bomInfo = WriteBlock(&file, info, sizeof(info));
+
+    UINT32 paths = WritePaths(&file, bom);
+    UINT32 hardLinks = WriteEmptyTree(&file, CPIO_BOM_BLOCK_SIZE);
+    UINT32 size64 = WriteEmptyTree(&file, CPIO_BOM_BLOCK_SIZE);
+
+    BYTE vindex[13] = { 0 };
+    PutBigEndian32(vindex, 1);
+    PutBigEndian32(vindex + 4, WriteEmptyTree(&file, 128));
+    UINT32 versions = WriteBlock(&file, vindex, sizeof(vindex));
+
+    UINT32 indexOffset = file.offset;
+    BYTE word[4];
+    PutBigEndian32(word, file.count);
+    BOOL ok = file.ok && CpioWriterWrite(&file.writer, word, sizeof(word), error);
+
+    for (UINT32 i = 0; ok && i < file.count * 2; i++) {
+        PutBigEndian32(word, file.pointers[i]);
+        ok = CpioWriterWrite(&file.writer, word, sizeof(word), error);
+    }
+
+    PutBigEndian32(word, 0);
+    ok = ok && CpioWriterWrite(&file.writer, word, sizeof(word), error);
+    UINT32 indexLength = 4 + file.count * 8 + 4;
+
+    PutBigEndian32(word, 5);
+    ok = ok && CpioWriterWrite(&file.writer, word, sizeof(word), error) &&
+         WriteVar(&file.writer, bomInfo, "BomInfo", error) &&
+         WriteVar(&file.writer, paths, "Paths", error) &&
+         WriteVar(&file.writer, hardLinks, "HLIndex", error) &&
+         WriteVar(&file.writer, versions, "VIndex", error) &&
+         WriteVar(&file.writer, size64, "Size64", error);
+    UINT32 varsLength = 4 + 5 * 4 + sizeof("BomInfo") + sizeof("Paths") + sizeof("HLIndex") +
+                        sizeof("VIndex") + sizeof("Size64");
+
+    ok = ok && CpioWriterFlush(&file.writer, error);
+    CpioWriterRelease(&file.writer);
+
+    if (ok) {
+        PutBigEndian32(header + 8, 1);
+        PutBigEndian32(header + 12, file.count - 1);
+        PutBigEndian32(header + 16, indexOffset);
+        PutBigEndian32(header + 20, indexLength);
+        PutBigEndian32(header + 24, indexOffset + indexLength);
+        PutBigEndian32(header + 28, varsLength);
+
+        DWORD written;
+        LARGE_INTEGER start;
+        start.QuadPart = 0;
+        ok = SetFilePointerEx(hFile, start, NULL, FILE_BEGIN) &&
+             WriteFile(hFile, header, 32, &written, NULL) && written == 32;
+        if (!ok) CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write Bom header");
+    }
+
+    CpioFree(file.pointers);
+    return ok;
+}
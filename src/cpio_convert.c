@@ -0,0 +1,603 @@
+#include "cpio.h"
+
+#define TAR_NAME_SIZE 100
+#define TAR_PREFIX_SIZE 155
+#define TAR_MAX_SIZE 077777777777ULL
+#define TAR_MAX_ID 07777777
+#define ODC_MAX_FIELD 0777777
+#define ODC_MAX_SIZE 077777777777ULL
+
+typedef struct ConvertLink {
+    UINT64 id;
+    UINT32 dev;
+    UINT32 inode;
+    UINT32 mode;
+    UINT32 uid;
+    UINT32 gid;
+    UINT32 mtime;
+    UINT32 nlink;
+    char* target;
+    CpioStringList* pending;
+    struct ConvertLink* next;
+    struct ConvertLink* nextInOrder;
+} ConvertLink;
+
+typedef struct {
+    CpioReader* reader;
+    CpioFormat format;
+    CpioWriter writer;
+    ConvertLink** buckets;
+    SIZE_T bucketCount;
+    SIZE_T linkCount;
+    ConvertLink* first;
+    ConvertLink* last;
+    UINT32 nextInode;
+    CpioString* pax;
+    char name[CPIO_MAX_NAME_LENGTH + 2];
+    char linkName[CPIO_MAX_NAME_LENGTH];
+    BYTE header[CPIO_HEADER_MAX_SIZE];
+} Converter;
+
+static UINT32 HashKey(UINT32 dev, UINT64 id) {
+    UINT64 key = id ^ ((UINT64)dev << 29);
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (UINT32)key;
+}
+
+static BOOL IsLinked(const CpioEntry* entry) {
+    return entry->nlink > 1 && (entry->mode & CPIO_S_IFMT) == CPIO_S_IFREG;
+}
+
+static void Grow(Converter* converter) {
+    SIZE_T newCount = converter->bucketCount * 2;
+    ConvertLink** newBuckets = (ConvertLink**)CpioAlloc(sizeof(ConvertLink*) * newCount);
+    if (!newBuckets) return;
+
+    for (ConvertLink* link = converter->first; link; link = link->nextInOrder) {
+        SIZE_T slot = HashKey(link->dev, link->id) & (newCount - 1);
+        link->next = newBuckets[slot];
+        newBuckets[slot] = link;
+    }
+
+    CpioFree(converter->buckets);
+    converter->buckets = newBuckets;
+    converter->bucketCount = newCount;
+}
+
+static ConvertLink* FindLink(Converter* converter, const CpioEntry* entry) {
+    UINT32 dev = entry->devMajor;
+    UINT64 id = ((UINT64)entry->devMinor << 32) | entry->inode;
+    UINT32 hash = HashKey(dev, id);
+
+    for (ConvertLink* link = converter->buckets[hash & (converter->bucketCount - 1)]; link; link = link->next) {
+        if (link->dev == dev && link->id == id) return link;
+    }
+
+    ConvertLink* link = (ConvertLink*)CpioAlloc(sizeof(ConvertLink));
+    if (!link) return NULL;
+
+    link->pending = CpioStringListCreate();
+    if (!link->pending) {
+        CpioFree(link);
+        return NULL;
+    }
+    link->dev = dev;
+    link->id = id;
+    link->inode = converter->format == CPIO_FORMAT_ODC ? converter->nextInode++ : entry->inode;
+    link->mode = entry->mode;
+    link->uid = entry->uid;
+    link->gid = entry->gid;
+    link->mtime = entry->mtime;
+    link->nlink = entry->nlink;
+
+    if (converter->linkCount >= converter->bucketCount * 2) {
+        Grow(converter);
+    }
+
+    SIZE_T slot = hash & (converter->bucketCount - 1);
+    link->next = converter->buckets[slot];
+    converter->buckets[slot] = link;
+
+    if (converter->last) {
+        converter->last->nextInOrder = link;
+    } else {
+        converter->first = link;
+    }
+    converter->last = link;
+    converter->linkCount++;
+    return link;
+}
+
+static void DestroyLinks(Converter* converter) {
+    ConvertLink* link = converter->first;
+    while (link) {
+        ConvertLink* next = link->nextInOrder;
+        if (link->target) CpioFree(link->target);
+        CpioStringListDestroy(link->pending);
+        CpioFree(link);
+        link = next;
+    }
+    CpioFree(converter->buckets);
+}
+
+static const BYTE zeros[CPIO_TAR_BLOCK_SIZE * 2] = { 0 };
+
+static BOOL WritePadding(Converter* converter, UINT64 length, UINT32 alignment, CpioError* error) {
+    SIZE_T padLen = (SIZE_T)((alignment - (length % alignment)) % alignment);
+    return CpioWriterWrite(&converter->writer, zeros, padLen, error);
+}
+
+static BOOL CopyData(Converter* converter, UINT64 size, CpioError* error) {
+    CpioWriter* writer = &converter->writer;
+
+    if (size >= writer->bufferSize) {
+        if (!CpioWriterFlush(writer, error)) return FALSE;
+        if (!CpioReaderCopyToHandle(converter->reader, writer->hFile, error)) return FALSE;
+        writer->totalWritten += size;
+        return TRUE;
+    }
+
+    if (writer->bufferLength + size > writer->bufferSize && !CpioWriterFlush(writer, error)) {
+        return FALSE;
+    }
+
+    UINT64 remaining = size;
+    while (remaining > 0) {
+        CpioError readError = { 0 };
+        DWORD bytesRead = CpioReaderRead(converter->reader, writer->buffer + writer->bufferLength,
+                                         (DWORD)remaining, &readError);
+        if (bytesRead == 0) {
+            if (readError.code == CPIO_SUCCESS) {
+                CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive truncated in entry data");
+            } else {
+                CpioErrorSet(error, readError.code, readError.message);
+            }
+            return FALSE;
+        }
+        writer->bufferLength += bytesRead;
+        remaining -= bytesRead;
+    }
+
+    writer->totalWritten += size;
+    return TRUE;
+}
+
+static BOOL ReadLinkTarget(Converter* converter, const CpioEntry* entry, CpioError* error) {
+    if (entry->fileSize >= sizeof(converter->linkName)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Symbolic link target too long");
+        return FALSE;
+    }
+
+    DWORD length = 0;
+    while (length < entry->fileSize) {
+        CpioError readError = { 0 };
+        DWORD bytesRead = CpioReaderRead(converter->reader, converter->linkName + length,
+                                         (DWORD)entry->fileSize - length, &readError);
+        if (bytesRead == 0) {
+            CpioErrorSet(error, readError.code == CPIO_SUCCESS ? CPIO_ERROR_SIZE_MISMATCH : readError.code,
+                         readError.code == CPIO_SUCCESS ? "Archive truncated in entry data" : readError.message);
+            return FALSE;
+        }
+        length += bytesRead;
+    }
+
+    converter->linkName[length] = '\0';
+    return TRUE;
+}
+
+static BOOL WriteCpioHeader(Converter* converter, const CpioEntry* entry, UINT64 fileSize, UINT32 inode,
+                            CpioError* error) {
+    SIZE_T length;
+
+    if (converter->format == CPIO_FORMAT_ODC) {
+        if (fileSize > ODC_MAX_SIZE || entry->uid > ODC_MAX_FIELD || entry->gid > ODC_MAX_FIELD) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Member does not fit in an odc header");
+            return FALSE;
+        }
+
+        CpioOdcHeader header;
+        header.dev = 0;
+        header.inode = inode & ODC_MAX_FIELD;
+        header.mode = entry->mode;
+        header.uid = entry->uid;
+        header.gid = entry->gid;
+        header.nlink = entry->nlink & ODC_MAX_FIELD;
+        header.rdev = ((entry->rdevMajor << 8) | (entry->rdevMinor & 0xFF)) & ODC_MAX_FIELD;
+        header.mtime = entry->mtime;
+        header.fileSize = fileSize;
+        CpioCopyMemory(header.name, entry->name, CpioStringLength(entry->name) + 1);
+        length = CpioOdcHeaderEncode(&header, converter->header);
+    } else {
+        CpioNewcHeader header;
+        CpioZeroMemory(&header, sizeof(header) - sizeof(header.name));
+        header.inode = inode;
+        header.mode = entry->mode;
+        header.uid = entry->uid;
+        header.gid = entry->gid;
+        header.nlink = entry->nlink;
+        header.mtime = entry->mtime;
+        header.fileSize = fileSize;
+        header.devMajor = entry->devMajor;
+        header.devMinor = entry->devMinor;
+        header.rdevMajor = entry->rdevMajor;
+        header.rdevMinor = entry->rdevMinor;
+        CpioCopyMemory(header.name, entry->name, CpioStringLength(entry->name) + 1);
+        length = CpioNewcHeaderEncode(&header, converter->header);
+    }
+
+    return CpioWriterWrite(&converter->writer, converter->header, length, error);
+}
+
+static void PutOctal(BYTE* field, UINT64 value, SIZE_T size) {
+    field[size - 1] = 0;
+    for (SIZE_T i = size - 1; i > 0; i--) {
+        field[i - 1] = (BYTE)('0' + (value & 7));
+        value >>= 3;
+    }
+}
+
+static SIZE_T FormatDecimal(char* output, UINT64 value) {
+    char digits[24];
+    SIZE_T count = 0;
+
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (SIZE_T i = 0; i < count; i++) {
+        output[i] = digits[count - 1 - i];
+    }
+    output[count] = '\0';
+    return count;
+}
+
+static BOOL AddPaxRecord(CpioString* pax, const char* key, const char* value, SIZE_T valueLength) {
+    SIZE_T base = CpioStringLength(key) + valueLength + 3;
+    SIZE_T digits = 1;
+    char number[24];
+
+    while (FormatDecimal(number, base + digits) != digits) digits++;
+
+    return CpioStringAppend(pax, number, digits) && CpioStringAppendChar(pax, ' ') &&
+           CpioStringAppend(pax, key, CpioStringLength(key)) && CpioStringAppendChar(pax, '=') &&
+           CpioStringAppend(pax, value, valueLength) && CpioStringAppendChar(pax, '\n');
+}
+
+static BOOL AddPaxNumber(CpioString* pax, const char* key, UINT64 value) {
+    char number[24];
+    SIZE_T length = FormatDecimal(number, value);
+    return AddPaxRecord(pax, key, number, length);
+}
+
+static SIZE_T SplitTarName(const char* name, SIZE_T length) {
+    if (length <= TAR_NAME_SIZE) return 0;
+
+    for (SIZE_T i = length - 1; i > 0; i--) {
+        if (name[i] != '/') continue;
+        if (length - i - 1 > TAR_NAME_SIZE) break;
+        if (i <= TAR_PREFIX_SIZE && i < length - 1) return i;
+    }
+    return (SIZE_T)-1;
+}
+
+static void BuildTarHeader(BYTE* block, const char* name, SIZE_T nameLength, const CpioEntry* entry,
+                           char type, UINT64 size, const char* linkName) {
+    CpioZeroMemory(block, CPIO_TAR_BLOCK_SIZE);
+
+    SIZE_T split = SplitTarName(name, nameLength);
+    if (split == (SIZE_T)-1) {
+        CpioCopyMemory(block, name, TAR_NAME_SIZE);
+    } else if (split > 0) {
+        CpioCopyMemory(block, name + split + 1, nameLength - split - 1);
+        CpioCopyMemory(block + 345, name, split);
+    } else {
+        CpioCopyMemory(block, name, nameLength);
+    }
+
+    PutOctal(block + 100, entry->mode & 07777, 8);
+    PutOctal(block + 108, entry->uid > TAR_MAX_ID ? TAR_MAX_ID : entry->uid, 8);
+    PutOctal(block + 116, entry->gid > TAR_MAX_ID ? TAR_MAX_ID : entry->gid, 8);
+    PutOctal(block + 124, size > TAR_MAX_SIZE ? 0 : size, 12);
+    PutOctal(block + 136, entry->mtime, 12);
+    block[156] = (BYTE)type;
+
+    if (linkName) {
+        SIZE_T linkLength = CpioStringLength(linkName);
+        CpioCopyMemory(block + 157, linkName, linkLength < TAR_NAME_SIZE ? linkLength : TAR_NAME_SIZE);
+    }
+
+    CpioCopyMemory(block + 257, "ustar", 6);
+    block[263] = '0';
+    block[264] = '0';
+
+    if (type == '3' || type == '4') {
+        PutOctal(block + 329, entry->rdevMajor, 8);
+        PutOctal(block + 337, entry->rdevMinor, 8);
+    }
+
+    CpioCopyMemory(block + 148, "        ", 8);
+    UINT32 checksum = 0;
+    for (SIZE_T i = 0; i < CPIO_TAR_BLOCK_SIZE; i++) {
+        checksum += block[i];
+    }
+    PutOctal(block + 148, checksum, 7);
+    block[155] = ' ';
+}
+
+static BOOL WritePaxHeader(Converter* converter, const char* name, SIZE_T nameLength, const CpioEntry* entry,
+                           CpioError* error) {
+    CpioString* pax = converter->pax;
+    SIZE_T base = nameLength;
+    while (base > 0 && name[base - 1] == '/') base--;
+    SIZE_T start = base;
+    while (start > 0 && name[start - 1] != '/') start--;
+
+    char paxName[TAR_NAME_SIZE + 1];
+    SIZE_T paxLength = 11;
+    CpioCopyMemory(paxName, "PaxHeaders/", paxLength);
+    SIZE_T take = base - start;
+    if (take > TAR_NAME_SIZE - paxLength) take = TAR_NAME_SIZE - paxLength;
+    CpioCopyMemory(paxName + paxLength, name + start, take);
+    paxLength += take;
+
+    CpioEntry paxEntry;
+    CpioZeroMemory(&paxEntry, sizeof(paxEntry) - sizeof(paxEntry.name));
+    paxEntry.mode = 0644;
+    paxEntry.mtime = entry->mtime;
+
+    BuildTarHeader(converter->header, paxName, paxLength, &paxEntry, 'x', pax->length, NULL);
+
+    return CpioWriterWrite(&converter->writer, converter->header, CPIO_TAR_BLOCK_SIZE, error) &&
+           CpioWriterWrite(&converter->writer, pax->data, pax->length, error) &&
+           WritePadding(converter, pax->length, CPIO_TAR_BLOCK_SIZE, error);
+}
+
+static BOOL WriteTarHeader(Converter* converter, const CpioEntry* entry, char type, UINT64 size,
+                           const char* linkName, CpioError* error) {
+    char* name = converter->name;
+    SIZE_T nameLength = CpioStringLength(entry->name);
+    CpioCopyMemory(name, entry->name, nameLength + 1);
+
+    if (type == '5' && (nameLength == 0 || name[nameLength - 1] != '/')) {
+        name[nameLength++] = '/';
+        name[nameLength] = '\0';
+    }
+
+    SIZE_T linkLength = linkName ? CpioStringLength(linkName) : 0;
+    BOOL longName = SplitTarName(name, nameLength) == (SIZE_T)-1;
+    BOOL longLink = linkLength > TAR_NAME_SIZE;
+    BOOL largeSize = size > TAR_MAX_SIZE;
+    BOOL largeId = entry->uid > TAR_MAX_ID || entry->gid > TAR_MAX_ID;
+
+    if (longName || longLink || largeSize || largeId) {
+        if (converter->format != CPIO_FORMAT_PAX) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Member does not fit in a ustar header; use --to=pax");
+            return FALSE;
+        }
+
+        CpioString* pax = converter->pax;
+        CpioStringClear(pax);
+
+        BOOL ok = TRUE;
+        if (longName) ok = AddPaxRecord(pax, "path", name, nameLength);
+        if (ok && longLink) ok = AddPaxRecord(pax, "linkpath", linkName, linkLength);
+        if (ok && largeSize) ok = AddPaxNumber(pax, "size", size);
+        if (ok && entry->uid > TAR_MAX_ID) ok = AddPaxNumber(pax, "uid", entry->uid);
+        if (ok && entry->gid > TAR_MAX_ID) ok = AddPaxNumber(pax, "gid", entry->gid);
+
+        if (!ok) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return FALSE;
+        }
+        if (!WritePaxHeader(converter, name, nameLength, entry, error)) return FALSE;
+    }
+
+    BuildTarHeader(converter->header, name, nameLength, entry, type, size, linkName);
+    return CpioWriterWrite(&converter->writer, converter->header, CPIO_TAR_BLOCK_SIZE, error);
+}
+
+static BOOL IsTar(const Converter* converter) {
+    return converter->format == CPIO_FORMAT_USTAR || converter->format == CPIO_FORMAT_PAX;
+}
+
+static BOOL WriteLinkName(Converter* converter, const ConvertLink* link, const char* name, CpioError* error) {
+    CpioEntry entry;
+    CpioZeroMemory(&entry, sizeof(entry) - sizeof(entry.name));
+    entry.mode = link->mode;
+    entry.uid = link->uid;
+    entry.gid = link->gid;
+    entry.mtime = link->mtime;
+    entry.nlink = link->nlink;
+    entry.devMajor = link->dev;
+    entry.devMinor = (UINT32)(link->id >> 32);
+    CpioCopyMemory(entry.name, name, CpioStringLength(name) + 1);
+
+    if (IsTar(converter)) {
+        return WriteTarHeader(converter, &entry, '1', 0, link->target, error);
+    }
+    return WriteCpioHeader(converter, &entry, 0, link->inode, error);
+}
+
+static BOOL FlushPending(Converter* converter, ConvertLink* link, CpioError* error) {
+    BOOL ok = TRUE;
+
+    for (SIZE_T i = 0; i < link->pending->count; i++) {
+        if (ok) ok = WriteLinkName(converter, link, link->pending->items[i], error);
+        CpioFree(link->pending->items[i]);
+    }
+    link->pending->count = 0;
+    return ok;
+}
+
+static BOOL SetTarget(ConvertLink* link, const char* name) {
+    SIZE_T length = CpioStringLength(name);
+    link->target = (char*)CpioAlloc(length + 1);
+    if (!link->target) return FALSE;
+    CpioCopyMemory(link->target, name, length + 1);
+    return TRUE;
+}
+
+static BOOL ConvertEntry(Converter* converter, const CpioEntry* entry, CpioError* error) {
+    UINT32 type = entry->mode & CPIO_S_IFMT;
+    UINT32 inode = converter->format == CPIO_FORMAT_ODC ? converter->nextInode++ : entry->inode;
+    ConvertLink* link = NULL;
+
+    if (IsLinked(entry)) {
+        link = FindLink(converter, entry);
+        if (!link) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return FALSE;
+        }
+
+        if (link->target) return WriteLinkName(converter, link, entry->name, error);
+
+        if (entry->fileSize == 0 && link->pending->count + 1 < entry->nlink) {
+            if (!CpioStringListAdd(link->pending, entry->name)) {
+                CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+                return FALSE;
+            }
+            return TRUE;
+        }
+
+        if (!SetTarget(link, entry->name)) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return FALSE;
+        }
+        if (converter->format == CPIO_FORMAT_ODC) inode = link->inode;
+    }
+
+    UINT64 size = entry->fileSize;
+
+    if (IsTar(converter)) {
+        char tarType;
+        const char* linkName = NULL;
+
+        switch (type) {
+        case CPIO_S_IFDIR: tarType = '5'; size = 0; break;
+        case CPIO_S_IFCHR: tarType = '3'; size = 0; break;
+        case CPIO_S_IFBLK: tarType = '4'; size = 0; break;
+        case CPIO_S_IFIFO: tarType = '6'; size = 0; break;
+        case CPIO_S_IFLNK: tarType = '2'; size = 0; break;
+        case CPIO_S_IFREG: tarType = '0'; break;
+        default: return TRUE;
+        }
+
+        if (type == CPIO_S_IFLNK) {
+            if (!ReadLinkTarget(converter, entry, error)) return FALSE;
+            linkName = converter->linkName;
+        }
+
+        if (!WriteTarHeader(converter, entry, tarType, size, linkName, error)) return FALSE;
+        if (size > 0 && (!CopyData(converter, size, error) ||
+                         !WritePadding(converter, size, CPIO_TAR_BLOCK_SIZE, error))) {
+            return FALSE;
+        }
+    } else {
+        if (!WriteCpioHeader(converter, entry, size, inode, error)) return FALSE;
+        if (size > 0 && !CopyData(converter, size, error)) return FALSE;
+        if (converter->format != CPIO_FORMAT_ODC && !WritePadding(converter, size, 4, error)) return FALSE;
+    }
+
+    return !link || FlushPending(converter, link, error);
+}
+
+static BOOL FinishPending(Converter* converter, CpioError* error) {
+    for (ConvertLink* link = converter->first; link; link = link->nextInOrder) {
+        if (link->target || link->pending->count == 0) continue;
+
+        CpioStringList* pending = link->pending;
+        char* first = pending->items[0];
+        pending->items[0] = pending->items[--pending->count];
+
+        CpioEntry entry;
+        CpioZeroMemory(&entry, sizeof(entry) - sizeof(entry.name));
+        entry.mode = link->mode;
+        entry.uid = link->uid;
+        entry.gid = link->gid;
+        entry.mtime = link->mtime;
+        entry.nlink = link->nlink;
+        entry.devMajor = link->dev;
+        entry.devMinor = (UINT32)(link->id >> 32);
+        CpioCopyMemory(entry.name, first, CpioStringLength(first) + 1);
+        link->target = first;
+
+        BOOL ok = IsTar(converter) ? WriteTarHeader(converter, &entry, '0', 0, NULL, error)
+                                   : WriteCpioHeader(converter, &entry, 0, link->inode, error);
+        if (!ok || !FlushPending(converter, link, error)) return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL WriteEnd(Converter* converter, CpioError* error) {
+    if (IsTar(converter)) {
+        return CpioWriterWrite(&converter->writer, zeros, sizeof(zeros), error);
+    }
+
+    CpioEntry trailer;
+    CpioZeroMemory(&trailer, sizeof(trailer) - sizeof(trailer.name));
+    trailer.nlink = 1;
+    CpioCopyMemory(trailer.name, "TRAILER!!!", 11);
+    return WriteCpioHeader(converter, &trailer, 0, 0, error);
+}
+
+static BOOL Run(Converter* converter, CpioError* error) {
+    CpioEntry entry;
+
+    while (CpioReaderReadNext(converter->reader, &entry, error)) {
+        if (CpioStringCompare(entry.name, CPIO_TOC_NAME) == 0) continue;
+        if (!ConvertEntry(converter, &entry, error)) return FALSE;
+    }
+
+    if (!CpioReaderIsAtEnd(converter->reader)) {
+        if (error && error->code == CPIO_SUCCESS) {
+            CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive ended before trailer");
+        }
+        return FALSE;
+    }
+
+    return FinishPending(converter, error) && WriteEnd(converter, error) &&
+           CpioWriterFlush(&converter->writer, error);
+}
+
+BOOL CpioConvert(CpioReader* reader, HANDLE hOutput, CpioFormat format, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
+
+    if (format != CPIO_FORMAT_NEWC && format != CPIO_FORMAT_ODC && format != CPIO_FORMAT_USTAR &&
+        format != CPIO_FORMAT_PAX) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Unsupported output format");
+        return FALSE;
+    }
+
+    Converter* converter = (Converter*)CpioAlloc(sizeof(Converter));
+    if (!converter) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    converter->reader = reader;
+    converter->format = format;
+    converter->nextInode = 1;
+    converter->bucketCount = 256;
+    converter->buckets = (ConvertLink**)CpioAlloc(sizeof(ConvertLink*) * converter->bucketCount);
+    converter->pax = CpioStringCreate();
+
+    BOOL ok = converter->buckets && converter->pax &&
+              CpioWriterInit(&converter->writer, hOutput, CPIO_POOL_BUFFER_SIZE);
+    if (!ok) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+    } else {
+        ok = Run(converter, error);
+    }
+
+    CpioWriterRelease(&converter->writer);
+    CpioStringDestroy(converter->pax);
+    DestroyLinks(converter);
+    CpioFree(converter);
+    return ok;
+}
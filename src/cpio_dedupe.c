@@ -0,0 +1,258 @@
+#include "cpio.h"
+
+#define DEDUPE_PHASE_STAT 0
+#define DEDUPE_PHASE_PREFIX 1
+#define DEDUPE_PHASE_DIGEST 2
+
+CpioDedupe* CpioDedupeCreate(void) {
+    return (CpioDedupe*)CpioAlloc(sizeof(CpioDedupe));
+}
+
+void CpioDedupeDestroy(CpioDedupe* dedupe) {
+    if (!dedupe) return;
+
+    for (SIZE_T i = 0; i < dedupe->count; i++) {
+        if (dedupe->files[i].path) CpioFree(dedupe->files[i].path);
+    }
+
+    if (dedupe->files) CpioFree(dedupe->files);
+    if (dedupe->slots) CpioFree(dedupe->slots);
+    if (dedupe->work) CpioFree(dedupe->work);
+    CpioFree(dedupe);
+}
+
+BOOL CpioDedupeAdd(CpioDedupe* dedupe, const WCHAR* path) {
+    if (!dedupe || !path) return FALSE;
+
+    if (dedupe->count >= dedupe->capacity) {
+        SIZE_T newCap = dedupe->capacity ? dedupe->capacity * 2 : 1024;
+        CpioDedupeFile* newFiles = (CpioDedupeFile*)CpioRealloc(dedupe->files, sizeof(CpioDedupeFile) * newCap);
+        if (!newFiles) return FALSE;
+
+        dedupe->files = newFiles;
+        dedupe->capacity = newCap;
+    }
+
+    SIZE_T len = 0;
+    while (path[len]) len++;
+
+    WCHAR* copy = (WCHAR*)CpioAlloc((len + 1) * sizeof(WCHAR));
+    if (!copy) return FALSE;
+    CpioCopyMemory(copy, path, (len + 1) * sizeof(WCHAR));
+
+    CpioDedupeFile* file = &dedupe->files[dedupe->count++];
+    CpioZeroMemory(file, sizeof(CpioDedupeFile));
+    file->path = copy;
+    return TRUE;
+}
+
+static UINT64 HashPrefix(const BYTE* data, SIZE_T length) {
+    UINT64 hash = 0x9E3779B97F4A7C15ULL ^ length;
+    SIZE_T i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        hash = (hash ^ *(const UINT64*)(data + i)) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+
+    for (; i < length; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static void StatFile(CpioDedupeFile* file) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(file->path, GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return;
+    }
+
+    file->fileSize = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    file->candidate = file->fileSize > 0;
+}
+
+static void HashFilePrefix(CpioDedupeFile* file, BYTE* buffer) {
+    HANDLE hFile = CreateFileW(file->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        file->candidate = FALSE;
+        return;
+    }
+
+    DWORD toRead = file->fileSize < CPIO_DEDUPE_PREFIX_SIZE ? (DWORD)file->fileSize : CPIO_DEDUPE_PREFIX_SIZE;
+    DWORD bytesRead = 0;
+
+    if (ReadFile(hFile, buffer, toRead, &bytesRead, NULL) && bytesRead == toRead) {
+        file->prefixHash = HashPrefix(buffer, bytesRead);
+    } else {
+        file->candidate = FALSE;
+    }
+
+    CloseHandle(hFile);
+}
+
+static DWORD WINAPI DedupeWorker(LPVOID param) {
+    CpioDedupe* dedupe = (CpioDedupe*)param;
+    BYTE* buffer = NULL;
+
+    if (dedupe->phase == DEDUPE_PHASE_PREFIX) {
+        buffer = CpioBufferPoolAcquire();
+        if (!buffer) return 1;
+    }
+
+    for (;;) {
+        LONG index = InterlockedIncrement(&dedupe->nextWork) - 1;
+        if ((SIZE_T)index >= dedupe->workCount) break;
+
+        CpioDedupeFile* file = &dedupe->files[dedupe->work[index]];
+
+        if (dedupe->phase == DEDUPE_PHASE_STAT) {
+            StatFile(file);
+        } else if (dedupe->phase == DEDUPE_PHASE_PREFIX) {
+            HashFilePrefix(file, buffer);
+        } else if (!CpioSha256File(file->path, file->digest, NULL)) {
+            file->candidate = FALSE;
+        }
+    }
+
+    if (buffer) CpioBufferPoolRelease(buffer);
+    return 0;
+}
+
+static void RunPhase(CpioDedupe* dedupe, int phase, UINT32 threadCount) {
+    dedupe->workCount = 0;
+    for (SIZE_T i = 0; i < dedupe->count; i++) {
+        if (phase == DEDUPE_PHASE_STAT || dedupe->files[i].candidate) {
+            dedupe->work[dedupe->workCount++] = (UINT32)i;
+        }
+    }
+
+    dedupe->phase = phase;
+    dedupe->nextWork = 0;
+
+    if (threadCount > dedupe->workCount) threadCount = (UINT32)dedupe->workCount;
+
+    HANDLE threads[CPIO_DEDUPE_MAX_THREADS];
+    DWORD started = 0;
+
+    for (UINT32 i = 1; i < threadCount; i++) {
+        threads[started] = CreateThread(NULL, 0, DedupeWorker, dedupe, 0, NULL);
+        if (threads[started]) started++;
+    }
+
+    DedupeWorker(dedupe);
+
+    if (started > 0) {
+        WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+        for (DWORD i = 0; i < started; i++) {
+            CloseHandle(threads[i]);
+        }
+    }
+}
+
+static UINT32 KeyHash(const CpioDedupeFile* file, int level) {
+    UINT64 key = file->fileSize;
+    if (level >= DEDUPE_PHASE_PREFIX) key ^= file->prefixHash;
+    if (level >= DEDUPE_PHASE_DIGEST) key ^= *(const UINT64*)file->digest;
+
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (UINT32)key;
+}
+
+static BOOL KeyEquals(const CpioDedupeFile* a, const CpioDedupeFile* b, int level) {
+    if (a->fileSize != b->fileSize) return FALSE;
+    if (level >= DEDUPE_PHASE_PREFIX && a->prefixHash != b->prefixHash) return FALSE;
+    if (level >= DEDUPE_PHASE_DIGEST && CpioCompareMemory(a->digest, b->digest, CPIO_SHA256_SIZE) != 0) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void GroupCandidates(CpioDedupe* dedupe, int level) {
+    CpioZeroMemory(dedupe->slots, sizeof(UINT32) * dedupe->slotCount);
+
+    for (SIZE_T i = 0; i < dedupe->count; i++) {
+        CpioDedupeFile* file = &dedupe->files[i];
+        file->group = 0;
+        file->groupSize = 0;
+        if (!file->candidate) continue;
+
+        SIZE_T slot = KeyHash(file, level) & (dedupe->slotCount - 1);
+        while (dedupe->slots[slot] != 0) {
+            CpioDedupeFile* leader = &dedupe->files[dedupe->slots[slot] - 1];
+            if (KeyEquals(leader, file, level)) break;
+            slot = (slot + 1) & (dedupe->slotCount - 1);
+        }
+
+        if (dedupe->slots[slot] == 0) {
+            dedupe->slots[slot] = (UINT32)(i + 1);
+        }
+
+        file->group = dedupe->slots[slot] - 1;
+        dedupe->files[file->group].groupSize++;
+    }
+
+    for (SIZE_T i = 0; i < dedupe->count; i++) {
+        CpioDedupeFile* file = &dedupe->files[i];
+        if (!file->candidate) continue;
+
+        file->groupSize = dedupe->files[file->group].groupSize;
+        file->candidate = file->groupSize > 1;
+    }
+
+    for (SIZE_T i = 0; i < dedupe->count; i++) {
+        if (!dedupe->files[i].candidate) {
+            dedupe->files[i].group = 0;
+            dedupe->files[i].groupSize = 0;
+        }
+    }
+}
+
+BOOL CpioDedupeRun(CpioDedupe* dedupe, UINT32 threadCount, CpioError* error) {
+    if (!dedupe) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL dedupe");
+        return FALSE;
+    }
+
+    if (dedupe->count == 0) return TRUE;
+
+    if (dedupe->count >= 0x7FFFFFFF) {
+        CpioErrorSet(error, CPIO_ERROR_VALUE_TOO_LARGE, "Too many files to deduplicate");
+        return FALSE;
+    }
+
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    if (threadCount > CPIO_DEDUPE_MAX_THREADS) {
+        threadCount = CPIO_DEDUPE_MAX_THREADS;
+    }
+
+    SIZE_T slotCount = 16;
+    while (slotCount < dedupe->count * 2) slotCount *= 2;
+
+    dedupe->slots = (UINT32*)CpioAlloc(sizeof(UINT32) * slotCount);
+    dedupe->work = (UINT32*)CpioAlloc(sizeof(UINT32) * dedupe->count);
+    if (!dedupe->slots || !dedupe->work) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+    dedupe->slotCount = slotCount;
+
+    RunPhase(dedupe, DEDUPE_PHASE_STAT, threadCount);
+    GroupCandidates(dedupe, DEDUPE_PHASE_STAT);
+
+    RunPhase(dedupe, DEDUPE_PHASE_PREFIX, threadCount);
+    GroupCandidates(dedupe, DEDUPE_PHASE_PREFIX);
+
+    RunPhase(dedupe, DEDUPE_PHASE_DIGEST, threadCount);
+    GroupCandidates(dedupe, DEDUPE_PHASE_DIGEST);
+
+    return TRUE;
+}
@@ -0,0 +1,1096 @@
+#include "cpio.h"
+#include <intrin.h>
+
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_MAX_DISTANCE 32768
+#define DEFLATE_TOO_FAR 4096
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_MAX_BITS 15
+#define DEFLATE_MAX_CODELEN_BITS 7
+#define DEFLATE_LITLEN_CODES 286
+#define DEFLATE_DIST_CODES 30
+#define DEFLATE_CODELEN_CODES 19
+#define DEFLATE_END_OF_BLOCK 256
+#define DEFLATE_STORED_MAX 65535
+
+#define INFLATE_WINDOW_LIMIT (CPIO_DEFLATE_WINDOW_SIZE + CPIO_INFLATE_OUTPUT_SIZE)
+
+typedef struct {
+    UINT16 good;
+    UINT16 lazy;
+    UINT16 nice;
+    UINT16 chain;
+} DeflateConfig;
+
+static const DeflateConfig DeflateConfigs[10] = {
+    { 0, 0, 0, 0 },
+    { 4, 4, 8, 4 },
+    { 4, 5, 16, 8 },
+    { 4, 6, 32, 32 },
+    { 4, 4, 16, 16 },
+    { 8, 16, 32, 32 },
+    { 8, 16, 128, 128 },
+    { 8, 32, 128, 256 },
+    { 32, 128, 258, 1024 },
+    { 32, 258, 258, 4096 }
+};
+
+static const UINT16 LengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const BYTE LengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const UINT16 DistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const BYTE DistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const BYTE CodeLengthOrder[DEFLATE_CODELEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static UINT32 ReverseBits(UINT32 code, UINT32 length) {
+    UINT32 result = 0;
+    while (length--) {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return result;
+}
+
+CpioDeflater* CpioDeflaterCreate(int level) {
+    if (level < 0 || level > 9) return NULL;
+
+    CpioDeflater* deflater = (CpioDeflater*)CpioAlloc(sizeof(CpioDeflater));
+    if (!deflater) return NULL;
+
+    deflater->level = level;
+    deflater->head = (UINT32*)CpioAlloc(sizeof(UINT32) * DEFLATE_HASH_SIZE);
+    deflater->prev = (UINT32*)CpioAlloc(sizeof(UINT32) * (CPIO_DEFLATE_WINDOW_SIZE + CPIO_DEFLATE_MAX_BLOCK));
+    deflater->symbols = (UINT32*)CpioAlloc(sizeof(UINT32) * CPIO_DEFLATE_MAX_BLOCK);
+
+    if (!deflater->head || !deflater->prev || !deflater->symbols) {
+        CpioDeflaterDestroy(deflater);
+        return NULL;
+    }
+
+    for (UINT32 code = 0; code < 29; code++) {
+        for (UINT32 k = 0; k < (1u << LengthExtra[code]); k++) {
+            deflater->lengthCode[LengthBase[code] + k] = (BYTE)code;
+        }
+    }
+
+    for (UINT32 code = 0; code < DEFLATE_DIST_CODES; code++) {
+        for (UINT32 k = 0; k < (1u << DistExtra[code]); k++) {
+            UINT32 dist = DistBase[code] + k;
+            if (dist <= 256) {
+                deflater->distCode[dist - 1] = (BYTE)code;
+            } else {
+                deflater->distCode[256 + ((dist - 1) >> 7)] = (BYTE)code;
+            }
+        }
+    }
+
+    return deflater;
+}
+
+void CpioDeflaterDestroy(CpioDeflater* deflater) {
+    if (!deflater) return;
+
+    if (deflater->head) CpioFree(deflater->head);
+    if (deflater->prev) CpioFree(deflater->prev);
+    if (deflater->symbols) CpioFree(deflater->symbols);
+    CpioFree(deflater);
+}
+
+SIZE_T CpioDeflateBound(SIZE_T length) {
+    return length + 5 * (length / DEFLATE_STORED_MAX + 1) + 16;
+}
+
+static void PutBits(CpioDeflater* deflater, UINT32 value, UINT32 count) {
+    deflater->bitBuffer |= (UINT64)value << deflater->bitCount;
+    deflater->bitCount += count;
+
+    while (deflater->bitCount >= 8) {
+        deflater->output[deflater->outputLength++] = (BYTE)deflater->bitBuffer;
+        deflater->bitBuffer >>= 8;
+        deflater->bitCount -= 8;
+    }
+}
+
+static void AlignToByte(CpioDeflater* deflater) {
+    if (deflater->bitCount > 0) {
+        PutBits(deflater, 0, 8 - deflater->bitCount);
+    }
+}
+
+static void WriteStored(CpioDeflater* deflater, const BYTE* data, SIZE_T length) {
+    while (length > 0) {
+        UINT32 chunk = length > DEFLATE_STORED_MAX ? DEFLATE_STORED_MAX : (UINT32)length;
+
+        PutBits(deflater, 0, 3);
+        AlignToByte(deflater);
+        PutBits(deflater, chunk, 16);
+        PutBits(deflater, ~chunk & 0xFFFF, 16);
+
+        CpioCopyMemory(deflater->output + deflater->outputLength, data, chunk);
+        deflater->outputLength += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+typedef struct {
+    UINT32 key;
+    UINT32 symbol;
+} HuffmanSymbol;
+
+static void MinimumRedundancy(HuffmanSymbol* a, int n) {
+    int root, leaf, next, avail, used, depth;
+
+    a[0].key += a[1].key;
+    root = 0;
+    leaf = 2;
+
+    for (next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root].key < a[leaf].key) {
+            a[next].key = a[root].key;
+            a[root++].key = (UINT32)next;
+        } else {
+            a[next].key = a[leaf++].key;
+        }
+
+        if (leaf >= n || (root < next && a[root].key < a[leaf].key)) {
+            a[next].key += a[root].key;
+            a[root++].key = (UINT32)next;
+        } else {
+            a[next].key += a[leaf++].key;
+        }
+    }
+
+    a[n - 2].key = 0;
+    for (next = n - 3; next >= 0; next--) {
+        a[next].key = a[a[next].key].key + 1;
+    }
+
+    avail = 1;
+    used = depth = 0;
+    root = n - 2;
+    next = n - 1;
+
+    while (avail > 0) {
+        while (root >= 0 && (int)a[root].key == depth) {
+            used++;
+            root--;
+        }
+        while (avail > used) {
+            a[next--].key = (UINT32)depth;
+            avail--;
+        }
+        avail = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+static void BuildLengths(const UINT32* freq, UINT32 count, UINT32 maxBits, BYTE* lengths) {
+    HuffmanSymbol symbols[DEFLATE_LITLEN_CODES];
+    UINT32 used = 0;
+
+    for (UINT32 i = 0; i < count; i++) {
+        lengths[i] = 0;
+        if (freq[i]) {
+            symbols[used].key = freq[i];
+            symbols[used].symbol = i;
+            used++;
+        }
+    }
+
+    if (used == 0) return;
+    if (used == 1) {
+        lengths[symbols[0].symbol] = 1;
+        return;
+    }
+
+    for (UINT32 i = 1; i < used; i++) {
+        HuffmanSymbol current = symbols[i];
+        UINT32 j = i;
+        while (j > 0 && symbols[j - 1].key > current.key) {
+            symbols[j] = symbols[j - 1];
+            j--;
+        }
+        symbols[j] = current;
+    }
+
+    MinimumRedundancy(symbols, (int)used);
+
+    UINT32 numCodes[33];
+    CpioZeroMemory(numCodes, sizeof(numCodes));
+    for (UINT32 i = 0; i < used; i++) {
+        numCodes[symbols[i].key < 32 ? symbols[i].key : 32]++;
+    }
+
+    for (UINT32 i = maxBits + 1; i <= 32; i++) {
+        numCodes[maxBits] += numCodes[i];
+    }
+
+    UINT32 total = 0;
+    for (UINT32 i = maxBits; i > 0; i--) {
+        total += numCodes[i] << (maxBits - i);
+    }
+
+    while (total != (1u << maxBits)) {
+        numCodes[maxBits]--;
+        for (UINT32 i = maxBits - 1; i > 0; i--) {
+            if (numCodes[i]) {
+                numCodes[i]--;
+                numCodes[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    UINT32 next = used;
+    for (UINT32 bits = 1; bits <= maxBits; bits++) {
+        for (UINT32 k = numCodes[bits]; k > 0; k--) {
+            lengths[symbols[--next].symbol] = (BYTE)bits;
+        }
+    }
+}
+
+static void BuildCodes(const BYTE* lengths, UINT32 count, UINT16* codes) {
+    UINT32 lengthCount[DEFLATE_MAX_BITS + 1];
+    UINT32 nextCode[DEFLATE_MAX_BITS + 1];
+
+    CpioZeroMemory(lengthCount, sizeof(lengthCount));
+    for (UINT32 i = 0; i < count; i++) {
+        lengthCount[lengths[i]]++;
+    }
+    lengthCount[0] = 0;
+
+    UINT32 code = 0;
+    for (UINT32 bits = 1; bits <= DEFLATE_MAX_BITS; bits++) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+
+    for (UINT32 i = 0; i < count; i++) {
+        if (lengths[i]) {
+            codes[i] = (UINT16)ReverseBits(nextCode[lengths[i]]++, lengths[i]);
+        }
+    }
+}
+
+static void CompleteCode(BYTE* lengths, UINT32 count) {
+    UINT32 used = 0;
+    for (UINT32 i = 0; i < count; i++) {
+        if (lengths[i]) used++;
+    }
+
+    for (UINT32 i = 0; i < count && used < 2; i++) {
+        if (!lengths[i]) {
+            lengths[i] = 1;
+            used++;
+        }
+    }
+}
+
+static UINT32 DistCode(const CpioDeflater* deflater, UINT32 dist) {
+    return dist <= 256 ? deflater->distCode[dist - 1] : deflater->distCode[256 + ((dist - 1) >> 7)];
+}
+
+static void WriteBlock(CpioDeflater* deflater, const BYTE* data, SIZE_T length) {
+    BYTE litLengths[DEFLATE_LITLEN_CODES];
+    BYTE distLengths[DEFLATE_DIST_CODES];
+    UINT16 litCodes[DEFLATE_LITLEN_CODES];
+    UINT16 distCodes[DEFLATE_DIST_CODES];
+
+    deflater->litFreq[DEFLATE_END_OF_BLOCK] = 1;
+    BuildLengths(deflater->litFreq, DEFLATE_LITLEN_CODES, DEFLATE_MAX_BITS, litLengths);
+    BuildLengths(deflater->distFreq, DEFLATE_DIST_CODES, DEFLATE_MAX_BITS, distLengths);
+    CompleteCode(litLengths, DEFLATE_LITLEN_CODES);
+    CompleteCode(distLengths, DEFLATE_DIST_CODES);
+    BuildCodes(litLengths, DEFLATE_LITLEN_CODES, litCodes);
+    BuildCodes(distLengths, DEFLATE_DIST_CODES, distCodes);
+
+    UINT32 litCount = DEFLATE_LITLEN_CODES;
+    while (litCount > 257 && litLengths[litCount - 1] == 0) litCount--;
+    UINT32 distCount = DEFLATE_DIST_CODES;
+    while (distCount > 1 && distLengths[distCount - 1] == 0) distCount--;
+
+    BYTE all[DEFLATE_LITLEN_CODES + DEFLATE_DIST_CODES];
+    CpioCopyMemory(all, litLengths, litCount);
+    CpioCopyMemory(all + litCount, distLengths, distCount);
+    UINT32 total = litCount + distCount;
+
+    BYTE runSymbols[DEFLATE_LITLEN_CODES + DEFLATE_DIST_CODES];
+    BYTE runExtra[DEFLATE_LITLEN_CODES + DEFLATE_DIST_CODES];
+    UINT32 runCount = 0;
+    UINT32 codeLengthFreq[DEFLATE_CODELEN_CODES];
+    CpioZeroMemory(codeLengthFreq, sizeof(codeLengthFreq));
+
+    for (UINT32 i = 0; i < total;) {
+        BYTE value = all[i];
+        UINT32 run = 1;
+        while (i + run < total && all[i + run] == value) run++;
+        i += run;
+
+        if (value == 0) {
+            while (run >= 11) {
+                UINT32 take = run > 138 ? 138 : run;
+                runSymbols[runCount] = 18;
+                runExtra[runCount++] = (BYTE)(take - 11);
+                codeLengthFreq[18]++;
+                run -= take;
+            }
+            if (run >= 3) {
+                runSymbols[runCount] = 17;
+                runExtra[runCount++] = (BYTE)(run - 3);
+                codeLengthFreq[17]++;
+                run = 0;
+            }
+        } else {
+            runSymbols[runCount] = value;
+            runExtra[runCount++] = 0;
+            codeLengthFreq[value]++;
+            run--;
+            while (run >= 3) {
+                UINT32 take = run > 6 ? 6 : run;
+                runSymbols[runCount] = 16;
+                runExtra[runCount++] = (BYTE)(take - 3);
+                codeLengthFreq[16]++;
+                run -= take;
+            }
+        }
+
+        while (run > 0) {
+            runSymbols[runCount] = value;
+            runExtra[runCount++] = 0;
+            codeLengthFreq[value]++;
+            run--;
+        }
+    }
+
+    BYTE codeLengthLengths[DEFLATE_CODELEN_CODES];
+    UINT16 codeLengthCodes[DEFLATE_CODELEN_CODES];
+    BuildLengths(codeLengthFreq, DEFLATE_CODELEN_CODES, DEFLATE_MAX_CODELEN_BITS, codeLengthLengths);
+    CompleteCode(codeLengthLengths, DEFLATE_CODELEN_CODES);
+    BuildCodes(codeLengthLengths, DEFLATE_CODELEN_CODES, codeLengthCodes);
+
+    UINT32 orderCount = DEFLATE_CODELEN_CODES;
+    while (orderCount > 4 && codeLengthLengths[CodeLengthOrder[orderCount - 1]] == 0) orderCount--;
+
+    UINT64 dynamicBits = 3 + 5 + 5 + 4 + 3 * orderCount;
+    for (UINT32 i = 0; i < runCount; i++) {
+        BYTE symbol = runSymbols[i];
+        dynamicBits += codeLengthLengths[symbol];
+        if (symbol == 16) dynamicBits += 2;
+        else if (symbol == 17) dynamicBits += 3;
+        else if (symbol == 18) dynamicBits += 7;
+    }
+    for (UINT32 i = 0; i < DEFLATE_LITLEN_CODES; i++) {
+        UINT64 bits = litLengths[i];
+        if (i > DEFLATE_END_OF_BLOCK) bits += LengthExtra[i - 257];
+        dynamicBits += bits * deflater->litFreq[i];
+    }
+    for (UINT32 i = 0; i < DEFLATE_DIST_CODES; i++) {
+        dynamicBits += (UINT64)(distLengths[i] + DistExtra[i]) * deflater->distFreq[i];
+    }
+
+    UINT64 storedBits = 40 * (length / DEFLATE_STORED_MAX + 1) + 8 * (UINT64)length;
+    if (storedBits <= dynamicBits) {
+        WriteStored(deflater, data, length);
+        return;
+    }
+
+    PutBits(deflater, 0, 1);
+    PutBits(deflater, 2, 2);
+    PutBits(deflater, litCount - 257, 5);
+    PutBits(deflater, distCount - 1, 5);
+    PutBits(deflater, orderCount - 4, 4);
+
+    for (UINT32 i = 0; i < orderCount; i++) {
+        PutBits(deflater, codeLengthLengths[CodeLengthOrder[i]], 3);
+    }
+
+    for (UINT32 i = 0; i < runCount; i++) {
+        BYTE symbol = runSymbols[i];
+        PutBits(deflater, codeLengthCodes[symbol], codeLengthLengths[symbol]);
+        if (symbol == 16) PutBits(deflater, runExtra[i], 2);
+        else if (symbol == 17) PutBits(deflater, runExtra[i], 3);
+        else if (symbol == 18) PutBits(deflater, runExtra[i], 7);
+    }
+
+    for (SIZE_T i = 0; i < deflater->symbolCount; i++) {
+        UINT32 symbol = deflater->symbols[i];
+        UINT32 matchLength = symbol >> 16;
+
+        if (matchLength == 0) {
+            PutBits(deflater, litCodes[symbol], litLengths[symbol]);
+            continue;
+        }
+
+        UINT32 dist = symbol & 0xFFFF;
+        if (dist == 0) dist = DEFLATE_MAX_DISTANCE;
+
+        UINT32 lengthCode = deflater->lengthCode[matchLength];
+        PutBits(deflater, litCodes[257 + lengthCode], litLengths[257 + lengthCode]);
+        if (LengthExtra[lengthCode]) {
+            PutBits(deflater, matchLength - LengthBase[lengthCode], LengthExtra[lengthCode]);
+        }
+
+        UINT32 distCode = DistCode(deflater, dist);
+        PutBits(deflater, distCodes[distCode], distLengths[distCode]);
+        if (DistExtra[distCode]) {
+            PutBits(deflater, dist - DistBase[distCode], DistExtra[distCode]);
+        }
+    }
+
+    PutBits(deflater, litCodes[DEFLATE_END_OF_BLOCK], litLengths[DEFLATE_END_OF_BLOCK]);
+}
+
+static UINT32 Hash3(const BYTE* p) {
+    UINT32 value = (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16);
+    return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static void InsertPosition(CpioDeflater* deflater, const BYTE* data, SIZE_T pos) {
+    UINT32 hash = Hash3(data + pos);
+    deflater->prev[pos] = deflater->head[hash];
+    deflater->head[hash] = (UINT32)(pos + 1);
+}
+
+static SIZE_T MatchLength(const BYTE* a, const BYTE* b, SIZE_T maxLength) {
+    SIZE_T length = 0;
+
+    while (length + 8 <= maxLength) {
+        UINT64 diff = *(const UINT64*)(a + length) ^ *(const UINT64*)(b + length);
+        if (diff) {
+            unsigned long index;
+            _BitScanForward64(&index, diff);
+            return length + (index >> 3);
+        }
+        length += 8;
+    }
+
+    while (length < maxLength && a[length] == b[length]) length++;
+    return length;
+}
+
+static SIZE_T LongestMatch(const CpioDeflater* deflater, const BYTE* data, SIZE_T pos, SIZE_T end,
+                           SIZE_T minLength, UINT32 chain, UINT32 nice, UINT32* distance) {
+    SIZE_T maxLength = end - pos;
+    if (maxLength > DEFLATE_MAX_MATCH) maxLength = DEFLATE_MAX_MATCH;
+    if (maxLength <= minLength) return 0;
+
+    SIZE_T best = minLength;
+    SIZE_T limit = pos > DEFLATE_MAX_DISTANCE ? pos - DEFLATE_MAX_DISTANCE : 0;
+    const BYTE* current = data + pos;
+    UINT32 candidate = deflater->prev[pos];
+
+    while (candidate != 0 && chain-- > 0) {
+        SIZE_T match = candidate - 1;
+        if (match < limit) break;
+
+        const BYTE* other = data + match;
+        if (other[best] == current[best] && other[0] == current[0] && other[1] == current[1]) {
+            SIZE_T length = MatchLength(current, other, maxLength);
+            if (length > best) {
+                best = length;
+                *distance = (UINT32)(pos - match);
+                if (length >= nice || length >= maxLength) break;
+            }
+        }
+
+        candidate = deflater->prev[match];
+    }
+
+    if (best == minLength) return 0;
+    if (best == DEFLATE_MIN_MATCH && *distance > DEFLATE_TOO_FAR) return 0;
+    return best;
+}
+
+static void RecordLiteral(CpioDeflater* deflater, BYTE value) {
+    deflater->symbols[deflater->symbolCount++] = value;
+    deflater->litFreq[value]++;
+}
+
+static void RecordMatch(CpioDeflater* deflater, SIZE_T length, UINT32 distance) {
+    deflater->symbols[deflater->symbolCount++] = ((UINT32)length << 16) | (distance & 0xFFFF);
+    deflater->litFreq[257 + deflater->lengthCode[length]]++;
+    deflater->distFreq[DistCode(deflater, distance)]++;
+}
+
+static void Tokenize(CpioDeflater* deflater, const BYTE* data, SIZE_T dictLength, SIZE_T length) {
+    const DeflateConfig* config = &DeflateConfigs[deflater->level];
+    SIZE_T end = dictLength + length;
+    SIZE_T hashEnd = end >= DEFLATE_MIN_MATCH ? end - (DEFLATE_MIN_MATCH - 1) : 0;
+
+    CpioZeroMemory(deflater->head, sizeof(UINT32) * DEFLATE_HASH_SIZE);
+    CpioZeroMemory(deflater->litFreq, sizeof(deflater->litFreq));
+    CpioZeroMemory(deflater->distFreq, sizeof(deflater->distFreq));
+    deflater->symbolCount = 0;
+
+    for (SIZE_T pos = 0; pos < dictLength && pos < hashEnd; pos++) {
+        InsertPosition(deflater, data, pos);
+    }
+
+    SIZE_T pos = dictLength;
+
+    if (deflater->level <= 3) {
+        while (pos < end) {
+            SIZE_T matchLength = 0;
+            UINT32 distance = 0;
+
+            if (pos < hashEnd) {
+                InsertPosition(deflater, data, pos);
+                matchLength = LongestMatch(deflater, data, pos, end, DEFLATE_MIN_MATCH - 1,
+                                           config->chain, config->nice, &distance);
+            }
+
+            if (matchLength == 0) {
+                RecordLiteral(deflater, data[pos++]);
+                continue;
+            }
+
+            RecordMatch(deflater, matchLength, distance);
+            SIZE_T next = pos + matchLength;
+            if (matchLength <= config->lazy) {
+                for (pos++; pos < next && pos < hashEnd; pos++) {
+                    InsertPosition(deflater, data, pos);
+                }
+            }
+            pos = next;
+        }
+        return;
+    }
+
+    SIZE_T prevLength = 0;
+    UINT32 prevDistance = 0;
+    BOOL pending = FALSE;
+
+    while (pos < end) {
+        SIZE_T matchLength = 0;
+        UINT32 distance = 0;
+
+        if (pos < hashEnd) {
+            InsertPosition(deflater, data, pos);
+            if (prevLength < config->lazy) {
+                UINT32 chain = prevLength >= config->good ? config->chain >> 2 : config->chain;
+                SIZE_T minLength = prevLength < DEFLATE_MIN_MATCH ? DEFLATE_MIN_MATCH - 1 : prevLength;
+                matchLength = LongestMatch(deflater, data, pos, end, minLength, chain, config->nice, &distance);
+            }
+        }
+
+        if (pending && prevLength >= DEFLATE_MIN_MATCH && matchLength <= prevLength) {
+            RecordMatch(deflater, prevLength, prevDistance);
+            SIZE_T next = pos - 1 + prevLength;
+            for (pos++; pos < next; pos++) {
+                if (pos < hashEnd) InsertPosition(deflater, data, pos);
+            }
+            pending = FALSE;
+            prevLength = 0;
+            continue;
+        }
+
+        if (pending) RecordLiteral(deflater, data[pos - 1]);
+        pending = TRUE;
+        prevLength = matchLength;
+        prevDistance = distance;
+        pos++;
+    }
+
+    if (pending) {
+        if (prevLength >= DEFLATE_MIN_MATCH) {
+            RecordMatch(deflater, prevLength, prevDistance);
+        } else {
+            RecordLiteral(deflater, data[pos - 1]);
+        }
+    }
+}
+
+SIZE_T CpioDeflaterCompress(CpioDeflater* deflater, const BYTE* data, SIZE_T dictLength, SIZE_T length,
+                            BYTE* output) {
+    if (!deflater || !output || length > CPIO_DEFLATE_MAX_BLOCK || dictLength > CPIO_DEFLATE_WINDOW_SIZE) {
+        return 0;
+    }
+
+    deflater->output = output;
+    deflater->outputLength = 0;
+    deflater->bitBuffer = 0;
+    deflater->bitCount = 0;
+
+    if (length > 0) {
+        if (deflater->level == 0) {
+            WriteStored(deflater, data + dictLength, length);
+        } else {
+            Tokenize(deflater, data, dictLength, length);
+            WriteBlock(deflater, data + dictLength, length);
+        }
+    }
+
+    PutBits(deflater, 0, 3);
+    AlignToByte(deflater);
+    PutBits(deflater, 0, 16);
+    PutBits(deflater, 0xFFFF, 16);
+
+    return deflater->outputLength;
+}
+
+CpioInflater* CpioInflaterCreate(HANDLE hInput, HANDLE hOutput) {
+    CpioInflater* inflater = (CpioInflater*)CpioAlloc(sizeof(CpioInflater));
+    if (!inflater) return NULL;
+
+    inflater->hInput = hInput;
+    inflater->hOutput = hOutput;
+    inflater->input = CpioBufferPoolAcquire();
+    inflater->window = (BYTE*)CpioAlloc(INFLATE_WINDOW_LIMIT + DEFLATE_MAX_MATCH + 8);
+
+    if (!inflater->input || !inflater->window) {
+        CpioInflaterDestroy(inflater);
+        return NULL;
+    }
+
+    return inflater;
+}
+
+void CpioInflaterDestroy(CpioInflater* inflater) {
+    if (!inflater) return;
+
+    if (inflater->input) CpioBufferPoolRelease(inflater->input);
+    if (inflater->window) CpioFree(inflater->window);
+    CpioFree(inflater);
+}
+
+BOOL CpioInflaterPrime(CpioInflater* inflater, const BYTE* data, SIZE_T length) {
+    if (!inflater || inflater->inputLength + length > CPIO_POOL_BUFFER_SIZE) return FALSE;
+
+    CpioCopyMemory(inflater->input + inflater->inputLength, data, length);
+    inflater->inputLength += length;
+    return TRUE;
+}
+
+void CpioInflaterReset(CpioInflater* inflater) {
+    inflater->windowPos = 0;
+    inflater->flushedPos = 0;
+    inflater->crc = 0;
+    inflater->totalOut = 0;
+}
+
+static BOOL FillInput(CpioInflater* inflater, CpioError* error) {
+    inflater->inputPos = 0;
+    inflater->inputLength = 0;
+
+    DWORD bytesRead = 0;
+    if (!ReadFile(inflater->hInput, inflater->input, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL)) {
+        DWORD lastError = GetLastError();
+        if (lastError != ERROR_BROKEN_PIPE && lastError != ERROR_HANDLE_EOF) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read compressed data");
+            return FALSE;
+        }
+        bytesRead = 0;
+    }
+
+    if (bytesRead == 0) inflater->inputEnd = TRUE;
+    inflater->inputLength = bytesRead;
+    return TRUE;
+}
+
+static BOOL Refill(CpioInflater* inflater, CpioError* error) {
+    while (inflater->bitCount <= 56) {
+        SIZE_T left = inflater->inputLength - inflater->inputPos;
+
+        if (left >= 8) {
+            UINT64 word = *(const UINT64*)(inflater->input + inflater->inputPos);
+            UINT32 take = (63 - inflater->bitCount) >> 3;
+            inflater->bitBuffer |= word << inflater->bitCount;
+            inflater->inputPos += take;
+            inflater->bitCount += take * 8;
+            return TRUE;
+        }
+
+        if (left == 0) {
+            if (inflater->inputEnd) return TRUE;
+            if (!FillInput(inflater, error)) return FALSE;
+            continue;
+        }
+
+        inflater->bitBuffer |= (UINT64)inflater->input[inflater->inputPos++] << inflater->bitCount;
+        inflater->bitCount += 8;
+    }
+
+    return TRUE;
+}
+
+static BOOL NeedBits(CpioInflater* inflater, UINT32 count, CpioError* error) {
+    if (inflater->bitCount >= count) return TRUE;
+    if (!Refill(inflater, error)) return FALSE;
+
+    if (inflater->bitCount < count) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of compressed data");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static UINT32 GetBits(CpioInflater* inflater, UINT32 count) {
+    UINT32 value = (UINT32)(inflater->bitBuffer & ((1ull << count) - 1));
+    inflater->bitBuffer >>= count;
+    inflater->bitCount -= count;
+    return value;
+}
+
+static BOOL BuildHuffman(CpioHuffman* huffman, const BYTE* lengths, UINT32 count) {
+    CpioZeroMemory(huffman, sizeof(CpioHuffman));
+
+    for (UINT32 i = 0; i < count; i++) {
+        huffman->count[lengths[i]]++;
+    }
+    huffman->count[0] = 0;
+
+    int left = 1;
+    for (UINT32 bits = 1; bits <= DEFLATE_MAX_BITS; bits++) {
+        left <<= 1;
+        left -= huffman->count[bits];
+        if (left < 0) return FALSE;
+    }
+
+    UINT32 offsets[DEFLATE_MAX_BITS + 1];
+    UINT32 nextCode[DEFLATE_MAX_BITS + 1];
+    UINT32 code = 0;
+
+    offsets[1] = 0;
+    for (UINT32 bits = 1; bits < DEFLATE_MAX_BITS; bits++) {
+        offsets[bits + 1] = offsets[bits] + huffman->count[bits];
+    }
+    for (UINT32 bits = 1; bits <= DEFLATE_MAX_BITS; bits++) {
+        code = (code + huffman->count[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+
+    for (UINT32 i = 0; i < count; i++) {
+        UINT32 length = lengths[i];
+        if (!length) continue;
+
+        huffman->symbols[offsets[length]++] = (UINT16)i;
+
+        UINT32 reversed = ReverseBits(nextCode[length]++, length);
+        if (length <= CPIO_INFLATE_FAST_BITS) {
+            for (UINT32 k = reversed; k < (1u << CPIO_INFLATE_FAST_BITS); k += 1u << length) {
+                huffman->fast[k] = (UINT16)((i << 4) | length);
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static int DecodeSymbol(CpioInflater* inflater, const CpioHuffman* huffman) {
+    UINT32 entry = huffman->fast[inflater->bitBuffer & ((1u << CPIO_INFLATE_FAST_BITS) - 1)];
+    if (entry) {
+        UINT32 length = entry & 15;
+        if (length > inflater->bitCount) return -1;
+        GetBits(inflater, length);
+        return (int)(entry >> 4);
+    }
+
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (UINT32 length = 1; length <= DEFLATE_MAX_BITS && length <= inflater->bitCount; length++) {
+        code |= (int)((inflater->bitBuffer >> (length - 1)) & 1);
+        int count = huffman->count[length];
+        if (code - count < first) {
+            GetBits(inflater, length);
+            return huffman->symbols[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static BOOL FlushWindow(CpioInflater* inflater, CpioError* error) {
+    const BYTE* data = inflater->window + inflater->flushedPos;
+    SIZE_T length = inflater->windowPos - inflater->flushedPos;
+
+    inflater->crc = CpioCrc32Update(inflater->crc, data, length);
+    inflater->totalOut += length;
+    inflater->flushedPos = inflater->windowPos;
+
+    while (length > 0) {
+        DWORD bytesWritten = 0;
+        if (!WriteFile(inflater->hOutput, data, (DWORD)length, &bytesWritten, NULL) || bytesWritten == 0) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write decompressed data");
+            return FALSE;
+        }
+        data += bytesWritten;
+        length -= bytesWritten;
+    }
+
+    return TRUE;
+}
+
+static BOOL SlideWindow(CpioInflater* inflater, CpioError* error) {
+    if (!FlushWindow(inflater, error)) return FALSE;
+
+    CpioCopyMemory(inflater->window, inflater->window + inflater->windowPos - CPIO_DEFLATE_WINDOW_SIZE,
+                   CPIO_DEFLATE_WINDOW_SIZE);
+    inflater->windowPos = CPIO_DEFLATE_WINDOW_SIZE;
+    inflater->flushedPos = CPIO_DEFLATE_WINDOW_SIZE;
+    return TRUE;
+}
+
+BOOL CpioInflaterReadBytes(CpioInflater* inflater, BYTE* data, SIZE_T length, SIZE_T* bytesRead,
+                           CpioError* error) {
+    GetBits(inflater, inflater->bitCount & 7);
+
+    SIZE_T total = 0;
+    while (total < length && inflater->bitCount >= 8) {
+        data[total++] = (BYTE)GetBits(inflater, 8);
+    }
+    if (inflater->bitCount == 0) inflater->bitBuffer = 0;
+
+    while (total < length) {
+        if (inflater->inputPos == inflater->inputLength) {
+            if (inflater->inputEnd) break;
+            if (!FillInput(inflater, error)) return FALSE;
+            continue;
+        }
+
+        SIZE_T take = inflater->inputLength - inflater->inputPos;
+        if (take > length - total) take = length - total;
+        CpioCopyMemory(data + total, inflater->input + inflater->inputPos, take);
+        inflater->inputPos += take;
+        total += take;
+    }
+
+    *bytesRead = total;
+    return TRUE;
+}
+
+static BOOL InflateStored(CpioInflater* inflater, CpioError* error) {
+    BYTE header[4];
+    SIZE_T got;
+
+    if (!CpioInflaterReadBytes(inflater, header, sizeof(header), &got, error)) return FALSE;
+    if (got != sizeof(header)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of compressed data");
+        return FALSE;
+    }
+
+    UINT32 length = header[0] | ((UINT32)header[1] << 8);
+    UINT32 check = header[2] | ((UINT32)header[3] << 8);
+    if (length != (~check & 0xFFFF)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt stored block in compressed data");
+        return FALSE;
+    }
+
+    while (length > 0) {
+        if (inflater->windowPos >= INFLATE_WINDOW_LIMIT && !SlideWindow(inflater, error)) return FALSE;
+
+        SIZE_T take = INFLATE_WINDOW_LIMIT - inflater->windowPos;
+        if (take > length) take = length;
+
+        if (!CpioInflaterReadBytes(inflater, inflater->window + inflater->windowPos, take, &got, error)) {
+            return FALSE;
+        }
+        if (got != take) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of compressed data");
+            return FALSE;
+        }
+
+        inflater->windowPos += take;
+        length -= (UINT32)take;
+    }
+
+    return TRUE;
+}
+
+static BOOL InflateCodes(CpioInflater* inflater, CpioError* error) {
+    for (;;) {
+        if (inflater->bitCount < 48 && !Refill(inflater, error)) return FALSE;
+        if (inflater->windowPos >= INFLATE_WINDOW_LIMIT && !SlideWindow(inflater, error)) return FALSE;
+
+        int symbol = DecodeSymbol(inflater, &inflater->litLen);
+        if (symbol < 0) break;
+
+        if (symbol < DEFLATE_END_OF_BLOCK) {
+            inflater->window[inflater->windowPos++] = (BYTE)symbol;
+            continue;
+        }
+
+        if (symbol == DEFLATE_END_OF_BLOCK) return TRUE;
+
+        symbol -= 257;
+        if (symbol >= 29 || inflater->bitCount < LengthExtra[symbol]) break;
+        UINT32 length = LengthBase[symbol] + GetBits(inflater, LengthExtra[symbol]);
+
+        int distSymbol = DecodeSymbol(inflater, &inflater->dist);
+        if (distSymbol < 0 || distSymbol >= DEFLATE_DIST_CODES || inflater->bitCount < DistExtra[distSymbol]) {
+            break;
+        }
+        UINT32 distance = DistBase[distSymbol] + GetBits(inflater, DistExtra[distSymbol]);
+
+        if (distance > inflater->windowPos) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid distance in compressed data");
+            return FALSE;
+        }
+
+        BYTE* out = inflater->window + inflater->windowPos;
+        const BYTE* from = out - distance;
+        inflater->windowPos += length;
+
+        if (distance >= 8) {
+            for (UINT32 i = 0; i < length; i += 8) {
+                *(UINT64*)(out + i) = *(const UINT64*)(from + i);
+            }
+        } else {
+            while (length--) *out++ = *from++;
+        }
+    }
+
+    CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt compressed data");
+    return FALSE;
+}
+
+static BOOL ReadDynamicTables(CpioInflater* inflater, CpioError* error) {
+    if (!NeedBits(inflater, 14, error)) return FALSE;
+
+    UINT32 litCount = GetBits(inflater, 5) + 257;
+    UINT32 distCount = GetBits(inflater, 5) + 1;
+    UINT32 orderCount = GetBits(inflater, 4) + 4;
+
+    if (litCount > DEFLATE_LITLEN_CODES || distCount > DEFLATE_DIST_CODES) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt compressed block header");
+        return FALSE;
+    }
+
+    BYTE codeLengthLengths[DEFLATE_CODELEN_CODES];
+    CpioZeroMemory(codeLengthLengths, sizeof(codeLengthLengths));
+
+    for (UINT32 i = 0; i < orderCount; i++) {
+        if (!NeedBits(inflater, 3, error)) return FALSE;
+        codeLengthLengths[CodeLengthOrder[i]] = (BYTE)GetBits(inflater, 3);
+    }
+
+    CpioHuffman codeLengths;
+    if (!BuildHuffman(&codeLengths, codeLengthLengths, DEFLATE_CODELEN_CODES)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt compressed block header");
+        return FALSE;
+    }
+
+    BYTE lengths[DEFLATE_LITLEN_CODES + DEFLATE_DIST_CODES];
+    UINT32 total = litCount + distCount;
+
+    for (UINT32 i = 0; i < total;) {
+        if (inflater->bitCount < 16 && !Refill(inflater, error)) return FALSE;
+
+        int symbol = DecodeSymbol(inflater, &codeLengths);
+        if (symbol < 0) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt compressed block header");
+            return FALSE;
+        }
+
+        if (symbol < 16) {
+            lengths[i++] = (BYTE)symbol;
+            continue;
+        }
+
+        BYTE value = 0;
+        UINT32 repeat = 0;
+        if (symbol == 16) {
+            if (i == 0 || inflater->bitCount < 2) symbol = -1;
+            else {
+                value = lengths[i - 1];
+                repeat = 3 + GetBits(inflater, 2);
+            }
+        } else if (symbol == 17) {
+            if (inflater->bitCount < 3) symbol = -1;
+            else repeat = 3 + GetBits(inflater, 3);
+        } else {
+            if (inflater->bitCount < 7) symbol = -1;
+            else repeat = 11 + GetBits(inflater, 7);
+        }
+
+        if (symbol < 0 || i + repeat > total) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt compressed block header");
+            return FALSE;
+        }
+
+        while (repeat--) lengths[i++] = value;
+    }
+
+    if (lengths[DEFLATE_END_OF_BLOCK] == 0 ||
+        !BuildHuffman(&inflater->litLen, lengths, litCount) ||
+        !BuildHuffman(&inflater->dist, lengths + litCount, distCount)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt compressed block header");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void BuildFixedTables(CpioInflater* inflater) {
+    BYTE lengths[288];
+
+    for (UINT32 i = 0; i < 288; i++) {
+        lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    }
+    BuildHuffman(&inflater->litLen, lengths, 288);
+
+    for (UINT32 i = 0; i < DEFLATE_DIST_CODES; i++) {
+        lengths[i] = 5;
+    }
+    BuildHuffman(&inflater->dist, lengths, DEFLATE_DIST_CODES);
+}
+
+BOOL CpioInflaterRun(CpioInflater* inflater, CpioError* error) {
+    if (!inflater) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL inflater");
+        return FALSE;
+    }
+
+    BOOL final = FALSE;
+
+    while (!final) {
+        if (!NeedBits(inflater, 3, error)) return FALSE;
+
+        final = GetBits(inflater, 1);
+        UINT32 type = GetBits(inflater, 2);
+        BOOL ok;
+
+        if (type == 0) {
+            ok = InflateStored(inflater, error);
+        } else if (type == 1) {
+            BuildFixedTables(inflater);
+            ok = InflateCodes(inflater, error);
+        } else if (type == 2) {
+            ok = ReadDynamicTables(inflater, error) && InflateCodes(inflater, error);
+        } else {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid compressed block type");
+            ok = FALSE;
+        }
+
+        if (!ok) return FALSE;
+    }
+
+    return FlushWindow(inflater, error);
+}
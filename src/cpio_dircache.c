@@ -0,0 +1,201 @@
+#include "cpio.h"
+
+static char FoldChar(char c) {
+    if (c >= 'A' && c <= 'Z') return (char)(c - 'A' + 'a');
+    if (c == '/') return '\\';
+    return c;
+}
+
+static UINT32 HashPath(const char* path, SIZE_T length) {
+    UINT32 hash = 2166136261u;
+    for (SIZE_T i = 0; i < length; i++) {
+        hash ^= (unsigned char)FoldChar(path[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static BOOL PathEquals(const char* a, const char* b) {
+    while (*a && *b) {
+        if (FoldChar(*a) != FoldChar(*b)) return FALSE;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+CpioDirCache* CpioDirCacheCreate(void) {
+    CpioDirCache* cache = (CpioDirCache*)CpioAlloc(sizeof(CpioDirCache));
+    if (!cache) return NULL;
+
+    cache->bucketCount = 1024;
+    cache->buckets = (CpioDirCacheEntry**)CpioAlloc(sizeof(CpioDirCacheEntry*) * cache->bucketCount);
+    cache->loadedDirs = CpioHashSetCreate();
+
+    if (!cache->buckets || !cache->loadedDirs) {
+        CpioDirCacheDestroy(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void CpioDirCacheDestroy(CpioDirCache* cache) {
+    if (!cache) return;
+
+    if (cache->buckets) {
+        for (SIZE_T i = 0; i < cache->bucketCount; i++) {
+            CpioDirCacheEntry* entry = cache->buckets[i];
+            while (entry) {
+                CpioDirCacheEntry* next = entry->next;
+                CpioFree(entry->path);
+                CpioFree(entry);
+                entry = next;
+            }
+        }
+        CpioFree(cache->buckets);
+    }
+
+    if (cache->loadedDirs) {
+        CpioHashSetDestroy(cache->loadedDirs);
+    }
+
+    CpioFree(cache);
+}
+
+static void Grow(CpioDirCache* cache) {
+    SIZE_T newCount = cache->bucketCount * 2;
+    CpioDirCacheEntry** newBuckets = (CpioDirCacheEntry**)CpioAlloc(sizeof(CpioDirCacheEntry*) * newCount);
+    if (!newBuckets) return;
+
+    for (SIZE_T i = 0; i < cache->bucketCount; i++) {
+        CpioDirCacheEntry* entry = cache->buckets[i];
+        while (entry) {
+            CpioDirCacheEntry* next = entry->next;
+            SIZE_T slot = entry->hash & (newCount - 1);
+            entry->next = newBuckets[slot];
+            newBuckets[slot] = entry;
+            entry = next;
+        }
+    }
+
+    CpioFree(cache->buckets);
+    cache->buckets = newBuckets;
+    cache->bucketCount = newCount;
+}
+
+static BOOL Insert(CpioDirCache* cache, const char* path, const WIN32_FIND_DATAW* data) {
+    CpioDirCacheEntry* entry = (CpioDirCacheEntry*)CpioAlloc(sizeof(CpioDirCacheEntry));
+    if (!entry) return FALSE;
+
+    SIZE_T len = CpioStringLength(path);
+    entry->path = (char*)CpioAlloc(len + 1);
+    if (!entry->path) {
+        CpioFree(entry);
+        return FALSE;
+    }
+    CpioCopyMemory(entry->path, path, len + 1);
+
+    ULARGE_INTEGER writeTime;
+    writeTime.LowPart = data->ftLastWriteTime.dwLowDateTime;
+    writeTime.HighPart = data->ftLastWriteTime.dwHighDateTime;
+
+    entry->hash = HashPath(path, len);
+    entry->fileSize = ((UINT64)data->nFileSizeHigh << 32) | data->nFileSizeLow;
+    entry->mtime = (UINT32)(writeTime.QuadPart / 10000000ULL - 11644473600ULL);
+    entry->attributes = data->dwFileAttributes;
+
+    if (cache->count >= cache->bucketCount * 2) {
+        Grow(cache);
+    }
+
+    SIZE_T slot = entry->hash & (cache->bucketCount - 1);
+    entry->next = cache->buckets[slot];
+    cache->buckets[slot] = entry;
+    cache->count++;
+    return TRUE;
+}
+
+static void LoadDirectory(CpioDirCache* cache, const char* dir, SIZE_T dirLength) {
+    char pattern[CPIO_MAX_NAME_LENGTH + 4];
+    SIZE_T len = 0;
+
+    if (dirLength > 0) {
+        CpioCopyMemory(pattern, dir, dirLength);
+        len = dirLength;
+        pattern[len++] = '\\';
+    }
+    pattern[len++] = '*';
+    pattern[len] = '\0';
+
+    WCHAR* widePattern = CpioStringToWide(pattern);
+    if (!widePattern) return;
+
+    WIN32_FIND_DATAW data;
+    HANDLE hFind = FindFirstFileExW(widePattern, FindExInfoBasic, &data, FindExSearchNameMatch,
+                                    NULL, FIND_FIRST_EX_LARGE_FETCH);
+    CpioFree(widePattern);
+
+    if (hFind == INVALID_HANDLE_VALUE) return;
+
+    char path[CPIO_MAX_NAME_LENGTH];
+
+    do {
+        if (data.cFileName[0] == L'.' &&
+            (data.cFileName[1] == L'\0' || (data.cFileName[1] == L'.' && data.cFileName[2] == L'\0'))) {
+            continue;
+        }
+
+        SIZE_T pathLen = 0;
+        if (dirLength > 0) {
+            CpioCopyMemory(path, dir, dirLength);
+            pathLen = dirLength;
+            path[pathLen++] = '\\';
+        }
+
+        int converted = WideCharToMultiByte(CP_UTF8, 0, data.cFileName, -1, path + pathLen,
+                                            (int)(sizeof(path) - pathLen), NULL, NULL);
+        if (converted == 0) continue;
+
+        Insert(cache, path, &data);
+    } while (FindNextFileW(hFind, &data));
+
+    FindClose(hFind);
+}
+
+const CpioDirCacheEntry* CpioDirCacheLookup(CpioDirCache* cache, const char* path) {
+    if (!cache || !path) return NULL;
+
+    SIZE_T len = CpioStringLength(path);
+    SIZE_T dirLength = 0;
+    for (SIZE_T i = 0; i < len; i++) {
+        if (path[i] == '\\' || path[i] == '/') dirLength = i;
+    }
+
+    char dirKey[CPIO_MAX_NAME_LENGTH];
+    dirKey[0] = '.';
+    dirKey[1] = '\0';
+    if (dirLength > 0) {
+        for (SIZE_T i = 0; i < dirLength; i++) {
+            dirKey[i] = FoldChar(path[i]);
+        }
+        dirKey[dirLength] = '\0';
+    }
+
+    if (!CpioHashSetContains(cache->loadedDirs, dirKey)) {
+        LoadDirectory(cache, path, dirLength);
+        CpioHashSetInsert(cache->loadedDirs, dirKey);
+    }
+
+    UINT32 hash = HashPath(path, len);
+    CpioDirCacheEntry* entry = cache->buckets[hash & (cache->bucketCount - 1)];
+
+    while (entry) {
+        if (entry->hash == hash && PathEquals(entry->path, path)) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,617 @@
+#include "cpio.h"
+
+#define CPIO_FS_DIR_CHILD 0x80000000u
+#define CPIO_FS_MAX_HEADER_SIZE (CPIO_MAGIC_SIZE + 104 + CPIO_MAX_NAME_LENGTH + 4)
+
+static UINT32 HashPath(const char* path, SIZE_T length) {
+    UINT32 hash = 2166136261u;
+    for (SIZE_T i = 0; i < length; i++) {
+        hash ^= (BYTE)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static BOOL NormalizePath(const char* path, char* output, SIZE_T outputSize) {
+    while (path[0] == '.' && path[1] == '/') path += 2;
+    while (path[0] == '/') path++;
+
+    SIZE_T length = CpioStringLength(path);
+    while (length > 0 && path[length - 1] == '/') length--;
+    if (length == 1 && path[0] == '.') length = 0;
+
+    if (length >= outputSize) return FALSE;
+    CpioCopyMemory(output, path, length);
+    output[length] = '\0';
+    return TRUE;
+}
+
+static const char* BaseName(const char* path) {
+    const char* base = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' && p[1] != '\0') base = p + 1;
+    }
+    return base;
+}
+
+static UINT32 FindDir(const CpioArchiveFs* fs, const char* path, SIZE_T length) {
+    if (fs->dirSlotCount == 0) return 0;
+
+    SIZE_T slot = HashPath(path, length) & (fs->dirSlotCount - 1);
+    while (fs->dirSlots[slot] != 0) {
+        const CpioFsDir* dir = &fs->dirs[fs->dirSlots[slot] - 1];
+        if (CpioStringLength(dir->path) == length && CpioCompareMemory(dir->path, path, length) == 0) {
+            return fs->dirSlots[slot];
+        }
+        slot = (slot + 1) & (fs->dirSlotCount - 1);
+    }
+    return 0;
+}
+
+static BOOL InsertDirSlot(CpioArchiveFs* fs, UINT32 index) {
+    if ((fs->dirCount + 1) * 2 > fs->dirSlotCount) {
+        SIZE_T newCount = fs->dirSlotCount ? fs->dirSlotCount * 2 : 64;
+        UINT32* newSlots = (UINT32*)CpioAlloc(sizeof(UINT32) * newCount);
+        if (!newSlots) return FALSE;
+
+        for (SIZE_T i = 0; i < fs->dirSlotCount; i++) {
+            UINT32 value = fs->dirSlots[i];
+            if (value == 0) continue;
+
+            const char* path = fs->dirs[value - 1].path;
+            SIZE_T slot = HashPath(path, CpioStringLength(path)) & (newCount - 1);
+            while (newSlots[slot] != 0) slot = (slot + 1) & (newCount - 1);
+            newSlots[slot] = value;
+        }
+
+        if (fs->dirSlots) CpioFree(fs->dirSlots);
+        fs->dirSlots = newSlots;
+        fs->dirSlotCount = newCount;
+    }
+
+    const char* path = fs->dirs[index - 1].path;
+    SIZE_T slot = HashPath(path, CpioStringLength(path)) & (fs->dirSlotCount - 1);
+    while (fs->dirSlots[slot] != 0) slot = (slot + 1) & (fs->dirSlotCount - 1);
+    fs->dirSlots[slot] = index;
+    return TRUE;
+}
+
+static BOOL AddChild(CpioFsDir* dir, UINT32 child) {
+    if (dir->childCount >= dir->childCapacity) {
+        SIZE_T newCap = dir->childCapacity ? dir->childCapacity * 2 : 8;
+        UINT32* newChildren = (UINT32*)CpioRealloc(dir->children, sizeof(UINT32) * newCap);
+        if (!newChildren) return FALSE;
+
+        dir->children = newChildren;
+        dir->childCapacity = newCap;
+    }
+
+    dir->children[dir->childCount++] = child;
+    return TRUE;
+}
+
+static UINT32 GetDir(CpioArchiveFs* fs, const char* path, SIZE_T length) {
+    UINT32 index = FindDir(fs, path, length);
+    if (index != 0) return index;
+
+    if (fs->dirCount >= fs->dirCapacity) {
+        SIZE_T newCap = fs->dirCapacity ? fs->dirCapacity * 2 : 64;
+        CpioFsDir* newDirs = (CpioFsDir*)CpioRealloc(fs->dirs, sizeof(CpioFsDir) * newCap);
+        if (!newDirs) return 0;
+
+        fs->dirs = newDirs;
+        fs->dirCapacity = newCap;
+    }
+
+    char* copy = (char*)CpioAlloc(length + 1);
+    if (!copy) return 0;
+    CpioCopyMemory(copy, path, length);
+
+    CpioFsDir* dir = &fs->dirs[fs->dirCount];
+    CpioZeroMemory(dir, sizeof(CpioFsDir));
+    dir->path = copy;
+    index = (UINT32)++fs->dirCount;
+
+    if (!InsertDirSlot(fs, index)) return 0;
+    if (length == 0) return index;
+
+    SIZE_T parentLength = length;
+    while (parentLength > 0 && path[parentLength - 1] != '/') parentLength--;
+    if (parentLength > 0) parentLength--;
+
+    UINT32 parent = GetDir(fs, path, parentLength);
+    if (parent == 0 || !AddChild(&fs->dirs[parent - 1], CPIO_FS_DIR_CHILD | (index - 1))) {
+        return 0;
+    }
+
+    return index;
+}
+
+static BOOL BuildDirs(CpioArchiveFs* fs) {
+    if (GetDir(fs, "", 0) == 0) return FALSE;
+
+    char path[CPIO_MAX_NAME_LENGTH];
+    SIZE_T count = CpioTocGetCount(fs->toc);
+
+    for (SIZE_T i = 0; i < count; i++) {
+        const CpioTocEntry* entry = CpioTocGetEntry(fs->toc, i);
+        if (CpioTocFind(fs->toc, entry->name) != entry) continue;
+        if (!NormalizePath(entry->name, path, sizeof(path))) continue;
+
+        SIZE_T length = CpioStringLength(path);
+
+        if (length == 0 || (entry->mode & CPIO_S_IFMT) == CPIO_S_IFDIR) {
+            UINT32 dir = GetDir(fs, path, length);
+            if (dir == 0) return FALSE;
+            fs->dirs[dir - 1].entryIndex = (UINT32)(i + 1);
+            continue;
+        }
+
+        SIZE_T parentLength = length;
+        while (parentLength > 0 && path[parentLength - 1] != '/') parentLength--;
+        if (parentLength > 0) parentLength--;
+
+        UINT32 parent = GetDir(fs, path, parentLength);
+        if (parent == 0 || !AddChild(&fs->dirs[parent - 1], (UINT32)i)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static BOOL IsLinked(const CpioTocEntry* entry) {
+    return entry->nlink > 1 && (entry->mode & CPIO_S_IFMT) == CPIO_S_IFREG;
+}
+
+static CpioLink* FindEntryLink(CpioLinkTable* table, const CpioTocEntry* entry, BOOL create) {
+    return CpioLinkTableFind(table, entry->devMajor, ((UINT64)entry->devMinor << 32) | entry->inode, create);
+}
+
+static BOOL BuildLinks(CpioArchiveFs* fs) {
+    SIZE_T count = CpioTocGetCount(fs->toc);
+    CpioLinkTable* links = NULL;
+
+    for (SIZE_T i = 0; i < count; i++) {
+        const CpioTocEntry* entry = CpioTocGetEntry(fs->toc, i);
+        if (!IsLinked(entry) || entry->fileSize == 0) continue;
+
+        if (!links && !(links = CpioLinkTableCreate())) return FALSE;
+
+        CpioLink* link = FindEntryLink(links, entry, TRUE);
+        if (!link) {
+            CpioLinkTableDestroy(links);
+            return FALSE;
+        }
+        link->inode = (UINT32)(i + 1);
+    }
+
+    if (!links) return TRUE;
+
+    fs->linkData = (UINT32*)CpioAlloc(sizeof(UINT32) * count);
+    if (!fs->linkData) {
+        CpioLinkTableDestroy(links);
+        return FALSE;
+    }
+
+    for (SIZE_T i = 0; i < count; i++) {
+        const CpioTocEntry* entry = CpioTocGetEntry(fs->toc, i);
+        if (!IsLinked(entry) || entry->fileSize != 0) continue;
+
+        CpioLink* link = FindEntryLink(links, entry, FALSE);
+        if (link) fs->linkData[i] = link->inode;
+    }
+
+    CpioLinkTableDestroy(links);
+    return TRUE;
+}
+
+static const CpioTocEntry* DataEntry(const CpioArchiveFs* fs, const CpioTocEntry* entry) {
+    if (!fs->linkData) return entry;
+
+    UINT32 target = fs->linkData[entry - fs->toc->entries];
+    return target ? CpioTocGetEntry(fs->toc, target - 1) : entry;
+}
+
+static BOOL Resolve(CpioArchiveFs* fs, const char* path, const CpioTocEntry** entry,
+                    const CpioFsDir** dir, CpioError* error) {
+    if (!fs || !path) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (!NormalizePath(path, normalized, sizeof(normalized))) {
+        CpioErrorSet(error, CPIO_ERROR_VALUE_TOO_LARGE, "Path too long");
+        return FALSE;
+    }
+
+    UINT32 index = FindDir(fs, normalized, CpioStringLength(normalized));
+    *dir = index ? &fs->dirs[index - 1] : NULL;
+
+    if (*dir) {
+        *entry = (*dir)->entryIndex ? CpioTocGetEntry(fs->toc, (*dir)->entryIndex - 1) : NULL;
+    } else {
+        *entry = CpioTocFind(fs->toc, normalized);
+    }
+
+    if (!*dir && !*entry) {
+        CpioErrorSet(error, CPIO_ERROR_NOT_FOUND, "Member not found");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static BOOL ReadDirect(CpioArchiveFs* fs, BYTE* buffer, DWORD size, UINT64 offset, CpioError* error) {
+    while (size > 0) {
+        OVERLAPPED overlapped;
+        CpioZeroMemory(&overlapped, sizeof(overlapped));
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(fs->hFile, buffer, size, &bytesRead, &overlapped) || bytesRead == 0) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read archive");
+            return FALSE;
+        }
+
+        buffer += bytesRead;
+        offset += bytesRead;
+        size -= bytesRead;
+    }
+
+    return TRUE;
+}
+
+static CpioFsBlock** FindBlockSlot(CpioArchiveFs* fs, UINT64 index) {
+    SIZE_T bucket = (SIZE_T)((index * 0x9E3779B97F4A7C15ull) >> 32) & (fs->blockBucketCount - 1);
+    CpioFsBlock** slot = &fs->blockBuckets[bucket];
+    while (*slot && (*slot)->index != index) slot = &(*slot)->hashNext;
+    return slot;
+}
+
+static void UnlinkBlock(CpioArchiveFs* fs, CpioFsBlock* block) {
+    if (block->prev) block->prev->next = block->next;
+    else fs->lruHead = block->next;
+
+    if (block->next) block->next->prev = block->prev;
+    else fs->lruTail = block->prev;
+
+    block->prev = NULL;
+    block->next = NULL;
+}
+
+static void PushBlock(CpioArchiveFs* fs, CpioFsBlock* block) {
+    block->prev = NULL;
+    block->next = fs->lruHead;
+    if (fs->lruHead) fs->lruHead->prev = block;
+    fs->lruHead = block;
+    if (!fs->lruTail) fs->lruTail = block;
+}
+
+static void FreeBlock(CpioFsBlock* block) {
+    if (block->data) CpioFree(block->data);
+    CpioFree(block);
+}
+
+static void EvictBlock(CpioArchiveFs* fs) {
+    CpioFsBlock* victim = fs->lruTail;
+    if (!victim) return;
+
+    UnlinkBlock(fs, victim);
+    *FindBlockSlot(fs, victim->index) = victim->hashNext;
+    fs->blockCount--;
+    FreeBlock(victim);
+}
+
+static CpioFsBlock* LoadBlock(CpioArchiveFs* fs, UINT64 index, CpioError* error) {
+    CpioFsBlock* block = (CpioFsBlock*)CpioAlloc(sizeof(CpioFsBlock));
+    if (!block || !(block->data = (BYTE*)CpioAlloc(CPIO_FS_BLOCK_SIZE))) {
+        if (block) CpioFree(block);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    UINT64 offset = index * CPIO_FS_BLOCK_SIZE;
+    UINT64 remaining = fs->archiveSize - offset;
+    block->index = index;
+    block->length = remaining < CPIO_FS_BLOCK_SIZE ? (DWORD)remaining : CPIO_FS_BLOCK_SIZE;
+
+    if (!ReadDirect(fs, block->data, block->length, offset, error)) {
+        FreeBlock(block);
+        return NULL;
+    }
+
+    return block;
+}
+
+static BOOL ReadCached(CpioArchiveFs* fs, BYTE* buffer, DWORD size, UINT64 offset, CpioError* error) {
+    while (size > 0) {
+        UINT64 index = offset / CPIO_FS_BLOCK_SIZE;
+        DWORD within = (DWORD)(offset % CPIO_FS_BLOCK_SIZE);
+        DWORD chunk = CPIO_FS_BLOCK_SIZE - within;
+        if (chunk > size) chunk = size;
+
+        AcquireSRWLockExclusive(&fs->cacheLock);
+        CpioFsBlock* block = *FindBlockSlot(fs, index);
+
+        if (!block) {
+            ReleaseSRWLockExclusive(&fs->cacheLock);
+
+            CpioFsBlock* loaded = LoadBlock(fs, index, error);
+            if (!loaded) return FALSE;
+
+            AcquireSRWLockExclusive(&fs->cacheLock);
+            CpioFsBlock** slot = FindBlockSlot(fs, index);
+
+            if (*slot) {
+                block = *slot;
+                FreeBlock(loaded);
+            } else {
+                while (fs->blockCount >= fs->maxBlocks) EvictBlock(fs);
+                slot = FindBlockSlot(fs, index);
+                loaded->hashNext = NULL;
+                *slot = loaded;
+                PushBlock(fs, loaded);
+                fs->blockCount++;
+                block = loaded;
+            }
+        }
+
+        if (fs->lruHead != block) {
+            UnlinkBlock(fs, block);
+            PushBlock(fs, block);
+        }
+
+        CpioCopyMemory(buffer, block->data + within, chunk);
+        ReleaseSRWLockExclusive(&fs->cacheLock);
+
+        buffer += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioArchiveFsReadAt(CpioArchiveFs* fs, void* buffer, DWORD size, UINT64 offset, CpioError* error) {
+    if (!fs || (!buffer && size > 0)) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (offset > fs->archiveSize || size > fs->archiveSize - offset) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Read past end of archive");
+        return FALSE;
+    }
+
+    if (fs->view) {
+        CpioCopyMemory(buffer, fs->view + offset, size);
+        return TRUE;
+    }
+
+    if (fs->maxBlocks == 0) {
+        return ReadDirect(fs, (BYTE*)buffer, size, offset, error);
+    }
+
+    return ReadCached(fs, (BYTE*)buffer, size, offset, error);
+}
+
+CpioArchiveFs* CpioArchiveFsCreate(HANDLE hFile, BOOL takeOwnership, SIZE_T cacheSize, CpioError* error) {
+    CpioReader* reader = CpioReaderCreate(hFile, takeOwnership, error);
+    if (!reader) return NULL;
+
+    CpioArchiveFs* fs = (CpioArchiveFs*)CpioAlloc(sizeof(CpioArchiveFs));
+    if (!fs) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    fs->reader = reader;
+    InitializeSRWLock(&fs->cacheLock);
+
+    if (reader->compression != CPIO_FORMAT_UNKNOWN || !CpioReaderIsSeekable(reader)) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Archive must be an uncompressed seekable file");
+        CpioArchiveFsDestroy(fs);
+        return NULL;
+    }
+
+    CpioSource* source = CpioReaderGetSource(reader);
+    fs->hFile = source->hFile;
+    fs->view = source->view;
+    fs->archiveSize = CpioSourceGetSize(source);
+
+    fs->toc = CpioTocCreate(reader, 0, error);
+    if (!fs->toc) {
+        CpioArchiveFsDestroy(fs);
+        return NULL;
+    }
+
+    if (!BuildDirs(fs) || !BuildLinks(fs)) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioArchiveFsDestroy(fs);
+        return NULL;
+    }
+
+    fs->maxBlocks = cacheSize / CPIO_FS_BLOCK_SIZE;
+    if (!fs->view && fs->maxBlocks > 0) {
+        SIZE_T bucketCount = 16;
+        while (bucketCount < fs->maxBlocks) bucketCount *= 2;
+
+        fs->blockBuckets = (CpioFsBlock**)CpioAlloc(sizeof(CpioFsBlock*) * bucketCount);
+        if (!fs->blockBuckets) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            CpioArchiveFsDestroy(fs);
+            return NULL;
+        }
+        fs->blockBucketCount = bucketCount;
+    }
+
+    return fs;
+}
+
+void CpioArchiveFsDestroy(CpioArchiveFs* fs) {
+    if (!fs) return;
+
+    while (fs->lruHead) EvictBlock(fs);
+    if (fs->blockBuckets) CpioFree(fs->blockBuckets);
+
+    for (SIZE_T i = 0; i < fs->dirCount; i++) {
+        CpioFree(fs->dirs[i].path);
+        if (fs->dirs[i].children) CpioFree(fs->dirs[i].children);
+    }
+    if (fs->dirs) CpioFree(fs->dirs);
+    if (fs->dirSlots) CpioFree(fs->dirSlots);
+    if (fs->linkData) CpioFree(fs->linkData);
+
+    if (fs->toc) CpioTocDestroy(fs->toc);
+    if (fs->reader) CpioReaderDestroy(fs->reader);
+
+    CpioFree(fs);
+}
+
+static BOOL ReadHeader(CpioArchiveFs* fs, const CpioTocEntry* tocEntry, CpioEntry* entry, CpioError* error) {
+    BYTE data[CPIO_FS_MAX_HEADER_SIZE];
+    UINT64 available = tocEntry->headerOffset < fs->archiveSize ? fs->archiveSize - tocEntry->headerOffset : 0;
+    DWORD size = available < sizeof(data) ? (DWORD)available : (DWORD)sizeof(data);
+
+    if (size <= CPIO_MAGIC_SIZE) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Table of contents does not match archive");
+        return FALSE;
+    }
+
+    if (!CpioArchiveFsReadAt(fs, data, size, tocEntry->headerOffset, error)) return FALSE;
+
+    SIZE_T consumed = 0;
+
+    if (CpioReaderGetFormat(fs->reader) == CPIO_FORMAT_ODC) {
+        CpioOdcHeader header;
+        if (!CpioOdcHeaderDecode(data + CPIO_MAGIC_SIZE, size - CPIO_MAGIC_SIZE, FALSE, &header, &consumed, error)) {
+            return FALSE;
+        }
+        CpioEntryFromOdc(entry, &header);
+    } else {
+        CpioNewcHeader header;
+        if (!CpioNewcHeaderDecode(data + CPIO_MAGIC_SIZE, size - CPIO_MAGIC_SIZE, FALSE, &header, &consumed, error)) {
+            return FALSE;
+        }
+        CpioEntryFromNewc(entry, &header);
+    }
+
+    if (CpioStringCompare(entry->name, tocEntry->name) != 0 || entry->fileSize != tocEntry->fileSize) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Table of contents does not match archive");
+        return FALSE;
+    }
+
+    entry->headerOffset = tocEntry->headerOffset;
+    entry->dataOffset = tocEntry->dataOffset;
+    return TRUE;
+}
+
+BOOL CpioArchiveFsStat(CpioArchiveFs* fs, const char* path, CpioEntry* entry, CpioError* error) {
+    const CpioTocEntry* tocEntry;
+    const CpioFsDir* dir;
+
+    if (!entry) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (!Resolve(fs, path, &tocEntry, &dir, error)) return FALSE;
+
+    if (tocEntry) {
+        if (!ReadHeader(fs, tocEntry, entry, error)) return FALSE;
+
+        const CpioTocEntry* data = DataEntry(fs, tocEntry);
+        entry->fileSize = data->fileSize;
+        entry->dataOffset = data->dataOffset;
+        return TRUE;
+    }
+
+    CpioZeroMemory(entry, sizeof(CpioEntry));
+    entry->mode = CPIO_S_IFDIR | 0755;
+    entry->nlink = 2;
+
+    SIZE_T length = CpioStringLength(dir->path);
+    CpioCopyMemory(entry->name, dir->path, length + 1);
+    return TRUE;
+}
+
+BOOL CpioArchiveFsReadDir(CpioArchiveFs* fs, const char* path, CpioFsReadDirCallback callback,
+                          void* context, CpioError* error) {
+    const CpioTocEntry* tocEntry;
+    const CpioFsDir* dir;
+
+    if (!callback) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL callback");
+        return FALSE;
+    }
+
+    if (!Resolve(fs, path, &tocEntry, &dir, error)) return FALSE;
+
+    if (!dir) {
+        CpioErrorSet(error, CPIO_ERROR_NOT_A_FILE, "Not a directory");
+        return FALSE;
+    }
+
+    for (SIZE_T i = 0; i < dir->childCount; i++) {
+        UINT32 child = dir->children[i];
+        const char* name;
+        const CpioTocEntry* childEntry;
+
+        if (child & CPIO_FS_DIR_CHILD) {
+            const CpioFsDir* childDir = &fs->dirs[child & ~CPIO_FS_DIR_CHILD];
+            name = BaseName(childDir->path);
+            childEntry = childDir->entryIndex ? CpioTocGetEntry(fs->toc, childDir->entryIndex - 1) : NULL;
+        } else {
+            childEntry = CpioTocGetEntry(fs->toc, child);
+            name = BaseName(childEntry->name);
+        }
+
+        if (!callback(context, name, childEntry)) break;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioArchiveFsOpen(CpioArchiveFs* fs, const char* path, CpioFsFile* file, CpioError* error) {
+    const CpioTocEntry* tocEntry;
+    const CpioFsDir* dir;
+
+    if (!file) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (!Resolve(fs, path, &tocEntry, &dir, error)) return FALSE;
+
+    if (dir || !tocEntry || (tocEntry->mode & CPIO_S_IFMT) == CPIO_S_IFDIR) {
+        CpioErrorSet(error, CPIO_ERROR_NOT_A_FILE, "Is a directory");
+        return FALSE;
+    }
+
+    file->fs = fs;
+    file->entry = tocEntry;
+    file->data = DataEntry(fs, tocEntry);
+    return TRUE;
+}
+
+DWORD CpioArchiveFsRead(const CpioFsFile* file, void* buffer, DWORD size, UINT64 offset, CpioError* error) {
+    if (!file || !file->fs || !file->data) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL file");
+        return 0;
+    }
+
+    const CpioTocEntry* entry = file->data;
+    if (offset >= entry->fileSize) return 0;
+
+    if (size > entry->fileSize - offset) {
+        size = (DWORD)(entry->fileSize - offset);
+    }
+
+    if (!CpioArchiveFsReadAt(file->fs, buffer, size, entry->dataOffset + offset, error)) {
+        return 0;
+    }
+
+    return size;
+}
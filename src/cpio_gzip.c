@@ -0,0 +1,505 @@
+#include "cpio.h"
+
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+#define GZIP_FLAG_HCRC 0x02
+#define GZIP_FLAG_EXTRA 0x04
+#define GZIP_FLAG_NAME 0x08
+#define GZIP_FLAG_COMMENT 0x10
+
+static BOOL WriteAll(HANDLE hFile, const BYTE* data, SIZE_T length) {
+    while (length > 0) {
+        DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+        DWORD bytesWritten = 0;
+        if (!WriteFile(hFile, data, chunk, &bytesWritten, NULL) || bytesWritten == 0) {
+            return FALSE;
+        }
+        data += bytesWritten;
+        length -= bytesWritten;
+    }
+    return TRUE;
+}
+
+static void PutLittleEndian32(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)value;
+    p[1] = (BYTE)(value >> 8);
+    p[2] = (BYTE)(value >> 16);
+    p[3] = (BYTE)(value >> 24);
+}
+
+static UINT32 GetLittleEndian32(const BYTE* p) {
+    return (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+static void WriterFail(CpioGzipWriter* writer, CpioErrorCode code, const char* message) {
+    AcquireSRWLockExclusive(&writer->lock);
+    if (!writer->failed) {
+        writer->failed = TRUE;
+        CpioErrorSet(&writer->error, code, message);
+    }
+    ReleaseSRWLockExclusive(&writer->lock);
+}
+
+static DWORD WINAPI CompressWorker(LPVOID param) {
+    CpioGzipWriter* writer = (CpioGzipWriter*)param;
+    CpioDeflater* deflater = writer->deflaters[InterlockedIncrement(&writer->nextDeflater) - 1];
+
+    AcquireSRWLockExclusive(&writer->lock);
+
+    for (;;) {
+        while (!writer->shutdown && writer->taken == writer->submitted) {
+            SleepConditionVariableSRW(&writer->workReady, &writer->lock, INFINITE, 0);
+        }
+        if (writer->taken == writer->submitted) break;
+
+        CpioGzipBlock* block = &writer->blocks[writer->taken++ % writer->blockCount];
+        ReleaseSRWLockExclusive(&writer->lock);
+
+        const BYTE* data = block->input + block->dictLength;
+        block->crc = CpioCrc32Update(0, data, block->length);
+        block->outputLength = CpioDeflaterCompress(deflater, block->input, block->dictLength,
+                                                   block->length, block->output);
+
+        AcquireSRWLockExclusive(&writer->lock);
+        block->done = TRUE;
+        WakeAllConditionVariable(&writer->workDone);
+    }
+
+    ReleaseSRWLockExclusive(&writer->lock);
+    return 0;
+}
+
+static BOOL FillBlock(CpioGzipWriter* writer, CpioGzipBlock* block, const CpioGzipBlock* previous) {
+    block->dictLength = 0;
+    block->length = 0;
+
+    if (previous) {
+        SIZE_T available = previous->dictLength + previous->length;
+        block->dictLength = available > CPIO_DEFLATE_WINDOW_SIZE ? CPIO_DEFLATE_WINDOW_SIZE : available;
+        CpioCopyMemory(block->input, previous->input + available - block->dictLength, block->dictLength);
+    }
+
+    BYTE* data = block->input + block->dictLength;
+
+    while (block->length < CPIO_DEFLATE_MAX_BLOCK) {
+        DWORD bytesRead = 0;
+        if (!ReadFile(writer->hPipe, data + block->length, (DWORD)(CPIO_DEFLATE_MAX_BLOCK - block->length),
+                      &bytesRead, NULL)) {
+            if (GetLastError() != ERROR_BROKEN_PIPE) {
+                WriterFail(writer, CPIO_ERROR_IO, "Failed to read archive stream");
+            }
+            break;
+        }
+        if (bytesRead == 0) break;
+        block->length += bytesRead;
+    }
+
+    return block->length > 0;
+}
+
+static DWORD WINAPI DispatchBlocks(LPVOID param) {
+    CpioGzipWriter* writer = (CpioGzipWriter*)param;
+    BYTE header[GZIP_HEADER_SIZE] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 11 };
+    header[8] = (BYTE)(writer->level == 9 ? 2 : writer->level == 1 ? 4 : 0);
+
+    UINT32 crc = 0;
+    UINT64 totalIn = 0;
+    UINT64 filled = 0;
+    UINT64 written = 0;
+    BOOL ended = FALSE;
+
+    if (!WriteAll(writer->hOutput, header, sizeof(header))) {
+        WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+    }
+
+    while (!writer->failed) {
+        CpioGzipBlock* oldest = &writer->blocks[written % writer->blockCount];
+
+        AcquireSRWLockShared(&writer->lock);
+        BOOL ready = written < filled && oldest->done;
+        ReleaseSRWLockShared(&writer->lock);
+
+        if (ready) {
+            if (!WriteAll(writer->hOutput, oldest->output, oldest->outputLength)) {
+                WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+                break;
+            }
+            crc = CpioCrc32Combine(crc, oldest->crc, oldest->length);
+            totalIn += oldest->length;
+            written++;
+            continue;
+        }
+
+        if (!ended && filled - written < writer->blockCount) {
+            CpioGzipBlock* block = &writer->blocks[filled % writer->blockCount];
+            const CpioGzipBlock* previous = filled > 0 ? &writer->blocks[(filled - 1) % writer->blockCount] : NULL;
+
+            if (!FillBlock(writer, block, previous)) {
+                ended = TRUE;
+                continue;
+            }
+
+            AcquireSRWLockExclusive(&writer->lock);
+            block->done = FALSE;
+            writer->submitted++;
+            WakeConditionVariable(&writer->workReady);
+            ReleaseSRWLockExclusive(&writer->lock);
+
+            filled++;
+            continue;
+        }
+
+        if (written == filled) break;
+
+        AcquireSRWLockExclusive(&writer->lock);
+        while (!oldest->done) {
+            SleepConditionVariableSRW(&writer->workDone, &writer->lock, INFINITE, 0);
+        }
+        ReleaseSRWLockExclusive(&writer->lock);
+    }
+
+    if (!writer->failed) {
+        BYTE trailer[2 + GZIP_TRAILER_SIZE] = { 3, 0 };
+        PutLittleEndian32(trailer + 2, crc);
+        PutLittleEndian32(trailer + 6, (UINT32)totalIn);
+
+        if (!WriteAll(writer->hOutput, trailer, sizeof(trailer))) {
+            WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+        }
+    }
+
+    if (writer->failed) {
+        CloseHandle(writer->hPipe);
+        writer->hPipe = NULL;
+    }
+
+    AcquireSRWLockExclusive(&writer->lock);
+    writer->shutdown = TRUE;
+    WakeAllConditionVariable(&writer->workReady);
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    return 0;
+}
+
+CpioGzipWriter* CpioGzipWriterCreate(HANDLE hOutput, int level, UINT32 threadCount, CpioError* error) {
+    if (hOutput == INVALID_HANDLE_VALUE || level < 0 || level > 9) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid gzip parameters");
+        return NULL;
+    }
+
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    if (threadCount > CPIO_GZIP_MAX_THREADS) {
+        threadCount = CPIO_GZIP_MAX_THREADS;
+    }
+
+    CpioGzipWriter* writer = (CpioGzipWriter*)CpioAlloc(sizeof(CpioGzipWriter));
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    writer->hOutput = hOutput;
+    writer->level = level;
+    writer->threadCount = threadCount;
+    writer->blockCount = threadCount * 2;
+    InitializeSRWLock(&writer->lock);
+    InitializeConditionVariable(&writer->workReady);
+    InitializeConditionVariable(&writer->workDone);
+
+    writer->blocks = (CpioGzipBlock*)CpioAlloc(sizeof(CpioGzipBlock) * writer->blockCount);
+    BOOL ok = writer->blocks != NULL;
+
+    for (UINT32 i = 0; ok && i < writer->blockCount; i++) {
+        CpioGzipBlock* block = &writer->blocks[i];
+        block->input = (BYTE*)CpioAlloc(CPIO_DEFLATE_WINDOW_SIZE + CPIO_DEFLATE_MAX_BLOCK);
+        block->output = (BYTE*)CpioAlloc(CpioDeflateBound(CPIO_DEFLATE_MAX_BLOCK));
+        ok = block->input && block->output;
+    }
+
+    for (UINT32 i = 0; ok && i < threadCount; i++) {
+        writer->deflaters[i] = CpioDeflaterCreate(level);
+        ok = writer->deflaters[i] != NULL;
+    }
+
+    if (!ok) {
+        CpioGzipWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    if (!CreatePipe(&writer->hPipe, &writer->hInput, NULL, CPIO_DEFLATE_MAX_BLOCK)) {
+        CpioGzipWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create compression pipe");
+        return NULL;
+    }
+
+    for (UINT32 i = 0; i < threadCount; i++) {
+        writer->threads[writer->started] = CreateThread(NULL, 0, CompressWorker, writer, 0, NULL);
+        if (writer->threads[writer->started]) writer->started++;
+    }
+
+    writer->dispatcher = writer->started > 0 ? CreateThread(NULL, 0, DispatchBlocks, writer, 0, NULL) : NULL;
+    if (!writer->dispatcher) {
+        CpioGzipWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start compression threads");
+        return NULL;
+    }
+
+    return writer;
+}
+
+HANDLE CpioGzipWriterGetHandle(const CpioGzipWriter* writer) {
+    return writer ? writer->hInput : INVALID_HANDLE_VALUE;
+}
+
+static void StopWriter(CpioGzipWriter* writer) {
+    if (writer->hInput) {
+        CloseHandle(writer->hInput);
+        writer->hInput = NULL;
+    }
+
+    if (writer->dispatcher) {
+        WaitForSingleObject(writer->dispatcher, INFINITE);
+        CloseHandle(writer->dispatcher);
+        writer->dispatcher = NULL;
+    }
+
+    AcquireSRWLockExclusive(&writer->lock);
+    writer->shutdown = TRUE;
+    WakeAllConditionVariable(&writer->workReady);
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    if (writer->started > 0) {
+        WaitForMultipleObjects(writer->started, writer->threads, TRUE, INFINITE);
+        for (UINT32 i = 0; i < writer->started; i++) {
+            CloseHandle(writer->threads[i]);
+        }
+        writer->started = 0;
+    }
+}
+
+BOOL CpioGzipWriterFinish(CpioGzipWriter* writer, CpioError* error) {
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL gzip writer");
+        return FALSE;
+    }
+
+    StopWriter(writer);
+
+    if (writer->failed) {
+        if (error) *error = writer->error;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CpioGzipWriterDestroy(CpioGzipWriter* writer) {
+    if (!writer) return;
+
+    StopWriter(writer);
+    if (writer->hPipe) CloseHandle(writer->hPipe);
+
+    for (UINT32 i = 0; i < writer->threadCount; i++) {
+        CpioDeflaterDestroy(writer->deflaters[i]);
+    }
+
+    if (writer->blocks) {
+        for (UINT32 i = 0; i < writer->blockCount; i++) {
+            if (writer->blocks[i].input) CpioFree(writer->blocks[i].input);
+            if (writer->blocks[i].output) CpioFree(writer->blocks[i].output);
+        }
+        CpioFree(writer->blocks);
+    }
+
+    CpioFree(writer);
+}
+
+static BOOL ReadExact(CpioInflater* inflater, BYTE* data, SIZE_T length, CpioError* error) {
+    SIZE_T got = 0;
+    if (!CpioInflaterReadBytes(inflater, data, length, &got, error)) return FALSE;
+
+    if (got != length) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of gzip stream");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL SkipString(CpioInflater* inflater, CpioError* error) {
+    BYTE c;
+    do {
+        if (!ReadExact(inflater, &c, 1, error)) return FALSE;
+    } while (c != 0);
+    return TRUE;
+}
+
+static BOOL ReadMemberHeader(CpioGzipReader* gzip, BOOL* found, CpioError* error) {
+    BYTE header[GZIP_HEADER_SIZE];
+    SIZE_T got = 0;
+
+    *found = FALSE;
+    if (!CpioInflaterReadBytes(gzip->inflater, header, sizeof(header), &got, error)) return FALSE;
+
+    if (got < 3 || header[0] != 0x1F || header[1] != 0x8B || header[2] != 8) {
+        if (gzip->members > 0) return TRUE;
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid gzip header");
+        return FALSE;
+    }
+
+    if (got != sizeof(header)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of gzip stream");
+        return FALSE;
+    }
+
+    BYTE flags = header[3];
+    if (flags & 0xE0) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Unsupported gzip flags");
+        return FALSE;
+    }
+
+    if (flags & GZIP_FLAG_EXTRA) {
+        BYTE extra[2];
+        if (!ReadExact(gzip->inflater, extra, sizeof(extra), error)) return FALSE;
+
+        UINT32 extraLength = extra[0] | ((UINT32)extra[1] << 8);
+        while (extraLength > 0) {
+            BYTE skip[256];
+            SIZE_T chunk = extraLength > sizeof(skip) ? sizeof(skip) : extraLength;
+            if (!ReadExact(gzip->inflater, skip, chunk, error)) return FALSE;
+            extraLength -= (UINT32)chunk;
+        }
+    }
+
+    if ((flags & GZIP_FLAG_NAME) && !SkipString(gzip->inflater, error)) return FALSE;
+    if ((flags & GZIP_FLAG_COMMENT) && !SkipString(gzip->inflater, error)) return FALSE;
+
+    if (flags & GZIP_FLAG_HCRC) {
+        BYTE headerCrc[2];
+        if (!ReadExact(gzip->inflater, headerCrc, sizeof(headerCrc), error)) return FALSE;
+    }
+
+    *found = TRUE;
+    return TRUE;
+}
+
+static BOOL InflateMembers(CpioGzipReader* gzip, CpioError* error) {
+    for (;;) {
+        BOOL found;
+        if (!ReadMemberHeader(gzip, &found, error)) return FALSE;
+        if (!found) return TRUE;
+
+        CpioInflaterReset(gzip->inflater);
+        if (!CpioInflaterRun(gzip->inflater, error)) return FALSE;
+
+        BYTE trailer[GZIP_TRAILER_SIZE];
+        if (!ReadExact(gzip->inflater, trailer, sizeof(trailer), error)) return FALSE;
+
+        if (GetLittleEndian32(trailer) != gzip->inflater->crc ||
+            GetLittleEndian32(trailer + 4) != (UINT32)gzip->inflater->totalOut) {
+            CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "gzip checksum mismatch");
+            return FALSE;
+        }
+
+        gzip->members++;
+    }
+}
+
+static DWORD WINAPI DecompressThread(LPVOID param) {
+    CpioGzipReader* gzip = (CpioGzipReader*)param;
+
+    if (!InflateMembers(gzip, &gzip->error)) {
+        gzip->failed = TRUE;
+    }
+
+    CloseHandle(gzip->hWrite);
+    gzip->hWrite = NULL;
+    return 0;
+}
+
+CpioGzipReader* CpioGzipReaderCreate(HANDLE hInput, BOOL takeOwnership, const BYTE* prefix, SIZE_T prefixLength,
+                                     CpioError* error) {
+    if (hInput == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Invalid file handle");
+        return NULL;
+    }
+
+    CpioGzipReader* gzip = (CpioGzipReader*)CpioAlloc(sizeof(CpioGzipReader));
+    if (!gzip) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    gzip->hInput = hInput;
+
+    if (!CreatePipe(&gzip->hPipe, &gzip->hWrite, NULL, CPIO_INFLATE_OUTPUT_SIZE)) {
+        CpioGzipReaderDestroy(gzip);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create decompression pipe");
+        return NULL;
+    }
+
+    gzip->inflater = CpioInflaterCreate(hInput, gzip->hWrite);
+    if (!gzip->inflater || !CpioInflaterPrime(gzip->inflater, prefix, prefixLength)) {
+        CpioGzipReaderDestroy(gzip);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    gzip->thread = CreateThread(NULL, 0, DecompressThread, gzip, 0, NULL);
+    if (!gzip->thread) {
+        CpioGzipReaderDestroy(gzip);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start decompression thread");
+        return NULL;
+    }
+
+    gzip->ownsInput = takeOwnership;
+    return gzip;
+}
+
+HANDLE CpioGzipReaderGetHandle(const CpioGzipReader* gzip) {
+    return gzip ? gzip->hPipe : INVALID_HANDLE_VALUE;
+}
+
+BOOL CpioGzipReaderFinish(CpioGzipReader* gzip, CpioError* error) {
+    if (!gzip) return TRUE;
+
+    if (gzip->hPipe) {
+        BYTE* buffer = CpioBufferPoolAcquire();
+        DWORD bytesRead = 0;
+
+        while (buffer && ReadFile(gzip->hPipe, buffer, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL) && bytesRead > 0) {
+        }
+        if (buffer) CpioBufferPoolRelease(buffer);
+    }
+
+    if (gzip->thread) {
+        WaitForSingleObject(gzip->thread, INFINITE);
+        CloseHandle(gzip->thread);
+        gzip->thread = NULL;
+    }
+
+    if (gzip->failed) {
+        if (error) *error = gzip->error;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CpioGzipReaderDestroy(CpioGzipReader* gzip) {
+    if (!gzip) return;
+
+    if (gzip->hPipe) CloseHandle(gzip->hPipe);
+
+    if (gzip->thread) {
+        WaitForSingleObject(gzip->thread, INFINITE);
+        CloseHandle(gzip->thread);
+    }
+
+    if (gzip->hWrite) CloseHandle(gzip->hWrite);
+    if (gzip->ownsInput) CloseHandle(gzip->hInput);
+    CpioInflaterDestroy(gzip->inflater);
+    CpioFree(gzip);
+}
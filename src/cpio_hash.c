@@ -0,0 +1,560 @@
+#include "cpio.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPIO_HASH_SSE2 1
+#endif
+
+static const UINT32 Sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void Sha256Block(UINT32* state, const BYTE* block) {
+    UINT32 w[64];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((UINT32)block[i * 4] << 24) | ((UINT32)block[i * 4 + 1] << 16) |
+               ((UINT32)block[i * 4 + 2] << 8) | (UINT32)block[i * 4 + 3];
+    }
+
+    for (int i = 16; i < 64; i++) {
+        UINT32 s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        UINT32 s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    UINT32 a = state[0], b = state[1], c = state[2], d = state[3];
+    UINT32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        UINT32 t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + Sha256K[i] + w[i];
+        UINT32 t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void CpioSha256Init(CpioSha256* sha) {
+    static const UINT32 initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    CpioCopyMemory(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->blockLength = 0;
+}
+
+void CpioSha256Update(CpioSha256* sha, const void* data, SIZE_T length) {
+    const BYTE* bytes = (const BYTE*)data;
+    sha->length += length;
+
+    if (sha->blockLength > 0) {
+        SIZE_T take = 64 - sha->blockLength;
+        if (take > length) take = length;
+
+        CpioCopyMemory(sha->block + sha->blockLength, bytes, take);
+        sha->blockLength += take;
+        bytes += take;
+        length -= take;
+
+        if (sha->blockLength < 64) return;
+        Sha256Block(sha->state, sha->block);
+        sha->blockLength = 0;
+    }
+
+    while (length >= 64) {
+        Sha256Block(sha->state, bytes);
+        bytes += 64;
+        length -= 64;
+    }
+
+    CpioCopyMemory(sha->block, bytes, length);
+    sha->blockLength = length;
+}
+
+void CpioSha256Final(CpioSha256* sha, BYTE* digest) {
+    UINT64 bits = sha->length * 8;
+
+    sha->block[sha->blockLength++] = 0x80;
+    if (sha->blockLength > 56) {
+        CpioZeroMemory(sha->block + sha->blockLength, 64 - sha->blockLength);
+        Sha256Block(sha->state, sha->block);
+        sha->blockLength = 0;
+    }
+
+    CpioZeroMemory(sha->block + sha->blockLength, 56 - sha->blockLength);
+    for (int i = 0; i < 8; i++) {
+        sha->block[56 + i] = (BYTE)(bits >> (56 - i * 8));
+    }
+    Sha256Block(sha->state, sha->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (BYTE)(sha->state[i] >> 24);
+        digest[i * 4 + 1] = (BYTE)(sha->state[i] >> 16);
+        digest[i * 4 + 2] = (BYTE)(sha->state[i] >> 8);
+        digest[i * 4 + 3] = (BYTE)sha->state[i];
+    }
+}
+
+void CpioSha256Callback(void* context, const void* data, SIZE_T length) {
+    CpioSha256Update((CpioSha256*)context, data, length);
+}
+
+BOOL CpioSha256File(const WCHAR* path, BYTE* digest, CpioError* error) {
+    HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to open file for hashing");
+        return FALSE;
+    }
+
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CloseHandle(hFile);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    CpioSha256 sha;
+    CpioSha256Init(&sha);
+
+    BOOL ok = TRUE;
+    for (;;) {
+        DWORD bytesRead;
+        if (!ReadFile(hFile, buffer, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL)) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read file for hashing");
+            ok = FALSE;
+            break;
+        }
+        if (bytesRead == 0) break;
+        CpioSha256Update(&sha, buffer, bytesRead);
+    }
+
+    CpioBufferPoolRelease(buffer);
+    CloseHandle(hFile);
+
+    if (ok) CpioSha256Final(&sha, digest);
+    return ok;
+}
+
+static SRWLOCK crcLock = SRWLOCK_INIT;
+static UINT32 crcTable[8][256];
+static UINT64 crc64Table[256];
+static UINT32 crc32cTable[256];
+static UINT32 cksumTable[8][256];
+static BOOL volatile crcReady = FALSE;
+
+static void InitCrcTable(void) {
+    AcquireSRWLockExclusive(&crcLock);
+
+    if (!crcReady) {
+        for (UINT32 i = 0; i < 256; i++) {
+            UINT32 crc = i;
+            for (int k = 0; k < 8; k++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+            crcTable[0][i] = crc;
+
+            UINT64 crc64 = i;
+            for (int k = 0; k < 8; k++) {
+                crc64 = (crc64 >> 1) ^ (0xC96C5795D7870F42ULL & (0 - (crc64 & 1)));
+            }
+            crc64Table[i] = crc64;
+
+            UINT32 crc32c = i;
+            for (int k = 0; k < 8; k++) {
+                crc32c = (crc32c >> 1) ^ (0x82F63B78 & (0 - (crc32c & 1)));
+            }
+            crc32cTable[i] = crc32c;
+
+            UINT32 cksum = i << 24;
+            for (int k = 0; k < 8; k++) {
+                cksum = (cksum << 1) ^ (0x04C11DB7 & (0 - (cksum >> 31)));
+            }
+            cksumTable[0][i] = cksum;
+        }
+
+        for (UINT32 i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) {
+                crcTable[t][i] = (crcTable[t - 1][i] >> 8) ^ crcTable[0][crcTable[t - 1][i] & 0xFF];
+                cksumTable[t][i] = (cksumTable[t - 1][i] << 8) ^ cksumTable[0][cksumTable[t - 1][i] >> 24];
+            }
+        }
+
+        crcReady = TRUE;
+    }
+
+    ReleaseSRWLockExclusive(&crcLock);
+}
+
+UINT32 CpioCrc32Update(UINT32 crc, const void* data, SIZE_T length) {
+    if (!crcReady) InitCrcTable();
+
+    const BYTE* p = (const BYTE*)data;
+    crc = ~crc;
+
+    while (length >= 8) {
+        UINT32 low = crc ^ ((UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24));
+        UINT32 high = (UINT32)p[4] | ((UINT32)p[5] << 8) | ((UINT32)p[6] << 16) | ((UINT32)p[7] << 24);
+
+        crc = crcTable[7][low & 0xFF] ^ crcTable[6][(low >> 8) & 0xFF] ^
+              crcTable[5][(low >> 16) & 0xFF] ^ crcTable[4][low >> 24] ^
+              crcTable[3][high & 0xFF] ^ crcTable[2][(high >> 8) & 0xFF] ^
+              crcTable[1][(high >> 16) & 0xFF] ^ crcTable[0][high >> 24];
+        p += 8;
+        length -= 8;
+    }
+
+    while (length--) {
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+UINT64 CpioCrc64Update(UINT64 crc, const void* data, SIZE_T length) {
+    if (!crcReady) InitCrcTable();
+
+    const BYTE* p = (const BYTE*)data;
+    crc = ~crc;
+
+    while (length--) {
+        crc = (crc >> 8) ^ crc64Table[(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+#ifdef CPIO_HASH_SSE2
+static LONG volatile crc32cInstruction = -1;
+
+static BOOL HasCrc32cInstruction(void) {
+    if (crc32cInstruction < 0) {
+        int info[4];
+        __cpuid(info, 1);
+        crc32cInstruction = (info[2] >> 20) & 1;
+    }
+    return crc32cInstruction != 0;
+}
+
+static UINT32 Crc32cInstruction(UINT32 crc, const BYTE* p, SIZE_T length) {
+#if defined(_M_X64)
+    UINT64 wide = crc;
+    while (length >= 8) {
+        wide = _mm_crc32_u64(wide, *(const UINT64*)p);
+        p += 8;
+        length -= 8;
+    }
+    crc = (UINT32)wide;
+#else
+    while (length >= 4) {
+        crc = _mm_crc32_u32(crc, *(const UINT32*)p);
+        p += 4;
+        length -= 4;
+    }
+#endif
+
+    while (length--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+UINT32 CpioCrc32cUpdate(UINT32 crc, const void* data, SIZE_T length) {
+    const BYTE* p = (const BYTE*)data;
+    crc = ~crc;
+
+#ifdef CPIO_HASH_SSE2
+    if (HasCrc32cInstruction()) return ~Crc32cInstruction(crc, p, length);
+#endif
+
+    if (!crcReady) InitCrcTable();
+    while (length--) {
+        crc = (crc >> 8) ^ crc32cTable[(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+UINT32 CpioCksumUpdate(UINT32 crc, const void* data, SIZE_T length) {
+    if (!crcReady) InitCrcTable();
+
+    const BYTE* p = (const BYTE*)data;
+
+    while (length >= 8) {
+        UINT32 high = crc ^ (((UINT32)p[0] << 24) | ((UINT32)p[1] << 16) | ((UINT32)p[2] << 8) | p[3]);
+
+        crc = cksumTable[7][high >> 24] ^ cksumTable[6][(high >> 16) & 0xFF] ^
+              cksumTable[5][(high >> 8) & 0xFF] ^ cksumTable[4][high & 0xFF] ^
+              cksumTable[3][p[4]] ^ cksumTable[2][p[5]] ^
+              cksumTable[1][p[6]] ^ cksumTable[0][p[7]];
+        p += 8;
+        length -= 8;
+    }
+
+    while (length--) {
+        crc = (crc << 8) ^ cksumTable[0][(crc >> 24) ^ *p++];
+    }
+
+    return crc;
+}
+
+UINT32 CpioCksumFinal(UINT32 crc, UINT64 length) {
+    if (!crcReady) InitCrcTable();
+
+    for (; length > 0; length >>= 8) {
+        crc = (crc << 8) ^ cksumTable[0][(crc >> 24) ^ (length & 0xFF)];
+    }
+    return ~crc;
+}
+
+static UINT32 Gf2MatrixTimes(const UINT32* matrix, UINT32 vector) {
+    UINT32 sum = 0;
+    while (vector) {
+        if (vector & 1) sum ^= *matrix;
+        vector >>= 1;
+        matrix++;
+    }
+    return sum;
+}
+
+static void Gf2MatrixSquare(UINT32* square, const UINT32* matrix) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = Gf2MatrixTimes(matrix, matrix[n]);
+    }
+}
+
+UINT32 CpioCrc32Combine(UINT32 crc1, UINT32 crc2, UINT64 length2) {
+    if (length2 == 0) return crc1;
+
+    UINT32 even[32];
+    UINT32 odd[32];
+
+    odd[0] = 0xEDB88320;
+    UINT32 row = 1;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    Gf2MatrixSquare(even, odd);
+    Gf2MatrixSquare(odd, even);
+
+    do {
+        Gf2MatrixSquare(even, odd);
+        if (length2 & 1) crc1 = Gf2MatrixTimes(even, crc1);
+        length2 >>= 1;
+        if (length2 == 0) break;
+
+        Gf2MatrixSquare(odd, even);
+        if (length2 & 1) crc1 = Gf2MatrixTimes(odd, crc1);
+        length2 >>= 1;
+    } while (length2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+#define XXH_PRIME1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3 0x165667B19E3779F9ULL
+#define XXH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5 0x27D4EB2F165667C5ULL
+
+static UINT64 Rotl64(UINT64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static UINT64 XxhRound(UINT64 acc, UINT64 input) {
+    acc += input * XXH_PRIME2;
+    return Rotl64(acc, 31) * XXH_PRIME1;
+}
+
+static UINT64 XxhMerge(UINT64 acc, UINT64 value) {
+    acc ^= XxhRound(0, value);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+void CpioXxh64Init(CpioXxh64* xxh, UINT64 seed) {
+    CpioZeroMemory(xxh, sizeof(CpioXxh64));
+    xxh->seed = seed;
+    xxh->v[0] = seed + XXH_PRIME1 + XXH_PRIME2;
+    xxh->v[1] = seed + XXH_PRIME2;
+    xxh->v[2] = seed;
+    xxh->v[3] = seed - XXH_PRIME1;
+}
+
+static void XxhStripe(UINT64* v, const BYTE* p) {
+    v[0] = XxhRound(v[0], *(const UINT64*)p);
+    v[1] = XxhRound(v[1], *(const UINT64*)(p + 8));
+    v[2] = XxhRound(v[2], *(const UINT64*)(p + 16));
+    v[3] = XxhRound(v[3], *(const UINT64*)(p + 24));
+}
+
+void CpioXxh64Update(CpioXxh64* xxh, const void* data, SIZE_T length) {
+    const BYTE* p = (const BYTE*)data;
+    xxh->total += length;
+
+    if (xxh->bufferLength + length < sizeof(xxh->buffer)) {
+        CpioCopyMemory(xxh->buffer + xxh->bufferLength, p, length);
+        xxh->bufferLength += length;
+        return;
+    }
+
+    if (xxh->bufferLength > 0) {
+        SIZE_T fill = sizeof(xxh->buffer) - xxh->bufferLength;
+        CpioCopyMemory(xxh->buffer + xxh->bufferLength, p, fill);
+        XxhStripe(xxh->v, xxh->buffer);
+        p += fill;
+        length -= fill;
+        xxh->bufferLength = 0;
+    }
+
+    while (length >= sizeof(xxh->buffer)) {
+        XxhStripe(xxh->v, p);
+        p += sizeof(xxh->buffer);
+        length -= sizeof(xxh->buffer);
+    }
+
+    CpioCopyMemory(xxh->buffer, p, length);
+    xxh->bufferLength = length;
+}
+
+UINT64 CpioXxh64Digest(const CpioXxh64* xxh) {
+    UINT64 hash;
+
+    if (xxh->total >= sizeof(xxh->buffer)) {
+        hash = Rotl64(xxh->v[0], 1) + Rotl64(xxh->v[1], 7) + Rotl64(xxh->v[2], 12) + Rotl64(xxh->v[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = XxhMerge(hash, xxh->v[i]);
+        }
+    } else {
+        hash = xxh->seed + XXH_PRIME5;
+    }
+
+    hash += xxh->total;
+
+    const BYTE* p = xxh->buffer;
+    SIZE_T length = xxh->bufferLength;
+
+    for (; length >= 8; p += 8, length -= 8) {
+        hash ^= XxhRound(0, *(const UINT64*)p);
+        hash = Rotl64(hash, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+
+    if (length >= 4) {
+        hash ^= (UINT64)*(const UINT32*)p * XXH_PRIME1;
+        hash = Rotl64(hash, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+        length -= 4;
+    }
+
+    for (; length > 0; p++, length--) {
+        hash ^= *p * XXH_PRIME5;
+        hash = Rotl64(hash, 11) * XXH_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+#ifdef CPIO_HASH_SSE2
+static UINT32 HorizontalSum(__m128i acc) {
+    return (UINT32)_mm_cvtsi128_si32(acc) + (UINT32)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+#endif
+
+UINT32 CpioByteSumUpdate(UINT32 sum, const void* data, SIZE_T length) {
+    const BYTE* p = (const BYTE*)data;
+
+#ifdef CPIO_HASH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero;
+    __m128i acc1 = zero;
+
+    while (length >= 64) {
+        __m128i a = _mm_add_epi64(_mm_sad_epu8(_mm_loadu_si128((const __m128i*)p), zero),
+                                  _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(p + 16)), zero));
+        __m128i b = _mm_add_epi64(_mm_sad_epu8(_mm_loadu_si128((const __m128i*)(p + 32)), zero),
+                                  _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(p + 48)), zero));
+        acc0 = _mm_add_epi64(acc0, a);
+        acc1 = _mm_add_epi64(acc1, b);
+        p += 64;
+        length -= 64;
+    }
+
+    while (length >= 16) {
+        acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)p), zero));
+        p += 16;
+        length -= 16;
+    }
+
+    sum += HorizontalSum(_mm_add_epi64(acc0, acc1));
+#endif
+
+    while (length--) sum += *p++;
+    return sum;
+}
+
+UINT32 CpioByteSumCopy(UINT32 sum, void* dest, const void* src, SIZE_T length) {
+    BYTE* d = (BYTE*)dest;
+    const BYTE* s = (const BYTE*)src;
+
+#ifdef CPIO_HASH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero;
+    __m128i acc1 = zero;
+
+    while (length >= 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)s);
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(s + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(s + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_storeu_si128((__m128i*)d, v0);
+        _mm_storeu_si128((__m128i*)(d + 16), v1);
+        _mm_storeu_si128((__m128i*)(d + 32), v2);
+        _mm_storeu_si128((__m128i*)(d + 48), v3);
+        acc0 = _mm_add_epi64(acc0, _mm_add_epi64(_mm_sad_epu8(v0, zero), _mm_sad_epu8(v1, zero)));
+        acc1 = _mm_add_epi64(acc1, _mm_add_epi64(_mm_sad_epu8(v2, zero), _mm_sad_epu8(v3, zero)));
+        s += 64;
+        d += 64;
+        length -= 64;
+    }
+
+    sum += HorizontalSum(_mm_add_epi64(acc0, acc1));
+#endif
+
+    while (length--) {
+        sum += *s;
+        *d++ = *s++;
+    }
+    return sum;
+}
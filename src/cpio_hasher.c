@@ -0,0 +1,359 @@
+#include "cpio.h"
+
+static CpioHashChunk* NextChunk(CpioHasher* hasher) {
+    for (UINT64 i = hasher->retired; i < hasher->submitted; i++) {
+        CpioHashChunk* chunk = &hasher->chunks[i % hasher->chunkCount];
+        if (!chunk->done && !chunk->running && !chunk->member->busy) return chunk;
+    }
+    return NULL;
+}
+
+static DWORD WINAPI HashWorker(LPVOID param) {
+    CpioHasher* hasher = (CpioHasher*)param;
+
+    AcquireSRWLockExclusive(&hasher->lock);
+
+    for (;;) {
+        CpioHashChunk* chunk = NextChunk(hasher);
+        if (!chunk) {
+            if (hasher->shutdown) break;
+            SleepConditionVariableSRW(&hasher->workReady, &hasher->lock, INFINITE, 0);
+            continue;
+        }
+
+        CpioHashMember* member = chunk->member;
+        chunk->running = TRUE;
+        member->busy = TRUE;
+        ReleaseSRWLockExclusive(&hasher->lock);
+
+        CpioSha256Update(&member->sha, chunk->data, chunk->length);
+        member->crc32c = CpioCrc32cUpdate(member->crc32c, chunk->data, chunk->length);
+        if (chunk->last) CpioSha256Final(&member->sha, member->digest);
+
+        AcquireSRWLockExclusive(&hasher->lock);
+        chunk->running = FALSE;
+        chunk->done = TRUE;
+        member->busy = FALSE;
+
+        while (hasher->retired < hasher->submitted && hasher->chunks[hasher->retired % hasher->chunkCount].done) {
+            hasher->retired++;
+        }
+
+        WakeAllConditionVariable(&hasher->workDone);
+        WakeAllConditionVariable(&hasher->workReady);
+    }
+
+    ReleaseSRWLockExclusive(&hasher->lock);
+    return 0;
+}
+
+CpioHasher* CpioHasherCreate(UINT32 threadCount, CpioError* error) {
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    if (threadCount > CPIO_HASHER_MAX_THREADS) {
+        threadCount = CPIO_HASHER_MAX_THREADS;
+    }
+
+    CpioHasher* hasher = (CpioHasher*)CpioAlloc(sizeof(CpioHasher));
+    if (!hasher) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    InitializeSRWLock(&hasher->lock);
+    InitializeConditionVariable(&hasher->workReady);
+    InitializeConditionVariable(&hasher->workDone);
+
+    hasher->chunkCount = threadCount * 4;
+    hasher->chunks = (CpioHashChunk*)CpioAlloc(sizeof(CpioHashChunk) * hasher->chunkCount);
+    BOOL ok = hasher->chunks != NULL;
+
+    for (UINT32 i = 0; ok && i < hasher->chunkCount; i++) {
+        hasher->chunks[i].data = (BYTE*)CpioAlloc(CPIO_HASHER_CHUNK_SIZE);
+        ok = hasher->chunks[i].data != NULL;
+    }
+
+    if (!ok) {
+        CpioHasherDestroy(hasher);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    for (UINT32 i = 0; i < threadCount; i++) {
+        hasher->threads[hasher->started] = CreateThread(NULL, 0, HashWorker, hasher, 0, NULL);
+        if (hasher->threads[hasher->started]) hasher->started++;
+    }
+
+    if (hasher->started == 0) {
+        CpioHasherDestroy(hasher);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start hashing threads");
+        return NULL;
+    }
+
+    return hasher;
+}
+
+static CpioHashChunk* FillingChunk(CpioHasher* hasher) {
+    CpioHashChunk* chunk = &hasher->chunks[hasher->submitted % hasher->chunkCount];
+    if (hasher->filling) return chunk;
+
+    AcquireSRWLockExclusive(&hasher->lock);
+    while (hasher->submitted - hasher->retired >= hasher->chunkCount) {
+        SleepConditionVariableSRW(&hasher->workDone, &hasher->lock, INFINITE, 0);
+    }
+    ReleaseSRWLockExclusive(&hasher->lock);
+
+    chunk->member = hasher->open;
+    chunk->length = 0;
+    chunk->last = FALSE;
+    hasher->filling = TRUE;
+    return chunk;
+}
+
+static void SubmitChunk(CpioHasher* hasher, CpioHashChunk* chunk, BOOL last) {
+    AcquireSRWLockExclusive(&hasher->lock);
+    chunk->last = last;
+    chunk->running = FALSE;
+    chunk->done = FALSE;
+    hasher->submitted++;
+    hasher->filling = FALSE;
+    WakeConditionVariable(&hasher->workReady);
+    ReleaseSRWLockExclusive(&hasher->lock);
+}
+
+void CpioHasherBegin(CpioHasher* hasher, const char* path, UINT32 mtime, UINT64 inode) {
+    if (!hasher) return;
+    if (hasher->open) CpioHasherEnd(hasher, FALSE);
+
+    CpioHashMember* member = (CpioHashMember*)CpioAlloc(sizeof(CpioHashMember));
+    SIZE_T len = CpioStringLength(path);
+    char* copy = member ? (char*)CpioAlloc(len + 1) : NULL;
+
+    if (!copy) {
+        if (member) CpioFree(member);
+        hasher->failed = TRUE;
+        return;
+    }
+
+    CpioCopyMemory(copy, path, len + 1);
+    member->path = copy;
+    member->mtime = mtime;
+    member->inode = inode;
+    CpioSha256Init(&member->sha);
+
+    if (hasher->last) {
+        hasher->last->next = member;
+    } else {
+        hasher->first = member;
+    }
+    hasher->last = member;
+    hasher->open = member;
+}
+
+void CpioHasherLink(CpioHasher* hasher, UINT32 dev, UINT64 id, const WCHAR* source) {
+    if (!hasher || !hasher->open) return;
+
+    CpioHashMember* member = hasher->open;
+    member->linked = TRUE;
+    member->linkDev = dev;
+    member->linkId = id;
+
+    if (source) {
+        SIZE_T len = 0;
+        while (source[len]) len++;
+        member->source = (WCHAR*)CpioAlloc((len + 1) * sizeof(WCHAR));
+        if (!member->source) {
+            hasher->failed = TRUE;
+            return;
+        }
+        CpioCopyMemory(member->source, source, (len + 1) * sizeof(WCHAR));
+    }
+}
+
+void CpioHasherUpdate(CpioHasher* hasher, const void* data, SIZE_T length) {
+    if (!hasher || !hasher->open) return;
+
+    const BYTE* p = (const BYTE*)data;
+    hasher->open->fileSize += length;
+
+    while (length > 0) {
+        CpioHashChunk* chunk = FillingChunk(hasher);
+        SIZE_T take = CPIO_HASHER_CHUNK_SIZE - chunk->length;
+        if (take > length) take = length;
+
+        CpioCopyMemory(chunk->data + chunk->length, p, take);
+        chunk->length += take;
+        p += take;
+        length -= take;
+
+        if (chunk->length == CPIO_HASHER_CHUNK_SIZE) {
+            SubmitChunk(hasher, chunk, FALSE);
+        }
+    }
+}
+
+void CpioHasherCallback(void* context, const void* data, SIZE_T length) {
+    CpioHasherUpdate((CpioHasher*)context, data, length);
+}
+
+void CpioHasherEnd(CpioHasher* hasher, BOOL keep) {
+    if (!hasher || !hasher->open) return;
+
+    hasher->open->discarded = !keep;
+    SubmitChunk(hasher, FillingChunk(hasher), TRUE);
+    hasher->open = NULL;
+}
+
+static void StopWorkers(CpioHasher* hasher) {
+    AcquireSRWLockExclusive(&hasher->lock);
+    hasher->shutdown = TRUE;
+    WakeAllConditionVariable(&hasher->workReady);
+    ReleaseSRWLockExclusive(&hasher->lock);
+
+    if (hasher->started > 0) {
+        WaitForMultipleObjects(hasher->started, hasher->threads, TRUE, INFINITE);
+        for (UINT32 i = 0; i < hasher->started; i++) {
+            CloseHandle(hasher->threads[i]);
+        }
+        hasher->started = 0;
+    }
+}
+
+static BOOL HashSource(CpioHashMember* member) {
+    HANDLE hFile = CreateFileW(member->source, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CloseHandle(hFile);
+        return FALSE;
+    }
+
+    CpioSha256Init(&member->sha);
+    member->crc32c = 0;
+    member->fileSize = 0;
+
+    BOOL ok = TRUE;
+    for (;;) {
+        DWORD bytesRead;
+        if (!ReadFile(hFile, buffer, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL)) {
+            ok = FALSE;
+            break;
+        }
+        if (bytesRead == 0) break;
+        CpioSha256Update(&member->sha, buffer, bytesRead);
+        member->crc32c = CpioCrc32cUpdate(member->crc32c, buffer, bytesRead);
+        member->fileSize += bytesRead;
+    }
+
+    CpioBufferPoolRelease(buffer);
+    CloseHandle(hFile);
+
+    if (ok) CpioSha256Final(&member->sha, member->digest);
+    return ok;
+}
+
+static BOOL ShareLinkedData(CpioHasher* hasher) {
+    SIZE_T count = 0;
+    for (const CpioHashMember* member = hasher->first; member; member = member->next) {
+        if (member->linked && !member->discarded) count++;
+    }
+    if (count == 0) return TRUE;
+
+    CpioLinkTable* groups = CpioLinkTableCreate();
+    CpioHashMember** holders = (CpioHashMember**)CpioAlloc(sizeof(CpioHashMember*) * count);
+    if (!groups || !holders) {
+        CpioLinkTableDestroy(groups);
+        if (holders) CpioFree(holders);
+        return FALSE;
+    }
+
+    UINT32 held = 0;
+    BOOL ok = TRUE;
+    for (CpioHashMember* member = hasher->first; ok && member; member = member->next) {
+        if (!member->linked || member->discarded) continue;
+
+        CpioLink* group = CpioLinkTableFind(groups, member->linkDev, member->linkId, TRUE);
+        if (!group) {
+            ok = FALSE;
+        }
+        else if (member->fileSize > 0 && !group->inode) {
+            holders[held++] = member;
+            group->inode = held;
+        }
+    }
+
+    for (CpioHashMember* member = hasher->first; ok && member; member = member->next) {
+        if (!member->linked || member->discarded || member->fileSize > 0) continue;
+
+        CpioLink* group = CpioLinkTableFind(groups, member->linkDev, member->linkId, FALSE);
+        if (!group->inode && !group->expected && member->source) {
+            group->expected = 1;
+            if (HashSource(member) && member->fileSize > 0) {
+                holders[held++] = member;
+                group->inode = held;
+            }
+            continue;
+        }
+        if (!group->inode) continue;
+
+        const CpioHashMember* holder = holders[group->inode - 1];
+        member->fileSize = holder->fileSize;
+        member->crc32c = holder->crc32c;
+        CpioCopyMemory(member->digest, holder->digest, CPIO_SHA256_SIZE);
+    }
+
+    CpioFree(holders);
+    CpioLinkTableDestroy(groups);
+    return ok;
+}
+
+BOOL CpioHasherFinish(CpioHasher* hasher, CpioManifest* manifest, CpioError* error) {
+    if (!hasher || !manifest) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    CpioHasherEnd(hasher, FALSE);
+    StopWorkers(hasher);
+
+    BOOL ok = !hasher->failed && ShareLinkedData(hasher);
+    for (const CpioHashMember* member = hasher->first; ok && member; member = member->next) {
+        if (member->discarded) continue;
+        ok = CpioManifestAdd(manifest, member->path, member->fileSize, member->mtime, member->inode,
+                             member->digest, &member->crc32c);
+    }
+
+    if (!ok) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+    }
+    return ok;
+}
+
+void CpioHasherDestroy(CpioHasher* hasher) {
+    if (!hasher) return;
+
+    StopWorkers(hasher);
+
+    if (hasher->chunks) {
+        for (UINT32 i = 0; i < hasher->chunkCount; i++) {
+            if (hasher->chunks[i].data) CpioFree(hasher->chunks[i].data);
+        }
+        CpioFree(hasher->chunks);
+    }
+
+    CpioHashMember* member = hasher->first;
+    while (member) {
+        CpioHashMember* next = member->next;
+        CpioFree(member->path);
+        if (member->source) CpioFree(member->source);
+        CpioFree(member);
+        member = next;
+    }
+
+    CpioFree(hasher);
+}
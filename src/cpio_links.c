@@ -0,0 +1,230 @@
+#include "cpio.h"
+
+static UINT32 HashKey(UINT32 dev, UINT64 id) {
+    UINT64 key = id ^ ((UINT64)dev << 29);
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (UINT32)key;
+}
+
+CpioLinkTable* CpioLinkTableCreate(void) {
+    CpioLinkTable* table = (CpioLinkTable*)CpioAlloc(sizeof(CpioLinkTable));
+    if (!table) return NULL;
+
+    table->bucketCount = 256;
+    table->buckets = (CpioLink**)CpioAlloc(sizeof(CpioLink*) * table->bucketCount);
+    if (!table->buckets) {
+        CpioFree(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+void CpioLinkTableDestroy(CpioLinkTable* table) {
+    if (!table) return;
+
+    CpioLink* link = table->first;
+    while (link) {
+        CpioLink* next = link->nextInOrder;
+        if (link->path) CpioFree(link->path);
+        CpioStringListDestroy(link->names);
+        CpioFree(link);
+        link = next;
+    }
+
+    CpioFree(table->buckets);
+    CpioFree(table);
+}
+
+static void Grow(CpioLinkTable* table) {
+    SIZE_T newCount = table->bucketCount * 2;
+    CpioLink** newBuckets = (CpioLink**)CpioAlloc(sizeof(CpioLink*) * newCount);
+    if (!newBuckets) return;
+
+    for (CpioLink* link = table->first; link; link = link->nextInOrder) {
+        SIZE_T slot = HashKey(link->dev, link->id) & (newCount - 1);
+        link->next = newBuckets[slot];
+        newBuckets[slot] = link;
+    }
+
+    CpioFree(table->buckets);
+    table->buckets = newBuckets;
+    table->bucketCount = newCount;
+}
+
+CpioLink* CpioLinkTableFind(CpioLinkTable* table, UINT32 dev, UINT64 id, BOOL create) {
+    if (!table) return NULL;
+
+    UINT32 hash = HashKey(dev, id);
+    for (CpioLink* link = table->buckets[hash & (table->bucketCount - 1)]; link; link = link->next) {
+        if (link->dev == dev && link->id == id) return link;
+    }
+
+    if (!create) return NULL;
+
+    CpioLink* link = (CpioLink*)CpioAlloc(sizeof(CpioLink));
+    if (!link) return NULL;
+
+    link->names = CpioStringListCreate();
+    if (!link->names) {
+        CpioFree(link);
+        return NULL;
+    }
+    link->dev = dev;
+    link->id = id;
+
+    if (table->count >= table->bucketCount * 2) {
+        Grow(table);
+    }
+
+    SIZE_T slot = hash & (table->bucketCount - 1);
+    link->next = table->buckets[slot];
+    table->buckets[slot] = link;
+
+    if (table->last) {
+        table->last->nextInOrder = link;
+    } else {
+        table->first = link;
+    }
+    table->last = link;
+    table->count++;
+    return link;
+}
+
+void CpioLinkReset(CpioLink* link) {
+    if (link->path) {
+        CpioFree(link->path);
+        link->path = NULL;
+    }
+
+    for (SIZE_T i = 0; i < link->names->count; i++) {
+        CpioFree(link->names->items[i]);
+    }
+    link->names->count = 0;
+}
+
+static BOOL IsLinked(const CpioEntry* entry) {
+    return entry->nlink > 1 && (entry->mode & CPIO_S_IFMT) == CPIO_S_IFREG;
+}
+
+static CpioLink* FindEntryLink(CpioLinkTable* table, const CpioEntry* entry, BOOL create) {
+    return CpioLinkTableFind(table, entry->devMajor, ((UINT64)entry->devMinor << 32) | entry->inode, create);
+}
+
+static WCHAR* CopyWide(const WCHAR* text) {
+    SIZE_T len = 0;
+    while (text[len]) len++;
+
+    WCHAR* copy = (WCHAR*)CpioAlloc((len + 1) * sizeof(WCHAR));
+    if (copy) CpioCopyMemory(copy, text, (len + 1) * sizeof(WCHAR));
+    return copy;
+}
+
+static BOOL LinkTo(const WCHAR* path, const WCHAR* target) {
+    DeleteFileW(path);
+    return CreateHardLinkW(path, target, NULL) || CopyFileW(target, path, FALSE);
+}
+
+BOOL CpioLinkTableResolve(CpioLinkTable* table, const CpioEntry* entry, const WCHAR* path,
+                          BOOL* handled, CpioError* error) {
+    *handled = FALSE;
+    if (!table || !IsLinked(entry)) return TRUE;
+
+    CpioLink* link = FindEntryLink(table, entry, TRUE);
+    if (!link) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    if (link->path && entry->fileSize == 0) {
+        *handled = TRUE;
+        if (!LinkTo(path, link->path)) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create hard link");
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (!link->path && entry->fileSize == 0) {
+        char* deferred = CpioWideToString(path);
+        if (!deferred || !CpioStringListAdd(link->names, deferred)) {
+            if (deferred) CpioFree(deferred);
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return FALSE;
+        }
+        CpioFree(deferred);
+        table->deferred++;
+        *handled = TRUE;
+    }
+
+    return TRUE;
+}
+
+static BOOL LinkDeferred(CpioLinkTable* table, CpioLink* link) {
+    BOOL ok = TRUE;
+
+    table->deferred -= link->names->count;
+
+    for (SIZE_T i = 0; i < link->names->count; i++) {
+        WCHAR* deferred = CpioStringToWide(link->names->items[i]);
+        if (!deferred || !LinkTo(deferred, link->path)) ok = FALSE;
+        if (deferred) CpioFree(deferred);
+        CpioFree(link->names->items[i]);
+    }
+    link->names->count = 0;
+
+    return ok;
+}
+
+BOOL CpioLinkTableCommit(CpioLinkTable* table, const CpioEntry* entry, const WCHAR* path, CpioError* error) {
+    if (!table || !IsLinked(entry)) return TRUE;
+
+    CpioLink* link = FindEntryLink(table, entry, FALSE);
+    if (!link) return TRUE;
+
+    if (!link->path) {
+        link->path = CopyWide(path);
+        if (!link->path) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return FALSE;
+        }
+    }
+
+    if (!LinkDeferred(table, link)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create hard link");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL CpioLinkTableFinish(CpioLinkTable* table, CpioError* error) {
+    if (!table) return TRUE;
+
+    BOOL ok = TRUE;
+
+    for (CpioLink* link = table->first; link; link = link->nextInOrder) {
+        if (link->path || link->names->count == 0) continue;
+
+        WCHAR* first = CpioStringToWide(link->names->items[0]);
+        HANDLE hFile = first ? CreateFileW(first, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                           FILE_ATTRIBUTE_NORMAL, NULL) : INVALID_HANDLE_VALUE;
+
+        if (hFile == INVALID_HANDLE_VALUE) {
+            if (first) CpioFree(first);
+            ok = FALSE;
+            continue;
+        }
+        CloseHandle(hFile);
+
+        link->path = first;
+        CpioFree(link->names->items[0]);
+        link->names->items[0] = link->names->items[--link->names->count];
+        table->deferred--;
+        if (!LinkDeferred(table, link)) ok = FALSE;
+    }
+
+    if (!ok) CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create hard link");
+    return ok;
+}
@@ -0,0 +1,1038 @@
+#include "cpio.h"
+#include <intrin.h>
+
+#define LZMA_STATES 12
+#define LZMA_POS_STATES 16
+#define LZMA_LEN_STATES 4
+#define LZMA_END_POS_MODEL 14
+#define LZMA_MIN_MATCH 2
+#define LZMA_LITERAL 0xFFFFFFFF
+#define LZMA_REPS 4
+#define LZMA_PROPS 0x5D
+#define LZMA_LC 3
+#define LZMA_PB_MASK 3
+#define LZMA_NICE 64
+#define LZMA_CHAIN 32
+#define LZMA_HASH_SIZE (1 << CPIO_LZMA_HASH_BITS)
+#define LZMA_SYMBOL_MAX 128
+#define LZMA_TOP (1u << 24)
+
+#define LZMA2_UNPACKED_MAX (2 * 1024 * 1024)
+#define LZMA2_PACKED_MAX (64 * 1024)
+#define LZMA2_STORED_MAX (64 * 1024)
+
+#define XZ_HEADER_SIZE 12
+#define XZ_BLOCK_HEADER_SIZE 12
+#define XZ_CHECK_NONE 0
+#define XZ_CHECK_CRC32 1
+#define XZ_CHECK_CRC64 4
+#define XZ_FILTER_LZMA2 0x21
+
+static const BYTE XzMagic[6] = { 0xFD, '7', 'z', 'X', 'Z', 0 };
+static const BYTE XzCheckSizes[16] = { 0, 4, 4, 4, 8, 8, 8, 16, 16, 16, 32, 32, 32, 64, 64, 64 };
+
+static void ResetProbs(UINT16* probs, SIZE_T count) {
+    for (SIZE_T i = 0; i < count; i++) {
+        probs[i] = 1024;
+    }
+}
+
+static void ResetLength(CpioLzmaLengthModel* length) {
+    length->choice = 1024;
+    length->choice2 = 1024;
+    ResetProbs(&length->low[0][0], sizeof(length->low) / sizeof(UINT16));
+    ResetProbs(&length->mid[0][0], sizeof(length->mid) / sizeof(UINT16));
+    ResetProbs(length->high, sizeof(length->high) / sizeof(UINT16));
+}
+
+static void ResetModel(CpioLzmaModel* model) {
+    ResetProbs(&model->isMatch[0][0], sizeof(model->isMatch) / sizeof(UINT16));
+    ResetProbs(model->isRep, LZMA_STATES);
+    ResetProbs(model->isRepG0, LZMA_STATES);
+    ResetProbs(model->isRepG1, LZMA_STATES);
+    ResetProbs(model->isRepG2, LZMA_STATES);
+    ResetProbs(&model->isRep0Long[0][0], sizeof(model->isRep0Long) / sizeof(UINT16));
+    ResetProbs(&model->posSlot[0][0], sizeof(model->posSlot) / sizeof(UINT16));
+    ResetProbs(model->posSpecial, sizeof(model->posSpecial) / sizeof(UINT16));
+    ResetProbs(model->align, sizeof(model->align) / sizeof(UINT16));
+    ResetLength(&model->matchLength);
+    ResetLength(&model->repLength);
+    ResetProbs(&model->literal[0][0], (SIZE_T)0x300 << (model->lc + model->lp));
+
+    model->state = 0;
+    model->reps[0] = model->reps[1] = model->reps[2] = model->reps[3] = 0;
+}
+
+static UINT32 StateAfterLiteral(UINT32 state) {
+    return state < 4 ? 0 : state < 10 ? state - 3 : state - 6;
+}
+
+static UINT32 PosSlot(UINT32 back) {
+    if (back < 4) return back;
+
+    unsigned long bit;
+    _BitScanReverse(&bit, back);
+    return (bit << 1) | ((back >> (bit - 1)) & 1);
+}
+
+static SIZE_T MatchLength(const BYTE* a, const BYTE* b, SIZE_T maxLength) {
+    SIZE_T length = 0;
+
+    while (length + 8 <= maxLength) {
+        UINT64 diff = *(const UINT64*)(a + length) ^ *(const UINT64*)(b + length);
+        if (diff) {
+            unsigned long index;
+            _BitScanForward64(&index, diff);
+            return length + (index >> 3);
+        }
+        length += 8;
+    }
+
+    while (length < maxLength && a[length] == b[length]) length++;
+    return length;
+}
+
+static void WriteBigEndian16(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)(value >> 8);
+    p[1] = (BYTE)value;
+}
+
+static void WriteLittleEndian32(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)value;
+    p[1] = (BYTE)(value >> 8);
+    p[2] = (BYTE)(value >> 16);
+    p[3] = (BYTE)(value >> 24);
+}
+
+static UINT32 ReadLittleEndian32(const BYTE* p) {
+    return (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+typedef struct {
+    BYTE* output;
+    SIZE_T capacity;
+    SIZE_T pos;
+    UINT64 low;
+    UINT32 range;
+    BYTE cache;
+    SIZE_T cacheSize;
+} RangeEncoder;
+
+static void RcInit(RangeEncoder* rc, BYTE* output, SIZE_T capacity) {
+    rc->output = output;
+    rc->capacity = capacity;
+    rc->pos = 0;
+    rc->low = 0;
+    rc->range = 0xFFFFFFFF;
+    rc->cache = 0;
+    rc->cacheSize = 1;
+}
+
+static void RcShiftLow(RangeEncoder* rc) {
+    if ((UINT32)rc->low < 0xFF000000 || (rc->low >> 32) != 0) {
+        BYTE carry = (BYTE)(rc->low >> 32);
+        BYTE temp = rc->cache;
+
+        do {
+            if (rc->pos < rc->capacity) rc->output[rc->pos] = (BYTE)(temp + carry);
+            rc->pos++;
+            temp = 0xFF;
+        } while (--rc->cacheSize != 0);
+
+        rc->cache = (BYTE)(rc->low >> 24);
+    }
+
+    rc->cacheSize++;
+    rc->low = (rc->low & 0x00FFFFFF) << 8;
+}
+
+static void RcBit(RangeEncoder* rc, UINT16* prob, UINT32 bit) {
+    UINT32 bound = (rc->range >> 11) * *prob;
+
+    if (bit == 0) {
+        rc->range = bound;
+        *prob += (2048 - *prob) >> 5;
+    } else {
+        rc->low += bound;
+        rc->range -= bound;
+        *prob -= *prob >> 5;
+    }
+
+    if (rc->range < LZMA_TOP) {
+        rc->range <<= 8;
+        RcShiftLow(rc);
+    }
+}
+
+static void RcDirect(RangeEncoder* rc, UINT32 value, UINT32 count) {
+    while (count--) {
+        rc->range >>= 1;
+        if ((value >> count) & 1) rc->low += rc->range;
+
+        if (rc->range < LZMA_TOP) {
+            rc->range <<= 8;
+            RcShiftLow(rc);
+        }
+    }
+}
+
+static void RcBitTree(RangeEncoder* rc, UINT16* probs, UINT32 bits, UINT32 symbol) {
+    UINT32 m = 1;
+    while (bits--) {
+        UINT32 bit = (symbol >> bits) & 1;
+        RcBit(rc, &probs[m], bit);
+        m = (m << 1) | bit;
+    }
+}
+
+static void RcReverseBitTree(RangeEncoder* rc, UINT16* probs, UINT32 bits, UINT32 symbol) {
+    UINT32 m = 1;
+    while (bits--) {
+        UINT32 bit = symbol & 1;
+        symbol >>= 1;
+        RcBit(rc, &probs[m], bit);
+        m = (m << 1) | bit;
+    }
+}
+
+static SIZE_T RcPending(const RangeEncoder* rc) {
+    return rc->pos + rc->cacheSize + 5;
+}
+
+static SIZE_T RcFlush(RangeEncoder* rc) {
+    for (int i = 0; i < 5; i++) {
+        RcShiftLow(rc);
+    }
+    return rc->pos;
+}
+
+CpioLzmaEncoder* CpioLzmaEncoderCreate(void) {
+    CpioLzmaEncoder* encoder = (CpioLzmaEncoder*)CpioAlloc(sizeof(CpioLzmaEncoder));
+    if (!encoder) return NULL;
+
+    encoder->head = (UINT32*)CpioAlloc(sizeof(UINT32) * LZMA_HASH_SIZE);
+    encoder->prev = (UINT32*)CpioAlloc(sizeof(UINT32) * CPIO_LZMA_DICT_SIZE);
+    encoder->chunk = (BYTE*)CpioAlloc(LZMA2_PACKED_MAX + LZMA_SYMBOL_MAX * 2);
+
+    if (!encoder->head || !encoder->prev || !encoder->chunk) {
+        CpioLzmaEncoderDestroy(encoder);
+        return NULL;
+    }
+
+    encoder->model.lc = LZMA_LC;
+    return encoder;
+}
+
+void CpioLzmaEncoderDestroy(CpioLzmaEncoder* encoder) {
+    if (!encoder) return;
+
+    if (encoder->head) CpioFree(encoder->head);
+    if (encoder->prev) CpioFree(encoder->prev);
+    if (encoder->chunk) CpioFree(encoder->chunk);
+    CpioFree(encoder);
+}
+
+static UINT32 Hash3(const BYTE* p) {
+    UINT32 value = (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16);
+    return (value * 2654435761u) >> (32 - CPIO_LZMA_HASH_BITS);
+}
+
+static UINT32 Available(SIZE_T pos, SIZE_T length) {
+    SIZE_T available = length - pos;
+    return available > CPIO_LZMA_MAX_MATCH ? CPIO_LZMA_MAX_MATCH : (UINT32)available;
+}
+
+static void SkipTo(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T length, SIZE_T target) {
+    while (encoder->nextInsert < target) {
+        SIZE_T pos = encoder->nextInsert++;
+        if (pos + 3 > length) continue;
+
+        UINT32 hash = Hash3(data + pos);
+        encoder->prev[pos & (CPIO_LZMA_DICT_SIZE - 1)] = encoder->head[hash];
+        encoder->head[hash] = (UINT32)(pos + 1);
+    }
+}
+
+static UINT32 FindMatches(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T pos, UINT32 available,
+                          CpioLzmaMatch* matches) {
+    if (available < 3) return 0;
+
+    UINT32 hash = Hash3(data + pos);
+    UINT32 candidate = encoder->head[hash];
+    encoder->prev[pos & (CPIO_LZMA_DICT_SIZE - 1)] = candidate;
+    encoder->head[hash] = (UINT32)(pos + 1);
+
+    const BYTE* current = data + pos;
+    UINT32 best = LZMA_MIN_MATCH;
+    UINT32 count = 0;
+    UINT32 chain = LZMA_CHAIN;
+
+    while (candidate != 0 && chain-- > 0) {
+        SIZE_T match = candidate - 1;
+        SIZE_T distance = pos - match;
+        if (distance >= CPIO_LZMA_DICT_SIZE) break;
+
+        const BYTE* other = data + match;
+        if (other[best] == current[best] && other[0] == current[0] && other[1] == current[1]) {
+            UINT32 length = (UINT32)MatchLength(current, other, available);
+            if (length > best) {
+                best = length;
+                matches[count].length = length;
+                matches[count].back = (UINT32)(distance - 1);
+                count++;
+                if (length >= LZMA_NICE || length == available) break;
+            }
+        }
+
+        candidate = encoder->prev[match & (CPIO_LZMA_DICT_SIZE - 1)];
+    }
+
+    return count;
+}
+
+static UINT32 MatchesAt(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T length, SIZE_T pos,
+                        CpioLzmaMatch** matches) {
+    UINT32 slot = (UINT32)(pos & 1);
+
+    if (encoder->matchPos[slot] != pos + 1) {
+        SkipTo(encoder, data, length, pos);
+        encoder->matchCount[slot] = FindMatches(encoder, data, pos, Available(pos, length), encoder->matches[slot]);
+        encoder->matchPos[slot] = pos + 1;
+        encoder->nextInsert = pos + 1;
+    }
+
+    *matches = encoder->matches[slot];
+    return encoder->matchCount[slot];
+}
+
+static BOOL ChangePair(UINT32 smallBack, UINT32 bigBack) {
+    return (bigBack >> 7) > smallBack;
+}
+
+static UINT32 ChooseSymbol(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T pos, SIZE_T length, UINT32* back) {
+    CpioLzmaMatch* matches;
+    UINT32 count = MatchesAt(encoder, data, length, pos, &matches);
+    UINT32 available = Available(pos, length);
+    const UINT32* reps = encoder->model.reps;
+    const BYTE* current = data + pos;
+
+    *back = LZMA_LITERAL;
+    if (available < 2) return 1;
+
+    UINT32 repLength = 0;
+    UINT32 repIndex = 0;
+
+    for (UINT32 i = 0; i < LZMA_REPS; i++) {
+        if (reps[i] >= pos) continue;
+
+        const BYTE* other = current - reps[i] - 1;
+        if (other[0] != current[0] || other[1] != current[1]) continue;
+
+        UINT32 len = (UINT32)MatchLength(current, other, available);
+        if (len >= LZMA_NICE) {
+            *back = i;
+            return len;
+        }
+        if (len > repLength) {
+            repIndex = i;
+            repLength = len;
+        }
+    }
+
+    UINT32 mainLength = count ? matches[count - 1].length : 0;
+    UINT32 mainBack = 0;
+
+    if (mainLength >= LZMA_NICE) {
+        *back = matches[count - 1].back + LZMA_REPS;
+        return mainLength;
+    }
+
+    if (mainLength >= LZMA_MIN_MATCH) {
+        mainBack = matches[count - 1].back;
+        while (count > 1 && mainLength == matches[count - 2].length + 1) {
+            if (!ChangePair(matches[count - 2].back, mainBack)) break;
+            count--;
+            mainLength = matches[count - 1].length;
+            mainBack = matches[count - 1].back;
+        }
+    }
+
+    if (repLength >= LZMA_MIN_MATCH &&
+        (repLength + 1 >= mainLength ||
+         (repLength + 2 >= mainLength && mainBack > (1u << 9)) ||
+         (repLength + 3 >= mainLength && mainBack > (1u << 15)))) {
+        *back = repIndex;
+        return repLength;
+    }
+
+    if (mainLength < LZMA_MIN_MATCH || available <= 2) return 1;
+
+    CpioLzmaMatch* next;
+    UINT32 nextCount = MatchesAt(encoder, data, length, pos + 1, &next);
+    if (nextCount > 0) {
+        UINT32 nextLength = next[nextCount - 1].length;
+        UINT32 nextBack = next[nextCount - 1].back;
+
+        if ((nextLength >= mainLength && nextBack < mainBack) ||
+            (nextLength == mainLength + 1 && !ChangePair(mainBack, nextBack)) ||
+            nextLength > mainLength + 1 ||
+            (nextLength + 1 >= mainLength && mainLength >= 3 && ChangePair(nextBack, mainBack))) {
+            return 1;
+        }
+    }
+
+    UINT32 limit = mainLength - 1 > 2 ? mainLength - 1 : 2;
+    for (UINT32 i = 0; i < LZMA_REPS; i++) {
+        if (reps[i] > pos) continue;
+        if (CpioCompareMemory(current + 1, current - reps[i], limit) == 0) return 1;
+    }
+
+    *back = mainBack + LZMA_REPS;
+    return mainLength;
+}
+
+static void EncodeLength(RangeEncoder* rc, CpioLzmaLengthModel* model, UINT32 length, UINT32 posState) {
+    length -= LZMA_MIN_MATCH;
+
+    if (length < 8) {
+        RcBit(rc, &model->choice, 0);
+        RcBitTree(rc, model->low[posState], 3, length);
+    } else if (length < 16) {
+        RcBit(rc, &model->choice, 1);
+        RcBit(rc, &model->choice2, 0);
+        RcBitTree(rc, model->mid[posState], 3, length - 8);
+    } else {
+        RcBit(rc, &model->choice, 1);
+        RcBit(rc, &model->choice2, 1);
+        RcBitTree(rc, model->high, 8, length - 16);
+    }
+}
+
+static void EncodeLiteral(CpioLzmaModel* model, RangeEncoder* rc, const BYTE* data, SIZE_T pos) {
+    UINT32 prevByte = pos > 0 ? data[pos - 1] : 0;
+    UINT16* probs = model->literal[prevByte >> (8 - LZMA_LC)];
+    UINT32 symbol = data[pos] | 0x100;
+
+    RcBit(rc, &model->isMatch[model->state][pos & LZMA_PB_MASK], 0);
+
+    if (model->state < 7) {
+        do {
+            RcBit(rc, &probs[symbol >> 8], (symbol >> 7) & 1);
+            symbol <<= 1;
+        } while (symbol < 0x10000);
+    } else {
+        UINT32 matchByte = data[pos - model->reps[0] - 1];
+        UINT32 offset = 0x100;
+
+        do {
+            matchByte <<= 1;
+            RcBit(rc, &probs[offset + (matchByte & offset) + (symbol >> 8)], (symbol >> 7) & 1);
+            symbol <<= 1;
+            offset &= ~(matchByte ^ symbol);
+        } while (symbol < 0x10000);
+    }
+
+    model->state = StateAfterLiteral(model->state);
+}
+
+static void EncodeMatch(CpioLzmaModel* model, RangeEncoder* rc, UINT32 back, UINT32 length, UINT32 posState) {
+    RcBit(rc, &model->isMatch[model->state][posState], 1);
+    RcBit(rc, &model->isRep[model->state], 0);
+    EncodeLength(rc, &model->matchLength, length, posState);
+
+    UINT32 lenState = length - LZMA_MIN_MATCH < LZMA_LEN_STATES ? length - LZMA_MIN_MATCH : LZMA_LEN_STATES - 1;
+    UINT32 slot = PosSlot(back);
+    RcBitTree(rc, model->posSlot[lenState], 6, slot);
+
+    if (slot >= 4) {
+        UINT32 footerBits = (slot >> 1) - 1;
+        UINT32 base = (2 | (slot & 1)) << footerBits;
+        UINT32 reduced = back - base;
+
+        if (slot < LZMA_END_POS_MODEL) {
+            RcReverseBitTree(rc, model->posSpecial + base - slot - 1, footerBits, reduced);
+        } else {
+            RcDirect(rc, reduced >> 4, footerBits - 4);
+            RcReverseBitTree(rc, model->align, 4, reduced & 15);
+        }
+    }
+
+    model->reps[3] = model->reps[2];
+    model->reps[2] = model->reps[1];
+    model->reps[1] = model->reps[0];
+    model->reps[0] = back;
+    model->state = model->state < 7 ? 7 : 10;
+}
+
+static void EncodeRep(CpioLzmaModel* model, RangeEncoder* rc, UINT32 index, UINT32 length, UINT32 posState) {
+    RcBit(rc, &model->isMatch[model->state][posState], 1);
+    RcBit(rc, &model->isRep[model->state], 1);
+
+    if (index == 0) {
+        RcBit(rc, &model->isRepG0[model->state], 0);
+        RcBit(rc, &model->isRep0Long[model->state][posState], 1);
+    } else {
+        UINT32 back = model->reps[index];
+        RcBit(rc, &model->isRepG0[model->state], 1);
+
+        if (index == 1) {
+            RcBit(rc, &model->isRepG1[model->state], 0);
+        } else {
+            RcBit(rc, &model->isRepG1[model->state], 1);
+            RcBit(rc, &model->isRepG2[model->state], index - 2);
+            if (index == 3) model->reps[3] = model->reps[2];
+            model->reps[2] = model->reps[1];
+        }
+
+        model->reps[1] = model->reps[0];
+        model->reps[0] = back;
+    }
+
+    EncodeLength(rc, &model->repLength, length, posState);
+    model->state = model->state < 7 ? 8 : 11;
+}
+
+static BYTE* WriteStoredChunks(BYTE* out, const BYTE* data, SIZE_T length, BOOL* needDictReset) {
+    while (length > 0) {
+        SIZE_T chunk = length > LZMA2_STORED_MAX ? LZMA2_STORED_MAX : length;
+
+        *out++ = *needDictReset ? 1 : 2;
+        WriteBigEndian16(out, (UINT32)(chunk - 1));
+        out += 2;
+        CpioCopyMemory(out, data, chunk);
+
+        *needDictReset = FALSE;
+        out += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    return out;
+}
+
+static BYTE* EncodeLzma2(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T length, BYTE* out) {
+    CpioLzmaModel* model = &encoder->model;
+    BOOL needDictReset = TRUE;
+    BOOL needProps = TRUE;
+    BOOL needStateReset = TRUE;
+    SIZE_T pos = 0;
+
+    while (pos < length) {
+        if (needStateReset) ResetModel(model);
+
+        RangeEncoder rc;
+        RcInit(&rc, encoder->chunk, LZMA2_PACKED_MAX + LZMA_SYMBOL_MAX * 2);
+        SIZE_T start = pos;
+
+        while (pos < length && pos - start <= LZMA2_UNPACKED_MAX - CPIO_LZMA_MAX_MATCH &&
+               RcPending(&rc) <= LZMA2_PACKED_MAX - LZMA_SYMBOL_MAX) {
+            UINT32 back;
+            UINT32 len = ChooseSymbol(encoder, data, pos, length, &back);
+            UINT32 posState = (UINT32)(pos & LZMA_PB_MASK);
+
+            if (back == LZMA_LITERAL) {
+                EncodeLiteral(model, &rc, data, pos);
+            } else if (back < LZMA_REPS) {
+                EncodeRep(model, &rc, back, len, posState);
+            } else {
+                EncodeMatch(model, &rc, back - LZMA_REPS, len, posState);
+            }
+            pos += len;
+        }
+
+        SIZE_T packed = RcFlush(&rc);
+        SIZE_T unpacked = pos - start;
+
+        if (packed >= unpacked || packed > LZMA2_PACKED_MAX) {
+            out = WriteStoredChunks(out, data + start, unpacked, &needDictReset);
+            needStateReset = TRUE;
+            continue;
+        }
+
+        UINT32 reset = needDictReset ? 3 : needProps ? 2 : needStateReset ? 1 : 0;
+        *out++ = (BYTE)(0x80 | (reset << 5) | ((unpacked - 1) >> 16));
+        WriteBigEndian16(out, (UINT32)(unpacked - 1));
+        WriteBigEndian16(out + 2, (UINT32)(packed - 1));
+        out += 4;
+        if (reset >= 2) *out++ = LZMA_PROPS;
+
+        CpioCopyMemory(out, encoder->chunk, packed);
+        out += packed;
+
+        needDictReset = FALSE;
+        needProps = FALSE;
+        needStateReset = FALSE;
+    }
+
+    *out++ = 0;
+    return out;
+}
+
+static BYTE* WriteVarint(BYTE* out, UINT64 value) {
+    while (value >= 0x80) {
+        *out++ = (BYTE)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (BYTE)value;
+    return out;
+}
+
+SIZE_T CpioXzBound(SIZE_T length) {
+    return length + length / 8192 + 256;
+}
+
+SIZE_T CpioXzCompress(CpioLzmaEncoder* encoder, const BYTE* data, SIZE_T length, BYTE* output, SIZE_T outputSize) {
+    if (!encoder || !output || outputSize < CpioXzBound(length) || length > 0xFFFFFFF0) return 0;
+
+    CpioZeroMemory(encoder->head, sizeof(UINT32) * LZMA_HASH_SIZE);
+    encoder->matchPos[0] = 0;
+    encoder->matchPos[1] = 0;
+    encoder->nextInsert = 0;
+
+    BYTE* out = output;
+    BYTE flags[2] = { 0, XZ_CHECK_CRC64 };
+
+    CpioCopyMemory(out, XzMagic, sizeof(XzMagic));
+    CpioCopyMemory(out + 6, flags, sizeof(flags));
+    WriteLittleEndian32(out + 8, CpioCrc32Update(0, flags, sizeof(flags)));
+    out += XZ_HEADER_SIZE;
+
+    BYTE* block = out;
+    CpioZeroMemory(block, XZ_BLOCK_HEADER_SIZE);
+    block[0] = XZ_BLOCK_HEADER_SIZE / 4 - 1;
+    block[2] = XZ_FILTER_LZMA2;
+    block[3] = 1;
+    block[4] = CPIO_LZMA_DICT_PROP;
+    WriteLittleEndian32(block + 8, CpioCrc32Update(0, block, XZ_BLOCK_HEADER_SIZE - 4));
+    out += XZ_BLOCK_HEADER_SIZE;
+
+    BYTE* packedStart = out;
+    out = EncodeLzma2(encoder, data, length, out);
+    UINT64 unpaddedSize = XZ_BLOCK_HEADER_SIZE + (UINT64)(out - packedStart) + 8;
+
+    while ((out - output) & 3) *out++ = 0;
+
+    UINT64 check = CpioCrc64Update(0, data, length);
+    for (int i = 0; i < 8; i++) {
+        *out++ = (BYTE)(check >> (i * 8));
+    }
+
+    BYTE* index = out;
+    *out++ = 0;
+    out = WriteVarint(out, 1);
+    out = WriteVarint(out, unpaddedSize);
+    out = WriteVarint(out, length);
+    while ((out - index) & 3) *out++ = 0;
+    WriteLittleEndian32(out, CpioCrc32Update(0, index, (SIZE_T)(out - index)));
+    out += 4;
+
+    UINT32 backwardSize = (UINT32)((out - index) / 4 - 1);
+    WriteLittleEndian32(out + 4, backwardSize);
+    CpioCopyMemory(out + 8, flags, sizeof(flags));
+    WriteLittleEndian32(out, CpioCrc32Update(0, out + 4, 6));
+    out[10] = 'Y';
+    out[11] = 'Z';
+    out += 12;
+
+    return (SIZE_T)(out - output);
+}
+
+typedef struct {
+    const BYTE* input;
+    SIZE_T pos;
+    SIZE_T end;
+    UINT32 range;
+    UINT32 code;
+} RangeDecoder;
+
+static BYTE RdByte(RangeDecoder* rd) {
+    BYTE value = rd->pos < rd->end ? rd->input[rd->pos] : 0;
+    rd->pos++;
+    return value;
+}
+
+static BOOL RdInit(RangeDecoder* rd, const BYTE* input, SIZE_T pos, SIZE_T end) {
+    rd->input = input;
+    rd->pos = pos;
+    rd->end = end;
+    rd->range = 0xFFFFFFFF;
+    rd->code = 0;
+
+    if (RdByte(rd) != 0) return FALSE;
+    for (int i = 0; i < 4; i++) {
+        rd->code = (rd->code << 8) | RdByte(rd);
+    }
+    return rd->code != 0xFFFFFFFF;
+}
+
+static UINT32 RdBit(RangeDecoder* rd, UINT16* prob) {
+    UINT32 bound = (rd->range >> 11) * *prob;
+    UINT32 bit;
+
+    if (rd->code < bound) {
+        rd->range = bound;
+        *prob += (2048 - *prob) >> 5;
+        bit = 0;
+    } else {
+        rd->code -= bound;
+        rd->range -= bound;
+        *prob -= *prob >> 5;
+        bit = 1;
+    }
+
+    if (rd->range < LZMA_TOP) {
+        rd->range <<= 8;
+        rd->code = (rd->code << 8) | RdByte(rd);
+    }
+    return bit;
+}
+
+static UINT32 RdDirect(RangeDecoder* rd, UINT32 count) {
+    UINT32 result = 0;
+
+    while (count--) {
+        rd->range >>= 1;
+        UINT32 bit = rd->code >= rd->range;
+        if (bit) rd->code -= rd->range;
+        result = (result << 1) | bit;
+
+        if (rd->range < LZMA_TOP) {
+            rd->range <<= 8;
+            rd->code = (rd->code << 8) | RdByte(rd);
+        }
+    }
+    return result;
+}
+
+static UINT32 RdBitTree(RangeDecoder* rd, UINT16* probs, UINT32 bits) {
+    UINT32 m = 1;
+    for (UINT32 i = 0; i < bits; i++) {
+        m = (m << 1) | RdBit(rd, &probs[m]);
+    }
+    return m - (1u << bits);
+}
+
+static UINT32 RdReverseBitTree(RangeDecoder* rd, UINT16* probs, UINT32 bits) {
+    UINT32 m = 1;
+    UINT32 symbol = 0;
+    for (UINT32 i = 0; i < bits; i++) {
+        UINT32 bit = RdBit(rd, &probs[m]);
+        m = (m << 1) | bit;
+        symbol |= bit << i;
+    }
+    return symbol;
+}
+
+static UINT32 DecodeLength(RangeDecoder* rd, CpioLzmaLengthModel* model, UINT32 posState) {
+    if (RdBit(rd, &model->choice) == 0) {
+        return LZMA_MIN_MATCH + RdBitTree(rd, model->low[posState], 3);
+    }
+    if (RdBit(rd, &model->choice2) == 0) {
+        return LZMA_MIN_MATCH + 8 + RdBitTree(rd, model->mid[posState], 3);
+    }
+    return LZMA_MIN_MATCH + 16 + RdBitTree(rd, model->high, 8);
+}
+
+static UINT32 DecodeDistance(RangeDecoder* rd, CpioLzmaModel* model, UINT32 length) {
+    UINT32 lenState = length - LZMA_MIN_MATCH < LZMA_LEN_STATES ? length - LZMA_MIN_MATCH : LZMA_LEN_STATES - 1;
+    UINT32 slot = RdBitTree(rd, model->posSlot[lenState], 6);
+    if (slot < 4) return slot;
+
+    UINT32 footerBits = (slot >> 1) - 1;
+    UINT32 back = (2 | (slot & 1)) << footerBits;
+
+    if (slot < LZMA_END_POS_MODEL) {
+        return back + RdReverseBitTree(rd, model->posSpecial + back - slot - 1, footerBits);
+    }
+
+    back += RdDirect(rd, footerBits - 4) << 4;
+    return back + RdReverseBitTree(rd, model->align, 4);
+}
+
+static BOOL DecodeLzmaChunk(CpioLzmaModel* model, RangeDecoder* rd, BYTE* output, SIZE_T dictStart,
+                            SIZE_T* outPos, SIZE_T chunkEnd) {
+    SIZE_T pos = *outPos;
+    UINT32 pbMask = (1u << model->pb) - 1;
+    UINT32 lpMask = (1u << model->lp) - 1;
+
+    while (pos < chunkEnd) {
+        SIZE_T processed = pos - dictStart;
+        UINT32 posState = (UINT32)(processed & pbMask);
+
+        if (RdBit(rd, &model->isMatch[model->state][posState]) == 0) {
+            UINT32 prevByte = processed > 0 ? output[pos - 1] : 0;
+            UINT16* probs = model->literal[((processed & lpMask) << model->lc) + (prevByte >> (8 - model->lc))];
+            UINT32 symbol = 1;
+
+            if (model->state < 7) {
+                do {
+                    symbol = (symbol << 1) | RdBit(rd, &probs[symbol]);
+                } while (symbol < 0x100);
+            } else {
+                if (model->reps[0] >= processed) return FALSE;
+
+                UINT32 matchByte = output[pos - model->reps[0] - 1];
+                UINT32 offset = 0x100;
+
+                do {
+                    matchByte <<= 1;
+                    UINT32 matchBit = matchByte & offset;
+                    UINT32 bit = RdBit(rd, &probs[offset + matchBit + symbol]);
+                    symbol = (symbol << 1) | bit;
+                    offset &= bit ? matchBit : ~matchBit;
+                } while (symbol < 0x100);
+            }
+
+            output[pos++] = (BYTE)symbol;
+            model->state = StateAfterLiteral(model->state);
+            continue;
+        }
+
+        UINT32 length;
+
+        if (RdBit(rd, &model->isRep[model->state]) == 0) {
+            length = DecodeLength(rd, &model->matchLength, posState);
+            UINT32 back = DecodeDistance(rd, model, length);
+
+            model->reps[3] = model->reps[2];
+            model->reps[2] = model->reps[1];
+            model->reps[1] = model->reps[0];
+            model->reps[0] = back;
+            model->state = model->state < 7 ? 7 : 10;
+        } else {
+            if (RdBit(rd, &model->isRepG0[model->state]) == 0) {
+                if (RdBit(rd, &model->isRep0Long[model->state][posState]) == 0) {
+                    if (model->reps[0] >= processed) return FALSE;
+
+                    output[pos] = output[pos - model->reps[0] - 1];
+                    pos++;
+                    model->state = model->state < 7 ? 9 : 11;
+                    continue;
+                }
+            } else {
+                UINT32 back;
+                if (RdBit(rd, &model->isRepG1[model->state]) == 0) {
+                    back = model->reps[1];
+                } else {
+                    if (RdBit(rd, &model->isRepG2[model->state]) == 0) {
+                        back = model->reps[2];
+                    } else {
+                        back = model->reps[3];
+                        model->reps[3] = model->reps[2];
+                    }
+                    model->reps[2] = model->reps[1];
+                }
+                model->reps[1] = model->reps[0];
+                model->reps[0] = back;
+            }
+
+            length = DecodeLength(rd, &model->repLength, posState);
+            model->state = model->state < 7 ? 8 : 11;
+        }
+
+        UINT32 back = model->reps[0];
+        if (back >= processed || length > chunkEnd - pos) return FALSE;
+
+        const BYTE* from = output + pos - back - 1;
+        BYTE* to = output + pos;
+        pos += length;
+        while (length--) *to++ = *from++;
+    }
+
+    *outPos = pos;
+    return rd->pos <= rd->end;
+}
+
+static BOOL DecodeLzma2(CpioLzmaModel* model, const BYTE* input, SIZE_T* inPos, SIZE_T inEnd,
+                        BYTE* output, SIZE_T* outPos, SIZE_T outputSize, CpioError* error) {
+    SIZE_T ip = *inPos;
+    SIZE_T op = *outPos;
+    SIZE_T dictStart = op;
+    BOOL needDictReset = TRUE;
+    BOOL needProps = TRUE;
+
+    for (;;) {
+        if (ip >= inEnd) break;
+
+        BYTE control = input[ip++];
+        if (control == 0) {
+            *inPos = ip;
+            *outPos = op;
+            return TRUE;
+        }
+
+        if (control == 1 || control == 2) {
+            if (ip + 2 > inEnd) break;
+            SIZE_T size = (((SIZE_T)input[ip] << 8) | input[ip + 1]) + 1;
+            ip += 2;
+
+            if (control == 1) {
+                dictStart = op;
+                needDictReset = FALSE;
+            } else if (needDictReset) {
+                break;
+            }
+
+            if (size > inEnd - ip || size > outputSize - op) break;
+            CpioCopyMemory(output + op, input + ip, size);
+            ip += size;
+            op += size;
+            continue;
+        }
+
+        if (control < 0x80 || ip + 4 > inEnd) break;
+
+        SIZE_T unpacked = ((SIZE_T)(control & 0x1F) << 16) + ((SIZE_T)input[ip] << 8) + input[ip + 1] + 1;
+        SIZE_T packed = ((SIZE_T)input[ip + 2] << 8) + input[ip + 3] + 1;
+        UINT32 reset = (control >> 5) & 3;
+        ip += 4;
+
+        if (reset == 3) {
+            dictStart = op;
+            needDictReset = FALSE;
+        } else if (needDictReset) {
+            break;
+        }
+
+        if (reset >= 2) {
+            if (ip >= inEnd) break;
+            UINT32 props = input[ip++];
+            if (props >= 9 * 5 * 5) break;
+
+            model->lc = props % 9;
+            model->lp = (props / 9) % 5;
+            model->pb = props / 45;
+            if (model->lc + model->lp > 4) break;
+            needProps = FALSE;
+        } else if (needProps) {
+            break;
+        }
+
+        if (reset >= 1) ResetModel(model);
+
+        if (packed > inEnd - ip || unpacked > outputSize - op) break;
+
+        RangeDecoder rd;
+        if (!RdInit(&rd, input, ip, ip + packed) ||
+            !DecodeLzmaChunk(model, &rd, output, dictStart, &op, op + unpacked)) {
+            break;
+        }
+        ip += packed;
+    }
+
+    CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt LZMA2 data");
+    return FALSE;
+}
+
+static BOOL ReadVarint(const BYTE* input, SIZE_T end, SIZE_T* pos, UINT64* value) {
+    UINT64 result = 0;
+
+    for (int i = 0; i < 9; i++) {
+        if (*pos >= end) return FALSE;
+
+        BYTE b = input[(*pos)++];
+        result |= (UINT64)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) {
+            *value = result;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static BOOL ParseBlockHeader(const BYTE* input, SIZE_T length, SIZE_T* pos, CpioError* error) {
+    SIZE_T start = *pos;
+    SIZE_T headerSize = ((SIZE_T)input[start] + 1) * 4;
+
+    if (headerSize > length - start ||
+        CpioCrc32Update(0, input + start, headerSize - 4) != ReadLittleEndian32(input + start + headerSize - 4)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt xz block header");
+        return FALSE;
+    }
+
+    SIZE_T p = start + 1;
+    SIZE_T end = start + headerSize - 4;
+    BYTE flags = input[p++];
+    UINT64 value;
+
+    if ((flags & 3) != 0 || (flags & 0x3C) != 0) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Unsupported xz filter chain");
+        return FALSE;
+    }
+
+    if ((flags & 0x40) && !ReadVarint(input, end, &p, &value)) return FALSE;
+    if ((flags & 0x80) && !ReadVarint(input, end, &p, &value)) return FALSE;
+
+    UINT64 filter;
+    UINT64 propsSize;
+    if (!ReadVarint(input, end, &p, &filter) || !ReadVarint(input, end, &p, &propsSize) ||
+        filter != XZ_FILTER_LZMA2 || propsSize != 1) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Unsupported xz filter chain");
+        return FALSE;
+    }
+
+    *pos = start + headerSize;
+    return TRUE;
+}
+
+BOOL CpioXzDecompress(const BYTE* input, SIZE_T inputLength, BYTE* output, SIZE_T outputSize,
+                      SIZE_T* outputLength, CpioError* error) {
+    if (inputLength < XZ_HEADER_SIZE || CpioCompareMemory(input, XzMagic, sizeof(XzMagic)) != 0) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid xz header");
+        return FALSE;
+    }
+
+    if (input[6] != 0 || (input[7] & 0xF0) != 0 ||
+        CpioCrc32Update(0, input + 6, 2) != ReadLittleEndian32(input + 8)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt xz stream header");
+        return FALSE;
+    }
+
+    UINT32 checkType = input[7];
+    SIZE_T checkSize = XzCheckSizes[checkType];
+    SIZE_T pos = XZ_HEADER_SIZE;
+    SIZE_T out = 0;
+
+    CpioLzmaModel* model = (CpioLzmaModel*)CpioAlloc(sizeof(CpioLzmaModel));
+    if (!model) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    BOOL ok = TRUE;
+
+    while (ok && pos < inputLength && input[pos] != 0) {
+        SIZE_T blockStart = out;
+
+        ok = ParseBlockHeader(input, inputLength, &pos, error) &&
+             DecodeLzma2(model, input, &pos, inputLength, output, &out, outputSize, error);
+        if (!ok) break;
+
+        while ((pos & 3) && pos < inputLength) pos++;
+
+        if (checkSize > inputLength - pos) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Truncated xz block");
+            ok = FALSE;
+            break;
+        }
+
+        if (checkType == XZ_CHECK_CRC32) {
+            ok = CpioCrc32Update(0, output + blockStart, out - blockStart) == ReadLittleEndian32(input + pos);
+        } else if (checkType == XZ_CHECK_CRC64) {
+            UINT64 check = CpioCrc64Update(0, output + blockStart, out - blockStart);
+            ok = (UINT32)check == ReadLittleEndian32(input + pos) &&
+                 (UINT32)(check >> 32) == ReadLittleEndian32(input + pos + 4);
+        }
+
+        if (!ok) CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "xz checksum mismatch");
+        pos += checkSize;
+    }
+
+    if (ok && pos >= inputLength) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Truncated xz stream");
+        ok = FALSE;
+    }
+
+    CpioFree(model);
+    *outputLength = out;
+    return ok;
+}
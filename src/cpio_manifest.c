@@ -0,0 +1,346 @@
+#include "cpio.h"
+
+#define CPIO_MANIFEST_HEADER "# cpio manifest v2: sha256 crc32c size mtime inode path\n"
+#define CPIO_MANIFEST_V2 "# cpio manifest v2"
+
+static UINT32 HashPath(const char* path) {
+    UINT32 hash = 2166136261u;
+    while (*path) {
+        hash ^= (BYTE)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+CpioManifest* CpioManifestCreate(void) {
+    CpioManifest* manifest = (CpioManifest*)CpioAlloc(sizeof(CpioManifest));
+    if (!manifest) return NULL;
+
+    manifest->bucketCount = 1024;
+    manifest->buckets = (CpioManifestRecord**)CpioAlloc(sizeof(CpioManifestRecord*) * manifest->bucketCount);
+    if (!manifest->buckets) {
+        CpioFree(manifest);
+        return NULL;
+    }
+
+    return manifest;
+}
+
+void CpioManifestDestroy(CpioManifest* manifest) {
+    if (!manifest) return;
+
+    CpioManifestRecord* record = manifest->first;
+    while (record) {
+        CpioManifestRecord* next = record->nextInOrder;
+        CpioFree(record->path);
+        CpioFree(record);
+        record = next;
+    }
+
+    CpioFree(manifest->buckets);
+    CpioFree(manifest);
+}
+
+static void Grow(CpioManifest* manifest) {
+    SIZE_T newCount = manifest->bucketCount * 2;
+    CpioManifestRecord** newBuckets = (CpioManifestRecord**)CpioAlloc(sizeof(CpioManifestRecord*) * newCount);
+    if (!newBuckets) return;
+
+    for (CpioManifestRecord* record = manifest->first; record; record = record->nextInOrder) {
+        SIZE_T slot = record->hash & (newCount - 1);
+        record->next = newBuckets[slot];
+        newBuckets[slot] = record;
+    }
+
+    CpioFree(manifest->buckets);
+    manifest->buckets = newBuckets;
+    manifest->bucketCount = newCount;
+}
+
+const CpioManifestRecord* CpioManifestFind(const CpioManifest* manifest, const char* path) {
+    if (!manifest || !path) return NULL;
+
+    UINT32 hash = HashPath(path);
+    CpioManifestRecord* record = manifest->buckets[hash & (manifest->bucketCount - 1)];
+
+    while (record) {
+        if (record->hash == hash && CpioStringCompare(record->path, path) == 0) {
+            return record;
+        }
+        record = record->next;
+    }
+
+    return NULL;
+}
+
+BOOL CpioManifestAdd(CpioManifest* manifest, const char* path, UINT64 fileSize, UINT32 mtime,
+                     UINT64 inode, const BYTE* digest, const UINT32* crc32c) {
+    if (!manifest || !path || !digest) return FALSE;
+
+    CpioManifestRecord* record = (CpioManifestRecord*)CpioManifestFind(manifest, path);
+    if (!record) {
+        record = (CpioManifestRecord*)CpioAlloc(sizeof(CpioManifestRecord));
+        if (!record) return FALSE;
+
+        SIZE_T len = CpioStringLength(path);
+        record->path = (char*)CpioAlloc(len + 1);
+        if (!record->path) {
+            CpioFree(record);
+            return FALSE;
+        }
+        CpioCopyMemory(record->path, path, len + 1);
+        record->hash = HashPath(path);
+
+        if (manifest->count >= manifest->bucketCount * 2) {
+            Grow(manifest);
+        }
+
+        SIZE_T slot = record->hash & (manifest->bucketCount - 1);
+        record->next = manifest->buckets[slot];
+        manifest->buckets[slot] = record;
+
+        if (manifest->last) {
+            manifest->last->nextInOrder = record;
+        } else {
+            manifest->first = record;
+        }
+        manifest->last = record;
+        manifest->count++;
+    }
+
+    record->fileSize = fileSize;
+    record->mtime = mtime;
+    record->inode = inode;
+    CpioCopyMemory(record->digest, digest, CPIO_SHA256_SIZE);
+    record->hasCrc32c = crc32c != NULL;
+    record->crc32c = crc32c ? *crc32c : 0;
+    return TRUE;
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static BOOL ParseNumber(const char** cursor, const char* end, UINT64* value) {
+    const char* p = *cursor;
+    UINT64 result = 0;
+
+    if (p >= end || *p < '0' || *p > '9') return FALSE;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (result > ((UINT64)-1 - 9) / 10) return FALSE;
+        result = result * 10 + (UINT64)(*p - '0');
+        p++;
+    }
+
+    if (p >= end || *p != ' ') return FALSE;
+    *cursor = p + 1;
+    *value = result;
+    return TRUE;
+}
+
+static BOOL ParseCrc32c(const char** cursor, const char* end, UINT32* crc32c, BOOL* present) {
+    const char* p = *cursor;
+
+    if (end - p >= 2 && p[0] == '-' && p[1] == ' ') {
+        *present = FALSE;
+        *cursor = p + 2;
+        return TRUE;
+    }
+
+    if (end - p < 9 || p[8] != ' ') return FALSE;
+
+    UINT32 value = 0;
+    for (int i = 0; i < 8; i++) {
+        int digit = HexValue(p[i]);
+        if (digit < 0) return FALSE;
+        value = (value << 4) | (UINT32)digit;
+    }
+
+    *crc32c = value;
+    *present = TRUE;
+    *cursor = p + 9;
+    return TRUE;
+}
+
+static BOOL ParseLine(CpioManifest* manifest, const char* line, const char* end, BOOL withCrc32c) {
+    BYTE digest[CPIO_SHA256_SIZE];
+
+    if (end - line < CPIO_SHA256_SIZE * 2 + 1) return FALSE;
+
+    for (int i = 0; i < CPIO_SHA256_SIZE; i++) {
+        int high = HexValue(line[i * 2]);
+        int low = HexValue(line[i * 2 + 1]);
+        if (high < 0 || low < 0) return FALSE;
+        digest[i] = (BYTE)((high << 4) | low);
+    }
+
+    const char* p = line + CPIO_SHA256_SIZE * 2;
+    if (*p++ != ' ') return FALSE;
+
+    UINT32 crc32c = 0;
+    BOOL hasCrc32c = FALSE;
+    if (withCrc32c && !ParseCrc32c(&p, end, &crc32c, &hasCrc32c)) return FALSE;
+
+    UINT64 fileSize, mtime, inode;
+    if (!ParseNumber(&p, end, &fileSize) || !ParseNumber(&p, end, &mtime) ||
+        !ParseNumber(&p, end, &inode) || mtime > 0xFFFFFFFF) {
+        return FALSE;
+    }
+
+    SIZE_T pathLength = (SIZE_T)(end - p);
+    if (pathLength == 0 || pathLength >= CPIO_MAX_NAME_LENGTH) return FALSE;
+
+    char path[CPIO_MAX_NAME_LENGTH];
+    CpioCopyMemory(path, p, pathLength);
+    path[pathLength] = '\0';
+
+    return CpioManifestAdd(manifest, path, fileSize, (UINT32)mtime, inode, digest,
+                           hasCrc32c ? &crc32c : NULL);
+}
+
+BOOL CpioManifestLoad(CpioManifest* manifest, const WCHAR* path, CpioError* error) {
+    if (!manifest || !path) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to open manifest");
+        return FALSE;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart > 0x7FFFFFFF) {
+        CloseHandle(hFile);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to get manifest size");
+        return FALSE;
+    }
+
+    DWORD size = (DWORD)fileSize.QuadPart;
+    char* data = (char*)CpioAlloc(size + 1);
+    if (!data) {
+        CloseHandle(hFile);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    DWORD bytesRead = 0;
+    BOOL ok = ReadFile(hFile, data, size, &bytesRead, NULL) && bytesRead == size;
+    CloseHandle(hFile);
+
+    if (!ok) {
+        CpioFree(data);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read manifest");
+        return FALSE;
+    }
+
+    const char* line = data;
+    const char* dataEnd = data + size;
+    BOOL withCrc32c = CpioStringStartsWith(data, CPIO_MANIFEST_V2);
+
+    while (line < dataEnd) {
+        const char* end = line;
+        while (end < dataEnd && *end != '\n') end++;
+
+        const char* next = end < dataEnd ? end + 1 : end;
+        if (end > line && end[-1] == '\r') end--;
+
+        if (end > line && line[0] != '#' && !ParseLine(manifest, line, end, withCrc32c)) {
+            CpioFree(data);
+            CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Malformed manifest line");
+            return FALSE;
+        }
+
+        line = next;
+    }
+
+    CpioFree(data);
+    return TRUE;
+}
+
+static char* FormatNumber(char* p, UINT64 value) {
+    char digits[24];
+    int count = 0;
+
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (count > 0) {
+        *p++ = digits[--count];
+    }
+    return p;
+}
+
+BOOL CpioManifestWrite(const CpioManifest* manifest, HANDLE hFile, CpioError* error) {
+    if (!manifest || hFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid parameter");
+        return FALSE;
+    }
+
+    CpioWriter writer;
+    if (!CpioWriterInit(&writer, hFile, 0)) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    BOOL ok = CpioWriterWriteString(&writer, CPIO_MANIFEST_HEADER, error);
+
+    for (const CpioManifestRecord* record = manifest->first; ok && record; record = record->nextInOrder) {
+        char line[CPIO_SHA256_SIZE * 2 + 80];
+        char* p = line;
+
+        for (int i = 0; i < CPIO_SHA256_SIZE; i++) {
+            *p++ = hex[record->digest[i] >> 4];
+            *p++ = hex[record->digest[i] & 0xF];
+        }
+        *p++ = ' ';
+        if (record->hasCrc32c) {
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                *p++ = hex[(record->crc32c >> shift) & 0xF];
+            }
+        } else {
+            *p++ = '-';
+        }
+        *p++ = ' ';
+        p = FormatNumber(p, record->fileSize);
+        *p++ = ' ';
+        p = FormatNumber(p, record->mtime);
+        *p++ = ' ';
+        p = FormatNumber(p, record->inode);
+        *p++ = ' ';
+
+        ok = CpioWriterWrite(&writer, line, (SIZE_T)(p - line), error) &&
+             CpioWriterWriteString(&writer, record->path, error) &&
+             CpioWriterWrite(&writer, "\n", 1, error);
+    }
+
+    ok = ok && CpioWriterFlush(&writer, error);
+    CpioWriterRelease(&writer);
+    return ok;
+}
+
+BOOL CpioManifestSave(const CpioManifest* manifest, const WCHAR* path, CpioError* error) {
+    if (!manifest || !path) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    HANDLE hFile = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create manifest");
+        return FALSE;
+    }
+
+    BOOL ok = CpioManifestWrite(manifest, hFile, error);
+    CloseHandle(hFile);
+    return ok;
+}
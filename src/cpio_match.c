@@ -0,0 +1,313 @@
+#include "cpio.h"
+
+#define CPIO_MATCH_LITERAL   0
+#define CPIO_MATCH_ANY       1
+#define CPIO_MATCH_CLASS     2
+#define CPIO_MATCH_STAR      3
+#define CPIO_MATCH_GLOBSTAR  4
+#define CPIO_MATCH_SPLIT     5
+#define CPIO_MATCH_DIRSTAR   6
+#define CPIO_MATCH_ACCEPT    7
+
+CpioMatcher* CpioMatcherCreate(void) {
+    CpioMatcher* matcher = (CpioMatcher*)CpioAlloc(sizeof(CpioMatcher));
+    if (!matcher) return NULL;
+
+    matcher->stateCapacity = 64;
+    matcher->states = (CpioMatchState*)CpioAlloc(sizeof(CpioMatchState) * matcher->stateCapacity);
+    if (!matcher->states) {
+        CpioFree(matcher);
+        return NULL;
+    }
+
+    return matcher;
+}
+
+void CpioMatcherDestroy(CpioMatcher* matcher) {
+    if (!matcher) return;
+
+    if (matcher->states) CpioFree(matcher->states);
+    if (matcher->classes) CpioFree(matcher->classes);
+    if (matcher->starts) CpioFree(matcher->starts);
+    if (matcher->current) CpioFree(matcher->current);
+    if (matcher->next) CpioFree(matcher->next);
+    if (matcher->marks) CpioFree(matcher->marks);
+
+    CpioFree(matcher);
+}
+
+static BOOL AddState(CpioMatcher* matcher, BYTE type, BYTE literal, UINT32 argument) {
+    if (matcher->stateCount >= matcher->stateCapacity) {
+        SIZE_T newCap = matcher->stateCapacity * 2;
+        CpioMatchState* newStates = (CpioMatchState*)CpioRealloc(matcher->states, sizeof(CpioMatchState) * newCap);
+        if (!newStates) return FALSE;
+
+        matcher->states = newStates;
+        matcher->stateCapacity = newCap;
+    }
+
+    CpioMatchState* state = &matcher->states[matcher->stateCount++];
+    state->type = type;
+    state->literal = literal;
+    state->argument = argument;
+    return TRUE;
+}
+
+static SIZE_T ParseClass(CpioMatcher* matcher, const char* pattern, SIZE_T i, UINT32* classIndex) {
+    BYTE bits[32];
+    CpioZeroMemory(bits, sizeof(bits));
+
+    BOOL negate = FALSE;
+    if (pattern[i] == '!' || pattern[i] == '^') {
+        negate = TRUE;
+        i++;
+    }
+
+    BOOL first = TRUE;
+    while (pattern[i] && (first || pattern[i] != ']')) {
+        unsigned char lo = (unsigned char)pattern[i];
+        if (lo == '\\' && pattern[i + 1]) {
+            lo = (unsigned char)pattern[++i];
+        }
+        unsigned char hi = lo;
+
+        if (pattern[i + 1] == '-' && pattern[i + 2] && pattern[i + 2] != ']') {
+            hi = (unsigned char)pattern[i + 2];
+            i += 2;
+        }
+
+        for (UINT32 c = lo; c <= hi; c++) {
+            bits[c >> 3] |= (BYTE)(1 << (c & 7));
+        }
+
+        first = FALSE;
+        i++;
+    }
+
+    if (pattern[i] != ']') {
+        return 0;
+    }
+
+    if (negate) {
+        for (int b = 0; b < 32; b++) bits[b] = (BYTE)~bits[b];
+    }
+    bits['/' >> 3] &= (BYTE)~(1 << ('/' & 7));
+
+    BYTE* newClasses = (BYTE*)CpioRealloc(matcher->classes, (matcher->classCount + 1) * 32);
+    if (!newClasses) return 0;
+
+    matcher->classes = newClasses;
+    CpioCopyMemory(matcher->classes + matcher->classCount * 32, bits, 32);
+    *classIndex = (UINT32)matcher->classCount++;
+
+    return i + 1;
+}
+
+BOOL CpioMatcherAddPattern(CpioMatcher* matcher, const char* pattern, BOOL exclude, CpioError* error) {
+    if (!matcher || !pattern) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    while (pattern[0] == '.' && pattern[1] == '/') pattern += 2;
+    while (pattern[0] == '/') pattern++;
+
+    if (pattern[0] == '\0') {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Empty pattern");
+        return FALSE;
+    }
+
+    UINT32* newStarts = (UINT32*)CpioRealloc(matcher->starts, sizeof(UINT32) * (matcher->startCount + 1));
+    if (!newStarts) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+    matcher->starts = newStarts;
+
+    SIZE_T firstState = matcher->stateCount;
+    SIZE_T i = 0;
+    BOOL ok = TRUE;
+
+    while (pattern[i] && ok) {
+        char c = pattern[i];
+
+        if (c == '*') {
+            if (pattern[i + 1] == '*') {
+                i += 2;
+                while (pattern[i] == '*') i++;
+
+                if (pattern[i] == '/') {
+                    ok = AddState(matcher, CPIO_MATCH_SPLIT, 0, 0) &&
+                         AddState(matcher, CPIO_MATCH_DIRSTAR, 0, 0);
+                    i++;
+                } else {
+                    ok = AddState(matcher, CPIO_MATCH_GLOBSTAR, 0, 0);
+                }
+            } else {
+                ok = AddState(matcher, CPIO_MATCH_STAR, 0, 0);
+                i++;
+            }
+        } else if (c == '?') {
+            ok = AddState(matcher, CPIO_MATCH_ANY, 0, 0);
+            i++;
+        } else if (c == '[') {
+            UINT32 classIndex = 0;
+            SIZE_T end = ParseClass(matcher, pattern, i + 1, &classIndex);
+            if (end == 0) {
+                ok = AddState(matcher, CPIO_MATCH_LITERAL, '[', 0);
+                i++;
+            } else {
+                ok = AddState(matcher, CPIO_MATCH_CLASS, 0, classIndex);
+                i = end;
+            }
+        } else {
+            if (c == '\\' && pattern[i + 1]) {
+                c = pattern[++i];
+            }
+            ok = AddState(matcher, CPIO_MATCH_LITERAL, (BYTE)c, 0);
+            i++;
+        }
+    }
+
+    if (ok) {
+        ok = AddState(matcher, CPIO_MATCH_ACCEPT, exclude ? 1 : 0, (UINT32)matcher->startCount);
+    }
+
+    if (!ok) {
+        matcher->stateCount = firstState;
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    matcher->starts[matcher->startCount++] = (UINT32)firstState;
+
+    if (exclude) {
+        matcher->excludeCount++;
+    } else {
+        matcher->includeCount++;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioMatcherIsEmpty(const CpioMatcher* matcher) {
+    return !matcher || matcher->startCount == 0;
+}
+
+static BOOL PrepareScratch(CpioMatcher* matcher) {
+    if (matcher->scratchCapacity >= matcher->stateCount) return TRUE;
+
+    SIZE_T capacity = matcher->stateCount;
+    UINT32* current = (UINT32*)CpioRealloc(matcher->current, sizeof(UINT32) * capacity);
+    if (!current) return FALSE;
+    matcher->current = current;
+
+    UINT32* next = (UINT32*)CpioRealloc(matcher->next, sizeof(UINT32) * capacity);
+    if (!next) return FALSE;
+    matcher->next = next;
+
+    UINT32* marks = (UINT32*)CpioRealloc(matcher->marks, sizeof(UINT32) * capacity);
+    if (!marks) return FALSE;
+    matcher->marks = marks;
+
+    CpioZeroMemory(matcher->marks, sizeof(UINT32) * capacity);
+    matcher->generation = 0;
+    matcher->scratchCapacity = capacity;
+    return TRUE;
+}
+
+static void Enqueue(CpioMatcher* matcher, UINT32* list, SIZE_T* count, UINT32 state) {
+    while (matcher->marks[state] != matcher->generation) {
+        matcher->marks[state] = matcher->generation;
+        list[(*count)++] = state;
+
+        BYTE type = matcher->states[state].type;
+        if (type == CPIO_MATCH_SPLIT) {
+            Enqueue(matcher, list, count, state + 1);
+            state += 2;
+        } else if (type == CPIO_MATCH_STAR || type == CPIO_MATCH_GLOBSTAR) {
+            state += 1;
+        } else {
+            break;
+        }
+    }
+}
+
+static void NextGeneration(CpioMatcher* matcher) {
+    if (++matcher->generation == 0) {
+        CpioZeroMemory(matcher->marks, sizeof(UINT32) * matcher->scratchCapacity);
+        matcher->generation = 1;
+    }
+}
+
+BOOL CpioMatcherMatch(CpioMatcher* matcher, const char* name) {
+    if (CpioMatcherIsEmpty(matcher)) return TRUE;
+    if (!name) return FALSE;
+
+    while (name[0] == '.' && name[1] == '/') name += 2;
+    while (name[0] == '/') name++;
+
+    if (!PrepareScratch(matcher)) return FALSE;
+
+    SIZE_T currentCount = 0;
+    NextGeneration(matcher);
+    for (SIZE_T p = 0; p < matcher->startCount; p++) {
+        Enqueue(matcher, matcher->current, &currentCount, matcher->starts[p]);
+    }
+
+    for (const unsigned char* s = (const unsigned char*)name; *s && currentCount > 0; s++) {
+        unsigned char c = *s;
+        SIZE_T nextCount = 0;
+        NextGeneration(matcher);
+
+        for (SIZE_T k = 0; k < currentCount; k++) {
+            UINT32 id = matcher->current[k];
+            const CpioMatchState* state = &matcher->states[id];
+
+            switch (state->type) {
+            case CPIO_MATCH_LITERAL:
+                if (c == state->literal) Enqueue(matcher, matcher->next, &nextCount, id + 1);
+                break;
+            case CPIO_MATCH_ANY:
+                if (c != '/') Enqueue(matcher, matcher->next, &nextCount, id + 1);
+                break;
+            case CPIO_MATCH_CLASS:
+                if (matcher->classes[state->argument * 32 + (c >> 3)] & (1 << (c & 7))) {
+                    Enqueue(matcher, matcher->next, &nextCount, id + 1);
+                }
+                break;
+            case CPIO_MATCH_STAR:
+                if (c != '/') Enqueue(matcher, matcher->next, &nextCount, id);
+                break;
+            case CPIO_MATCH_GLOBSTAR:
+                Enqueue(matcher, matcher->next, &nextCount, id);
+                break;
+            case CPIO_MATCH_DIRSTAR:
+                Enqueue(matcher, matcher->next, &nextCount, id);
+                if (c == '/') Enqueue(matcher, matcher->next, &nextCount, id + 1);
+                break;
+            default:
+                break;
+            }
+        }
+
+        UINT32* swap = matcher->current;
+        matcher->current = matcher->next;
+        matcher->next = swap;
+        currentCount = nextCount;
+    }
+
+    BOOL included = (matcher->includeCount == 0);
+
+    for (SIZE_T k = 0; k < currentCount; k++) {
+        const CpioMatchState* state = &matcher->states[matcher->current[k]];
+        if (state->type != CPIO_MATCH_ACCEPT) continue;
+
+        if (state->literal) {
+            return FALSE;
+        }
+        included = TRUE;
+    }
+
+    return included;
+}
@@ -48,32 +48,22 @@ static UINT64 ReadHexU64(HANDLE hFile, SIZE_T count, CpioError* error) {
     return ParseHexU64(buffer, count);
 }
 
-static BOOL WriteHex(HANDLE hFile, UINT64 value, SIZE_T width, CpioError* error) {
-    char buffer[32];
-    char hexChars[] = "0123456789abcdef";
+static void EncodeHex(BYTE* output, UINT64 value, SIZE_T width) {
+    static const char hexChars[] = "0123456789abcdef";
     
     for (int i = (int)width - 1; i >= 0; i--) {
-        buffer[i] = hexChars[value & 0xF];
+        output[i] = (BYTE)hexChars[value & 0xF];
         value >>= 4;
     }
-    
-    DWORD bytesWritten;
-    if (!WriteFile(hFile, buffer, (DWORD)width, &bytesWritten, NULL) || bytesWritten != width) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write hex value");
-        return FALSE;
-    }
-    
-    return TRUE;
 }
 
-static BOOL WritePadding(HANDLE hFile, SIZE_T count, CpioError* error) {
-    if (count == 0) return TRUE;
+static BOOL WriteHex(HANDLE hFile, UINT64 value, SIZE_T width, CpioError* error) {
+    BYTE buffer[32];
+    EncodeHex(buffer, value, width);
     
-    char zeros[4] = {0, 0, 0, 0};
     DWORD bytesWritten;
-    
-    if (!WriteFile(hFile, zeros, (DWORD)count, &bytesWritten, NULL) || bytesWritten != count) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write padding");
+    if (!WriteFile(hFile, buffer, (DWORD)width, &bytesWritten, NULL) || bytesWritten != width) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write hex value");
         return FALSE;
     }
     
@@ -130,51 +120,142 @@ BOOL CpioNewcHeaderRead(HANDLE hFile, CpioNewcHeader* header, CpioError* error)
     return TRUE;
 }
 
+SIZE_T CpioNewcHeaderEncode(const CpioNewcHeader* header, BYTE* output) {
+    UINT32 nameSize = (UINT32)CpioStringLength(header->name) + 1;
+    
+    CpioCopyMemory(output, header->crc ? "070702" : "070701", 6);
+    EncodeHex(output + 6, header->inode, 8);
+    EncodeHex(output + 14, header->mode, 8);
+    EncodeHex(output + 22, header->uid, 8);
+    EncodeHex(output + 30, header->gid, 8);
+    EncodeHex(output + 38, header->nlink, 8);
+    EncodeHex(output + 46, header->mtime, 8);
+    EncodeHex(output + 54, header->fileSize, 8);
+    EncodeHex(output + 62, header->devMajor, 8);
+    EncodeHex(output + 70, header->devMinor, 8);
+    EncodeHex(output + 78, header->rdevMajor, 8);
+    EncodeHex(output + 86, header->rdevMinor, 8);
+    EncodeHex(output + 94, nameSize, 8);
+    EncodeHex(output + 102, header->checksum, 8);
+    CpioCopyMemory(output + 110, header->name, nameSize);
+    
+    SIZE_T total = 110 + nameSize;
+    while (total % 4) output[total++] = 0;
+    return total;
+}
+
 UINT64 CpioNewcHeaderWrite(HANDLE hFile, const CpioNewcHeader* header, CpioError* error) {
     if (!header) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL header");
         return 0;
     }
     
-    DWORD bytesWritten;
+    BYTE buffer[CPIO_HEADER_MAX_SIZE];
+    SIZE_T length = CpioNewcHeaderEncode(header, buffer);
     
-    if (!WriteFile(hFile, "070701", 6, &bytesWritten, NULL) || bytesWritten != 6) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write magic");
+    DWORD bytesWritten;
+    if (!WriteFile(hFile, buffer, (DWORD)length, &bytesWritten, NULL) || bytesWritten != length) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write header");
         return 0;
     }
     
-    UINT32 nameSize = (UINT32)CpioStringLength(header->name) + 1;
-    
-    if (!WriteHex(hFile, header->inode, 8, error)) return 0;
-    if (!WriteHex(hFile, header->mode, 8, error)) return 0;
-    if (!WriteHex(hFile, header->uid, 8, error)) return 0;
-    if (!WriteHex(hFile, header->gid, 8, error)) return 0;
-    if (!WriteHex(hFile, header->nlink, 8, error)) return 0;
-    if (!WriteHex(hFile, header->mtime, 8, error)) return 0;
-    if (!WriteHex(hFile, header->fileSize, 8, error)) return 0;
-    if (!WriteHex(hFile, header->devMajor, 8, error)) return 0;
-    if (!WriteHex(hFile, header->devMinor, 8, error)) return 0;
-    if (!WriteHex(hFile, header->rdevMajor, 8, error)) return 0;
-    if (!WriteHex(hFile, header->rdevMinor, 8, error)) return 0;
-    if (!WriteHex(hFile, nameSize, 8, error)) return 0;
-    if (!WriteHex(hFile, header->checksum, 8, error)) return 0;
-    
-    if (!WriteFile(hFile, header->name, nameSize - 1, &bytesWritten, NULL)) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write filename");
-        return 0;
+    return length;
+}
+
+static BOOL IsHexChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+BOOL CpioNewcHeaderDecode(const BYTE* data, SIZE_T size, BOOL strict, CpioNewcHeader* header,
+                          SIZE_T* consumed, CpioError* error) {
+    if (!data || !header || !consumed) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
     }
-    
-    char nul = '\0';
-    if (!WriteFile(hFile, &nul, 1, &bytesWritten, NULL)) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write filename NUL");
-        return 0;
+
+    if (size < 104) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read header");
+        return FALSE;
     }
-    
-    SIZE_T totalBeforePad = 110 + nameSize;
+
+    const char* fields = (const char*)data;
+
+    if (strict) {
+        for (SIZE_T i = 0; i < 104; i++) {
+            if (!IsHexChar(fields[i])) {
+                CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid header field");
+                return FALSE;
+            }
+        }
+    }
+
+    CpioZeroMemory(header, sizeof(CpioNewcHeader));
+
+    header->inode = ParseHexU32(fields, 8);
+    header->mode = ParseHexU32(fields + 8, 8);
+    header->uid = ParseHexU32(fields + 16, 8);
+    header->gid = ParseHexU32(fields + 24, 8);
+    header->nlink = ParseHexU32(fields + 32, 8);
+    header->mtime = ParseHexU32(fields + 40, 8);
+    header->fileSize = ParseHexU64(fields + 48, 8);
+    header->devMajor = ParseHexU32(fields + 56, 8);
+    header->devMinor = ParseHexU32(fields + 64, 8);
+    header->rdevMajor = ParseHexU32(fields + 72, 8);
+    header->rdevMinor = ParseHexU32(fields + 80, 8);
+
+    UINT32 nameLength = ParseHexU32(fields + 88, 8);
+    header->checksum = ParseHexU32(fields + 96, 8);
+
+    if (nameLength == 0 || nameLength > CPIO_MAX_NAME_LENGTH) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid name length");
+        return FALSE;
+    }
+
+    SIZE_T totalBeforePad = 110 + nameLength;
     SIZE_T padLen = (4 - (totalBeforePad % 4)) % 4;
-    if (!WritePadding(hFile, padLen, error)) return 0;
-    
-    return totalBeforePad + padLen;
+
+    if (size < 104 + nameLength + padLen) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read filename");
+        return FALSE;
+    }
+
+    if (strict && data[104 + nameLength - 1] != '\0') {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Unterminated filename");
+        return FALSE;
+    }
+
+    CpioCopyMemory(header->name, data + 104, nameLength);
+    header->name[nameLength - 1] = '\0';
+
+    *consumed = 104 + nameLength + padLen;
+    return TRUE;
+}
+
+static BOOL ReadNewcHeaderFromSource(CpioSource* source, CpioNewcHeader* header, CpioError* error) {
+    SIZE_T available;
+    const BYTE* data = CpioSourcePeek(source, 104, &available, error);
+    if (!data) return FALSE;
+
+    if (available < 104) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read header");
+        return FALSE;
+    }
+
+    SIZE_T nameLength = ParseHexU32((const char*)data + 88, 8);
+    SIZE_T total = 104 + nameLength + (4 - ((110 + nameLength) % 4)) % 4;
+
+    if (nameLength > 0 && nameLength <= CPIO_MAX_NAME_LENGTH) {
+        data = CpioSourcePeek(source, total, &available, error);
+        if (!data) return FALSE;
+    }
+
+    SIZE_T consumed = 0;
+    if (!CpioNewcHeaderDecode(data, available, FALSE, header, &consumed, error)) {
+        return FALSE;
+    }
+
+    CpioSourceConsume(source, consumed);
+    return TRUE;
 }
 
 CpioNewcReader* CpioNewcReaderCreate(HANDLE hFile, BOOL takeOwnership) {
@@ -183,6 +264,15 @@ CpioNewcReader* CpioNewcReaderCreate(HANDLE hFile, BOOL takeOwnership) {
     CpioNewcReader* reader = (CpioNewcReader*)CpioAlloc(sizeof(CpioNewcReader));
     if (!reader) return NULL;
     
+    if (!CpioSourceInit(&reader->source, hFile)) {
+        CpioFree(reader);
+        return NULL;
+    }
+    
+    if (!reader->source.seekable) {
+        reader->source.position = CPIO_MAGIC_SIZE;
+    }
+    
     reader->hFile = hFile;
     reader->ownsHandle = takeOwnership;
     reader->currentEntrySize = 0;
@@ -194,9 +284,38 @@ CpioNewcReader* CpioNewcReaderCreate(HANDLE hFile, BOOL takeOwnership) {
     return reader;
 }
 
+CpioNewcReader* CpioNewcReaderCreateFromMemory(const void* data, SIZE_T size, CpioError* error) {
+    if (!data) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return NULL;
+    }
+    
+    const BYTE* magic = (const BYTE*)data;
+    if (size < CPIO_MAGIC_SIZE || CpioCompareMemory(magic, "07070", 5) != 0 || (magic[5] != '1' && magic[5] != '2')) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid magic number");
+        return NULL;
+    }
+    
+    CpioNewcReader* reader = (CpioNewcReader*)CpioAlloc(sizeof(CpioNewcReader));
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+    
+    CpioSourceInitMemory(&reader->source, data, size);
+    reader->source.position = CPIO_MAGIC_SIZE;
+    reader->hFile = INVALID_HANDLE_VALUE;
+    reader->crc = magic[5] == '2';
+    reader->firstEntry = TRUE;
+    
+    return reader;
+}
+
 void CpioNewcReaderDestroy(CpioNewcReader* reader) {
     if (!reader) return;
     
+    CpioSourceRelease(&reader->source);
+    
     if (reader->ownsHandle && reader->hFile != INVALID_HANDLE_VALUE) {
         CloseHandle(reader->hFile);
     }
@@ -217,31 +336,39 @@ BOOL CpioNewcReaderReadNext(CpioNewcReader* reader, CpioNewcHeader* header, Cpio
     }
     
     if (!reader->firstEntry) {
-        char magic[6];
-        DWORD bytesRead;
+        SIZE_T available;
+        const BYTE* magic = CpioSourcePeek(&reader->source, 6, &available, error);
         
-        if (!ReadFile(reader->hFile, magic, 6, &bytesRead, NULL)) {
-            if (GetLastError() == ERROR_HANDLE_EOF) {
-                return FALSE;
-            }
-            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read magic");
+        if (!magic) {
             return FALSE;
         }
         
-        if (bytesRead == 0) {
+        if (available == 0) {
             return FALSE;
         }
         
-        if (bytesRead != 6 || CpioCompareMemory(magic, "070701", 6) != 0) {
+        if (available != 6 || CpioCompareMemory(magic, "07070", 5) != 0 || (magic[5] != '1' && magic[5] != '2')) {
             CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid magic number");
             return FALSE;
         }
+        
+        reader->crc = magic[5] == '2';
+        CpioSourceConsume(&reader->source, 6);
     }
     reader->firstEntry = FALSE;
     
-    if (!CpioNewcHeaderRead(reader->hFile, header, error)) {
+    UINT64 headerAt = CpioSourceTell(&reader->source);
+    reader->nameView = NULL;
+    
+    if (!ReadNewcHeaderFromSource(&reader->source, header, error)) {
         return FALSE;
     }
+    header->crc = reader->crc;
+    reader->nameLength = CpioStringLength(header->name);
+    
+    if (reader->source.view && reader->source.view[headerAt + 104 + reader->nameLength] == '\0') {
+        reader->nameView = (const char*)reader->source.view + headerAt + 104;
+    }
     
     if (CpioStringCompare(header->name, "TRAILER!!!") == 0) {
         reader->seenTrailer = TRUE;
@@ -251,7 +378,26 @@ BOOL CpioNewcReaderReadNext(CpioNewcReader* reader, CpioNewcHeader* header, Cpio
     reader->currentEntrySize = header->fileSize;
     reader->currentEntryRead = 0;
     reader->entryDataPad = (SIZE_T)((4 - (reader->currentEntrySize % 4)) % 4);
+    reader->verify = reader->crc && (header->mode & CPIO_S_IFMT) == CPIO_S_IFREG && header->fileSize > 0;
+    reader->expectedSum = header->checksum;
+    reader->source.summing = reader->verify;
+    reader->source.sum = 0;
+    
+    return TRUE;
+}
+
+static BOOL VerifyChecksum(CpioNewcReader* reader, CpioError* error) {
+    if (!reader->verify || reader->currentEntryRead < reader->currentEntrySize) {
+        return TRUE;
+    }
     
+    reader->verify = FALSE;
+    reader->source.summing = FALSE;
+    
+    if (reader->source.sum != reader->expectedSum) {
+        CpioErrorSet(error, CPIO_ERROR_CHECKSUM, "Entry data does not match its checksum");
+        return FALSE;
+    }
     return TRUE;
 }
 
@@ -272,64 +418,80 @@ DWORD CpioNewcReaderRead(CpioNewcReader* reader, void* buffer, DWORD bufferSize,
         toRead = (DWORD)remaining;
     }
     
-    DWORD bytesRead;
-    if (!ReadFile(reader->hFile, buffer, toRead, &bytesRead, NULL)) {
+    SIZE_T bytesRead;
+    if (!CpioSourceRead(&reader->source, buffer, toRead, &bytesRead, error)) {
         CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read entry data");
         return 0;
     }
     
     reader->currentEntryRead += bytesRead;
-    return bytesRead;
+    if (!VerifyChecksum(reader, error)) return 0;
+    return (DWORD)bytesRead;
 }
 
-BOOL CpioNewcReaderFinish(CpioNewcReader* reader, CpioError* error) {
-    if (!reader) return FALSE;
+BOOL CpioNewcReaderCopyToHandle(CpioNewcReader* reader, HANDLE hOutFile, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
     
-    if (reader->currentEntrySize == 0 || reader->currentEntryRead >= reader->currentEntrySize) {
-        if (reader->entryDataPad > 0) {
-            char pad[4];
-            DWORD bytesRead;
-            ReadFile(reader->hFile, pad, (DWORD)reader->entryDataPad, &bytesRead, NULL);
-            reader->entryDataPad = 0;
-        }
-        
-        reader->currentEntrySize = 0;
-        reader->currentEntryRead = 0;
+    if (reader->currentEntryRead >= reader->currentEntrySize) {
         return TRUE;
     }
     
     UINT64 remaining = reader->currentEntrySize - reader->currentEntryRead;
+    UINT64 copied = 0;
+    BOOL ok = CpioSourceCopyToHandle(&reader->source, hOutFile, remaining, &copied, error);
+    reader->currentEntryRead += copied;
     
-    if (remaining > 0) {
-        LARGE_INTEGER dist;
-        dist.QuadPart = remaining;
-        
-        if (!SetFilePointerEx(reader->hFile, dist, NULL, FILE_CURRENT)) {
-            char buffer[8192];
-            while (remaining > 0) {
-                DWORD toRead = remaining > sizeof(buffer) ? sizeof(buffer) : (DWORD)remaining;
-                DWORD bytesRead;
-                
-                if (!ReadFile(reader->hFile, buffer, toRead, &bytesRead, NULL)) {
-                    CpioErrorSet(error, CPIO_ERROR_IO, "Failed to skip entry data");
-                    return FALSE;
-                }
-                
-                remaining -= bytesRead;
-                if (bytesRead == 0) break;
-            }
-        }
+    if (ok && copied != remaining) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive truncated in entry data");
+        return FALSE;
     }
     
-    if (reader->entryDataPad > 0) {
-        char pad[4];
-        DWORD bytesRead;
-        ReadFile(reader->hFile, pad, (DWORD)reader->entryDataPad, &bytesRead, NULL);
-        reader->entryDataPad = 0;
+    return ok && VerifyChecksum(reader, error);
+}
+
+BOOL CpioNewcReaderFinish(CpioNewcReader* reader, CpioError* error) {
+    if (!reader) return FALSE;
+    
+    UINT64 remaining = 0;
+    if (reader->currentEntryRead < reader->currentEntrySize) {
+        remaining = reader->currentEntrySize - reader->currentEntryRead;
+    }
+    
+    reader->verify = FALSE;
+    reader->source.summing = FALSE;
+    
+    BOOL ok = CpioSourceSkip(&reader->source, remaining + reader->entryDataPad, error);
+    
+    reader->entryDataPad = 0;
+    reader->currentEntrySize = 0;
+    reader->currentEntryRead = 0;
+    return ok;
+}
+
+BOOL CpioNewcReaderSeek(CpioNewcReader* reader, UINT64 headerOffset, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
+    
+    if (reader->firstEntry && headerOffset + CPIO_MAGIC_SIZE == CpioSourceTell(&reader->source)) {
+        return TRUE;
+    }
+    
+    if (!CpioSourceSeek(&reader->source, headerOffset, error)) {
+        return FALSE;
     }
     
     reader->currentEntrySize = 0;
     reader->currentEntryRead = 0;
+    reader->entryDataPad = 0;
+    reader->seenTrailer = FALSE;
+    reader->firstEntry = FALSE;
+    reader->verify = FALSE;
+    reader->source.summing = FALSE;
     return TRUE;
 }
 
@@ -337,14 +499,118 @@ BOOL CpioNewcReaderIsAtEnd(const CpioNewcReader* reader) {
     return reader ? reader->seenTrailer : TRUE;
 }
 
-CpioNewcBuilder* CpioNewcBuilderCreate(HANDLE hFile, BOOL takeOwnership) {
-    if (hFile == INVALID_HANDLE_VALUE) return NULL;
+const char* CpioNewcReaderNameView(const CpioNewcReader* reader, SIZE_T* length) {
+    if (!reader || !reader->nameView) return NULL;
+    
+    if (length) *length = reader->nameLength;
+    return reader->nameView;
+}
+
+const BYTE* CpioNewcReaderDataView(CpioNewcReader* reader, UINT64* length, CpioError* error) {
+    if (!reader || !length) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return NULL;
+    }
+    
+    if (!reader->source.view) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Archive is not memory-backed");
+        return NULL;
+    }
+    
+    UINT64 remaining = reader->currentEntrySize - reader->currentEntryRead;
+    UINT64 position = CpioSourceTell(&reader->source);
+    const BYTE* data = reader->source.view + position;
+    
+    if (position > reader->source.viewSize || reader->source.viewSize - position < remaining) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive truncated in entry data");
+        return NULL;
+    }
+    
+    if (reader->source.summing) {
+        reader->source.sum = CpioByteSumUpdate(reader->source.sum, data, (SIZE_T)remaining);
+    }
+    
+    reader->source.position += remaining;
+    reader->currentEntryRead = reader->currentEntrySize;
+    *length = remaining;
+    
+    return VerifyChecksum(reader, error) ? data : NULL;
+}
+
+BOOL CpioNewcReaderAdvance(CpioNewcReader* reader, CpioNewcEntryView* entry, CpioError* error) {
+    if (!reader || !entry) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+    
+    CpioNewcHeader* header = &reader->current;
+    if (!CpioNewcReaderReadNext(reader, header, error)) {
+        return FALSE;
+    }
+    
+    entry->inode = header->inode;
+    entry->mode = header->mode;
+    entry->uid = header->uid;
+    entry->gid = header->gid;
+    entry->nlink = header->nlink;
+    entry->mtime = header->mtime;
+    entry->fileSize = header->fileSize;
+    entry->devMajor = header->devMajor;
+    entry->devMinor = header->devMinor;
+    entry->rdevMajor = header->rdevMajor;
+    entry->rdevMinor = header->rdevMinor;
+    entry->checksum = header->checksum;
+    entry->name = reader->nameView ? reader->nameView : header->name;
+    entry->nameLength = reader->nameLength;
+    
+    return TRUE;
+}
+
+BOOL CpioNewcReaderNextSpan(CpioNewcReader* reader, const BYTE** data, SIZE_T* length, CpioError* error) {
+    if (!reader || !data || !length) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+    
+    *data = NULL;
+    *length = 0;
+    
+    if (reader->currentEntryRead >= reader->currentEntrySize) {
+        return FALSE;
+    }
+    
+    UINT64 remaining = reader->currentEntrySize - reader->currentEntryRead;
+    SIZE_T wanted = remaining > (SIZE_T)-1 ? (SIZE_T)-1 : (SIZE_T)remaining;
+    SIZE_T available;
+    
+    const BYTE* span = CpioSourcePeek(&reader->source, wanted, &available, error);
+    if (!span) return FALSE;
+    
+    if (available == 0) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive truncated in entry data");
+        return FALSE;
+    }
+    
+    if (reader->source.summing) {
+        reader->source.sum = CpioByteSumUpdate(reader->source.sum, span, available);
+    }
+    
+    CpioSourceConsume(&reader->source, available);
+    reader->currentEntryRead += available;
+    
+    if (!VerifyChecksum(reader, error)) return FALSE;
     
+    *data = span;
+    *length = available;
+    return TRUE;
+}
+
+static CpioNewcBuilder* AllocBuilder(void) {
     CpioNewcBuilder* builder = (CpioNewcBuilder*)CpioAlloc(sizeof(CpioNewcBuilder));
     if (!builder) return NULL;
     
-    builder->hFile = hFile;
-    builder->ownsHandle = takeOwnership;
+    builder->hFile = INVALID_HANDLE_VALUE;
+    builder->ownsHandle = FALSE;
     builder->defaultUid = 0;
     builder->defaultGid = 0;
     builder->defaultMtime = CpioGetCurrentUnixTime();
@@ -352,8 +618,18 @@ CpioNewcBuilder* CpioNewcBuilderCreate(HANDLE hFile, BOOL takeOwnership) {
     builder->defaultModeDir = CPIO_S_IFDIR | CPIO_S_IRUSR | CPIO_S_IWUSR | CPIO_S_IXUSR | 
                               CPIO_S_IRGRP | CPIO_S_IXGRP | CPIO_S_IROTH | CPIO_S_IXOTH;
     builder->autoWriteDirs = TRUE;
+    builder->writeToc = FALSE;
+    builder->crc = FALSE;
     builder->seenDirs = CpioHashSetCreate();
     builder->entryCount = 0;
+    builder->detectLinks = TRUE;
+    builder->links = NULL;
+    builder->dataCallback = NULL;
+    builder->dataContext = NULL;
+    builder->bom = NULL;
+    builder->offset = 0;
+    builder->toc = NULL;
+    builder->inMemory = FALSE;
     builder->finished = FALSE;
     
     if (!builder->seenDirs) {
@@ -364,46 +640,262 @@ CpioNewcBuilder* CpioNewcBuilderCreate(HANDLE hFile, BOOL takeOwnership) {
     return builder;
 }
 
-void CpioNewcBuilderDestroy(CpioNewcBuilder* builder) {
-    if (!builder) return;
-    
-    if (builder->seenDirs) {
-        CpioHashSetDestroy(builder->seenDirs);
-    }
+CpioNewcBuilder* CpioNewcBuilderCreate(HANDLE hFile, BOOL takeOwnership) {
+    if (hFile == INVALID_HANDLE_VALUE) return NULL;
     
-    if (builder->ownsHandle && builder->hFile != INVALID_HANDLE_VALUE) {
-        CloseHandle(builder->hFile);
-    }
+    CpioNewcBuilder* builder = AllocBuilder();
+    if (!builder) return NULL;
     
-    CpioFree(builder);
+    builder->hFile = hFile;
+    builder->ownsHandle = takeOwnership;
+    return builder;
 }
 
-void CpioNewcBuilderNextHeader(CpioNewcBuilder* builder, CpioNewcHeader* header) {
-    if (!builder || !header) return;
-    
-    CpioZeroMemory(header, sizeof(CpioNewcHeader));
-    
-    header->devMajor = 0;
-    header->devMinor = 0;
-    header->inode = builder->entryCount++;
-    header->mode = builder->defaultModeFile;
-    header->uid = builder->defaultUid;
-    header->gid = builder->defaultGid;
-    header->nlink = 1;
-    header->mtime = builder->defaultMtime;
-    header->rdevMajor = 0;
-    header->rdevMinor = 0;
-    header->checksum = 0;
-    header->fileSize = 0;
-    header->name[0] = '\0';
-}
+CpioNewcBuilder* CpioNewcBuilderCreateAppend(HANDLE hFile, BOOL takeOwnership, CpioError* error) {
+    CpioReader* reader = CpioReaderCreate(hFile, FALSE, error);
+    if (!reader) return NULL;
 
-static UINT64 EmitParentDirectories(CpioNewcBuilder* builder, const char* filePath, CpioError* error) {
-    if (!builder->autoWriteDirs) return 0;
-    
-    char normalized[CPIO_MAX_NAME_LENGTH];
-    if (!CpioNormalizeArchivePath(filePath, normalized, sizeof(normalized))) {
-        return 0;
+    CpioFormat format = CpioReaderGetFormat(reader);
+    if (format != CPIO_FORMAT_NEWC && format != CPIO_FORMAT_CRC) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Archive is not in newc format");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    if (reader->compression != CPIO_FORMAT_UNKNOWN) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Cannot append to a compressed archive");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    CpioNewcBuilder* builder = CpioNewcBuilderCreate(hFile, FALSE);
+    if (!builder) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    builder->toc = CpioStringCreate();
+    if (!builder->toc) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioReaderDestroy(reader);
+        CpioNewcBuilderDestroy(builder);
+        return NULL;
+    }
+
+    CpioAppendPoint point;
+    BOOL found = CpioReaderFindAppendPoint(reader, builder->seenDirs, builder->toc, &point, error);
+    CpioReaderDestroy(reader);
+
+    if (!found) {
+        CpioNewcBuilderDestroy(builder);
+        return NULL;
+    }
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = (LONGLONG)point.offset;
+    if (!SetFilePointerEx(hFile, distance, NULL, FILE_BEGIN) || !SetEndOfFile(hFile)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to truncate archive trailer");
+        CpioNewcBuilderDestroy(builder);
+        return NULL;
+    }
+
+    builder->ownsHandle = takeOwnership;
+    builder->entryCount = point.nextInode;
+    builder->offset = point.offset;
+    builder->crc = format == CPIO_FORMAT_CRC;
+    builder->writeToc = point.hasToc;
+    return builder;
+}
+
+CpioNewcBuilder* CpioNewcBuilderCreateMemory(void* storage, SIZE_T capacity) {
+    if (storage && capacity == 0) return NULL;
+    
+    CpioNewcBuilder* builder = AllocBuilder();
+    if (!builder) return NULL;
+    
+    builder->inMemory = TRUE;
+    builder->memory = (BYTE*)storage;
+    builder->memoryCapacity = storage ? capacity : 0;
+    builder->growMemory = storage == NULL;
+    
+    if (!storage && capacity > 0) {
+        builder->memory = (BYTE*)CpioAlloc(capacity);
+        if (!builder->memory) {
+            CpioNewcBuilderDestroy(builder);
+            return NULL;
+        }
+        builder->memoryCapacity = capacity;
+    }
+    
+    return builder;
+}
+
+const BYTE* CpioNewcBuilderGetMemory(const CpioNewcBuilder* builder, SIZE_T* length) {
+    if (!builder || !builder->inMemory) return NULL;
+    
+    if (length) *length = builder->memoryLength;
+    return builder->memory;
+}
+
+BYTE* CpioNewcBuilderDetachMemory(CpioNewcBuilder* builder, SIZE_T* length) {
+    if (!builder || !builder->inMemory) return NULL;
+    
+    BYTE* memory = builder->memory;
+    if (length) *length = builder->memoryLength;
+    
+    builder->memory = NULL;
+    builder->memoryLength = 0;
+    builder->memoryCapacity = 0;
+    return memory;
+}
+
+void CpioNewcBuilderDestroy(CpioNewcBuilder* builder) {
+    if (!builder) return;
+    
+    if (builder->seenDirs) {
+        CpioHashSetDestroy(builder->seenDirs);
+    }
+    
+    CpioLinkTableDestroy(builder->links);
+    
+    if (builder->toc) {
+        CpioStringDestroy(builder->toc);
+    }
+    
+    if (builder->ownsHandle && builder->hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(builder->hFile);
+    }
+    
+    if (builder->growMemory) {
+        CpioFree(builder->memory);
+    }
+    
+    CpioFree(builder);
+}
+
+void CpioNewcBuilderNextHeader(CpioNewcBuilder* builder, CpioNewcHeader* header) {
+    if (!builder || !header) return;
+    
+    CpioZeroMemory(header, sizeof(CpioNewcHeader));
+    
+    header->devMajor = 0;
+    header->devMinor = 0;
+    header->inode = builder->entryCount++;
+    header->mode = builder->defaultModeFile;
+    header->uid = builder->defaultUid;
+    header->gid = builder->defaultGid;
+    header->nlink = 1;
+    header->mtime = builder->defaultMtime;
+    header->rdevMajor = 0;
+    header->rdevMinor = 0;
+    header->checksum = 0;
+    header->crc = builder->crc;
+    header->fileSize = 0;
+    header->name[0] = '\0';
+}
+
+static BOOL ReserveMemory(CpioNewcBuilder* builder, SIZE_T size, CpioError* error) {
+    if (builder->memoryCapacity - builder->memoryLength >= size) return TRUE;
+    
+    if (!builder->growMemory) {
+        CpioErrorSet(error, CPIO_ERROR_VALUE_TOO_LARGE, "Archive does not fit in the output buffer");
+        return FALSE;
+    }
+    
+    SIZE_T needed = builder->memoryLength + size;
+    SIZE_T capacity = builder->memoryCapacity ? builder->memoryCapacity : CPIO_WRITER_BUFFER_SIZE;
+    
+    while (capacity < needed && capacity <= ((SIZE_T)-1) / 2) {
+        capacity *= 2;
+    }
+    
+    BYTE* memory = needed < size || capacity < needed ? NULL : (BYTE*)CpioRealloc(builder->memory, capacity);
+    if (!memory) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+    
+    builder->memory = memory;
+    builder->memoryCapacity = capacity;
+    return TRUE;
+}
+
+static BOOL BuilderWrite(CpioNewcBuilder* builder, const void* data, SIZE_T size, const char* message,
+                         CpioError* error) {
+    if (builder->inMemory) {
+        if (!ReserveMemory(builder, size, error)) return FALSE;
+        
+        CpioCopyMemory(builder->memory + builder->memoryLength, data, size);
+        builder->memoryLength += size;
+        return TRUE;
+    }
+    
+    const BYTE* bytes = (const BYTE*)data;
+    
+    while (size > 0) {
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD bytesWritten;
+        if (!WriteFile(builder->hFile, bytes, chunk, &bytesWritten, NULL) || bytesWritten != chunk) {
+            CpioErrorSet(error, CPIO_ERROR_IO, message);
+            return FALSE;
+        }
+        bytes += chunk;
+        size -= chunk;
+    }
+    
+    return TRUE;
+}
+
+static BOOL WritePadding(CpioNewcBuilder* builder, SIZE_T count, CpioError* error) {
+    static const BYTE zeros[4] = {0, 0, 0, 0};
+    return count == 0 || BuilderWrite(builder, zeros, count, "Failed to write padding", error);
+}
+
+static UINT64 BuilderWriteHeader(CpioNewcBuilder* builder, const CpioNewcHeader* header, CpioError* error) {
+    BYTE buffer[CPIO_HEADER_MAX_SIZE];
+    SIZE_T length = CpioNewcHeaderEncode(header, buffer);
+    return BuilderWrite(builder, buffer, length, "Failed to write header", error) ? length : 0;
+}
+
+static UINT64 WriteEntryHeader(CpioNewcBuilder* builder, const CpioNewcHeader* header, CpioError* error) {
+    UINT64 written = BuilderWriteHeader(builder, header, error);
+    if (written == 0) return 0;
+    
+    CpioBomWriterAdd(builder->bom, header);
+    
+    if (builder->writeToc) {
+        if (!builder->toc) {
+            builder->toc = CpioStringCreate();
+        }
+        
+        CpioTocEntry record;
+        record.headerOffset = builder->offset;
+        record.dataOffset = builder->offset + written;
+        record.fileSize = header->fileSize;
+        record.mode = header->mode;
+        record.inode = header->inode;
+        record.devMajor = header->devMajor;
+        record.devMinor = header->devMinor;
+        record.nlink = header->nlink;
+        record.name = header->name;
+        
+        if (!builder->toc || !CpioTocAppendRecord(builder->toc, &record)) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return 0;
+        }
+    }
+    
+    builder->offset += written;
+    return written;
+}
+
+static UINT64 EmitParentDirectories(CpioNewcBuilder* builder, const char* filePath, CpioError* error) {
+    if (!builder->autoWriteDirs) return 0;
+    
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (!CpioNormalizeArchivePath(filePath, normalized, sizeof(normalized))) {
+        return 0;
     }
     
     UINT64 totalWritten = 0;
@@ -442,7 +934,7 @@ static UINT64 EmitParentDirectories(CpioNewcBuilder* builder, const char* filePa
                     }
                     header.name[len] = '\0';
                     
-                    UINT64 w = CpioNewcHeaderWrite(builder->hFile, &header, error);
+                    UINT64 w = WriteEntryHeader(builder, &header, error);
                     if (w == 0) return 0;
                     totalWritten += w;
                     
@@ -462,13 +954,260 @@ static UINT64 EmitParentDirectories(CpioNewcBuilder* builder, const char* filePa
     return totalWritten;
 }
 
-UINT64 CpioNewcBuilderAppendFileFromPath(CpioNewcBuilder* builder, const char* archivePath,
-                                          const WCHAR* filePath, CpioError* error) {
-    if (!builder || !archivePath || !filePath) {
+static BOOL SumSourceFile(HANDLE hSourceFile, UINT64 fileSize, BYTE* buffer, UINT32* sum) {
+    UINT64 total = 0;
+    
+    while (total < fileSize) {
+        UINT64 remaining = fileSize - total;
+        DWORD toRead = remaining < CPIO_POOL_BUFFER_SIZE ? (DWORD)remaining : CPIO_POOL_BUFFER_SIZE;
+        DWORD bytesRead;
+        
+        if (!ReadFile(hSourceFile, buffer, toRead, &bytesRead, NULL)) return FALSE;
+        if (bytesRead == 0) break;
+        
+        *sum = CpioByteSumUpdate(*sum, buffer, bytesRead);
+        total += bytesRead;
+    }
+    
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    return SetFilePointerEx(hSourceFile, zero, NULL, FILE_BEGIN);
+}
+
+static BOOL FindPatchOffset(CpioNewcBuilder* builder, LARGE_INTEGER* patchAt) {
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    
+    if (builder->inMemory) {
+        patchAt->QuadPart = (LONGLONG)builder->memoryLength + CPIO_MAGIC_SIZE + 96;
+        return TRUE;
+    }
+    
+    if (GetFileType(builder->hFile) == FILE_TYPE_DISK &&
+        SetFilePointerEx(builder->hFile, zero, patchAt, FILE_CURRENT)) {
+        patchAt->QuadPart += CPIO_MAGIC_SIZE + 96;
+        return TRUE;
+    }
+    
+    patchAt->QuadPart = -1;
+    return FALSE;
+}
+
+static BOOL PrepareChecksum(CpioNewcBuilder* builder, CpioNewcHeader* header, HANDLE hSourceFile, BYTE* buffer,
+                            DWORD* preloaded, LARGE_INTEGER* patchAt, CpioError* error) {
+    patchAt->QuadPart = -1;
+    
+    if (!header->crc || header->fileSize == 0 || FindPatchOffset(builder, patchAt)) return TRUE;
+    
+    if (header->fileSize <= CPIO_POOL_BUFFER_SIZE) {
+        while (*preloaded < header->fileSize) {
+            DWORD bytesRead;
+            if (!ReadFile(hSourceFile, buffer + *preloaded, (DWORD)header->fileSize - *preloaded, &bytesRead, NULL)) {
+                CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read source file");
+                return FALSE;
+            }
+            if (bytesRead == 0) break;
+            *preloaded += bytesRead;
+        }
+        header->checksum = CpioByteSumUpdate(0, buffer, *preloaded);
+        return TRUE;
+    }
+    
+    if (!SumSourceFile(hSourceFile, header->fileSize, buffer, &header->checksum)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read source file");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL PatchChecksum(CpioNewcBuilder* builder, LARGE_INTEGER patchAt, UINT32 checksum, CpioError* error) {
+    if (builder->inMemory) {
+        EncodeHex(builder->memory + patchAt.QuadPart, checksum, 8);
+        return TRUE;
+    }
+    
+    HANDLE hFile = builder->hFile;
+    LARGE_INTEGER zero;
+    LARGE_INTEGER end;
+    zero.QuadPart = 0;
+    
+    if (!SetFilePointerEx(hFile, zero, &end, FILE_CURRENT) || !SetFilePointerEx(hFile, patchAt, NULL, FILE_BEGIN) ||
+        !WriteHex(hFile, checksum, 8, error) || !SetFilePointerEx(hFile, end, NULL, FILE_BEGIN)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write entry checksum");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static UINT64 WriteFileEntry(CpioNewcBuilder* builder, CpioNewcHeader* header, HANDLE hSourceFile,
+                             CpioError* error) {
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return 0;
+    }
+    
+    DWORD preloaded = 0;
+    LARGE_INTEGER patchAt;
+    if (!PrepareChecksum(builder, header, hSourceFile, buffer, &preloaded, &patchAt, error)) {
+        CpioBufferPoolRelease(buffer);
+        return 0;
+    }
+    
+    UINT64 totalWritten = WriteEntryHeader(builder, header, error);
+    if (totalWritten == 0) {
+        CpioBufferPoolRelease(buffer);
+        return 0;
+    }
+    
+    UINT64 totalCopied = 0;
+    UINT32 checksum = 0;
+    
+    while (totalCopied < header->fileSize) {
+        DWORD toRead = CPIO_POOL_BUFFER_SIZE;
+        UINT64 remaining = header->fileSize - totalCopied;
+        
+        if (toRead > remaining) {
+            toRead = (DWORD)remaining;
+        }
+        
+        DWORD bytesRead = preloaded;
+        if (preloaded > 0) {
+            preloaded = 0;
+        } else if (!ReadFile(hSourceFile, buffer, toRead, &bytesRead, NULL)) {
+            CpioBufferPoolRelease(buffer);
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read source file");
+            return 0;
+        }
+        
+        if (bytesRead == 0) break;
+        
+        if (patchAt.QuadPart >= 0) {
+            checksum = CpioByteSumUpdate(checksum, buffer, bytesRead);
+        }
+        
+        if (builder->dataCallback) {
+            builder->dataCallback(builder->dataContext, buffer, bytesRead);
+        }
+        
+        CpioBomWriterUpdate(builder->bom, buffer, bytesRead);
+        
+        if (!BuilderWrite(builder, buffer, bytesRead, "Failed to write file data", error)) {
+            CpioBufferPoolRelease(buffer);
+            return 0;
+        }
+        
+        totalCopied += bytesRead;
+    }
+    
+    CpioBufferPoolRelease(buffer);
+    totalWritten += totalCopied;
+    
+    SIZE_T dataPad = (SIZE_T)((4 - (totalCopied % 4)) % 4);
+    if (!WritePadding(builder, dataPad, error)) {
+        return 0;
+    }
+    totalWritten += dataPad;
+    builder->offset += totalCopied + dataPad;
+    
+    if (patchAt.QuadPart >= 0 && !PatchChecksum(builder, patchAt, checksum, error)) {
+        return 0;
+    }
+    
+    return totalWritten;
+}
+
+static UINT64 EmitHardLinks(CpioNewcBuilder* builder, CpioLink* link, CpioError* error) {
+    UINT64 totalWritten = 0;
+    UINT32 count = (UINT32)link->names->count;
+    
+    for (UINT32 i = 0; i < count; i++) {
+        const char* name = link->names->items[i];
+        HANDLE hSourceFile = INVALID_HANDLE_VALUE;
+        LARGE_INTEGER fileSize;
+        fileSize.QuadPart = 0;
+        
+        if (i + 1 == count) {
+            hSourceFile = CreateFileW(link->path, GENERIC_READ, FILE_SHARE_READ,
+                                      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (hSourceFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hSourceFile, &fileSize)) {
+                if (hSourceFile != INVALID_HANDLE_VALUE) CloseHandle(hSourceFile);
+                CpioLinkReset(link);
+                CpioErrorSet(error, CPIO_ERROR_IO, "Failed to open source file");
+                return 0;
+            }
+        }
+        
+        totalWritten += EmitParentDirectories(builder, name, error);
+        
+        CpioNewcHeader header;
+        CpioNewcBuilderNextHeader(builder, &header);
+        header.inode = link->inode;
+        header.nlink = count;
+        header.fileSize = fileSize.QuadPart;
+        
+        SIZE_T len = CpioStringLength(name);
+        CpioCopyMemory(header.name, name, len + 1);
+        
+        UINT64 written = WriteFileEntry(builder, &header, hSourceFile, error);
+        if (hSourceFile != INVALID_HANDLE_VALUE) CloseHandle(hSourceFile);
+        
+        if (written == 0) {
+            CpioLinkReset(link);
+            return 0;
+        }
+        totalWritten += written;
+    }
+    
+    CpioLinkReset(link);
+    return totalWritten;
+}
+
+static UINT64 AppendHardLink(CpioNewcBuilder* builder, const char* name, const WCHAR* filePath,
+                             UINT32 dev, UINT64 id, UINT32 linkCount, BOOL* deferred,
+                             CpioError* error) {
+    if (!builder->links) {
+        builder->links = CpioLinkTableCreate();
+    }
+    
+    CpioLink* link = CpioLinkTableFind(builder->links, dev, id, TRUE);
+    
+    SIZE_T pathLength = 0;
+    while (filePath[pathLength]) pathLength++;
+    WCHAR* path = (WCHAR*)CpioAlloc((pathLength + 1) * sizeof(WCHAR));
+    
+    if (!link || !path || !CpioStringListAdd(link->names, name)) {
+        if (path) CpioFree(path);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return 0;
+    }
+    
+    CpioCopyMemory(path, filePath, (pathLength + 1) * sizeof(WCHAR));
+    if (link->path) CpioFree(link->path);
+    link->path = path;
+    
+    if (link->names->count == 1) {
+        link->inode = builder->entryCount++;
+        link->expected = linkCount;
+    }
+    
+    if (link->names->count < link->expected) {
+        *deferred = TRUE;
+        return 0;
+    }
+    
+    return EmitHardLinks(builder, link, error);
+}
+
+UINT64 CpioNewcBuilderAppendFileFromPath(CpioNewcBuilder* builder, const char* archivePath, 
+                                          const WCHAR* filePath, BOOL* deferred, CpioError* error) {
+    if (!builder || !archivePath || !filePath || !deferred) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
         return 0;
     }
     
+    *deferred = FALSE;
+    
     char normalized[CPIO_MAX_NAME_LENGTH];
     if (!CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized))) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Path normalization failed");
@@ -490,6 +1229,14 @@ UINT64 CpioNewcBuilderAppendFileFromPath(CpioNewcBuilder* builder, const char* a
         return 0;
     }
     
+    BY_HANDLE_FILE_INFORMATION info;
+    if (builder->detectLinks && GetFileInformationByHandle(hSourceFile, &info) && info.nNumberOfLinks > 1) {
+        CloseHandle(hSourceFile);
+        return AppendHardLink(builder, normalized, filePath, info.dwVolumeSerialNumber,
+                              ((UINT64)info.nFileIndexHigh << 32) | info.nFileIndexLow,
+                              info.nNumberOfLinks, deferred, error);
+    }
+    
     UINT64 totalWritten = EmitParentDirectories(builder, normalized, error);
     
     CpioNewcHeader header;
@@ -502,55 +1249,251 @@ UINT64 CpioNewcBuilderAppendFileFromPath(CpioNewcBuilder* builder, const char* a
     header.name[len] = '\0';
     header.fileSize = fileSize.QuadPart;
     
-    UINT64 headerWritten = CpioNewcHeaderWrite(builder->hFile, &header, error);
+    UINT64 written = WriteFileEntry(builder, &header, hSourceFile, error);
+    CloseHandle(hSourceFile);
+    
+    if (written == 0) {
+        return 0;
+    }
+    
+    return totalWritten + written;
+}
+
+UINT64 CpioNewcBuilderAppendLink(CpioNewcBuilder* builder, const char* archivePath, const WCHAR* filePath,
+                                 UINT32 dev, UINT64 id, UINT32 linkCount, BOOL* deferred, CpioError* error) {
+    if (!builder || !archivePath || !filePath || !deferred || linkCount == 0) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid parameter");
+        return 0;
+    }
+    
+    *deferred = FALSE;
+    
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (!CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized))) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Path normalization failed");
+        return 0;
+    }
+    
+    return AppendHardLink(builder, normalized, filePath, dev, id, linkCount, deferred, error);
+}
+
+static BOOL PrepareEntry(CpioNewcBuilder* builder, const char* archivePath, const CpioEntryMetadata* metadata,
+                         UINT32 mode, CpioNewcHeader* header, UINT64* written, CpioError* error) {
+    if (!builder || !archivePath) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+    
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (!CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized))) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Path normalization failed");
+        return FALSE;
+    }
+    
+    *written = EmitParentDirectories(builder, normalized, error);
+    
+    CpioNewcBuilderNextHeader(builder, header);
+    CpioCopyMemory(header->name, normalized, CpioStringLength(normalized) + 1);
+    header->mode = mode;
+    
+    if (metadata) {
+        header->mode = (mode & CPIO_S_IFMT) | (metadata->mode & ~CPIO_S_IFMT);
+        header->uid = metadata->uid;
+        header->gid = metadata->gid;
+        header->mtime = metadata->mtime;
+    }
+    
+    return TRUE;
+}
+
+static UINT64 WriteDataEntry(CpioNewcBuilder* builder, CpioNewcHeader* header, const void* data, CpioError* error) {
+    BOOL regular = (header->mode & CPIO_S_IFMT) == CPIO_S_IFREG;
+    SIZE_T length = (SIZE_T)header->fileSize;
+    
+    if (header->crc && regular) {
+        header->checksum = CpioByteSumUpdate(0, data, length);
+    }
+    
+    UINT64 written = WriteEntryHeader(builder, header, error);
+    if (written == 0) return 0;
+    
+    if (regular && length > 0 && builder->dataCallback) {
+        builder->dataCallback(builder->dataContext, data, length);
+    }
+    
+    CpioBomWriterUpdate(builder->bom, data, length);
+    
+    SIZE_T dataPad = (4 - (length % 4)) % 4;
+    if (!BuilderWrite(builder, data, length, "Failed to write file data", error) ||
+        !WritePadding(builder, dataPad, error)) {
+        return 0;
+    }
+    builder->offset += length + dataPad;
+    
+    return written + length + dataPad;
+}
+
+UINT64 CpioNewcBuilderAppendData(CpioNewcBuilder* builder, const char* archivePath,
+                                 const CpioEntryMetadata* metadata, const void* data, SIZE_T length,
+                                 CpioError* error) {
+    if (!data && length > 0) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return 0;
+    }
+    
+    CpioNewcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, builder ? builder->defaultModeFile : 0, &header,
+                      &totalWritten, error)) {
+        return 0;
+    }
+    
+    header.fileSize = length;
+    UINT64 written = WriteDataEntry(builder, &header, data, error);
+    return written ? totalWritten + written : 0;
+}
+
+UINT64 CpioNewcBuilderAppendStream(CpioNewcBuilder* builder, const char* archivePath,
+                                   const CpioEntryMetadata* metadata, UINT64 size, CpioPullCallback pull,
+                                   void* context, CpioError* error) {
+    if (!pull) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return 0;
+    }
+    
+    CpioNewcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, builder ? builder->defaultModeFile : 0, &header,
+                      &totalWritten, error)) {
+        return 0;
+    }
+    header.fileSize = size;
+    
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return 0;
+    }
+    
+    DWORD preloaded = 0;
+    LARGE_INTEGER patchAt;
+    patchAt.QuadPart = -1;
+    
+    if (header.crc && size > 0 && !FindPatchOffset(builder, &patchAt)) {
+        if (size > CPIO_POOL_BUFFER_SIZE) {
+            CpioBufferPoolRelease(buffer);
+            CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Checksummed streams over 1 MiB need a seekable output");
+            return 0;
+        }
+        
+        while (preloaded < size) {
+            DWORD bytesRead = 0;
+            if (!pull(context, buffer + preloaded, (DWORD)size - preloaded, &bytesRead) || bytesRead == 0) {
+                CpioBufferPoolRelease(buffer);
+                CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Stream ended before its declared size");
+                return 0;
+            }
+            preloaded += bytesRead;
+        }
+        
+        UINT64 written = WriteDataEntry(builder, &header, buffer, error);
+        CpioBufferPoolRelease(buffer);
+        return written ? totalWritten + written : 0;
+    }
+    
+    UINT64 headerWritten = WriteEntryHeader(builder, &header, error);
     if (headerWritten == 0) {
-        CloseHandle(hSourceFile);
+        CpioBufferPoolRelease(buffer);
         return 0;
     }
-    totalWritten += headerWritten;
     
-    char buffer[8192];
     UINT64 totalCopied = 0;
+    UINT32 checksum = 0;
     
-    while (totalCopied < (UINT64)fileSize.QuadPart) {
-        DWORD toRead = sizeof(buffer);
-        UINT64 remaining = fileSize.QuadPart - totalCopied;
+    while (totalCopied < size) {
+        UINT64 remaining = size - totalCopied;
+        DWORD toRead = remaining < CPIO_POOL_BUFFER_SIZE ? (DWORD)remaining : CPIO_POOL_BUFFER_SIZE;
+        DWORD bytesRead = 0;
         
-        if (toRead > remaining) {
-            toRead = (DWORD)remaining;
+        if (!pull(context, buffer, toRead, &bytesRead) || bytesRead == 0) {
+            CpioBufferPoolRelease(buffer);
+            CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Stream ended before its declared size");
+            return 0;
         }
         
-        DWORD bytesRead;
-        if (!ReadFile(hSourceFile, buffer, toRead, &bytesRead, NULL)) {
-            CloseHandle(hSourceFile);
-            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read source file");
-            return 0;
+        if (bytesRead > toRead) bytesRead = toRead;
+        
+        if (patchAt.QuadPart >= 0) {
+            checksum = CpioByteSumUpdate(checksum, buffer, bytesRead);
         }
         
-        if (bytesRead == 0) break;
+        if (builder->dataCallback) {
+            builder->dataCallback(builder->dataContext, buffer, bytesRead);
+        }
         
-        DWORD bytesWritten;
-        if (!WriteFile(builder->hFile, buffer, bytesRead, &bytesWritten, NULL) ||
-            bytesWritten != bytesRead) {
-            CloseHandle(hSourceFile);
-            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write file data");
+        CpioBomWriterUpdate(builder->bom, buffer, bytesRead);
+        
+        if (!BuilderWrite(builder, buffer, bytesRead, "Failed to write file data", error)) {
+            CpioBufferPoolRelease(buffer);
             return 0;
         }
         
         totalCopied += bytesRead;
     }
     
-    CloseHandle(hSourceFile);
+    CpioBufferPoolRelease(buffer);
     
-    totalWritten += totalCopied;
+    SIZE_T dataPad = (SIZE_T)((4 - (size % 4)) % 4);
+    if (!WritePadding(builder, dataPad, error)) {
+        return 0;
+    }
+    builder->offset += size + dataPad;
     
-    SIZE_T dataPad = (SIZE_T)((4 - (totalCopied % 4)) % 4);
-    if (!WritePadding(builder->hFile, dataPad, error)) {
+    if (patchAt.QuadPart >= 0 && !PatchChecksum(builder, patchAt, checksum, error)) {
         return 0;
     }
-    totalWritten += dataPad;
     
-    return totalWritten;
+    return totalWritten + headerWritten + size + dataPad;
+}
+
+UINT64 CpioNewcBuilderAppendDirectory(CpioNewcBuilder* builder, const char* archivePath,
+                                      const CpioEntryMetadata* metadata, CpioError* error) {
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (builder && archivePath && CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized)) &&
+        CpioHashSetContains(builder->seenDirs, normalized)) {
+        return 0;
+    }
+    
+    CpioNewcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, builder ? builder->defaultModeDir : 0, &header,
+                      &totalWritten, error)) {
+        return 0;
+    }
+    
+    UINT64 written = WriteDataEntry(builder, &header, NULL, error);
+    if (written == 0) return 0;
+    
+    CpioHashSetInsert(builder->seenDirs, header.name);
+    return totalWritten + written;
+}
+
+UINT64 CpioNewcBuilderAppendSymlink(CpioNewcBuilder* builder, const char* archivePath, const char* target,
+                                    const CpioEntryMetadata* metadata, CpioError* error) {
+    if (!target || target[0] == '\0') {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Symlink target is empty");
+        return 0;
+    }
+    
+    CpioNewcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, CPIO_S_IFLNK | 0777, &header, &totalWritten, error)) {
+        return 0;
+    }
+    
+    header.fileSize = CpioStringLength(target);
+    UINT64 written = WriteDataEntry(builder, &header, target, error);
+    return written ? totalWritten + written : 0;
 }
 
 UINT64 CpioNewcBuilderEmitRootDirectory(CpioNewcBuilder* builder, CpioError* error) {
@@ -570,7 +1513,7 @@ UINT64 CpioNewcBuilderEmitRootDirectory(CpioNewcBuilder* builder, CpioError* err
     header.name[0] = '.';
     header.name[1] = '\0';
     
-    UINT64 written = CpioNewcHeaderWrite(builder->hFile, &header, error);
+    UINT64 written = WriteEntryHeader(builder, &header, error);
     if (written > 0) {
         CpioHashSetInsert(builder->seenDirs, ".");
     }
@@ -588,6 +1531,45 @@ UINT64 CpioNewcBuilderFinish(CpioNewcBuilder* builder, CpioError* error) {
         return 0;
     }
     
+    UINT64 linksWritten = 0;
+    for (CpioLink* link = builder->links ? builder->links->first : NULL; link; link = link->nextInOrder) {
+        if (link->names->count == 0) continue;
+        
+        UINT64 w = EmitHardLinks(builder, link, error);
+        if (w == 0) return 0;
+        linksWritten += w;
+    }
+    
+    UINT64 tocHeaderOffset = 0;
+    UINT64 tocWritten = 0;
+    
+    if (builder->writeToc && builder->toc) {
+        CpioNewcHeader tocHeader;
+        CpioNewcBuilderNextHeader(builder, &tocHeader);
+        CpioCopyMemory(tocHeader.name, CPIO_TOC_NAME, sizeof(CPIO_TOC_NAME));
+        tocHeader.mode = CPIO_S_IFREG | CPIO_S_IRUSR | CPIO_S_IRGRP | CPIO_S_IROTH;
+        tocHeader.fileSize = builder->toc->length;
+        if (tocHeader.crc) {
+            tocHeader.checksum = CpioByteSumUpdate(0, builder->toc->data, builder->toc->length);
+        }
+        
+        tocHeaderOffset = builder->offset;
+        
+        UINT64 headerWritten = BuilderWriteHeader(builder, &tocHeader, error);
+        if (headerWritten == 0) return 0;
+        
+        if (!BuilderWrite(builder, builder->toc->data, builder->toc->length,
+                          "Failed to write table of contents", error)) {
+            return 0;
+        }
+        
+        SIZE_T tocPad = (4 - (builder->toc->length % 4)) % 4;
+        if (!WritePadding(builder, tocPad, error)) return 0;
+        
+        tocWritten = headerWritten + builder->toc->length + tocPad;
+        builder->offset += tocWritten;
+    }
+    
     CpioNewcHeader trailer;
     CpioNewcBuilderNextHeader(builder, &trailer);
     
@@ -603,8 +1585,21 @@ UINT64 CpioNewcBuilderFinish(CpioNewcBuilder* builder, CpioError* error) {
     trailer.mode = 0;
     trailer.nlink = 1;
     
-    UINT64 written = CpioNewcHeaderWrite(builder->hFile, &trailer, error);
+    UINT64 written = BuilderWriteHeader(builder, &trailer, error);
     builder->finished = TRUE;
+    if (written == 0) return 0;
+    builder->offset += written;
     
-    return written;
+    if (tocWritten > 0) {
+        BYTE locator[CPIO_TOC_LOCATOR_SIZE];
+        CpioTocBuildLocator(locator, builder->toc, tocHeaderOffset, builder->offset);
+        
+        if (!BuilderWrite(builder, locator, sizeof(locator), "Failed to write table of contents locator", error)) {
+            return 0;
+        }
+        builder->offset += sizeof(locator);
+        written += tocWritten + sizeof(locator);
+    }
+    
+    return written + linksWritten;
 }
\ No newline at end of file
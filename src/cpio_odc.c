@@ -45,21 +45,11 @@ static UINT64 ReadOctalU64(HANDLE hFile, SIZE_T count, CpioError* error) {
     return ParseOctalU64(buffer, count);
 }
 
-static BOOL WriteOctal(HANDLE hFile, UINT64 value, SIZE_T size, CpioError* error) {
-    char buffer[32];
-    
+static void EncodeOctal(BYTE* output, UINT64 value, SIZE_T size) {
     for (int i = (int)size - 1; i >= 0; i--) {
-        buffer[i] = '0' + (char)(value & 7);
+        output[i] = (BYTE)('0' + (value & 7));
         value >>= 3;
     }
-    
-    DWORD bytesWritten;
-    if (!WriteFile(hFile, buffer, (DWORD)size, &bytesWritten, NULL) || bytesWritten != size) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write octal value");
-        return FALSE;
-    }
-    
-    return TRUE;
 }
 
 BOOL CpioOdcHeaderRead(HANDLE hFile, CpioOdcHeader* header, CpioError* error) {
@@ -98,50 +88,126 @@ BOOL CpioOdcHeaderRead(HANDLE hFile, CpioOdcHeader* header, CpioError* error) {
     return TRUE;
 }
 
+SIZE_T CpioOdcHeaderEncode(const CpioOdcHeader* header, BYTE* output) {
+    UINT32 nameLen = (UINT32)CpioStringLength(header->name) + 1;
+    
+    CpioCopyMemory(output, "070707", 6);
+    EncodeOctal(output + 6, header->dev, 6);
+    EncodeOctal(output + 12, header->inode, 6);
+    EncodeOctal(output + 18, header->mode, 6);
+    EncodeOctal(output + 24, header->uid, 6);
+    EncodeOctal(output + 30, header->gid, 6);
+    EncodeOctal(output + 36, header->nlink, 6);
+    EncodeOctal(output + 42, header->rdev, 6);
+    EncodeOctal(output + 48, header->mtime, 11);
+    EncodeOctal(output + 59, nameLen, 6);
+    EncodeOctal(output + 65, header->fileSize, 11);
+    CpioCopyMemory(output + 76, header->name, nameLen);
+    
+    return 76 + nameLen;
+}
+
 UINT64 CpioOdcHeaderWrite(HANDLE hFile, const CpioOdcHeader* header, CpioError* error) {
     if (!header) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL header");
         return 0;
     }
     
-    DWORD bytesWritten;
+    BYTE buffer[CPIO_HEADER_MAX_SIZE];
+    SIZE_T length = CpioOdcHeaderEncode(header, buffer);
     
-    if (!WriteFile(hFile, "070707", 6, &bytesWritten, NULL) || bytesWritten != 6) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write magic");
+    DWORD bytesWritten;
+    if (!WriteFile(hFile, buffer, (DWORD)length, &bytesWritten, NULL) || bytesWritten != length) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write header");
         return 0;
     }
     
-    DWORD totalWritten = 6;
-    
-    if (!WriteOctal(hFile, header->dev, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->inode, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->mode, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->uid, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->gid, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->nlink, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->rdev, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->mtime, 11, error)) return 0;
-    
-    UINT32 nameLen = (UINT32)CpioStringLength(header->name) + 1;
-    if (!WriteOctal(hFile, nameLen, 6, error)) return 0;
-    if (!WriteOctal(hFile, header->fileSize, 11, error)) return 0;
-    
-    totalWritten += 6 * 7 + 11 * 2;
-    
-    if (!WriteFile(hFile, header->name, nameLen - 1, &bytesWritten, NULL)) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write filename");
-        return 0;
+    return length;
+}
+
+BOOL CpioOdcHeaderDecode(const BYTE* data, SIZE_T size, BOOL strict, CpioOdcHeader* header,
+                         SIZE_T* consumed, CpioError* error) {
+    if (!data || !header || !consumed) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
     }
-    totalWritten += bytesWritten;
-    
-    char nul = '\0';
-    if (!WriteFile(hFile, &nul, 1, &bytesWritten, NULL)) {
-        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write filename NUL");
-        return 0;
+
+    if (size < 70) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read header");
+        return FALSE;
     }
-    totalWritten += 1;
-    
-    return totalWritten;
+
+    const char* fields = (const char*)data;
+
+    if (strict) {
+        for (SIZE_T i = 0; i < 70; i++) {
+            if (fields[i] < '0' || fields[i] > '7') {
+                CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid header field");
+                return FALSE;
+            }
+        }
+    }
+
+    CpioZeroMemory(header, sizeof(CpioOdcHeader));
+
+    header->dev = ParseOctalU32(fields, 6);
+    header->inode = ParseOctalU32(fields + 6, 6);
+    header->mode = ParseOctalU32(fields + 12, 6);
+    header->uid = ParseOctalU32(fields + 18, 6);
+    header->gid = ParseOctalU32(fields + 24, 6);
+    header->nlink = ParseOctalU32(fields + 30, 6);
+    header->rdev = ParseOctalU32(fields + 36, 6);
+    header->mtime = ParseOctalU32(fields + 42, 11);
+
+    UINT32 nameLength = ParseOctalU32(fields + 53, 6);
+    header->fileSize = ParseOctalU64(fields + 59, 11);
+
+    if (nameLength == 0 || nameLength > CPIO_MAX_NAME_LENGTH) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid name length");
+        return FALSE;
+    }
+
+    if (size < 70 + nameLength) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read filename");
+        return FALSE;
+    }
+
+    if (strict && data[70 + nameLength - 1] != '\0') {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Unterminated filename");
+        return FALSE;
+    }
+
+    CpioCopyMemory(header->name, data + 70, nameLength);
+    header->name[nameLength - 1] = '\0';
+
+    *consumed = 70 + nameLength;
+    return TRUE;
+}
+
+static BOOL ReadOdcHeaderFromSource(CpioSource* source, CpioOdcHeader* header, CpioError* error) {
+    SIZE_T available;
+    const BYTE* data = CpioSourcePeek(source, 70, &available, error);
+    if (!data) return FALSE;
+
+    if (available < 70) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read header");
+        return FALSE;
+    }
+
+    SIZE_T nameLength = ParseOctalU32((const char*)data + 53, 6);
+
+    if (nameLength > 0 && nameLength <= CPIO_MAX_NAME_LENGTH) {
+        data = CpioSourcePeek(source, 70 + nameLength, &available, error);
+        if (!data) return FALSE;
+    }
+
+    SIZE_T consumed = 0;
+    if (!CpioOdcHeaderDecode(data, available, FALSE, header, &consumed, error)) {
+        return FALSE;
+    }
+
+    CpioSourceConsume(source, consumed);
+    return TRUE;
 }
 
 CpioOdcReader* CpioOdcReaderCreate(HANDLE hFile, BOOL takeOwnership) {
@@ -150,6 +216,15 @@ CpioOdcReader* CpioOdcReaderCreate(HANDLE hFile, BOOL takeOwnership) {
     CpioOdcReader* reader = (CpioOdcReader*)CpioAlloc(sizeof(CpioOdcReader));
     if (!reader) return NULL;
     
+    if (!CpioSourceInit(&reader->source, hFile)) {
+        CpioFree(reader);
+        return NULL;
+    }
+    
+    if (!reader->source.seekable) {
+        reader->source.position = CPIO_MAGIC_SIZE;
+    }
+    
     reader->hFile = hFile;
     reader->ownsHandle = takeOwnership;
     reader->currentEntrySize = 0;
@@ -163,6 +238,8 @@ CpioOdcReader* CpioOdcReaderCreate(HANDLE hFile, BOOL takeOwnership) {
 void CpioOdcReaderDestroy(CpioOdcReader* reader) {
     if (!reader) return;
     
+    CpioSourceRelease(&reader->source);
+    
     if (reader->ownsHandle && reader->hFile != INVALID_HANDLE_VALUE) {
         CloseHandle(reader->hFile);
     }
@@ -183,29 +260,27 @@ BOOL CpioOdcReaderReadNext(CpioOdcReader* reader, CpioOdcHeader* header, CpioErr
     }
     
     if (!reader->firstEntry) {
-        char magic[6];
-        DWORD bytesRead;
+        SIZE_T available;
+        const BYTE* magic = CpioSourcePeek(&reader->source, 6, &available, error);
         
-        if (!ReadFile(reader->hFile, magic, 6, &bytesRead, NULL)) {
-            if (GetLastError() == ERROR_HANDLE_EOF) {
-                return FALSE;
-            }
-            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read magic");
+        if (!magic) {
             return FALSE;
         }
         
-        if (bytesRead == 0) {
+        if (available == 0) {
             return FALSE;
         }
         
-        if (bytesRead != 6 || CpioCompareMemory(magic, "070707", 6) != 0) {
+        if (available != 6 || CpioCompareMemory(magic, "070707", 6) != 0) {
             CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid magic number");
             return FALSE;
         }
+        
+        CpioSourceConsume(&reader->source, 6);
     }
     reader->firstEntry = FALSE;
     
-    if (!CpioOdcHeaderRead(reader->hFile, header, error)) {
+    if (!ReadOdcHeaderFromSource(&reader->source, header, error)) {
         return FALSE;
     }
     
@@ -237,50 +312,72 @@ DWORD CpioOdcReaderRead(CpioOdcReader* reader, void* buffer, DWORD bufferSize, C
         toRead = (DWORD)remaining;
     }
     
-    DWORD bytesRead;
-    if (!ReadFile(reader->hFile, buffer, toRead, &bytesRead, NULL)) {
+    SIZE_T bytesRead;
+    if (!CpioSourceRead(&reader->source, buffer, toRead, &bytesRead, error)) {
         CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read entry data");
         return 0;
     }
     
     reader->currentEntryRead += bytesRead;
-    return bytesRead;
+    return (DWORD)bytesRead;
 }
 
-BOOL CpioOdcReaderFinish(CpioOdcReader* reader, CpioError* error) {
-    if (!reader) return FALSE;
+BOOL CpioOdcReaderCopyToHandle(CpioOdcReader* reader, HANDLE hOutFile, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
     
-    if (reader->currentEntrySize == 0 || reader->currentEntryRead >= reader->currentEntrySize) {
-        reader->currentEntrySize = 0;
-        reader->currentEntryRead = 0;
+    if (reader->currentEntryRead >= reader->currentEntrySize) {
         return TRUE;
     }
     
     UINT64 remaining = reader->currentEntrySize - reader->currentEntryRead;
+    UINT64 copied = 0;
+    BOOL ok = CpioSourceCopyToHandle(&reader->source, hOutFile, remaining, &copied, error);
+    reader->currentEntryRead += copied;
     
-    if (remaining > 0) {
-        LARGE_INTEGER dist;
-        dist.QuadPart = remaining;
-        
-        if (!SetFilePointerEx(reader->hFile, dist, NULL, FILE_CURRENT)) {
-            char buffer[8192];
-            while (remaining > 0) {
-                DWORD toRead = remaining > sizeof(buffer) ? sizeof(buffer) : (DWORD)remaining;
-                DWORD bytesRead;
-                
-                if (!ReadFile(reader->hFile, buffer, toRead, &bytesRead, NULL)) {
-                    CpioErrorSet(error, CPIO_ERROR_IO, "Failed to skip entry data");
-                    return FALSE;
-                }
-                
-                remaining -= bytesRead;
-                if (bytesRead == 0) break;
-            }
-        }
+    if (ok && copied != remaining) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive truncated in entry data");
+        return FALSE;
     }
     
+    return ok;
+}
+
+BOOL CpioOdcReaderFinish(CpioOdcReader* reader, CpioError* error) {
+    if (!reader) return FALSE;
+    
+    UINT64 remaining = 0;
+    if (reader->currentEntryRead < reader->currentEntrySize) {
+        remaining = reader->currentEntrySize - reader->currentEntryRead;
+    }
+    
+    BOOL ok = CpioSourceSkip(&reader->source, remaining, error);
+    
     reader->currentEntrySize = 0;
     reader->currentEntryRead = 0;
+    return ok;
+}
+
+BOOL CpioOdcReaderSeek(CpioOdcReader* reader, UINT64 headerOffset, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
+    
+    if (reader->firstEntry && headerOffset + CPIO_MAGIC_SIZE == CpioSourceTell(&reader->source)) {
+        return TRUE;
+    }
+    
+    if (!CpioSourceSeek(&reader->source, headerOffset, error)) {
+        return FALSE;
+    }
+    
+    reader->currentEntrySize = 0;
+    reader->currentEntryRead = 0;
+    reader->seenTrailer = FALSE;
+    reader->firstEntry = FALSE;
     return TRUE;
 }
 
@@ -305,6 +402,10 @@ CpioOdcBuilder* CpioOdcBuilderCreate(HANDLE hFile, BOOL takeOwnership) {
     builder->autoWriteDirs = TRUE;
     builder->seenDirs = CpioHashSetCreate();
     builder->entryCount = 0;
+    builder->detectLinks = TRUE;
+    builder->links = NULL;
+    builder->dataCallback = NULL;
+    builder->dataContext = NULL;
     builder->finished = FALSE;
     
     if (!builder->seenDirs) {
@@ -315,6 +416,51 @@ CpioOdcBuilder* CpioOdcBuilderCreate(HANDLE hFile, BOOL takeOwnership) {
     return builder;
 }
 
+CpioOdcBuilder* CpioOdcBuilderCreateAppend(HANDLE hFile, BOOL takeOwnership, CpioError* error) {
+    CpioReader* reader = CpioReaderCreate(hFile, FALSE, error);
+    if (!reader) return NULL;
+
+    if (CpioReaderGetFormat(reader) != CPIO_FORMAT_ODC) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Archive is not in odc format");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    if (reader->compression != CPIO_FORMAT_UNKNOWN) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Cannot append to a compressed archive");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    CpioOdcBuilder* builder = CpioOdcBuilderCreate(hFile, FALSE);
+    if (!builder) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioReaderDestroy(reader);
+        return NULL;
+    }
+
+    CpioAppendPoint point;
+    BOOL found = CpioReaderFindAppendPoint(reader, builder->seenDirs, NULL, &point, error);
+    CpioReaderDestroy(reader);
+
+    if (!found) {
+        CpioOdcBuilderDestroy(builder);
+        return NULL;
+    }
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = (LONGLONG)point.offset;
+    if (!SetFilePointerEx(hFile, distance, NULL, FILE_BEGIN) || !SetEndOfFile(hFile)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to truncate archive trailer");
+        CpioOdcBuilderDestroy(builder);
+        return NULL;
+    }
+
+    builder->ownsHandle = takeOwnership;
+    builder->entryCount = point.nextInode;
+    return builder;
+}
+
 void CpioOdcBuilderDestroy(CpioOdcBuilder* builder) {
     if (!builder) return;
     
@@ -322,6 +468,8 @@ void CpioOdcBuilderDestroy(CpioOdcBuilder* builder) {
         CpioHashSetDestroy(builder->seenDirs);
     }
     
+    CpioLinkTableDestroy(builder->links);
+    
     if (builder->ownsHandle && builder->hFile != INVALID_HANDLE_VALUE) {
         CloseHandle(builder->hFile);
     }
@@ -409,13 +557,150 @@ static UINT64 EmitParentDirectoriesOdc(CpioOdcBuilder* builder, const char* file
     return totalWritten;
 }
 
+static UINT64 WriteFileEntry(CpioOdcBuilder* builder, CpioOdcHeader* header, HANDLE hSourceFile,
+                             CpioError* error) {
+    UINT64 totalWritten = CpioOdcHeaderWrite(builder->hFile, header, error);
+    if (totalWritten == 0) {
+        return 0;
+    }
+    
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return 0;
+    }
+    
+    UINT64 totalCopied = 0;
+    
+    while (totalCopied < header->fileSize) {
+        DWORD toRead = CPIO_POOL_BUFFER_SIZE;
+        UINT64 remaining = header->fileSize - totalCopied;
+        
+        if (toRead > remaining) {
+            toRead = (DWORD)remaining;
+        }
+        
+        DWORD bytesRead;
+        if (!ReadFile(hSourceFile, buffer, toRead, &bytesRead, NULL)) {
+            CpioBufferPoolRelease(buffer);
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read source file");
+            return 0;
+        }
+        
+        if (bytesRead == 0) break;
+        
+        if (builder->dataCallback) {
+            builder->dataCallback(builder->dataContext, buffer, bytesRead);
+        }
+        
+        DWORD bytesWritten;
+        if (!WriteFile(builder->hFile, buffer, bytesRead, &bytesWritten, NULL) ||
+            bytesWritten != bytesRead) {
+            CpioBufferPoolRelease(buffer);
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write file data");
+            return 0;
+        }
+        
+        totalCopied += bytesRead;
+    }
+    
+    CpioBufferPoolRelease(buffer);
+    totalWritten += totalCopied;
+    
+    return totalWritten;
+}
+
+static UINT64 EmitHardLinks(CpioOdcBuilder* builder, CpioLink* link, CpioError* error) {
+    UINT64 totalWritten = 0;
+    UINT32 count = (UINT32)link->names->count;
+    
+    for (UINT32 i = 0; i < count; i++) {
+        const char* name = link->names->items[i];
+        HANDLE hSourceFile = INVALID_HANDLE_VALUE;
+        LARGE_INTEGER fileSize;
+        fileSize.QuadPart = 0;
+        
+        if (i + 1 == count) {
+            hSourceFile = CreateFileW(link->path, GENERIC_READ, FILE_SHARE_READ,
+                                      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (hSourceFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hSourceFile, &fileSize)) {
+                if (hSourceFile != INVALID_HANDLE_VALUE) CloseHandle(hSourceFile);
+                CpioLinkReset(link);
+                CpioErrorSet(error, CPIO_ERROR_IO, "Failed to open source file");
+                return 0;
+            }
+        }
+        
+        totalWritten += EmitParentDirectoriesOdc(builder, name, error);
+        
+        CpioOdcHeader header;
+        CpioOdcBuilderNextHeader(builder, &header);
+        header.inode = link->inode;
+        header.nlink = count;
+        header.fileSize = fileSize.QuadPart;
+        
+        SIZE_T len = CpioStringLength(name);
+        CpioCopyMemory(header.name, name, len + 1);
+        
+        UINT64 written = WriteFileEntry(builder, &header, hSourceFile, error);
+        if (hSourceFile != INVALID_HANDLE_VALUE) CloseHandle(hSourceFile);
+        
+        if (written == 0) {
+            CpioLinkReset(link);
+            return 0;
+        }
+        totalWritten += written;
+    }
+    
+    CpioLinkReset(link);
+    return totalWritten;
+}
+
+static UINT64 AppendHardLink(CpioOdcBuilder* builder, const char* name, const WCHAR* filePath,
+                             UINT32 dev, UINT64 id, UINT32 linkCount, BOOL* deferred,
+                             CpioError* error) {
+    if (!builder->links) {
+        builder->links = CpioLinkTableCreate();
+    }
+    
+    CpioLink* link = CpioLinkTableFind(builder->links, dev, id, TRUE);
+    
+    SIZE_T pathLength = 0;
+    while (filePath[pathLength]) pathLength++;
+    WCHAR* path = (WCHAR*)CpioAlloc((pathLength + 1) * sizeof(WCHAR));
+    
+    if (!link || !path || !CpioStringListAdd(link->names, name)) {
+        if (path) CpioFree(path);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return 0;
+    }
+    
+    CpioCopyMemory(path, filePath, (pathLength + 1) * sizeof(WCHAR));
+    if (link->path) CpioFree(link->path);
+    link->path = path;
+    
+    if (link->names->count == 1) {
+        link->inode = builder->entryCount++;
+        link->expected = linkCount;
+    }
+    
+    if (link->names->count < link->expected) {
+        *deferred = TRUE;
+        return 0;
+    }
+    
+    return EmitHardLinks(builder, link, error);
+}
+
 UINT64 CpioOdcBuilderAppendFileFromPath(CpioOdcBuilder* builder, const char* archivePath,
-                                         const WCHAR* filePath, CpioError* error) {
-    if (!builder || !archivePath || !filePath) {
+                                         const WCHAR* filePath, BOOL* deferred, CpioError* error) {
+    if (!builder || !archivePath || !filePath || !deferred) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
         return 0;
     }
     
+    *deferred = FALSE;
+    
     char normalized[CPIO_MAX_NAME_LENGTH];
     if (!CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized))) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Path normalization failed");
@@ -437,6 +722,14 @@ UINT64 CpioOdcBuilderAppendFileFromPath(CpioOdcBuilder* builder, const char* arc
         return 0;
     }
     
+    BY_HANDLE_FILE_INFORMATION info;
+    if (builder->detectLinks && GetFileInformationByHandle(hSourceFile, &info) && info.nNumberOfLinks > 1) {
+        CloseHandle(hSourceFile);
+        return AppendHardLink(builder, normalized, filePath, info.dwVolumeSerialNumber,
+                              ((UINT64)info.nFileIndexHigh << 32) | info.nFileIndexLow,
+                              info.nNumberOfLinks, deferred, error);
+    }
+    
     UINT64 totalWritten = EmitParentDirectoriesOdc(builder, normalized, error);
     
     CpioOdcHeader header;
@@ -449,48 +742,211 @@ UINT64 CpioOdcBuilderAppendFileFromPath(CpioOdcBuilder* builder, const char* arc
     header.name[len] = '\0';
     header.fileSize = fileSize.QuadPart;
     
+    UINT64 written = WriteFileEntry(builder, &header, hSourceFile, error);
+    CloseHandle(hSourceFile);
+    
+    if (written == 0) {
+        return 0;
+    }
+    
+    return totalWritten + written;
+}
+
+UINT64 CpioOdcBuilderAppendLink(CpioOdcBuilder* builder, const char* archivePath, const WCHAR* filePath,
+                                UINT32 dev, UINT64 id, UINT32 linkCount, BOOL* deferred, CpioError* error) {
+    if (!builder || !archivePath || !filePath || !deferred || linkCount == 0) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid parameter");
+        return 0;
+    }
+    
+    *deferred = FALSE;
+    
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (!CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized))) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Path normalization failed");
+        return 0;
+    }
+    
+    return AppendHardLink(builder, normalized, filePath, dev, id, linkCount, deferred, error);
+}
+
+static BOOL WriteBytes(HANDLE hFile, const void* data, SIZE_T size, const char* message, CpioError* error) {
+    const BYTE* bytes = (const BYTE*)data;
+    
+    while (size > 0) {
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD bytesWritten;
+        if (!WriteFile(hFile, bytes, chunk, &bytesWritten, NULL) || bytesWritten != chunk) {
+            CpioErrorSet(error, CPIO_ERROR_IO, message);
+            return FALSE;
+        }
+        bytes += chunk;
+        size -= chunk;
+    }
+    
+    return TRUE;
+}
+
+static BOOL PrepareEntry(CpioOdcBuilder* builder, const char* archivePath, const CpioEntryMetadata* metadata,
+                         UINT32 mode, CpioOdcHeader* header, UINT64* written, CpioError* error) {
+    if (!builder || !archivePath) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+    
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (!CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized))) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Path normalization failed");
+        return FALSE;
+    }
+    
+    *written = EmitParentDirectoriesOdc(builder, normalized, error);
+    
+    CpioOdcBuilderNextHeader(builder, header);
+    CpioCopyMemory(header->name, normalized, CpioStringLength(normalized) + 1);
+    header->mode = mode;
+    
+    if (metadata) {
+        header->mode = (mode & CPIO_S_IFMT) | (metadata->mode & ~CPIO_S_IFMT);
+        header->uid = metadata->uid;
+        header->gid = metadata->gid;
+        header->mtime = metadata->mtime;
+    }
+    
+    return TRUE;
+}
+
+static UINT64 WriteDataEntry(CpioOdcBuilder* builder, CpioOdcHeader* header, const void* data, CpioError* error) {
+    SIZE_T length = (SIZE_T)header->fileSize;
+    
+    UINT64 written = CpioOdcHeaderWrite(builder->hFile, header, error);
+    if (written == 0) return 0;
+    
+    if ((header->mode & CPIO_S_IFMT) == CPIO_S_IFREG && length > 0 && builder->dataCallback) {
+        builder->dataCallback(builder->dataContext, data, length);
+    }
+    
+    if (!WriteBytes(builder->hFile, data, length, "Failed to write file data", error)) {
+        return 0;
+    }
+    
+    return written + length;
+}
+
+UINT64 CpioOdcBuilderAppendData(CpioOdcBuilder* builder, const char* archivePath,
+                                const CpioEntryMetadata* metadata, const void* data, SIZE_T length,
+                                CpioError* error) {
+    if (!data && length > 0) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return 0;
+    }
+    
+    CpioOdcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, builder ? builder->defaultModeFile : 0, &header,
+                      &totalWritten, error)) {
+        return 0;
+    }
+    
+    header.fileSize = length;
+    UINT64 written = WriteDataEntry(builder, &header, data, error);
+    return written ? totalWritten + written : 0;
+}
+
+UINT64 CpioOdcBuilderAppendStream(CpioOdcBuilder* builder, const char* archivePath,
+                                  const CpioEntryMetadata* metadata, UINT64 size, CpioPullCallback pull,
+                                  void* context, CpioError* error) {
+    if (!pull) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return 0;
+    }
+    
+    CpioOdcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, builder ? builder->defaultModeFile : 0, &header,
+                      &totalWritten, error)) {
+        return 0;
+    }
+    header.fileSize = size;
+    
     UINT64 headerWritten = CpioOdcHeaderWrite(builder->hFile, &header, error);
-    if (headerWritten == 0) {
-        CloseHandle(hSourceFile);
+    if (headerWritten == 0) return 0;
+    
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
         return 0;
     }
-    totalWritten += headerWritten;
     
-    char buffer[8192];
     UINT64 totalCopied = 0;
     
-    while (totalCopied < (UINT64)fileSize.QuadPart) {
-        DWORD toRead = sizeof(buffer);
-        UINT64 remaining = fileSize.QuadPart - totalCopied;
-        
-        if (toRead > remaining) {
-            toRead = (DWORD)remaining;
-        }
+    while (totalCopied < size) {
+        UINT64 remaining = size - totalCopied;
+        DWORD toRead = remaining < CPIO_POOL_BUFFER_SIZE ? (DWORD)remaining : CPIO_POOL_BUFFER_SIZE;
+        DWORD bytesRead = 0;
         
-        DWORD bytesRead;
-        if (!ReadFile(hSourceFile, buffer, toRead, &bytesRead, NULL)) {
-            CloseHandle(hSourceFile);
-            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read source file");
+        if (!pull(context, buffer, toRead, &bytesRead) || bytesRead == 0) {
+            CpioBufferPoolRelease(buffer);
+            CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Stream ended before its declared size");
             return 0;
         }
         
-        if (bytesRead == 0) break;
+        if (bytesRead > toRead) bytesRead = toRead;
         
-        DWORD bytesWritten;
-        if (!WriteFile(builder->hFile, buffer, bytesRead, &bytesWritten, NULL) ||
-            bytesWritten != bytesRead) {
-            CloseHandle(hSourceFile);
-            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write file data");
+        if (builder->dataCallback) {
+            builder->dataCallback(builder->dataContext, buffer, bytesRead);
+        }
+        
+        if (!WriteBytes(builder->hFile, buffer, bytesRead, "Failed to write file data", error)) {
+            CpioBufferPoolRelease(buffer);
             return 0;
         }
         
         totalCopied += bytesRead;
     }
     
-    CloseHandle(hSourceFile);
-    totalWritten += totalCopied;
+    CpioBufferPoolRelease(buffer);
+    return totalWritten + headerWritten + size;
+}
+
+UINT64 CpioOdcBuilderAppendDirectory(CpioOdcBuilder* builder, const char* archivePath,
+                                     const CpioEntryMetadata* metadata, CpioError* error) {
+    char normalized[CPIO_MAX_NAME_LENGTH];
+    if (builder && archivePath && CpioNormalizeArchivePath(archivePath, normalized, sizeof(normalized)) &&
+        CpioHashSetContains(builder->seenDirs, normalized)) {
+        return 0;
+    }
     
-    return totalWritten;
+    CpioOdcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, builder ? builder->defaultModeDir : 0, &header,
+                      &totalWritten, error)) {
+        return 0;
+    }
+    
+    UINT64 written = WriteDataEntry(builder, &header, NULL, error);
+    if (written == 0) return 0;
+    
+    CpioHashSetInsert(builder->seenDirs, header.name);
+    return totalWritten + written;
+}
+
+UINT64 CpioOdcBuilderAppendSymlink(CpioOdcBuilder* builder, const char* archivePath, const char* target,
+                                   const CpioEntryMetadata* metadata, CpioError* error) {
+    if (!target || target[0] == '\0') {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Symlink target is empty");
+        return 0;
+    }
+    
+    CpioOdcHeader header;
+    UINT64 totalWritten;
+    if (!PrepareEntry(builder, archivePath, metadata, CPIO_S_IFLNK | 0777, &header, &totalWritten, error)) {
+        return 0;
+    }
+    
+    header.fileSize = CpioStringLength(target);
+    UINT64 written = WriteDataEntry(builder, &header, target, error);
+    return written ? totalWritten + written : 0;
 }
 
 UINT64 CpioOdcBuilderEmitRootDirectory(CpioOdcBuilder* builder, CpioError* error) {
@@ -528,6 +984,15 @@ UINT64 CpioOdcBuilderFinish(CpioOdcBuilder* builder, CpioError* error) {
         return 0;
     }
     
+    UINT64 linksWritten = 0;
+    for (CpioLink* link = builder->links ? builder->links->first : NULL; link; link = link->nextInOrder) {
+        if (link->names->count == 0) continue;
+        
+        UINT64 w = EmitHardLinks(builder, link, error);
+        if (w == 0) return 0;
+        linksWritten += w;
+    }
+    
     CpioOdcHeader trailer;
     CpioOdcBuilderNextHeader(builder, &trailer);
     
@@ -541,6 +1006,7 @@ UINT64 CpioOdcBuilderFinish(CpioOdcBuilder* builder, CpioError* error) {
     
     UINT64 written = CpioOdcHeaderWrite(builder->hFile, &trailer, error);
     builder->finished = TRUE;
+    if (written == 0) return 0;
     
-    return written;
+    return written + linksWritten;
 }
\ No newline at end of file
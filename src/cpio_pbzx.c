@@ -0,0 +1,590 @@
+#include "cpio.h"
+
+#define PBZX_HEADER_SIZE 12
+#define PBZX_CHUNK_HEADER_SIZE 16
+
+static BOOL WriteAll(HANDLE hFile, const BYTE* data, SIZE_T length) {
+    while (length > 0) {
+        DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+        DWORD bytesWritten = 0;
+        if (!WriteFile(hFile, data, chunk, &bytesWritten, NULL) || bytesWritten == 0) {
+            return FALSE;
+        }
+        data += bytesWritten;
+        length -= bytesWritten;
+    }
+    return TRUE;
+}
+
+static BOOL ReadAll(HANDLE hFile, BYTE* data, SIZE_T length, SIZE_T* total) {
+    *total = 0;
+
+    while (*total < length) {
+        SIZE_T remaining = length - *total;
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+        DWORD bytesRead = 0;
+
+        if (!ReadFile(hFile, data + *total, chunk, &bytesRead, NULL)) {
+            return GetLastError() == ERROR_BROKEN_PIPE;
+        }
+        if (bytesRead == 0) break;
+        *total += bytesRead;
+    }
+    return TRUE;
+}
+
+static void PutBigEndian64(BYTE* p, UINT64 value) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (BYTE)value;
+        value >>= 8;
+    }
+}
+
+static UINT64 GetBigEndian64(const BYTE* p) {
+    UINT64 value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static void WriterFail(CpioPbzxWriter* writer, CpioErrorCode code, const char* message) {
+    AcquireSRWLockExclusive(&writer->lock);
+    if (!writer->failed) {
+        writer->failed = TRUE;
+        CpioErrorSet(&writer->error, code, message);
+    }
+    ReleaseSRWLockExclusive(&writer->lock);
+}
+
+static DWORD WINAPI CompressWorker(LPVOID param) {
+    CpioPbzxWriter* writer = (CpioPbzxWriter*)param;
+    CpioLzmaEncoder* encoder = writer->encoders[InterlockedIncrement(&writer->nextEncoder) - 1];
+
+    AcquireSRWLockExclusive(&writer->lock);
+
+    for (;;) {
+        while (!writer->shutdown && writer->taken == writer->submitted) {
+            SleepConditionVariableSRW(&writer->workReady, &writer->lock, INFINITE, 0);
+        }
+        if (writer->taken == writer->submitted) break;
+
+        CpioPbzxChunk* chunk = &writer->chunks[writer->taken++ % writer->chunkCount];
+        ReleaseSRWLockExclusive(&writer->lock);
+
+        chunk->outputLength = CpioXzCompress(encoder, chunk->input, chunk->inputLength, chunk->output,
+                                             CpioXzBound(CPIO_PBZX_CHUNK_SIZE));
+        chunk->stored = chunk->outputLength == 0 || chunk->outputLength >= chunk->inputLength;
+
+        AcquireSRWLockExclusive(&writer->lock);
+        chunk->done = TRUE;
+        WakeAllConditionVariable(&writer->workDone);
+    }
+
+    ReleaseSRWLockExclusive(&writer->lock);
+    return 0;
+}
+
+static BOOL WriteChunk(CpioPbzxWriter* writer, const CpioPbzxChunk* chunk) {
+    BYTE header[PBZX_CHUNK_HEADER_SIZE];
+    const BYTE* data = chunk->stored ? chunk->input : chunk->output;
+    SIZE_T length = chunk->stored ? chunk->inputLength : chunk->outputLength;
+
+    PutBigEndian64(header, chunk->inputLength);
+    PutBigEndian64(header + 8, length);
+
+    return WriteAll(writer->hOutput, header, sizeof(header)) && WriteAll(writer->hOutput, data, length);
+}
+
+static DWORD WINAPI DispatchWriterChunks(LPVOID param) {
+    CpioPbzxWriter* writer = (CpioPbzxWriter*)param;
+    BYTE header[PBZX_HEADER_SIZE];
+    UINT64 filled = 0;
+    UINT64 written = 0;
+    BOOL ended = FALSE;
+
+    CpioCopyMemory(header, CPIO_PBZX_MAGIC, 4);
+    PutBigEndian64(header + 4, CPIO_PBZX_CHUNK_SIZE);
+
+    if (!WriteAll(writer->hOutput, header, sizeof(header))) {
+        WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+    }
+
+    while (!writer->failed) {
+        CpioPbzxChunk* oldest = &writer->chunks[written % writer->chunkCount];
+
+        AcquireSRWLockShared(&writer->lock);
+        BOOL ready = written < filled && oldest->done;
+        ReleaseSRWLockShared(&writer->lock);
+
+        if (ready) {
+            if (!WriteChunk(writer, oldest)) {
+                WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+                break;
+            }
+            written++;
+            continue;
+        }
+
+        if (!ended && filled - written < writer->chunkCount) {
+            CpioPbzxChunk* chunk = &writer->chunks[filled % writer->chunkCount];
+
+            if (!ReadAll(writer->hPipe, chunk->input, CPIO_PBZX_CHUNK_SIZE, &chunk->inputLength)) {
+                WriterFail(writer, CPIO_ERROR_IO, "Failed to read archive stream");
+                break;
+            }
+            if (chunk->inputLength == 0) {
+                ended = TRUE;
+                continue;
+            }
+
+            AcquireSRWLockExclusive(&writer->lock);
+            chunk->done = FALSE;
+            writer->submitted++;
+            WakeConditionVariable(&writer->workReady);
+            ReleaseSRWLockExclusive(&writer->lock);
+
+            filled++;
+            continue;
+        }
+
+        if (written == filled) break;
+
+        AcquireSRWLockExclusive(&writer->lock);
+        while (!oldest->done) {
+            SleepConditionVariableSRW(&writer->workDone, &writer->lock, INFINITE, 0);
+        }
+        ReleaseSRWLockExclusive(&writer->lock);
+    }
+
+    if (writer->failed) {
+        CloseHandle(writer->hPipe);
+        writer->hPipe = NULL;
+    }
+
+    AcquireSRWLockExclusive(&writer->lock);
+    writer->shutdown = TRUE;
+    WakeAllConditionVariable(&writer->workReady);
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    return 0;
+}
+
+static UINT32 ResolveThreadCount(UINT32 threadCount) {
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    return threadCount > CPIO_PBZX_MAX_THREADS ? CPIO_PBZX_MAX_THREADS : threadCount;
+}
+
+static BOOL AllocateChunks(CpioPbzxChunk** chunks, UINT32 count, SIZE_T inputSize, SIZE_T outputSize) {
+    *chunks = (CpioPbzxChunk*)CpioAlloc(sizeof(CpioPbzxChunk) * count);
+    if (!*chunks) return FALSE;
+
+    for (UINT32 i = 0; i < count; i++) {
+        (*chunks)[i].input = (BYTE*)CpioAlloc(inputSize);
+        (*chunks)[i].output = (BYTE*)CpioAlloc(outputSize);
+        if (!(*chunks)[i].input || !(*chunks)[i].output) return FALSE;
+    }
+    return TRUE;
+}
+
+static void FreeChunks(CpioPbzxChunk* chunks, UINT32 count) {
+    if (!chunks) return;
+
+    for (UINT32 i = 0; i < count; i++) {
+        if (chunks[i].input) CpioFree(chunks[i].input);
+        if (chunks[i].output) CpioFree(chunks[i].output);
+    }
+    CpioFree(chunks);
+}
+
+CpioPbzxWriter* CpioPbzxWriterCreate(HANDLE hOutput, UINT32 threadCount, CpioError* error) {
+    if (hOutput == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Invalid file handle");
+        return NULL;
+    }
+
+    threadCount = ResolveThreadCount(threadCount);
+
+    CpioPbzxWriter* writer = (CpioPbzxWriter*)CpioAlloc(sizeof(CpioPbzxWriter));
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    writer->hOutput = hOutput;
+    writer->threadCount = threadCount;
+    writer->chunkCount = threadCount + 1;
+    InitializeSRWLock(&writer->lock);
+    InitializeConditionVariable(&writer->workReady);
+    InitializeConditionVariable(&writer->workDone);
+
+    BOOL ok = AllocateChunks(&writer->chunks, writer->chunkCount, CPIO_PBZX_CHUNK_SIZE,
+                             CpioXzBound(CPIO_PBZX_CHUNK_SIZE));
+
+    for (UINT32 i = 0; ok && i < threadCount; i++) {
+        writer->encoders[i] = CpioLzmaEncoderCreate();
+        ok = writer->encoders[i] != NULL;
+    }
+
+    if (!ok) {
+        CpioPbzxWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    if (!CreatePipe(&writer->hPipe, &writer->hInput, NULL, CPIO_POOL_BUFFER_SIZE)) {
+        CpioPbzxWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create compression pipe");
+        return NULL;
+    }
+
+    for (UINT32 i = 0; i < threadCount; i++) {
+        writer->threads[writer->started] = CreateThread(NULL, 0, CompressWorker, writer, 0, NULL);
+        if (writer->threads[writer->started]) writer->started++;
+    }
+
+    writer->dispatcher = writer->started > 0 ? CreateThread(NULL, 0, DispatchWriterChunks, writer, 0, NULL) : NULL;
+    if (!writer->dispatcher) {
+        CpioPbzxWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start compression threads");
+        return NULL;
+    }
+
+    return writer;
+}
+
+HANDLE CpioPbzxWriterGetHandle(const CpioPbzxWriter* writer) {
+    return writer ? writer->hInput : INVALID_HANDLE_VALUE;
+}
+
+static void StopWriter(CpioPbzxWriter* writer) {
+    if (writer->hInput) {
+        CloseHandle(writer->hInput);
+        writer->hInput = NULL;
+    }
+
+    if (writer->dispatcher) {
+        WaitForSingleObject(writer->dispatcher, INFINITE);
+        CloseHandle(writer->dispatcher);
+        writer->dispatcher = NULL;
+    }
+
+    AcquireSRWLockExclusive(&writer->lock);
+    writer->shutdown = TRUE;
+    WakeAllConditionVariable(&writer->workReady);
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    if (writer->started > 0) {
+        WaitForMultipleObjects(writer->started, writer->threads, TRUE, INFINITE);
+        for (UINT32 i = 0; i < writer->started; i++) {
+            CloseHandle(writer->threads[i]);
+        }
+        writer->started = 0;
+    }
+}
+
+BOOL CpioPbzxWriterFinish(CpioPbzxWriter* writer, CpioError* error) {
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL pbzx writer");
+        return FALSE;
+    }
+
+    StopWriter(writer);
+
+    if (writer->failed) {
+        if (error) *error = writer->error;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CpioPbzxWriterDestroy(CpioPbzxWriter* writer) {
+    if (!writer) return;
+
+    StopWriter(writer);
+    if (writer->hPipe) CloseHandle(writer->hPipe);
+
+    for (UINT32 i = 0; i < writer->threadCount; i++) {
+        CpioLzmaEncoderDestroy(writer->encoders[i]);
+    }
+
+    FreeChunks(writer->chunks, writer->chunkCount);
+    CpioFree(writer);
+}
+
+static void ReaderFail(CpioPbzxReader* pbzx, CpioErrorCode code, const char* message) {
+    AcquireSRWLockExclusive(&pbzx->lock);
+    if (!pbzx->failed) {
+        pbzx->failed = TRUE;
+        CpioErrorSet(&pbzx->error, code, message);
+    }
+    ReleaseSRWLockExclusive(&pbzx->lock);
+}
+
+static DWORD WINAPI DecompressWorker(LPVOID param) {
+    CpioPbzxReader* pbzx = (CpioPbzxReader*)param;
+
+    AcquireSRWLockExclusive(&pbzx->lock);
+
+    for (;;) {
+        while (!pbzx->shutdown && pbzx->taken == pbzx->submitted) {
+            SleepConditionVariableSRW(&pbzx->workReady, &pbzx->lock, INFINITE, 0);
+        }
+        if (pbzx->taken == pbzx->submitted) break;
+
+        CpioPbzxChunk* chunk = &pbzx->chunks[pbzx->taken++ % pbzx->chunkCount];
+        ReleaseSRWLockExclusive(&pbzx->lock);
+
+        if (!chunk->stored) {
+            CpioError error;
+            CpioZeroMemory(&error, sizeof(error));
+
+            if (!CpioXzDecompress(chunk->input, chunk->inputLength, chunk->output, pbzx->chunkSize,
+                                  &chunk->outputLength, &error)) {
+                ReaderFail(pbzx, error.code, error.message);
+            } else if (chunk->outputLength != chunk->flags) {
+                ReaderFail(pbzx, CPIO_ERROR_SIZE_MISMATCH, "pbzx chunk size mismatch");
+            }
+        }
+
+        AcquireSRWLockExclusive(&pbzx->lock);
+        chunk->done = TRUE;
+        WakeAllConditionVariable(&pbzx->workDone);
+    }
+
+    ReleaseSRWLockExclusive(&pbzx->lock);
+    return 0;
+}
+
+static BOOL FillReaderChunk(CpioPbzxReader* pbzx, CpioPbzxChunk* chunk, BOOL* ended) {
+    BYTE header[PBZX_CHUNK_HEADER_SIZE];
+    SIZE_T got;
+
+    if (!ReadAll(pbzx->hInput, header, sizeof(header), &got)) {
+        ReaderFail(pbzx, CPIO_ERROR_IO, "Failed to read compressed archive");
+        return FALSE;
+    }
+
+    UINT64 flags = got == sizeof(header) ? GetBigEndian64(header) : 0;
+    UINT64 length = got == sizeof(header) ? GetBigEndian64(header + 8) : 0;
+
+    if (got == 0 || (got == sizeof(header) && flags == 0 && length == 0)) {
+        *ended = TRUE;
+        return TRUE;
+    }
+
+    if (got != sizeof(header) || flags == 0 || flags > pbzx->chunkSize || length == 0 ||
+        length > CpioXzBound(pbzx->chunkSize)) {
+        ReaderFail(pbzx, CPIO_ERROR_BAD_HEADER, "Corrupt pbzx chunk header");
+        return FALSE;
+    }
+
+    if (!ReadAll(pbzx->hInput, chunk->input, (SIZE_T)length, &got) || got != length) {
+        ReaderFail(pbzx, CPIO_ERROR_IO, "Unexpected end of pbzx stream");
+        return FALSE;
+    }
+
+    chunk->flags = flags;
+    chunk->inputLength = (SIZE_T)length;
+    chunk->stored = length == flags;
+    chunk->outputLength = chunk->stored ? (SIZE_T)length : 0;
+    return TRUE;
+}
+
+static DWORD WINAPI DispatchReaderChunks(LPVOID param) {
+    CpioPbzxReader* pbzx = (CpioPbzxReader*)param;
+    UINT64 filled = 0;
+    UINT64 written = 0;
+    BOOL ended = FALSE;
+
+    while (!pbzx->failed) {
+        CpioPbzxChunk* oldest = &pbzx->chunks[written % pbzx->chunkCount];
+
+        AcquireSRWLockShared(&pbzx->lock);
+        BOOL ready = written < filled && oldest->done;
+        ReleaseSRWLockShared(&pbzx->lock);
+
+        if (ready) {
+            if (pbzx->failed) break;
+
+            const BYTE* data = oldest->stored ? oldest->input : oldest->output;
+            if (!WriteAll(pbzx->hWrite, data, oldest->outputLength)) {
+                ReaderFail(pbzx, CPIO_ERROR_IO, "Failed to write decompressed archive");
+                break;
+            }
+            written++;
+            continue;
+        }
+
+        if (!ended && filled - written < pbzx->chunkCount) {
+            CpioPbzxChunk* chunk = &pbzx->chunks[filled % pbzx->chunkCount];
+            if (!FillReaderChunk(pbzx, chunk, &ended)) break;
+            if (ended) continue;
+
+            AcquireSRWLockExclusive(&pbzx->lock);
+            chunk->done = FALSE;
+            pbzx->submitted++;
+            WakeConditionVariable(&pbzx->workReady);
+            ReleaseSRWLockExclusive(&pbzx->lock);
+
+            filled++;
+            continue;
+        }
+
+        if (written == filled) break;
+
+        AcquireSRWLockExclusive(&pbzx->lock);
+        while (!oldest->done) {
+            SleepConditionVariableSRW(&pbzx->workDone, &pbzx->lock, INFINITE, 0);
+        }
+        ReleaseSRWLockExclusive(&pbzx->lock);
+    }
+
+    CloseHandle(pbzx->hWrite);
+    pbzx->hWrite = NULL;
+
+    AcquireSRWLockExclusive(&pbzx->lock);
+    pbzx->shutdown = TRUE;
+    WakeAllConditionVariable(&pbzx->workReady);
+    ReleaseSRWLockExclusive(&pbzx->lock);
+
+    return 0;
+}
+
+static BOOL ReadStreamHeader(CpioPbzxReader* pbzx, const BYTE* prefix, SIZE_T prefixLength, CpioError* error) {
+    BYTE header[PBZX_HEADER_SIZE];
+    SIZE_T got = 0;
+
+    if (prefixLength > sizeof(header)) prefixLength = sizeof(header);
+    if (prefixLength > 0) CpioCopyMemory(header, prefix, prefixLength);
+
+    if (!ReadAll(pbzx->hInput, header + prefixLength, sizeof(header) - prefixLength, &got) ||
+        got != sizeof(header) - prefixLength || CpioCompareMemory(header, CPIO_PBZX_MAGIC, 4) != 0) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid pbzx header");
+        return FALSE;
+    }
+
+    UINT64 chunkSize = GetBigEndian64(header + 4);
+    if (chunkSize == 0 || chunkSize > CPIO_PBZX_MAX_CHUNK_SIZE) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Unsupported pbzx chunk size");
+        return FALSE;
+    }
+
+    pbzx->chunkSize = (SIZE_T)chunkSize;
+    return TRUE;
+}
+
+static void StopReader(CpioPbzxReader* pbzx) {
+    if (pbzx->dispatcher) {
+        WaitForSingleObject(pbzx->dispatcher, INFINITE);
+        CloseHandle(pbzx->dispatcher);
+        pbzx->dispatcher = NULL;
+    }
+
+    AcquireSRWLockExclusive(&pbzx->lock);
+    pbzx->shutdown = TRUE;
+    WakeAllConditionVariable(&pbzx->workReady);
+    ReleaseSRWLockExclusive(&pbzx->lock);
+
+    if (pbzx->started > 0) {
+        WaitForMultipleObjects(pbzx->started, pbzx->threads, TRUE, INFINITE);
+        for (UINT32 i = 0; i < pbzx->started; i++) {
+            CloseHandle(pbzx->threads[i]);
+        }
+        pbzx->started = 0;
+    }
+}
+
+CpioPbzxReader* CpioPbzxReaderCreate(HANDLE hInput, BOOL takeOwnership, const BYTE* prefix, SIZE_T prefixLength,
+                                     UINT32 threadCount, CpioError* error) {
+    if (hInput == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Invalid file handle");
+        return NULL;
+    }
+
+    CpioPbzxReader* pbzx = (CpioPbzxReader*)CpioAlloc(sizeof(CpioPbzxReader));
+    if (!pbzx) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    pbzx->hInput = hInput;
+    pbzx->threadCount = ResolveThreadCount(threadCount);
+    pbzx->chunkCount = pbzx->threadCount + 1;
+    InitializeSRWLock(&pbzx->lock);
+    InitializeConditionVariable(&pbzx->workReady);
+    InitializeConditionVariable(&pbzx->workDone);
+
+    if (!ReadStreamHeader(pbzx, prefix, prefixLength, error)) {
+        CpioPbzxReaderDestroy(pbzx);
+        return NULL;
+    }
+
+    if (!AllocateChunks(&pbzx->chunks, pbzx->chunkCount, CpioXzBound(pbzx->chunkSize), pbzx->chunkSize)) {
+        CpioPbzxReaderDestroy(pbzx);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    if (!CreatePipe(&pbzx->hPipe, &pbzx->hWrite, NULL, CPIO_POOL_BUFFER_SIZE)) {
+        CpioPbzxReaderDestroy(pbzx);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create decompression pipe");
+        return NULL;
+    }
+
+    for (UINT32 i = 0; i < pbzx->threadCount; i++) {
+        pbzx->threads[pbzx->started] = CreateThread(NULL, 0, DecompressWorker, pbzx, 0, NULL);
+        if (pbzx->threads[pbzx->started]) pbzx->started++;
+    }
+
+    pbzx->dispatcher = pbzx->started > 0 ? CreateThread(NULL, 0, DispatchReaderChunks, pbzx, 0, NULL) : NULL;
+    if (!pbzx->dispatcher) {
+        CpioPbzxReaderDestroy(pbzx);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start decompression threads");
+        return NULL;
+    }
+
+    pbzx->ownsInput = takeOwnership;
+    return pbzx;
+}
+
+HANDLE CpioPbzxReaderGetHandle(const CpioPbzxReader* pbzx) {
+    return pbzx ? pbzx->hPipe : INVALID_HANDLE_VALUE;
+}
+
+BOOL CpioPbzxReaderFinish(CpioPbzxReader* pbzx, CpioError* error) {
+    if (!pbzx) return TRUE;
+
+    if (pbzx->hPipe) {
+        BYTE* buffer = CpioBufferPoolAcquire();
+        DWORD bytesRead = 0;
+
+        while (buffer && ReadFile(pbzx->hPipe, buffer, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL) && bytesRead > 0) {
+        }
+        if (buffer) CpioBufferPoolRelease(buffer);
+    }
+
+    StopReader(pbzx);
+
+    if (pbzx->failed) {
+        if (error) *error = pbzx->error;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CpioPbzxReaderDestroy(CpioPbzxReader* pbzx) {
+    if (!pbzx) return;
+
+    if (pbzx->hPipe) CloseHandle(pbzx->hPipe);
+    StopReader(pbzx);
+
+    if (pbzx->hWrite) CloseHandle(pbzx->hWrite);
+    if (pbzx->ownsInput) CloseHandle(pbzx->hInput);
+    FreeChunks(pbzx->chunks, pbzx->chunkCount);
+    CpioFree(pbzx);
+}
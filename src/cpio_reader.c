@@ -0,0 +1,291 @@
+#include "cpio.h"
+
+static void DestroyDecompressor(CpioGzipReader* gzip, CpioPbzxReader* pbzx, CpioZstdReader* zstd) {
+    CpioGzipReaderDestroy(gzip);
+    CpioPbzxReaderDestroy(pbzx);
+    CpioZstdReaderDestroy(zstd);
+}
+
+static BOOL FinishDecompressor(CpioGzipReader* gzip, CpioPbzxReader* pbzx, CpioZstdReader* zstd,
+                               CpioError* error) {
+    if (gzip) return CpioGzipReaderFinish(gzip, error);
+    if (zstd) return CpioZstdReaderFinish(zstd, error);
+    return CpioPbzxReaderFinish(pbzx, error);
+}
+
+CpioReader* CpioReaderCreate(HANDLE hFile, BOOL takeOwnership, CpioError* error) {
+    if (hFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Invalid file handle");
+        return NULL;
+    }
+
+    BYTE magic[CPIO_MAGIC_SIZE];
+    CpioFormat format = CpioReadFormat(hFile, magic, error);
+    CpioFormat compression = CPIO_FORMAT_UNKNOWN;
+    CpioGzipReader* gzip = NULL;
+    CpioPbzxReader* pbzx = NULL;
+    CpioZstdReader* zstd = NULL;
+    HANDLE hArchive = hFile;
+
+    if (format == CPIO_FORMAT_GZIP) {
+        gzip = CpioGzipReaderCreate(hFile, FALSE, magic, CPIO_MAGIC_SIZE, error);
+        if (!gzip) return NULL;
+        hArchive = CpioGzipReaderGetHandle(gzip);
+    } else if (format == CPIO_FORMAT_PBZX) {
+        pbzx = CpioPbzxReaderCreate(hFile, FALSE, magic, CPIO_MAGIC_SIZE, 0, error);
+        if (!pbzx) return NULL;
+        hArchive = CpioPbzxReaderGetHandle(pbzx);
+    } else if (format == CPIO_FORMAT_ZSTD) {
+        zstd = CpioZstdReaderCreate(hFile, FALSE, magic, CPIO_MAGIC_SIZE, error);
+        if (!zstd) return NULL;
+        hArchive = CpioZstdReaderGetHandle(zstd);
+    }
+
+    if (hArchive != hFile) {
+        compression = format;
+        format = CpioDetectFormat(hArchive, error);
+    }
+
+    if (format == CPIO_FORMAT_UNKNOWN) {
+        if (FinishDecompressor(gzip, pbzx, zstd, error)) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Unknown or invalid CPIO format");
+        }
+        DestroyDecompressor(gzip, pbzx, zstd);
+        return NULL;
+    }
+
+    CpioReader* reader = (CpioReader*)CpioAlloc(sizeof(CpioReader));
+    if (!reader) {
+        DestroyDecompressor(gzip, pbzx, zstd);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    reader->format = format;
+    reader->compression = compression;
+    reader->gzip = gzip;
+    reader->pbzx = pbzx;
+    reader->zstd = zstd;
+
+    BOOL ownsArchive = hArchive == hFile ? takeOwnership : FALSE;
+
+    if (format == CPIO_FORMAT_ODC) {
+        reader->odc = CpioOdcReaderCreate(hArchive, ownsArchive);
+    } else {
+        reader->newc = CpioNewcReaderCreate(hArchive, ownsArchive);
+        if (reader->newc) reader->newc->crc = format == CPIO_FORMAT_CRC;
+    }
+
+    if (!reader->odc && !reader->newc) {
+        DestroyDecompressor(gzip, pbzx, zstd);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Failed to create reader");
+        CpioFree(reader);
+        return NULL;
+    }
+
+    if (gzip) gzip->ownsInput = takeOwnership;
+    if (pbzx) pbzx->ownsInput = takeOwnership;
+    if (zstd) zstd->ownsInput = takeOwnership;
+    return reader;
+}
+
+void CpioReaderDestroy(CpioReader* reader) {
+    if (!reader) return;
+
+    if (reader->odc) CpioOdcReaderDestroy(reader->odc);
+    if (reader->newc) CpioNewcReaderDestroy(reader->newc);
+    DestroyDecompressor(reader->gzip, reader->pbzx, reader->zstd);
+
+    CpioFree(reader);
+}
+
+CpioFormat CpioReaderGetFormat(const CpioReader* reader) {
+    return reader ? reader->format : CPIO_FORMAT_UNKNOWN;
+}
+
+CpioSource* CpioReaderGetSource(CpioReader* reader) {
+    if (!reader) return NULL;
+    return reader->odc ? &reader->odc->source : &reader->newc->source;
+}
+
+void CpioEntryFromNewc(CpioEntry* entry, const CpioNewcHeader* header) {
+    entry->inode = header->inode;
+    entry->mode = header->mode;
+    entry->uid = header->uid;
+    entry->gid = header->gid;
+    entry->nlink = header->nlink;
+    entry->mtime = header->mtime;
+    entry->fileSize = header->fileSize;
+    entry->devMajor = header->devMajor;
+    entry->devMinor = header->devMinor;
+    entry->rdevMajor = header->rdevMajor;
+    entry->rdevMinor = header->rdevMinor;
+    entry->checksum = header->checksum;
+
+    SIZE_T len = CpioStringLength(header->name);
+    CpioCopyMemory(entry->name, header->name, len + 1);
+}
+
+void CpioEntryFromOdc(CpioEntry* entry, const CpioOdcHeader* header) {
+    entry->inode = header->inode;
+    entry->mode = header->mode;
+    entry->uid = header->uid;
+    entry->gid = header->gid;
+    entry->nlink = header->nlink;
+    entry->mtime = header->mtime;
+    entry->fileSize = header->fileSize;
+    entry->devMajor = header->dev >> 8;
+    entry->devMinor = header->dev & 0xFF;
+    entry->rdevMajor = header->rdev >> 8;
+    entry->rdevMinor = header->rdev & 0xFF;
+    entry->checksum = 0;
+
+    SIZE_T len = CpioStringLength(header->name);
+    CpioCopyMemory(entry->name, header->name, len + 1);
+}
+
+UINT64 CpioReaderTell(CpioReader* reader, CpioError* error) {
+    if (!reader) return 0;
+
+    BOOL firstEntry;
+
+    if (reader->odc) {
+        CpioOdcReaderFinish(reader->odc, error);
+        firstEntry = reader->odc->firstEntry;
+    } else {
+        CpioNewcReaderFinish(reader->newc, error);
+        firstEntry = reader->newc->firstEntry;
+    }
+
+    UINT64 headerOffset = CpioSourceTell(CpioReaderGetSource(reader));
+    if (firstEntry && headerOffset >= CPIO_MAGIC_SIZE) {
+        headerOffset -= CPIO_MAGIC_SIZE;
+    }
+    return headerOffset;
+}
+
+BOOL CpioReaderReadNext(CpioReader* reader, CpioEntry* entry, CpioError* error) {
+    if (!reader || !entry) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    CpioSource* source = CpioReaderGetSource(reader);
+    UINT64 headerOffset = CpioReaderTell(reader, error);
+    reader->headerOffset = headerOffset;
+
+    if (reader->odc) {
+        CpioOdcHeader header;
+        if (!CpioOdcReaderReadNext(reader->odc, &header, error)) return FALSE;
+        CpioEntryFromOdc(entry, &header);
+    } else {
+        CpioNewcHeader header;
+        if (!CpioNewcReaderReadNext(reader->newc, &header, error)) return FALSE;
+        CpioEntryFromNewc(entry, &header);
+    }
+
+    entry->headerOffset = headerOffset;
+    entry->dataOffset = CpioSourceTell(source);
+    return TRUE;
+}
+
+DWORD CpioReaderRead(CpioReader* reader, void* buffer, DWORD bufferSize, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return 0;
+    }
+
+    if (reader->odc) {
+        return CpioOdcReaderRead(reader->odc, buffer, bufferSize, error);
+    }
+    return CpioNewcReaderRead(reader->newc, buffer, bufferSize, error);
+}
+
+BOOL CpioReaderCopyToHandle(CpioReader* reader, HANDLE hOutFile, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
+
+    if (reader->odc) {
+        return CpioOdcReaderCopyToHandle(reader->odc, hOutFile, error);
+    }
+    return CpioNewcReaderCopyToHandle(reader->newc, hOutFile, error);
+}
+
+BOOL CpioReaderFinish(CpioReader* reader, CpioError* error) {
+    if (!reader) return FALSE;
+
+    if (reader->odc) {
+        return CpioOdcReaderFinish(reader->odc, error);
+    }
+    return CpioNewcReaderFinish(reader->newc, error);
+}
+
+BOOL CpioReaderFinishStream(CpioReader* reader, CpioError* error) {
+    if (!reader) return TRUE;
+    return FinishDecompressor(reader->gzip, reader->pbzx, reader->zstd, error);
+}
+
+static BOOL SeekFrames(CpioReader* reader, UINT64 headerOffset, CpioError* error) {
+    CpioSource* source = CpioReaderGetSource(reader);
+    BOOL firstEntry = reader->odc ? reader->odc->firstEntry : reader->newc->firstEntry;
+    UINT64 position = CpioSourceTell(source);
+
+    if (firstEntry && headerOffset + CPIO_MAGIC_SIZE == position) return TRUE;
+    if (headerOffset >= position && CpioZstdReaderFrameStart(reader->zstd, headerOffset) <= position) {
+        return TRUE;
+    }
+
+    UINT64 frameStart;
+    if (!CpioZstdReaderRestart(reader->zstd, headerOffset, &frameStart, error)) return FALSE;
+
+    HANDLE hArchive = CpioZstdReaderGetHandle(reader->zstd);
+    CpioSourceRelease(source);
+    if (!CpioSourceInit(source, hArchive)) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return FALSE;
+    }
+    source->position = frameStart;
+
+    if (reader->odc) {
+        reader->odc->hFile = hArchive;
+        reader->odc->firstEntry = FALSE;
+    } else {
+        reader->newc->hFile = hArchive;
+        reader->newc->firstEntry = FALSE;
+    }
+    return TRUE;
+}
+
+BOOL CpioReaderSeek(CpioReader* reader, UINT64 headerOffset, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return FALSE;
+    }
+
+    if (reader->zstd && reader->zstd->frameCount > 0 && !SeekFrames(reader, headerOffset, error)) {
+        return FALSE;
+    }
+
+    if (reader->odc) {
+        return CpioOdcReaderSeek(reader->odc, headerOffset, error);
+    }
+    return CpioNewcReaderSeek(reader->newc, headerOffset, error);
+}
+
+BOOL CpioReaderIsAtEnd(const CpioReader* reader) {
+    if (!reader) return TRUE;
+
+    if (reader->odc) {
+        return CpioOdcReaderIsAtEnd(reader->odc);
+    }
+    return CpioNewcReaderIsAtEnd(reader->newc);
+}
+
+BOOL CpioReaderIsSeekable(const CpioReader* reader) {
+    if (!reader) return FALSE;
+
+    const CpioSource* source = reader->odc ? &reader->odc->source : &reader->newc->source;
+    return source->seekable || (reader->zstd && reader->zstd->frameCount > 0);
+}
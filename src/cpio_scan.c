@@ -0,0 +1,435 @@
+#include "cpio.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPIO_SCAN_SSE2 1
+#endif
+
+#define CPIO_SCAN_MIN_CHUNK (8 * 1024 * 1024)
+#define CPIO_SCAN_MAX_THREADS 64
+#define CPIO_SCAN_RECOVER_WINDOW (256 * 1024)
+#define CPIO_SCAN_MAX_HEADER_SIZE (CPIO_MAGIC_SIZE + 104 + CPIO_MAX_NAME_LENGTH + 4)
+
+typedef struct {
+    UINT64 offset;
+    UINT64 next;
+    UINT64 dataOffset;
+    UINT64 fileSize;
+    UINT32 inode;
+    UINT32 mode;
+    UINT32 uid;
+    UINT32 gid;
+    UINT32 nlink;
+    UINT32 mtime;
+    UINT32 devMajor;
+    UINT32 devMinor;
+    UINT32 rdevMajor;
+    UINT32 rdevMinor;
+    UINT32 checksum;
+    UINT32 nameLength;
+} CpioScanCandidate;
+
+typedef struct {
+    CpioScanCandidate* items;
+    SIZE_T count;
+    SIZE_T capacity;
+    SIZE_T cursor;
+} CpioScanChunk;
+
+typedef struct {
+    const BYTE* view;
+    UINT64 start;
+    UINT64 size;
+    CpioFormat format;
+    UINT64 chunkSize;
+    SIZE_T chunkCount;
+    CpioScanChunk* chunks;
+    LONG volatile nextChunk;
+} CpioScanJob;
+
+static BYTE FormatDigit(CpioFormat format) {
+    if (format == CPIO_FORMAT_ODC) return '7';
+    return format == CPIO_FORMAT_CRC ? '2' : '1';
+}
+
+static const BYTE* FindMagicPrefix(const BYTE* p, const BYTE* end, const BYTE* limit) {
+#ifdef CPIO_SCAN_SSE2
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i seven = _mm_set1_epi8('7');
+
+    while (p < end && p + 20 <= limit) {
+        __m128i m = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero),
+                          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), seven)),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 2)), zero),
+                          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 3)), seven)));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 4)), zero));
+
+        unsigned long mask = (unsigned long)_mm_movemask_epi8(m);
+        if (mask) {
+            unsigned long bit;
+            _BitScanForward(&bit, mask);
+            return (p + bit < end) ? p + bit : NULL;
+        }
+        p += 16;
+    }
+#endif
+
+    for (; p < end && p + 5 <= limit; p++) {
+        if (p[0] == '0' && p[1] == '7' && p[2] == '0' && p[3] == '7' && p[4] == '0') {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+static BOOL DecodeAt(const CpioScanJob* job, UINT64 offset, BOOL strict, CpioEntry* entry,
+                     UINT64* next, CpioError* error) {
+    const BYTE* data = job->view + offset;
+    UINT64 available = job->size - offset;
+    if (available < CPIO_MAGIC_SIZE || CpioCompareMemory(data, "07070", 5) != 0 ||
+        data[5] != FormatDigit(job->format)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid magic number");
+        return FALSE;
+    }
+
+    SIZE_T limit = (SIZE_T)(available - CPIO_MAGIC_SIZE);
+    SIZE_T consumed = 0;
+    UINT64 pad = 0;
+
+    if (job->format == CPIO_FORMAT_ODC) {
+        CpioOdcHeader header;
+        if (!CpioOdcHeaderDecode(data + CPIO_MAGIC_SIZE, limit, strict, &header, &consumed, error)) {
+            return FALSE;
+        }
+        CpioEntryFromOdc(entry, &header);
+    } else {
+        CpioNewcHeader header;
+        if (!CpioNewcHeaderDecode(data + CPIO_MAGIC_SIZE, limit, strict, &header, &consumed, error)) {
+            return FALSE;
+        }
+        CpioEntryFromNewc(entry, &header);
+        pad = (4 - (header.fileSize % 4)) % 4;
+    }
+
+    entry->headerOffset = offset;
+    entry->dataOffset = offset + CPIO_MAGIC_SIZE + consumed;
+
+    if (entry->fileSize > job->size - entry->dataOffset) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Entry data extends past end of archive");
+        return FALSE;
+    }
+
+    *next = entry->dataOffset + entry->fileSize + pad;
+    return TRUE;
+}
+
+static BOOL AddCandidate(CpioScanChunk* chunk, const CpioEntry* entry, UINT64 next) {
+    if (chunk->count >= chunk->capacity) {
+        SIZE_T newCap = chunk->capacity ? chunk->capacity * 2 : 256;
+        CpioScanCandidate* items = (CpioScanCandidate*)CpioRealloc(chunk->items, sizeof(CpioScanCandidate) * newCap);
+        if (!items) return FALSE;
+
+        chunk->items = items;
+        chunk->capacity = newCap;
+    }
+
+    CpioScanCandidate* candidate = &chunk->items[chunk->count++];
+    candidate->offset = entry->headerOffset;
+    candidate->next = next;
+    candidate->dataOffset = entry->dataOffset;
+    candidate->fileSize = entry->fileSize;
+    candidate->inode = entry->inode;
+    candidate->mode = entry->mode;
+    candidate->uid = entry->uid;
+    candidate->gid = entry->gid;
+    candidate->nlink = entry->nlink;
+    candidate->mtime = entry->mtime;
+    candidate->devMajor = entry->devMajor;
+    candidate->devMinor = entry->devMinor;
+    candidate->rdevMajor = entry->rdevMajor;
+    candidate->rdevMinor = entry->rdevMinor;
+    candidate->checksum = entry->checksum;
+    candidate->nameLength = (UINT32)CpioStringLength(entry->name);
+    return TRUE;
+}
+
+static void ScanChunk(CpioScanJob* job, SIZE_T index) {
+    CpioScanChunk* chunk = &job->chunks[index];
+    UINT64 begin = job->start + index * job->chunkSize;
+    UINT64 end = begin + job->chunkSize;
+    if (end > job->size) end = job->size;
+
+    BYTE formatDigit = FormatDigit(job->format);
+    const BYTE* limit = job->view + job->size;
+    const BYTE* p = job->view + begin;
+    CpioEntry entry;
+
+    while ((p = FindMagicPrefix(p, job->view + end, limit)) != NULL) {
+        UINT64 offset = (UINT64)(p - job->view);
+        UINT64 next;
+
+        if (p + CPIO_MAGIC_SIZE <= limit && p[5] == formatDigit &&
+            (job->format == CPIO_FORMAT_ODC || ((offset - job->start) & 3) == 0) &&
+            DecodeAt(job, offset, TRUE, &entry, &next, NULL)) {
+            if (!AddCandidate(chunk, &entry, next)) return;
+        }
+
+        p++;
+    }
+}
+
+static DWORD WINAPI ScanWorker(LPVOID param) {
+    CpioScanJob* job = (CpioScanJob*)param;
+
+    for (;;) {
+        LONG index = InterlockedIncrement(&job->nextChunk) - 1;
+        if ((SIZE_T)index >= job->chunkCount) break;
+        ScanChunk(job, (SIZE_T)index);
+    }
+
+    return 0;
+}
+
+static const CpioScanCandidate* FindCandidate(CpioScanJob* job, UINT64 offset) {
+    SIZE_T index = (SIZE_T)((offset - job->start) / job->chunkSize);
+    if (index >= job->chunkCount) return NULL;
+
+    CpioScanChunk* chunk = &job->chunks[index];
+    while (chunk->cursor < chunk->count && chunk->items[chunk->cursor].offset < offset) {
+        chunk->cursor++;
+    }
+
+    if (chunk->cursor < chunk->count && chunk->items[chunk->cursor].offset == offset) {
+        return &chunk->items[chunk->cursor];
+    }
+
+    return NULL;
+}
+
+static void EntryFromCandidate(const CpioScanJob* job, const CpioScanCandidate* candidate, CpioEntry* entry) {
+    SIZE_T headerSize = (job->format == CPIO_FORMAT_ODC) ? 76 : 110;
+
+    entry->inode = candidate->inode;
+    entry->mode = candidate->mode;
+    entry->uid = candidate->uid;
+    entry->gid = candidate->gid;
+    entry->nlink = candidate->nlink;
+    entry->mtime = candidate->mtime;
+    entry->fileSize = candidate->fileSize;
+    entry->devMajor = candidate->devMajor;
+    entry->devMinor = candidate->devMinor;
+    entry->rdevMajor = candidate->rdevMajor;
+    entry->rdevMinor = candidate->rdevMinor;
+    entry->checksum = candidate->checksum;
+    entry->headerOffset = candidate->offset;
+    entry->dataOffset = candidate->dataOffset;
+
+    CpioCopyMemory(entry->name, job->view + candidate->offset + headerSize, candidate->nameLength);
+    entry->name[candidate->nameLength] = '\0';
+}
+
+static BOOL ScanSequential(CpioReader* reader, UINT64 start, CpioScanCallback callback,
+                           void* context, CpioError* error) {
+    CpioSource* source = CpioReaderGetSource(reader);
+    if (!CpioReaderSeek(reader, start, error)) return FALSE;
+
+    BOOL headersOnly = !source->view;
+    if (headersOnly) CpioSourceSetHeadersOnly(source, TRUE);
+
+    CpioEntry entry;
+    BOOL ok = TRUE;
+    while (ok && CpioReaderReadNext(reader, &entry, error)) {
+        ok = callback(context, &entry);
+    }
+
+    if (headersOnly) CpioSourceSetHeadersOnly(source, FALSE);
+    return ok && CpioReaderIsAtEnd(reader);
+}
+
+static BOOL RunWorkers(CpioScanJob* job, UINT32 threadCount) {
+    HANDLE threads[CPIO_SCAN_MAX_THREADS];
+    DWORD started = 0;
+
+    for (UINT32 i = 0; i < threadCount; i++) {
+        threads[started] = CreateThread(NULL, 0, ScanWorker, job, 0, NULL);
+        if (threads[started]) started++;
+    }
+
+    ScanWorker(job);
+
+    if (started > 0) {
+        WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+        for (DWORD i = 0; i < started; i++) {
+            CloseHandle(threads[i]);
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL CpioScanArchive(CpioReader* reader, UINT32 threadCount, CpioScanCallback callback,
+                     void* context, CpioError* error) {
+    if (!reader || !callback) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    CpioSource* source = CpioReaderGetSource(reader);
+    UINT64 start = CpioReaderTell(reader, error);
+
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    if (threadCount > CPIO_SCAN_MAX_THREADS) {
+        threadCount = CPIO_SCAN_MAX_THREADS;
+    }
+
+    if (!source->view || threadCount <= 1 || source->viewSize - start < CPIO_SCAN_MIN_CHUNK) {
+        return ScanSequential(reader, start, callback, context, error);
+    }
+
+    CpioScanJob job;
+    CpioZeroMemory(&job, sizeof(job));
+    job.view = source->view;
+    job.start = start;
+    job.size = source->viewSize;
+    job.format = CpioReaderGetFormat(reader);
+
+    UINT64 length = job.size - start;
+    job.chunkSize = length / ((UINT64)threadCount * 4);
+    if (job.chunkSize < CPIO_SCAN_MIN_CHUNK) job.chunkSize = CPIO_SCAN_MIN_CHUNK;
+    job.chunkCount = (SIZE_T)((length + job.chunkSize - 1) / job.chunkSize);
+
+    job.chunks = (CpioScanChunk*)CpioAlloc(sizeof(CpioScanChunk) * job.chunkCount);
+    if (!job.chunks) {
+        return ScanSequential(reader, start, callback, context, error);
+    }
+
+    RunWorkers(&job, threadCount - 1);
+
+    CpioEntry entry;
+    UINT64 offset = start;
+    BOOL ok = TRUE;
+
+    for (;;) {
+        UINT64 next;
+        const CpioScanCandidate* candidate = FindCandidate(&job, offset);
+
+        if (candidate) {
+            EntryFromCandidate(&job, candidate, &entry);
+            next = candidate->next;
+        } else if (!DecodeAt(&job, offset, FALSE, &entry, &next, error)) {
+            ok = FALSE;
+            break;
+        }
+
+        if (CpioStringCompare(entry.name, "TRAILER!!!") == 0) {
+            break;
+        }
+
+        if (!callback(context, &entry)) {
+            ok = FALSE;
+            break;
+        }
+
+        offset = next;
+    }
+
+    for (SIZE_T i = 0; i < job.chunkCount; i++) {
+        if (job.chunks[i].items) CpioFree(job.chunks[i].items);
+    }
+    CpioFree(job.chunks);
+
+    return ok;
+}
+
+static BOOL ValidateCandidate(CpioFormat format, const BYTE* data, SIZE_T available, UINT64 offset,
+                              UINT64 archiveSize) {
+    if (available < CPIO_MAGIC_SIZE || data[5] != FormatDigit(format)) {
+        return FALSE;
+    }
+
+    SIZE_T consumed = 0;
+    UINT64 fileSize;
+
+    if (format == CPIO_FORMAT_ODC) {
+        CpioOdcHeader header;
+        if (!CpioOdcHeaderDecode(data + CPIO_MAGIC_SIZE, available - CPIO_MAGIC_SIZE, TRUE, &header,
+                                 &consumed, NULL)) {
+            return FALSE;
+        }
+        fileSize = header.fileSize;
+    } else {
+        CpioNewcHeader header;
+        if (!CpioNewcHeaderDecode(data + CPIO_MAGIC_SIZE, available - CPIO_MAGIC_SIZE, TRUE, &header,
+                                  &consumed, NULL)) {
+            return FALSE;
+        }
+        fileSize = header.fileSize;
+    }
+
+    if (archiveSize > 0) {
+        UINT64 dataOffset = offset + CPIO_MAGIC_SIZE + consumed;
+        if (dataOffset > archiveSize || fileSize > archiveSize - dataOffset) return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioReaderResync(CpioReader* reader, UINT64* skippedStart, UINT64* skippedEnd, CpioError* error) {
+    if (!reader || !skippedStart || !skippedEnd) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    CpioSource* source = CpioReaderGetSource(reader);
+    CpioFormat format = CpioReaderGetFormat(reader);
+    UINT64 archiveSize = CpioSourceGetSize(source);
+    UINT64 start = reader->headerOffset + 1;
+
+    if (start < CpioSourceTell(source) && !source->seekable) {
+        start = CpioSourceTell(source);
+    }
+    if (archiveSize > 0 && start > archiveSize) {
+        start = archiveSize;
+    }
+
+    *skippedStart = reader->headerOffset;
+    *skippedEnd = start;
+
+    if (!CpioSourceSeek(source, start, error)) return FALSE;
+
+    for (;;) {
+        SIZE_T available;
+        const BYTE* data = CpioSourcePeek(source, CPIO_SCAN_RECOVER_WINDOW, &available, error);
+        if (!data) return FALSE;
+
+        BOOL atEnd = available < CPIO_SCAN_RECOVER_WINDOW;
+        const BYTE* end = data + available;
+        const BYTE* scanEnd = atEnd ? end : end - CPIO_SCAN_MAX_HEADER_SIZE;
+        const BYTE* p = data;
+
+        while (p < scanEnd && (p = FindMagicPrefix(p, scanEnd, end)) != NULL) {
+            UINT64 offset = CpioSourceTell(source) + (UINT64)(p - data);
+
+            if (ValidateCandidate(format, p, (SIZE_T)(end - p), offset, archiveSize)) {
+                CpioSourceConsume(source, (SIZE_T)(p - data));
+                *skippedEnd = offset;
+                return CpioReaderSeek(reader, offset, error);
+            }
+            p++;
+        }
+
+        CpioSourceConsume(source, (SIZE_T)(scanEnd - data));
+        *skippedEnd = CpioSourceTell(source);
+
+        if (atEnd) {
+            CpioErrorSet(error, CPIO_ERROR_NOT_FOUND, "No valid header found before end of archive");
+            return FALSE;
+        }
+    }
+}
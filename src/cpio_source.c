@@ -0,0 +1,449 @@
+#include "cpio.h"
+
+#define CPIO_SOURCE_MAX_WRITE (64 * 1024 * 1024)
+
+static BOOL CpioSourceTryMap(CpioSource* source) {
+    if (GetFileType(source->hFile) != FILE_TYPE_DISK) return FALSE;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(source->hFile, &fileSize) || fileSize.QuadPart <= 0) {
+        return FALSE;
+    }
+
+    if ((UINT64)fileSize.QuadPart > (UINT64)(SIZE_T)-1) {
+        return FALSE;
+    }
+
+    LARGE_INTEGER zero;
+    LARGE_INTEGER current;
+    zero.QuadPart = 0;
+    if (!SetFilePointerEx(source->hFile, zero, &current, FILE_CURRENT)) {
+        return FALSE;
+    }
+
+    HANDLE hMapping = CreateFileMappingW(source->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMapping) return FALSE;
+
+    const BYTE* view = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(hMapping);
+        return FALSE;
+    }
+
+    source->hMapping = hMapping;
+    source->view = view;
+    source->viewSize = (UINT64)fileSize.QuadPart;
+    source->position = (UINT64)current.QuadPart;
+    source->seekable = TRUE;
+    return TRUE;
+}
+
+BOOL CpioSourceInit(CpioSource* source, HANDLE hFile) {
+    if (!source || hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+    CpioZeroMemory(source, sizeof(CpioSource));
+    source->hFile = hFile;
+
+    if (CpioSourceTryMap(source)) {
+        return TRUE;
+    }
+
+    source->buffer = CpioBufferPoolAcquire();
+    if (!source->buffer) return FALSE;
+    source->bufferSize = CPIO_SOURCE_BUFFER_SIZE;
+
+    if (GetFileType(hFile) == FILE_TYPE_DISK) {
+        LARGE_INTEGER zero;
+        LARGE_INTEGER current;
+        zero.QuadPart = 0;
+        if (SetFilePointerEx(hFile, zero, &current, FILE_CURRENT)) {
+            source->position = (UINT64)current.QuadPart;
+            source->seekable = TRUE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL CpioSourceInitMemory(CpioSource* source, const void* data, SIZE_T size) {
+    if (!source || (!data && size > 0)) return FALSE;
+
+    CpioZeroMemory(source, sizeof(CpioSource));
+    source->hFile = INVALID_HANDLE_VALUE;
+    source->view = (const BYTE*)data;
+    source->viewSize = size;
+    source->seekable = TRUE;
+    return TRUE;
+}
+
+void CpioSourceRelease(CpioSource* source) {
+    if (!source) return;
+
+    LARGE_INTEGER dist;
+
+    if (source->hMapping) {
+        UnmapViewOfFile(source->view);
+        CloseHandle(source->hMapping);
+
+        dist.QuadPart = (LONGLONG)source->position;
+        SetFilePointerEx(source->hFile, dist, NULL, FILE_BEGIN);
+    } else if (source->seekable && source->bufferLength > source->bufferPos) {
+        dist.QuadPart = -(LONGLONG)(source->bufferLength - source->bufferPos);
+        SetFilePointerEx(source->hFile, dist, NULL, FILE_CURRENT);
+    }
+
+    if (source->buffer) {
+        CpioBufferPoolRelease(source->buffer);
+    }
+
+    CpioZeroMemory(source, sizeof(CpioSource));
+    source->hFile = INVALID_HANDLE_VALUE;
+}
+
+static void CpioSourceCopyOut(CpioSource* source, BYTE* dest, const BYTE* src, SIZE_T length) {
+    if (source->summing) {
+        source->sum = CpioByteSumCopy(source->sum, dest, src, length);
+    } else {
+        CpioCopyMemory(dest, src, length);
+    }
+}
+
+static BOOL CpioSourceFill(CpioSource* source, SIZE_T minimum, CpioError* error) {
+    SIZE_T available = source->bufferLength - source->bufferPos;
+    if (available >= minimum) return TRUE;
+
+    if (source->bufferPos > 0) {
+        CpioCopyMemory(source->buffer, source->buffer + source->bufferPos, available);
+        source->bufferPos = 0;
+        source->bufferLength = available;
+    }
+
+    if (minimum > source->bufferSize) {
+        minimum = source->bufferSize;
+    }
+
+    while (source->bufferLength < minimum && !source->atEnd) {
+        DWORD bytesRead;
+        DWORD toRead = (DWORD)(source->bufferSize - source->bufferLength);
+
+        if (source->headersOnly) {
+            toRead = (DWORD)(minimum - source->bufferLength);
+        }
+
+        if (!ReadFile(source->hFile, source->buffer + source->bufferLength, toRead, &bytesRead, NULL)) {
+            DWORD lastError = GetLastError();
+            if (lastError == ERROR_BROKEN_PIPE || lastError == ERROR_HANDLE_EOF) {
+                source->atEnd = TRUE;
+                break;
+            }
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read archive");
+            return FALSE;
+        }
+
+        if (bytesRead == 0) {
+            source->atEnd = TRUE;
+            break;
+        }
+
+        source->bufferLength += bytesRead;
+    }
+
+    return TRUE;
+}
+
+const BYTE* CpioSourcePeek(CpioSource* source, SIZE_T size, SIZE_T* available, CpioError* error) {
+    if (!source || !available) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return NULL;
+    }
+
+    if (source->view) {
+        UINT64 left = source->position < source->viewSize ? source->viewSize - source->position : 0;
+        *available = left < size ? (SIZE_T)left : size;
+        return source->view + (source->position < source->viewSize ? source->position : source->viewSize);
+    }
+
+    if (!CpioSourceFill(source, size, error)) {
+        *available = 0;
+        return NULL;
+    }
+
+    SIZE_T left = source->bufferLength - source->bufferPos;
+    *available = left < size ? left : size;
+    return source->buffer + source->bufferPos;
+}
+
+void CpioSourceConsume(CpioSource* source, SIZE_T size) {
+    if (!source) return;
+
+    if (!source->view) {
+        SIZE_T left = source->bufferLength - source->bufferPos;
+        if (size > left) size = left;
+        source->bufferPos += size;
+    }
+
+    source->position += size;
+}
+
+BOOL CpioSourceRead(CpioSource* source, void* buffer, SIZE_T size, SIZE_T* bytesRead, CpioError* error) {
+    if (!source || !buffer || !bytesRead) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    BYTE* out = (BYTE*)buffer;
+    SIZE_T total = 0;
+
+    if (source->view) {
+        UINT64 left = source->position < source->viewSize ? source->viewSize - source->position : 0;
+        total = left < size ? (SIZE_T)left : size;
+        CpioSourceCopyOut(source, out, source->view + source->position, total);
+        source->position += total;
+        *bytesRead = total;
+        return TRUE;
+    }
+
+    while (total < size) {
+        SIZE_T left = source->bufferLength - source->bufferPos;
+
+        if (left == 0) {
+            if (source->atEnd) break;
+
+            if (size - total >= source->bufferSize) {
+                DWORD chunk;
+                DWORD toRead = (size - total) > CPIO_SOURCE_MAX_WRITE ? CPIO_SOURCE_MAX_WRITE : (DWORD)(size - total);
+                if (!ReadFile(source->hFile, out + total, toRead, &chunk, NULL)) {
+                    DWORD lastError = GetLastError();
+                    if (lastError != ERROR_BROKEN_PIPE && lastError != ERROR_HANDLE_EOF) {
+                        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read archive");
+                        *bytesRead = total;
+                        return FALSE;
+                    }
+                    chunk = 0;
+                }
+                if (chunk == 0) {
+                    source->atEnd = TRUE;
+                    break;
+                }
+                if (source->summing) source->sum = CpioByteSumUpdate(source->sum, out + total, chunk);
+                total += chunk;
+                source->position += chunk;
+                continue;
+            }
+
+            if (!CpioSourceFill(source, size - total, error)) {
+                *bytesRead = total;
+                return FALSE;
+            }
+            continue;
+        }
+
+        SIZE_T take = left < size - total ? left : size - total;
+        CpioSourceCopyOut(source, out + total, source->buffer + source->bufferPos, take);
+        source->bufferPos += take;
+        source->position += take;
+        total += take;
+    }
+
+    *bytesRead = total;
+    return TRUE;
+}
+
+BOOL CpioSourceSkip(CpioSource* source, UINT64 count, CpioError* error) {
+    if (!source) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (source->view) {
+        UINT64 left = source->position < source->viewSize ? source->viewSize - source->position : 0;
+        source->position += count < left ? count : left;
+        return TRUE;
+    }
+
+    SIZE_T left = source->bufferLength - source->bufferPos;
+    SIZE_T take = count < left ? (SIZE_T)count : left;
+    source->bufferPos += take;
+    source->position += take;
+    count -= take;
+
+    if (count == 0) return TRUE;
+
+    if (source->seekable) {
+        LARGE_INTEGER dist;
+        dist.QuadPart = (LONGLONG)count;
+        if (SetFilePointerEx(source->hFile, dist, NULL, FILE_CURRENT)) {
+            source->position += count;
+            return TRUE;
+        }
+    }
+
+    while (count > 0) {
+        source->bufferPos = 0;
+        source->bufferLength = 0;
+
+        if (!CpioSourceFill(source, 1, error)) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to skip entry data");
+            return FALSE;
+        }
+
+        left = source->bufferLength;
+        if (left == 0) break;
+
+        take = count < left ? (SIZE_T)count : left;
+        source->bufferPos = take;
+        source->position += take;
+        count -= take;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioSourceCopyToHandle(CpioSource* source, HANDLE hOutFile, UINT64 count, UINT64* copied, CpioError* error) {
+    if (!source || hOutFile == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid parameter");
+        return FALSE;
+    }
+
+    UINT64 total = 0;
+    DWORD bytesWritten;
+
+    if (source->view) {
+        UINT64 left = source->position < source->viewSize ? source->viewSize - source->position : 0;
+        if (count > left) count = left;
+
+        DWORD limit = source->summing ? CPIO_POOL_BUFFER_SIZE : CPIO_SOURCE_MAX_WRITE;
+        while (total < count) {
+            DWORD chunk = (count - total) > limit ? limit : (DWORD)(count - total);
+            if (source->summing) source->sum = CpioByteSumUpdate(source->sum, source->view + source->position, chunk);
+            if (!WriteFile(hOutFile, source->view + source->position, chunk, &bytesWritten, NULL) ||
+                bytesWritten != chunk) {
+                CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write entry data");
+                if (copied) *copied = total;
+                return FALSE;
+            }
+            source->position += chunk;
+            total += chunk;
+        }
+
+        if (copied) *copied = total;
+        return TRUE;
+    }
+
+    while (total < count) {
+        if (source->bufferPos == source->bufferLength) {
+            source->bufferPos = 0;
+            source->bufferLength = 0;
+
+            if (!CpioSourceFill(source, 1, error)) {
+                if (copied) *copied = total;
+                return FALSE;
+            }
+            if (source->bufferLength == 0) break;
+        }
+
+        SIZE_T left = source->bufferLength - source->bufferPos;
+        DWORD chunk = (count - total) < left ? (DWORD)(count - total) : (DWORD)left;
+        if (source->summing) source->sum = CpioByteSumUpdate(source->sum, source->buffer + source->bufferPos, chunk);
+
+        if (!WriteFile(hOutFile, source->buffer + source->bufferPos, chunk, &bytesWritten, NULL) ||
+            bytesWritten != chunk) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write entry data");
+            if (copied) *copied = total;
+            return FALSE;
+        }
+
+        source->bufferPos += chunk;
+        source->position += chunk;
+        total += chunk;
+    }
+
+    if (copied) *copied = total;
+    return TRUE;
+}
+
+UINT64 CpioSourceTell(const CpioSource* source) {
+    return source ? source->position : 0;
+}
+
+UINT64 CpioSourceGetSize(const CpioSource* source) {
+    if (!source) return 0;
+    if (source->view) return source->viewSize;
+    if (!source->seekable) return 0;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(source->hFile, &size)) return 0;
+    return (UINT64)size.QuadPart;
+}
+
+static BOOL CpioSourceUnmap(CpioSource* source) {
+    BYTE* buffer = CpioBufferPoolAcquire();
+    if (!buffer) return FALSE;
+
+    LARGE_INTEGER dist;
+    dist.QuadPart = (LONGLONG)source->position;
+    if (!SetFilePointerEx(source->hFile, dist, NULL, FILE_BEGIN)) {
+        CpioBufferPoolRelease(buffer);
+        return FALSE;
+    }
+
+    UnmapViewOfFile(source->view);
+    CloseHandle(source->hMapping);
+
+    source->hMapping = NULL;
+    source->view = NULL;
+    source->viewSize = 0;
+    source->buffer = buffer;
+    source->bufferSize = CPIO_SOURCE_BUFFER_SIZE;
+    source->bufferPos = 0;
+    source->bufferLength = 0;
+    source->atEnd = FALSE;
+    return TRUE;
+}
+
+void CpioSourceSetHeadersOnly(CpioSource* source, BOOL headersOnly) {
+    if (!source) return;
+
+    if (headersOnly && source->hMapping && !CpioSourceUnmap(source)) {
+        return;
+    }
+
+    source->headersOnly = headersOnly && source->seekable && !source->view;
+}
+
+BOOL CpioSourceSeek(CpioSource* source, UINT64 offset, CpioError* error) {
+    if (!source) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (source->view) {
+        if (offset > source->viewSize) {
+            CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Seek beyond end of archive");
+            return FALSE;
+        }
+        source->position = offset;
+        return TRUE;
+    }
+
+    if (!source->seekable) {
+        if (offset < source->position) {
+            CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Cannot seek backwards in a pipe");
+            return FALSE;
+        }
+        return CpioSourceSkip(source, offset - source->position, error);
+    }
+
+    LARGE_INTEGER dist;
+    dist.QuadPart = (LONGLONG)offset;
+    if (!SetFilePointerEx(source->hFile, dist, NULL, FILE_BEGIN)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to seek archive");
+        return FALSE;
+    }
+
+    source->bufferPos = 0;
+    source->bufferLength = 0;
+    source->atEnd = FALSE;
+    source->position = offset;
+    return TRUE;
+}
@@ -0,0 +1,455 @@
+#include "cpio.h"
+
+#define CPIO_TOC_HEADER_SIZE 16
+#define CPIO_TOC_RECORD_SIZE 48
+
+static UINT64 LoadU64(const BYTE* p) {
+    UINT64 value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static UINT32 LoadU32(const BYTE* p) {
+    return (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+static void StoreU64(BYTE* p, UINT64 value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (BYTE)(value >> (i * 8));
+    }
+}
+
+static void StoreU32(BYTE* p, UINT32 value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (BYTE)(value >> (i * 8));
+    }
+}
+
+static UINT32 HashBytes(const BYTE* data, SIZE_T length) {
+    UINT32 hash = 2166136261u;
+    for (SIZE_T i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const char* StripName(const char* name) {
+    while (name[0] == '.' && name[1] == '/') name += 2;
+    while (name[0] == '/') name++;
+    return name;
+}
+
+BOOL CpioTocAppendRecord(CpioString* toc, const CpioTocEntry* record) {
+    if (!toc || !record || !record->name) return FALSE;
+
+    if (toc->length == 0) {
+        BYTE header[CPIO_TOC_HEADER_SIZE];
+        CpioCopyMemory(header, CPIO_TOC_MAGIC, 8);
+        StoreU64(header + 8, 0);
+        if (!CpioStringAppend(toc, (const char*)header, sizeof(header))) return FALSE;
+    }
+
+    UINT32 nameSize = (UINT32)CpioStringLength(record->name) + 1;
+    SIZE_T pad = (8 - ((CPIO_TOC_RECORD_SIZE + nameSize) % 8)) % 8;
+
+    BYTE fields[CPIO_TOC_RECORD_SIZE];
+    StoreU64(fields, record->headerOffset);
+    StoreU64(fields + 8, record->dataOffset);
+    StoreU64(fields + 16, record->fileSize);
+    StoreU32(fields + 24, record->mode);
+    StoreU32(fields + 28, nameSize);
+    StoreU32(fields + 32, record->inode);
+    StoreU32(fields + 36, record->devMajor);
+    StoreU32(fields + 40, record->devMinor);
+    StoreU32(fields + 44, record->nlink);
+
+    char zeros[8] = { 0 };
+    if (!CpioStringAppend(toc, (const char*)fields, sizeof(fields)) ||
+        !CpioStringAppend(toc, record->name, nameSize) ||
+        !CpioStringAppend(toc, zeros, pad)) {
+        return FALSE;
+    }
+
+    BYTE* count = (BYTE*)toc->data + 8;
+    StoreU64(count, LoadU64(count) + 1);
+    return TRUE;
+}
+
+void CpioTocBuildLocator(BYTE* locator, const CpioString* toc, UINT64 tocHeaderOffset, UINT64 locatorOffset) {
+    CpioZeroMemory(locator, CPIO_TOC_LOCATOR_SIZE);
+    CpioCopyMemory(locator, CPIO_TOC_LOCATOR_MAGIC, 8);
+    StoreU64(locator + 8, tocHeaderOffset);
+    StoreU64(locator + 16, locatorOffset);
+    StoreU32(locator + 24, HashBytes((const BYTE*)toc->data, toc->length));
+}
+
+static BOOL AddEntry(CpioToc* toc, const CpioTocEntry* record, SIZE_T nameOffset) {
+    if (toc->count >= toc->capacity) {
+        SIZE_T newCap = toc->capacity ? toc->capacity * 2 : 1024;
+        CpioTocEntry* newEntries = (CpioTocEntry*)CpioRealloc(toc->entries, sizeof(CpioTocEntry) * newCap);
+        if (!newEntries) return FALSE;
+
+        toc->entries = newEntries;
+        toc->capacity = newCap;
+    }
+
+    CpioTocEntry* entry = &toc->entries[toc->count++];
+    *entry = *record;
+    entry->name = (const char*)(UINT_PTR)nameOffset;
+    return TRUE;
+}
+
+static BOOL BuildIndex(CpioToc* toc) {
+    for (SIZE_T i = 0; i < toc->count; i++) {
+        toc->entries[i].name = toc->names->data + (UINT_PTR)toc->entries[i].name;
+    }
+
+    SIZE_T slotCount = 16;
+    while (slotCount < toc->count * 2) slotCount *= 2;
+
+    toc->slots = (UINT32*)CpioAlloc(sizeof(UINT32) * slotCount);
+    if (!toc->slots) return FALSE;
+    toc->slotCount = slotCount;
+
+    for (SIZE_T i = 0; i < toc->count; i++) {
+        const char* name = StripName(toc->entries[i].name);
+        SIZE_T slot = HashBytes((const BYTE*)name, CpioStringLength(name)) & (slotCount - 1);
+
+        while (toc->slots[slot] != 0) {
+            const char* other = StripName(toc->entries[toc->slots[slot] - 1].name);
+            if (CpioStringCompare(other, name) == 0) break;
+            slot = (slot + 1) & (slotCount - 1);
+        }
+
+        toc->slots[slot] = (UINT32)(i + 1);
+    }
+
+    return TRUE;
+}
+
+static BOOL ReadAt(CpioSource* source, UINT64 offset, void* buffer, SIZE_T size) {
+    SIZE_T bytesRead = 0;
+    return CpioSourceSeek(source, offset, NULL) &&
+           CpioSourceRead(source, buffer, size, &bytesRead, NULL) && bytesRead == size;
+}
+
+static BOOL LoadEmbedded(CpioToc* toc, CpioReader* reader) {
+    CpioSource* source = CpioReaderGetSource(reader);
+    UINT64 size = CpioSourceGetSize(source);
+    if (size < CPIO_TOC_LOCATOR_SIZE) return FALSE;
+
+    UINT64 locatorAt = size - CPIO_TOC_LOCATOR_SIZE;
+    BYTE locator[CPIO_TOC_LOCATOR_SIZE];
+
+    if (!ReadAt(source, locatorAt, locator, sizeof(locator)) ||
+        CpioCompareMemory(locator, CPIO_TOC_LOCATOR_MAGIC, 8) != 0) {
+        return FALSE;
+    }
+
+    UINT64 tocHeaderOffset = LoadU64(locator + 8);
+    UINT64 locatorOffset = LoadU64(locator + 16);
+    UINT32 checksum = LoadU32(locator + 24);
+
+    if (locatorOffset > locatorAt || tocHeaderOffset >= locatorOffset) return FALSE;
+    UINT64 base = locatorAt - locatorOffset;
+
+    CpioEntry entry;
+    if (!CpioReaderSeek(reader, base + tocHeaderOffset, NULL) ||
+        !CpioReaderReadNext(reader, &entry, NULL) ||
+        CpioStringCompare(entry.name, CPIO_TOC_NAME) != 0 ||
+        entry.fileSize < CPIO_TOC_HEADER_SIZE || entry.fileSize > (UINT64)(SIZE_T)-1 / 2) {
+        return FALSE;
+    }
+
+    SIZE_T blobSize = (SIZE_T)entry.fileSize;
+    char* blob = (char*)CpioRealloc(toc->names->data, blobSize + 1);
+    if (!blob) return FALSE;
+    toc->names->data = blob;
+    toc->names->capacity = blobSize + 1;
+
+    SIZE_T bytesRead = 0;
+    if (!CpioSourceRead(source, blob, blobSize, &bytesRead, NULL) || bytesRead != blobSize) {
+        return FALSE;
+    }
+    toc->names->length = blobSize;
+    blob[blobSize] = '\0';
+
+    const BYTE* data = (const BYTE*)blob;
+    if (HashBytes(data, blobSize) != checksum || CpioCompareMemory(data, CPIO_TOC_MAGIC, 8) != 0) {
+        return FALSE;
+    }
+
+    UINT64 count = LoadU64(data + 8);
+    SIZE_T pos = CPIO_TOC_HEADER_SIZE;
+
+    for (UINT64 i = 0; i < count; i++) {
+        if (blobSize - pos < CPIO_TOC_RECORD_SIZE) return FALSE;
+
+        const BYTE* record = data + pos;
+        UINT32 nameSize = LoadU32(record + 28);
+        SIZE_T nameOffset = pos + CPIO_TOC_RECORD_SIZE;
+
+        if (nameSize == 0 || nameSize > blobSize - nameOffset || blob[nameOffset + nameSize - 1] != '\0') {
+            return FALSE;
+        }
+
+        CpioTocEntry loaded;
+        loaded.headerOffset = base + LoadU64(record);
+        loaded.dataOffset = base + LoadU64(record + 8);
+        loaded.fileSize = LoadU64(record + 16);
+        loaded.mode = LoadU32(record + 24);
+        loaded.inode = LoadU32(record + 32);
+        loaded.devMajor = LoadU32(record + 36);
+        loaded.devMinor = LoadU32(record + 40);
+        loaded.nlink = LoadU32(record + 44);
+        loaded.name = NULL;
+
+        if (!AddEntry(toc, &loaded, nameOffset)) {
+            return FALSE;
+        }
+
+        pos = nameOffset + nameSize;
+        pos += (8 - (pos % 8)) % 8;
+        if (pos > blobSize) pos = blobSize;
+    }
+
+    toc->embedded = TRUE;
+    return TRUE;
+}
+
+static void RecordFromEntry(CpioTocEntry* record, const CpioEntry* entry) {
+    record->headerOffset = entry->headerOffset;
+    record->dataOffset = entry->dataOffset;
+    record->fileSize = entry->fileSize;
+    record->mode = entry->mode;
+    record->inode = entry->inode;
+    record->devMajor = entry->devMajor;
+    record->devMinor = entry->devMinor;
+    record->nlink = entry->nlink;
+    record->name = entry->name;
+}
+
+static BOOL AddScannedEntry(void* context, const CpioEntry* entry) {
+    CpioToc* toc = (CpioToc*)context;
+    if (CpioStringCompare(entry->name, CPIO_TOC_NAME) == 0) return TRUE;
+
+    CpioTocEntry record;
+    RecordFromEntry(&record, entry);
+
+    SIZE_T nameOffset = toc->names->length;
+    return CpioStringAppend(toc->names, entry->name, CpioStringLength(entry->name) + 1) &&
+           AddEntry(toc, &record, nameOffset);
+}
+
+static BOOL ScanArchive(CpioToc* toc, CpioReader* reader, UINT64 start, UINT32 threadCount, CpioError* error) {
+    toc->count = 0;
+    CpioStringClear(toc->names);
+
+    if (!CpioReaderSeek(reader, start, error)) return FALSE;
+
+    return CpioScanArchive(reader, threadCount, AddScannedEntry, toc, error);
+}
+
+CpioToc* CpioTocCreate(CpioReader* reader, UINT32 threadCount, CpioError* error) {
+    if (!reader) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL reader");
+        return NULL;
+    }
+
+    if (!CpioReaderIsSeekable(reader)) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Table of contents requires a seekable archive");
+        return NULL;
+    }
+
+    CpioToc* toc = (CpioToc*)CpioAlloc(sizeof(CpioToc));
+    if (!toc) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    toc->names = CpioStringCreate();
+    if (!toc->names) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioFree(toc);
+        return NULL;
+    }
+
+    UINT64 start = CpioReaderTell(reader, error);
+
+    if (!LoadEmbedded(toc, reader)) {
+        if (!ScanArchive(toc, reader, start, threadCount, error)) {
+            CpioTocDestroy(toc);
+            return NULL;
+        }
+    }
+
+    if (!BuildIndex(toc)) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioTocDestroy(toc);
+        return NULL;
+    }
+
+    if (!CpioReaderSeek(reader, start, error)) {
+        CpioTocDestroy(toc);
+        return NULL;
+    }
+
+    return toc;
+}
+
+void CpioTocDestroy(CpioToc* toc) {
+    if (!toc) return;
+
+    if (toc->entries) CpioFree(toc->entries);
+    if (toc->slots) CpioFree(toc->slots);
+    if (toc->names) CpioStringDestroy(toc->names);
+
+    CpioFree(toc);
+}
+
+SIZE_T CpioTocGetCount(const CpioToc* toc) {
+    return toc ? toc->count : 0;
+}
+
+const CpioTocEntry* CpioTocGetEntry(const CpioToc* toc, SIZE_T index) {
+    if (!toc || index >= toc->count) return NULL;
+    return &toc->entries[index];
+}
+
+const CpioTocEntry* CpioTocFind(const CpioToc* toc, const char* name) {
+    if (!toc || !name || toc->slotCount == 0) return NULL;
+
+    name = StripName(name);
+    SIZE_T slot = HashBytes((const BYTE*)name, CpioStringLength(name)) & (toc->slotCount - 1);
+
+    while (toc->slots[slot] != 0) {
+        const CpioTocEntry* entry = &toc->entries[toc->slots[slot] - 1];
+        if (CpioStringCompare(StripName(entry->name), name) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & (toc->slotCount - 1);
+    }
+
+    return NULL;
+}
+
+BOOL CpioReaderOpenEntry(CpioReader* reader, const CpioTocEntry* tocEntry, CpioEntry* entry, CpioError* error) {
+    if (!reader || !tocEntry || !entry) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (!CpioReaderSeek(reader, tocEntry->headerOffset, error) ||
+        !CpioReaderReadNext(reader, entry, error)) {
+        return FALSE;
+    }
+
+    if (CpioStringCompare(entry->name, tocEntry->name) != 0 || entry->fileSize != tocEntry->fileSize) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Table of contents does not match archive");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioReaderOpenByName(CpioReader* reader, const CpioToc* toc, const char* name,
+                          CpioEntry* entry, CpioError* error) {
+    const CpioTocEntry* tocEntry = CpioTocFind(toc, name);
+    if (!tocEntry) {
+        CpioErrorSet(error, CPIO_ERROR_NOT_FOUND, "Member not found");
+        return FALSE;
+    }
+
+    return CpioReaderOpenEntry(reader, tocEntry, entry, error);
+}
+
+typedef struct {
+    CpioFormat format;
+    CpioHashSet* seenDirs;
+    CpioString* toc;
+    CpioAppendPoint* point;
+} AppendScan;
+
+static BOOL RecordExisting(AppendScan* scan, const CpioTocEntry* record) {
+    if (CpioStringCompare(record->name, CPIO_TOC_NAME) == 0) {
+        scan->point->hasToc = TRUE;
+        return TRUE;
+    }
+
+    UINT64 end = record->dataOffset + record->fileSize;
+    if (scan->format != CPIO_FORMAT_ODC) end += (4 - (record->fileSize % 4)) % 4;
+    if (end > scan->point->offset) scan->point->offset = end;
+    if (record->inode >= scan->point->nextInode) scan->point->nextInode = record->inode + 1;
+
+    if ((record->mode & CPIO_S_IFMT) == CPIO_S_IFDIR) {
+        char normalized[CPIO_MAX_NAME_LENGTH];
+        if (CpioNormalizeArchivePath(record->name, normalized, sizeof(normalized)) &&
+            !CpioHashSetContains(scan->seenDirs, normalized) &&
+            !CpioHashSetInsert(scan->seenDirs, normalized)) {
+            return FALSE;
+        }
+    }
+
+    return !scan->toc || CpioTocAppendRecord(scan->toc, record);
+}
+
+static BOOL AppendScannedEntry(void* context, const CpioEntry* entry) {
+    CpioTocEntry record;
+    RecordFromEntry(&record, entry);
+    return RecordExisting((AppendScan*)context, &record);
+}
+
+BOOL CpioReaderFindAppendPoint(CpioReader* reader, CpioHashSet* seenDirs, CpioString* toc,
+                               CpioAppendPoint* point, CpioError* error) {
+    if (!reader || !seenDirs || !point) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    CpioSource* source = CpioReaderGetSource(reader);
+    if (!source->seekable) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Appending requires a seekable archive");
+        return FALSE;
+    }
+
+    AppendScan scan;
+    scan.format = CpioReaderGetFormat(reader);
+    scan.seenDirs = seenDirs;
+    scan.toc = toc;
+    scan.point = point;
+
+    UINT64 start = CpioReaderTell(reader, error);
+    point->offset = start;
+    point->nextInode = 0;
+    point->hasToc = FALSE;
+
+    CpioToc* existing = (CpioToc*)CpioAlloc(sizeof(CpioToc));
+    if (existing) existing->names = CpioStringCreate();
+    if (!existing || !existing->names) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        CpioTocDestroy(existing);
+        return FALSE;
+    }
+
+    BOOL ok;
+    if (LoadEmbedded(existing, reader)) {
+        ok = TRUE;
+        for (SIZE_T i = 0; ok && i < existing->count; i++) {
+            CpioTocEntry record = existing->entries[i];
+            record.name = existing->names->data + (UINT_PTR)record.name;
+            ok = RecordExisting(&scan, &record);
+        }
+        if (!ok) CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+
+        point->hasToc = TRUE;
+    } else {
+        ok = CpioReaderSeek(reader, start, error) &&
+             CpioScanArchive(reader, 1, AppendScannedEntry, &scan, error);
+    }
+
+    CpioTocDestroy(existing);
+    return ok;
+}
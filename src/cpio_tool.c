@@ -29,16 +29,68 @@ static void PrintUsage(void) {
   WriteStdErrLine("    DO NOT do this (creates absolute paths):");
   WriteStdErrLine("      dir /b /s PayloadRoot | cpio -o > Payload  # WRONG!");
   WriteStdErrLine("");
+  WriteStdErrLine("  List archive contents:");
+  WriteStdErrLine("    cpio -t < archive.cpio");
+  WriteStdErrLine("    cpio -tv < archive.cpio      (long format: mode, size, mtime, name)");
+  WriteStdErrLine("");
   WriteStdErrLine("  Extract archive (copy-in):");
   WriteStdErrLine("    cpio -i < archive.cpio");
+  WriteStdErrLine("    cpio -i < archive.cpio.gz    (gzip, pbzx and zstd input are detected automatically)");
   WriteStdErrLine("    Get-Content archive.cpio -Raw | cpio -i");
+  WriteStdErrLine("    cpio -i \"Applications/*.app/**\" < archive.cpio");
+  WriteStdErrLine("");
+  WriteStdErrLine("  Copy a file list into another tree (pass-through):");
+  WriteStdErrLine("    cpio -p C:\\Staging < filelist.txt  (absolute names are recreated under C:\\Staging)");
+  WriteStdErrLine("");
+  WriteStdErrLine("  Convert archive format:");
+  WriteStdErrLine("    cpio --convert --to=ustar < archive.cpio > archive.tar");
   WriteStdErrLine("");
   WriteStdErrLine("Options:");
   WriteStdErrLine("  -o, --create          Create archive (copy-out mode)");
   WriteStdErrLine("  -i, --extract         Extract archive (copy-in mode)");
+  WriteStdErrLine("  -t, --list            List archive contents without extracting");
+  WriteStdErrLine("  -p DIR, --pass-through=DIR");
+  WriteStdErrLine("                        Copy the files listed on stdin into DIR (block clone where supported)");
+  WriteStdErrLine("  --verify              Hash every member without extracting; print a manifest, or");
+  WriteStdErrLine("                        check the archive against one given with --manifest=FILE");
+  WriteStdErrLine("  --convert --to=FORMAT Re-encode the archive on stdin as newc, odc, ustar or pax on stdout");
   WriteStdErrLine("  --format=newc         Use NewC format (default, required for macOS .pkg)");
   WriteStdErrLine("  --format=odc          Use ODC format");
+  WriteStdErrLine("  --format=crc          Use NewC with per-file checksums (070702), verified on extraction");
+  WriteStdErrLine("  -A, --append          Add members to the end of an existing archive (-o, requires -F)");
+  WriteStdErrLine("  -F FILE, --file=FILE  Write the archive to FILE instead of stdout (-o)");
+  WriteStdErrLine("  --since-manifest=FILE Only add files changed since FILE, then update FILE (-o)");
+  WriteStdErrLine("  --manifest=FILE       Write SHA-256 and CRC32C of each archived file to FILE (-o),");
+  WriteStdErrLine("                        or the manifest to check against (--verify)");
+  WriteStdErrLine("  --toc                 Append a table of contents for random member access (-o, newc)");
+  WriteStdErrLine("  --bom=FILE            Write a .pkg Bom for the archived entries to FILE (-o, newc)");
+  WriteStdErrLine("  --dedupe              Store files with identical content once, as hard links (-o)");
+  WriteStdErrLine("  --gzip[=LEVEL]        Compress the archive with gzip, LEVEL 0-9 (default 6) (-o)");
+  WriteStdErrLine("  --pbzx                Compress the archive as a pbzx Payload with XZ chunks (-o, newc)");
+  WriteStdErrLine("  --zstd[=LEVEL]        Compress the archive with zstd, LEVEL 1-9 (default 3) (-o)");
+  WriteStdErrLine("  --long                With --zstd, match across a 128 MiB window in a single frame");
+  WriteStdErrLine("  --seekable            With --zstd, write independent frames and a seek table (newc)");
+  WriteStdErrLine("  -j N, --jobs=N        Use N threads (-t: parallel header discovery, -o --dedupe/--manifest");
+  WriteStdErrLine("                        and --verify: hashing,");
+  WriteStdErrLine("                        -o --gzip/--pbzx/--zstd: compression,");
+  WriteStdErrLine("                        --batch and -p: workers)");
+  WriteStdErrLine("  --batch=FILE          Run the create/extract/list jobs listed in FILE concurrently");
   WriteStdErrLine("  -v, --verbose         Verbose output");
+  WriteStdErrLine("  -m                    Restore member modification times on extraction (-i, -p)");
+  WriteStdErrLine("  --update              Skip members whose existing file has the same size and mtime");
+  WriteStdErrLine("  --keep-newer          Skip members whose existing file is not older");
+  WriteStdErrLine("  --compare-content     Like --update, and only rewrite same-size files that differ");
+  WriteStdErrLine("  --checkpoint=FILE     Record extraction progress in FILE and resume from it (-i)");
+  WriteStdErrLine("  --recover             Skip damaged regions and resume at the next valid header (-i, -t)");
+  WriteStdErrLine("  --exclude=PATTERN     Skip members matching PATTERN (-i, -t)");
+  WriteStdErrLine("  --pattern-file=FILE   Only process members matching patterns in FILE (-i, -t)");
+  WriteStdErrLine("");
+  WriteStdErrLine("BATCH FILE (one job per line, quote paths containing spaces):");
+  WriteStdErrLine("  create SOURCE_DIR ARCHIVE      extract ARCHIVE DEST_DIR      list ARCHIVE OUTPUT_FILE");
+  WriteStdErrLine("");
+  WriteStdErrLine("PATTERNS:");
+  WriteStdErrLine("  *   matches within one path component    **  matches across components");
+  WriteStdErrLine("  ?   matches one character                [a-z]  matches a character class");
   WriteStdErrLine("");
   WriteStdErrLine("NOTES:");
   WriteStdErrLine("  - Always cd into the directory you want to archive");
@@ -47,16 +99,10 @@ static void PrintUsage(void) {
   WriteStdErrLine("  - macOS .pkg payloads MUST use newc format (070701)");
 }
 
-static CpioStringList* ReadFilenamesFromStdin(void) {
+static CpioStringList* ReadLinesFromHandle(HANDLE hInput) {
   CpioStringList* list = CpioStringListCreate();
   if (!list) return NULL;
 
-  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
-  if (hStdin == INVALID_HANDLE_VALUE) {
-    CpioStringListDestroy(list);
-    return NULL;
-  }
-
   CpioString* line = CpioStringCreate();
   if (!line) {
     CpioStringListDestroy(list);
@@ -66,7 +112,7 @@ static CpioStringList* ReadFilenamesFromStdin(void) {
   char buffer[1024];
   DWORD bytesRead;
 
-  while (ReadFile(hStdin, buffer, sizeof(buffer), &bytesRead, NULL) && bytesRead > 0) {
+  while (ReadFile(hInput, buffer, sizeof(buffer), &bytesRead, NULL) && bytesRead > 0) {
     for (DWORD i = 0; i < bytesRead; i++) {
       char c = buffer[i];
 
@@ -113,16 +159,242 @@ static CpioStringList* ReadFilenamesFromStdin(void) {
   return list;
 }
 
-static int CreateArchive(BOOL verbose, BOOL useOdc) {
-  HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-  if (hStdout == INVALID_HANDLE_VALUE) {
-    WriteStdErrLine("Error: Cannot get stdout handle");
-    return 1;
+static CpioStringList* ReadFilenamesFromStdin(void) {
+  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
+  if (hStdin == INVALID_HANDLE_VALUE) {
+    return NULL;
   }
 
-  SetFilePointer(hStdout, 0, NULL, FILE_BEGIN);
+  return ReadLinesFromHandle(hStdin);
+}
 
-  if (useOdc) {
+static BOOL AddPattern(CpioMatcher** matcher, const char* pattern, BOOL exclude) {
+  if (!*matcher) {
+    *matcher = CpioMatcherCreate();
+    if (!*matcher) {
+      WriteStdErrLine("Error: Failed to create pattern matcher");
+      return FALSE;
+    }
+  }
+
+  CpioError error = { 0 };
+  if (!CpioMatcherAddPattern(*matcher, pattern, exclude, &error)) {
+    WriteStdErr("Error: Invalid pattern ");
+    WriteStdErr(pattern);
+    WriteStdErr(": ");
+    WriteStdErrLine(error.message);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static BOOL AddPatternFile(CpioMatcher** matcher, const char* path) {
+  WCHAR* widePath = CpioStringToWide(path);
+  if (!widePath) return FALSE;
+
+  HANDLE hFile = CreateFileW(widePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  CpioFree(widePath);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    WriteStdErr("Error: Cannot open pattern file ");
+    WriteStdErrLine(path);
+    return FALSE;
+  }
+
+  CpioStringList* patterns = ReadLinesFromHandle(hFile);
+  CloseHandle(hFile);
+
+  if (!patterns) {
+    WriteStdErr("Error: Cannot read pattern file ");
+    WriteStdErrLine(path);
+    return FALSE;
+  }
+
+  BOOL ok = TRUE;
+  for (SIZE_T i = 0; i < patterns->count && ok; i++) {
+    ok = AddPattern(matcher, patterns->items[i], FALSE);
+  }
+
+  CpioStringListDestroy(patterns);
+  return ok;
+}
+
+typedef struct {
+  BOOL append;
+  BOOL verbose;
+  BOOL useOdc;
+  BOOL useCrc;
+  BOOL writeToc;
+  BOOL dedupe;
+  BOOL gzip;
+  int gzipLevel;
+  BOOL pbzx;
+  BOOL zstd;
+  int zstdLevel;
+  CpioZstdMode zstdMode;
+  UINT32 jobs;
+  const char* manifestPath;
+  const char* hashManifestPath;
+  CpioHasher* hasher;
+  const char* bomPath;
+} CreateOptions;
+
+typedef struct {
+  CpioManifest* previous;
+  CpioManifest* current;
+  CpioSha256 sha;
+  char name[CPIO_MAX_NAME_LENGTH];
+  UINT64 fileSize;
+  UINT32 mtime;
+  UINT64 inode;
+} IncrementalState;
+
+static BOOL StatSourceFile(const WCHAR* path, UINT64* fileSize, UINT32* mtime, UINT64* inode, UINT32* volume,
+  UINT32* links) {
+  HANDLE hFile = CreateFileW(path, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+  BY_HANDLE_FILE_INFORMATION info;
+  BOOL ok = GetFileInformationByHandle(hFile, &info);
+  CloseHandle(hFile);
+  if (!ok) return FALSE;
+
+  ULARGE_INTEGER writeTime;
+  writeTime.LowPart = info.ftLastWriteTime.dwLowDateTime;
+  writeTime.HighPart = info.ftLastWriteTime.dwHighDateTime;
+
+  *fileSize = ((UINT64)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+  *mtime = (UINT32)(writeTime.QuadPart / 10000000ULL - 11644473600ULL);
+  *inode = ((UINT64)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+  *volume = info.dwVolumeSerialNumber;
+  *links = info.nNumberOfLinks;
+  return TRUE;
+}
+
+static BOOL IsUnchangedSinceManifest(IncrementalState* state, const char* filename, const WCHAR* widePath) {
+  CpioSha256Init(&state->sha);
+
+  UINT32 volume;
+  UINT32 links;
+  if (!CpioNormalizeArchivePath(filename, state->name, sizeof(state->name)) ||
+    !StatSourceFile(widePath, &state->fileSize, &state->mtime, &state->inode, &volume, &links)) {
+    state->name[0] = '\0';
+    return FALSE;
+  }
+
+  const CpioManifestRecord* prior = CpioManifestFind(state->previous, state->name);
+  if (!prior || prior->fileSize != state->fileSize) return FALSE;
+
+  if (prior->mtime != state->mtime || prior->inode != state->inode) {
+    BYTE digest[CPIO_SHA256_SIZE];
+    if (!CpioSha256File(widePath, digest, NULL) ||
+      CpioCompareMemory(digest, prior->digest, CPIO_SHA256_SIZE) != 0) {
+      return FALSE;
+    }
+  }
+
+  return CpioManifestAdd(state->current, state->name, state->fileSize, state->mtime, state->inode,
+    prior->digest, prior->hasCrc32c ? &prior->crc32c : NULL);
+}
+
+static void RecordArchivedFile(IncrementalState* state, const WCHAR* widePath) {
+  if (!state->name[0]) return;
+
+  BYTE digest[CPIO_SHA256_SIZE];
+  if (state->sha.length == state->fileSize) {
+    CpioSha256Final(&state->sha, digest);
+  }
+  else if (!CpioSha256File(widePath, digest, NULL)) {
+    return;
+  }
+  CpioManifestAdd(state->current, state->name, state->fileSize, state->mtime, state->inode, digest, NULL);
+}
+
+static void BeginHashedFile(CpioHasher* hasher, const char* filename, const WCHAR* widePath,
+  const CpioDedupeFile* duplicate) {
+  if (!hasher) return;
+
+  char name[CPIO_MAX_NAME_LENGTH];
+  UINT64 fileSize = 0;
+  UINT32 mtime = 0;
+  UINT64 inode = 0;
+  UINT32 volume = 0;
+  UINT32 links = 0;
+
+  if (!CpioNormalizeArchivePath(filename, name, sizeof(name))) return;
+  StatSourceFile(widePath, &fileSize, &mtime, &inode, &volume, &links);
+  CpioHasherBegin(hasher, name, mtime, inode);
+
+  if (duplicate) {
+    CpioHasherLink(hasher, CPIO_DEDUPE_DEV, duplicate->group, widePath);
+  }
+  else if (links > 1) {
+    CpioHasherLink(hasher, volume, inode, widePath);
+  }
+}
+
+static CpioDedupe* FindDuplicates(const CpioStringList* filenames, UINT32 jobs) {
+  CpioDedupe* dedupe = CpioDedupeCreate();
+  if (!dedupe) return NULL;
+
+  for (SIZE_T i = 0; i < filenames->count; i++) {
+    WCHAR* widePath = CpioStringToWide(filenames->items[i]);
+    BOOL ok = CpioDedupeAdd(dedupe, widePath ? widePath : L"");
+    if (widePath) CpioFree(widePath);
+
+    if (!ok) {
+      CpioDedupeDestroy(dedupe);
+      return NULL;
+    }
+  }
+
+  CpioError error = { 0 };
+  if (!CpioDedupeRun(dedupe, jobs, &error)) {
+    CpioDedupeDestroy(dedupe);
+    return NULL;
+  }
+
+  return dedupe;
+}
+
+static const CpioDedupeFile* FindDuplicate(const CpioDedupe* dedupe, SIZE_T index) {
+  if (!dedupe || dedupe->files[index].groupSize < 2) return NULL;
+  return &dedupe->files[index];
+}
+
+static BOOL WriteBom(CpioBomWriter* bom, const char* bomPath) {
+  CpioError error = { 0 };
+  WCHAR* widePath = CpioStringToWide(bomPath);
+  HANDLE hBom = INVALID_HANDLE_VALUE;
+  if (widePath) {
+    hBom = CreateFileW(widePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    CpioFree(widePath);
+  }
+
+  BOOL ok = hBom != INVALID_HANDLE_VALUE && CpioBomWriterFinish(bom, hBom, &error);
+  if (hBom != INVALID_HANDLE_VALUE) CloseHandle(hBom);
+
+  if (!ok) {
+    WriteStdErr("Error: Cannot write Bom ");
+    WriteStdErrLine(bomPath);
+  }
+  return ok;
+}
+
+static int WriteArchive(HANDLE hArchive, const CreateOptions* options, IncrementalState* incremental,
+  CpioZstdWriter* zstd) {
+  BOOL verbose = options->verbose;
+  BOOL useOdc = options->useOdc;
+  BOOL append = options->append;
+
+  if (append) {
+    useOdc = CpioDetectFormat(hArchive, NULL) == CPIO_FORMAT_ODC;
+    SetFilePointer(hArchive, 0, NULL, FILE_BEGIN);
+  }
+  else if (useOdc) {
     WriteStdErrLine("Warning: ODC format selected. macOS .pkg payloads require newc (070701).");
   }
 
@@ -132,17 +404,44 @@ static int CreateArchive(BOOL verbose, BOOL useOdc) {
     return 1;
   }
 
+  CpioDedupe* dedupe = NULL;
+  if (options->dedupe) {
+    dedupe = FindDuplicates(filenames, options->jobs);
+    if (!dedupe) {
+      WriteStdErrLine("Error: Failed to scan files for duplicates");
+      CpioStringListDestroy(filenames);
+      return 1;
+    }
+  }
+
   CpioError error = { 0 };
   int result = 0;
 
   if (useOdc) {
-    CpioOdcBuilder* builder = CpioOdcBuilderCreate(hStdout, FALSE);
+    CpioOdcBuilder* builder = append ? CpioOdcBuilderCreateAppend(hArchive, FALSE, &error) :
+      CpioOdcBuilderCreate(hArchive, FALSE);
     if (!builder) {
-      WriteStdErrLine("Error: Failed to create ODC builder");
+      if (append) {
+        WriteStdErr("Error: Cannot append to archive: ");
+        WriteStdErrLine(error.message);
+      }
+      else {
+        WriteStdErrLine("Error: Failed to create ODC builder");
+      }
+      CpioDedupeDestroy(dedupe);
       CpioStringListDestroy(filenames);
       return 1;
     }
 
+    if (incremental) {
+      builder->dataCallback = CpioSha256Callback;
+      builder->dataContext = &incremental->sha;
+    }
+    else if (options->hasher) {
+      builder->dataCallback = CpioHasherCallback;
+      builder->dataContext = options->hasher;
+    }
+
     CpioOdcBuilderEmitRootDirectory(builder, &error);
     if (verbose) WriteStdErrLine("  dir  .");
 
@@ -175,33 +474,90 @@ static int CreateArchive(BOOL verbose, BOOL useOdc) {
         continue;
       }
 
-      UINT64 written = CpioOdcBuilderAppendFileFromPath(builder, filename, widePath, &error);
-      if (written == 0) {
+      if (incremental && IsUnchangedSinceManifest(incremental, filename, widePath)) {
+        if (verbose) {
+          WriteStdErr("  same ");
+          WriteStdErrLine(filename);
+        }
+        CpioFree(widePath);
+        continue;
+      }
+
+      const CpioDedupeFile* duplicate = FindDuplicate(dedupe, i);
+      BeginHashedFile(options->hasher, filename, widePath, duplicate);
+      BOOL deferred = FALSE;
+      UINT64 written = duplicate ?
+        CpioOdcBuilderAppendLink(builder, filename, widePath, CPIO_DEDUPE_DEV, duplicate->group,
+          duplicate->groupSize, &deferred, &error) :
+        CpioOdcBuilderAppendFileFromPath(builder, filename, widePath, &deferred, &error);
+      if (written == 0 && !deferred) {
         WriteStdErr("Warning: Cannot add ");
         WriteStdErr(filename);
         WriteStdErr(": ");
         WriteStdErrLine(error.message);
+        CpioHasherEnd(options->hasher, FALSE);
       }
-      else if (verbose) {
-        WriteStdErr("  file ");
-        WriteStdErrLine(filename);
+      else {
+        CpioHasherEnd(options->hasher, TRUE);
+        if (incremental) RecordArchivedFile(incremental, widePath);
+        if (verbose) {
+          WriteStdErr("  file ");
+          WriteStdErrLine(filename);
+        }
       }
 
       CpioFree(widePath);
     }
 
-    CpioOdcBuilderFinish(builder, &error);
+    if (CpioOdcBuilderFinish(builder, &error) == 0) {
+      WriteStdErr("Error: Cannot finish archive: ");
+      WriteStdErrLine(error.message);
+      result = 1;
+    }
     CpioOdcBuilderDestroy(builder);
 
   }
   else {
-    CpioNewcBuilder* builder = CpioNewcBuilderCreate(hStdout, FALSE);
+    CpioNewcBuilder* builder = append ? CpioNewcBuilderCreateAppend(hArchive, FALSE, &error) :
+      CpioNewcBuilderCreate(hArchive, FALSE);
     if (!builder) {
-      WriteStdErrLine("Error: Failed to create NewC builder");
+      if (append) {
+        WriteStdErr("Error: Cannot append to archive: ");
+        WriteStdErrLine(error.message);
+      }
+      else {
+        WriteStdErrLine("Error: Failed to create NewC builder");
+      }
+      CpioDedupeDestroy(dedupe);
       CpioStringListDestroy(filenames);
       return 1;
     }
 
+    if (options->writeToc) builder->writeToc = TRUE;
+    if (options->useCrc && !append) builder->crc = TRUE;
+
+    CpioBomWriter* bom = NULL;
+    if (options->bomPath) {
+      bom = CpioBomWriterCreate();
+      if (!bom) {
+        WriteStdErrLine("Error: Out of memory");
+        CpioNewcBuilderDestroy(builder);
+        CpioDedupeDestroy(dedupe);
+        CpioStringListDestroy(filenames);
+        return 1;
+      }
+      builder->bom = bom;
+    }
+
+    if (incremental) {
+      builder->dataCallback = CpioSha256Callback;
+      builder->dataContext = &incremental->sha;
+    }
+    else if (options->hasher) {
+      builder->dataCallback = CpioHasherCallback;
+      builder->dataContext = options->hasher;
+    }
+
     CpioNewcBuilderEmitRootDirectory(builder, &error);
     if (verbose) WriteStdErrLine("  dir  .");
 
@@ -234,250 +590,1729 @@ static int CreateArchive(BOOL verbose, BOOL useOdc) {
         continue;
       }
 
-      UINT64 written = CpioNewcBuilderAppendFileFromPath(builder, filename, widePath, &error);
-      if (written == 0) {
+      if (incremental && IsUnchangedSinceManifest(incremental, filename, widePath)) {
+        if (verbose) {
+          WriteStdErr("  same ");
+          WriteStdErrLine(filename);
+        }
+        CpioFree(widePath);
+        continue;
+      }
+
+      CpioZstdWriterMarkBoundary(zstd, builder->offset);
+      const CpioDedupeFile* duplicate = FindDuplicate(dedupe, i);
+      BeginHashedFile(options->hasher, filename, widePath, duplicate);
+      BOOL deferred = FALSE;
+      UINT64 written = duplicate ?
+        CpioNewcBuilderAppendLink(builder, filename, widePath, CPIO_DEDUPE_DEV, duplicate->group,
+          duplicate->groupSize, &deferred, &error) :
+        CpioNewcBuilderAppendFileFromPath(builder, filename, widePath, &deferred, &error);
+      if (written == 0 && !deferred) {
         WriteStdErr("Warning: Cannot add ");
         WriteStdErr(filename);
         WriteStdErr(": ");
         WriteStdErrLine(error.message);
+        CpioHasherEnd(options->hasher, FALSE);
       }
-      else if (verbose) {
-        WriteStdErr("  file ");
-        WriteStdErrLine(filename);
+      else {
+        CpioHasherEnd(options->hasher, TRUE);
+        if (incremental) RecordArchivedFile(incremental, widePath);
+        if (verbose) {
+          WriteStdErr("  file ");
+          WriteStdErrLine(filename);
+        }
       }
 
       CpioFree(widePath);
     }
 
-    CpioNewcBuilderFinish(builder, &error);
+    if (CpioNewcBuilderFinish(builder, &error) == 0) {
+      WriteStdErr("Error: Cannot finish archive: ");
+      WriteStdErrLine(error.message);
+      result = 1;
+    }
     CpioNewcBuilderDestroy(builder);
+
+    if (bom) {
+      if (result == 0 && !WriteBom(bom, options->bomPath)) result = 1;
+      CpioBomWriterDestroy(bom);
+    }
   }
 
+  CpioDedupeDestroy(dedupe);
   CpioStringListDestroy(filenames);
   return result;
 }
 
-static int ExtractArchive(BOOL verbose) {
-  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
-  if (hStdin == INVALID_HANDLE_VALUE) {
-    WriteStdErrLine("Error: Cannot get stdin handle");
+static int WritePbzxArchive(HANDLE hOutput, const CreateOptions* options, IncrementalState* incremental) {
+  CpioError error = { 0 };
+  CpioPbzxWriter* pbzx = CpioPbzxWriterCreate(hOutput, options->jobs, &error);
+  if (!pbzx) {
+    WriteStdErr("Error: Cannot start compression: ");
+    WriteStdErrLine(error.message);
     return 1;
   }
 
+  int result = WriteArchive(CpioPbzxWriterGetHandle(pbzx), options, incremental, NULL);
+
+  if (!CpioPbzxWriterFinish(pbzx, &error)) {
+    WriteStdErr("Error: Cannot compress archive: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+  CpioPbzxWriterDestroy(pbzx);
+  return result;
+}
+
+static int WriteZstdArchive(HANDLE hOutput, const CreateOptions* options, IncrementalState* incremental) {
   CpioError error = { 0 };
-  CpioFormat format = CpioDetectFormat(hStdin, &error);
+  CpioZstdWriter* zstd = CpioZstdWriterCreate(hOutput, options->zstdLevel, options->jobs, options->zstdMode, &error);
+  if (!zstd) {
+    WriteStdErr("Error: Cannot start compression: ");
+    WriteStdErrLine(error.message);
+    return 1;
+  }
+
+  int result = WriteArchive(CpioZstdWriterGetHandle(zstd), options, incremental, zstd);
+
+  if (!CpioZstdWriterFinish(zstd, &error)) {
+    WriteStdErr("Error: Cannot compress archive: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+  CpioZstdWriterDestroy(zstd);
+  return result;
+}
+
+static int WriteCompressedArchive(HANDLE hOutput, const CreateOptions* options, IncrementalState* incremental) {
+  if (options->pbzx) return WritePbzxArchive(hOutput, options, incremental);
+  if (options->zstd) return WriteZstdArchive(hOutput, options, incremental);
+  if (!options->gzip) return WriteArchive(hOutput, options, incremental, NULL);
 
-  if (format == CPIO_FORMAT_UNKNOWN) {
-    WriteStdErrLine("Error: Unknown or invalid CPIO format");
+  CpioError error = { 0 };
+  CpioGzipWriter* gzip = CpioGzipWriterCreate(hOutput, options->gzipLevel, options->jobs, &error);
+  if (!gzip) {
+    WriteStdErr("Error: Cannot start compression: ");
+    WriteStdErrLine(error.message);
     return 1;
   }
 
-  if (verbose) {
-    if (format == CPIO_FORMAT_ODC) {
-      WriteStdErrLine("Format: ODC");
-    }
-    else {
-      WriteStdErrLine("Format: NewC");
-    }
+  int result = WriteArchive(CpioGzipWriterGetHandle(gzip), options, incremental, NULL);
+
+  if (!CpioGzipWriterFinish(gzip, &error)) {
+    WriteStdErr("Error: Cannot compress archive: ");
+    WriteStdErrLine(error.message);
+    result = 1;
   }
+  CpioGzipWriterDestroy(gzip);
+  return result;
+}
 
-  if (format == CPIO_FORMAT_ODC) {
-    CpioOdcReader* reader = CpioOdcReaderCreate(hStdin, FALSE);
-    if (!reader) {
-      WriteStdErrLine("Error: Failed to create ODC reader");
+static int WriteArchiveTo(const char* archivePath, const CreateOptions* options, IncrementalState* incremental) {
+  if (!archivePath) {
+    HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hStdout == INVALID_HANDLE_VALUE) {
+      WriteStdErrLine("Error: Cannot get stdout handle");
       return 1;
     }
 
-    CpioOdcHeader header;
-    while (CpioOdcReaderReadNext(reader, &header, &error)) {
-      if (CpioStringCompare(header.name, ".") == 0) {
-        CpioOdcReaderFinish(reader, &error);
-        continue;
-      }
+    SetFilePointer(hStdout, 0, NULL, FILE_BEGIN);
+    CreateOptions streamOptions = *options;
+    streamOptions.append = FALSE;
+    return WriteCompressedArchive(hStdout, &streamOptions, incremental);
+  }
 
-      const char* name = header.name;
-      if (name[0] == '.' && name[1] == '/') {
-        name += 2;
-      }
+  WCHAR* widePath = CpioStringToWide(archivePath);
+  HANDLE hArchive = INVALID_HANDLE_VALUE;
+  if (widePath) {
+    hArchive = CreateFileW(widePath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+      options->append ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    CpioFree(widePath);
+  }
 
-      if (name[0] == '\0') {
-        CpioOdcReaderFinish(reader, &error);
-        continue;
-      }
+  if (hArchive == INVALID_HANDLE_VALUE) {
+    WriteStdErr("Error: Cannot open archive ");
+    WriteStdErrLine(archivePath);
+    return 1;
+  }
 
-      char winPath[CPIO_MAX_NAME_LENGTH];
-      SIZE_T j = 0;
-      for (SIZE_T i = 0; name[i] && j < CPIO_MAX_NAME_LENGTH - 1; i++) {
-        winPath[j++] = (name[i] == '/') ? '\\' : name[i];
-      }
-      winPath[j] = '\0';
+  int result = WriteCompressedArchive(hArchive, options, incremental);
+  CloseHandle(hArchive);
+  return result;
+}
 
-      if (verbose) WriteStdErrLine(winPath);
+static int CreateHashedArchive(const char* archivePath, const CreateOptions* options) {
+  CpioError error = { 0 };
+  CpioHasher* hasher = CpioHasherCreate(options->jobs, &error);
+  CpioManifest* manifest = CpioManifestCreate();
+  if (!hasher || !manifest) {
+    WriteStdErrLine("Error: Cannot start hashing threads");
+    CpioHasherDestroy(hasher);
+    CpioManifestDestroy(manifest);
+    return 1;
+  }
 
-      WCHAR* wideName = CpioStringToWide(winPath);
-      if (!wideName) {
-        CpioOdcReaderFinish(reader, &error);
-        continue;
-      }
+  CreateOptions hashedOptions = *options;
+  hashedOptions.hasher = hasher;
+  int result = WriteArchiveTo(archivePath, &hashedOptions, NULL);
 
-      if (header.mode & CPIO_S_IFDIR) {
-        CreateDirectoryW(wideName, NULL);
-      }
-      else {
-        WCHAR* lastSlash = wideName;
-        for (WCHAR* p = wideName; *p; p++) {
-          if (*p == L'\\') lastSlash = p;
-        }
+  WCHAR* wideManifest = CpioStringToWide(options->hashManifestPath);
+  if (!CpioHasherFinish(hasher, manifest, &error) || !wideManifest ||
+    !CpioManifestSave(manifest, wideManifest, &error)) {
+    WriteStdErr("Error: Cannot write manifest ");
+    WriteStdErrLine(options->hashManifestPath);
+    result = 1;
+  }
 
-        if (lastSlash != wideName) {
-          *lastSlash = L'\0';
+  if (wideManifest) CpioFree(wideManifest);
+  CpioHasherDestroy(hasher);
+  CpioManifestDestroy(manifest);
+  return result;
+}
 
-          for (WCHAR* p = wideName; *p; p++) {
-            if (*p == L'\\') {
-              *p = L'\0';
-              CreateDirectoryW(wideName, NULL);
-              *p = L'\\';
-            }
-          }
-          CreateDirectoryW(wideName, NULL);
+static int CreateArchive(const char* archivePath, const CreateOptions* options) {
+  if (options->hashManifestPath) {
+    return CreateHashedArchive(archivePath, options);
+  }
 
-          *lastSlash = L'\\';
-        }
+  const char* manifestPath = options->manifestPath;
+  if (!manifestPath) {
+    return WriteArchiveTo(archivePath, options, NULL);
+  }
 
-        HANDLE hOutFile = CreateFileW(wideName, GENERIC_WRITE, 0, NULL,
-          CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  IncrementalState* incremental = (IncrementalState*)CpioAlloc(sizeof(IncrementalState));
+  if (!incremental) {
+    WriteStdErrLine("Error: Out of memory");
+    return 1;
+  }
 
-        if (hOutFile == INVALID_HANDLE_VALUE) {
-          WriteStdErr("Warning: Cannot create ");
-          WriteStdErrLine(winPath);
-          CpioFree(wideName);
-          CpioOdcReaderFinish(reader, &error);
-          continue;
-        }
+  CpioString* tempPath = CpioStringCreate();
+  WCHAR* wideManifest = CpioStringToWide(manifestPath);
+  WCHAR* wideTemp = NULL;
+  CpioError error = { 0 };
+  int result = 1;
 
-        char buffer[8192];
-        DWORD bytesRead;
-        while ((bytesRead = CpioOdcReaderRead(reader, buffer, sizeof(buffer), &error)) > 0) {
-          DWORD bytesWritten;
-          WriteFile(hOutFile, buffer, bytesRead, &bytesWritten, NULL);
-        }
+  if (tempPath && CpioStringSet(tempPath, manifestPath, CpioStringLength(manifestPath)) &&
+    CpioStringAppend(tempPath, ".new", 4)) {
+    wideTemp = CpioStringToWide(tempPath->data);
+  }
 
-        CloseHandle(hOutFile);
-      }
+  incremental->previous = CpioManifestCreate();
+  incremental->current = CpioManifestCreate();
 
-      CpioFree(wideName);
+  if (!wideManifest || !wideTemp || !incremental->previous || !incremental->current) {
+    WriteStdErrLine("Error: Out of memory");
+  }
+  else if (GetFileAttributesW(wideManifest) != INVALID_FILE_ATTRIBUTES &&
+    !CpioManifestLoad(incremental->previous, wideManifest, &error)) {
+    WriteStdErr("Error: Cannot load manifest ");
+    WriteStdErr(manifestPath);
+    WriteStdErr(": ");
+    WriteStdErrLine(error.message);
+  }
+  else {
+    result = WriteArchiveTo(archivePath, options, incremental);
+
+    if (result == 0 &&
+      (!CpioManifestSave(incremental->current, wideTemp, &error) ||
+        !MoveFileExW(wideTemp, wideManifest, MOVEFILE_REPLACE_EXISTING))) {
+      WriteStdErr("Error: Cannot write manifest ");
+      WriteStdErrLine(manifestPath);
+      DeleteFileW(wideTemp);
+      result = 1;
     }
+  }
+
+  CpioManifestDestroy(incremental->previous);
+  CpioManifestDestroy(incremental->current);
+  CpioFree(incremental);
+  if (wideManifest) CpioFree(wideManifest);
+  if (wideTemp) CpioFree(wideTemp);
+  if (tempPath) CpioStringDestroy(tempPath);
+  return result;
+}
 
-    CpioOdcReaderDestroy(reader);
+static BOOL ParseUInt32(const char* text, UINT32* value) {
+  UINT32 result = 0;
 
+  if (!text[0]) return FALSE;
+
+  for (SIZE_T i = 0; text[i]; i++) {
+    if (text[i] < '0' || text[i] > '9') return FALSE;
+    UINT32 digit = (UINT32)(text[i] - '0');
+    if (result > 429496729 || (result == 429496729 && digit > 5)) return FALSE;
+    result = result * 10 + digit;
   }
-  else {
-    CpioNewcReader* reader = CpioNewcReaderCreate(hStdin, FALSE);
-    if (!reader) {
-      WriteStdErrLine("Error: Failed to create NewC reader");
-      return 1;
-    }
 
-    CpioNewcHeader header;
-    while (CpioNewcReaderReadNext(reader, &header, &error)) {
-      if (CpioStringCompare(header.name, ".") == 0) {
-        CpioNewcReaderFinish(reader, &error);
-        continue;
-      }
+  *value = result;
+  return TRUE;
+}
 
-      const char* name = header.name;
-      if (name[0] == '.' && name[1] == '/') {
-        name += 2;
-      }
+typedef struct {
+  BOOL verbose;
+  BOOL preserveMtime;
+  BOOL update;
+  BOOL keepNewer;
+  BOOL compareContent;
+  BOOL recover;
+  CpioMatcher* matcher;
+  const char* checkpointPath;
+} ExtractOptions;
+
+#define COMPARE_CHUNK_SIZE (256 * 1024)
+
+static void CreateParentDirectories(WCHAR* wideName) {
+  WCHAR* lastSlash = wideName;
+  for (WCHAR* p = wideName; *p; p++) {
+    if (*p == L'\\') lastSlash = p;
+  }
 
-      if (name[0] == '\0') {
-        CpioNewcReaderFinish(reader, &error);
-        continue;
-      }
+  if (lastSlash == wideName) return;
 
-      char winPath[CPIO_MAX_NAME_LENGTH];
-      SIZE_T j = 0;
-      for (SIZE_T i = 0; name[i] && j < CPIO_MAX_NAME_LENGTH - 1; i++) {
-        winPath[j++] = (name[i] == '/') ? '\\' : name[i];
-      }
-      winPath[j] = '\0';
+  *lastSlash = L'\0';
 
-      if (verbose) WriteStdErrLine(winPath);
+  for (WCHAR* p = wideName; *p; p++) {
+    if (*p == L'\\') {
+      *p = L'\0';
+      CreateDirectoryW(wideName, NULL);
+      *p = L'\\';
+    }
+  }
+  CreateDirectoryW(wideName, NULL);
 
-      WCHAR* wideName = CpioStringToWide(winPath);
-      if (!wideName) {
-        CpioNewcReaderFinish(reader, &error);
-        continue;
-      }
+  *lastSlash = L'\\';
+}
 
-      if (header.mode & CPIO_S_IFDIR) {
-        CreateDirectoryW(wideName, NULL);
-      }
-      else {
-        WCHAR* lastSlash = wideName;
-        for (WCHAR* p = wideName; *p; p++) {
-          if (*p == L'\\') lastSlash = p;
-        }
+static void SetFileMtime(HANDLE hFile, UINT32 mtime) {
+  ULARGE_INTEGER uli;
+  uli.QuadPart = ((UINT64)mtime + 11644473600ULL) * 10000000ULL;
 
-        if (lastSlash != wideName) {
-          *lastSlash = L'\0';
+  FILETIME ft;
+  ft.dwLowDateTime = uli.LowPart;
+  ft.dwHighDateTime = uli.HighPart;
 
-          for (WCHAR* p = wideName; *p; p++) {
-            if (*p == L'\\') {
-              *p = L'\0';
-              CreateDirectoryW(wideName, NULL);
-              *p = L'\\';
-            }
-          }
-          CreateDirectoryW(wideName, NULL);
+  SetFileTime(hFile, NULL, NULL, &ft);
+}
 
-          *lastSlash = L'\\';
-        }
+static BOOL RewriteIfDifferent(CpioReader* reader, const WCHAR* wideName, const CpioEntry* entry,
+  BYTE* archiveChunk, BYTE* fileChunk, BOOL* changed, CpioError* error) {
+  HANDLE hFile = CreateFileW(wideName, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return FALSE;
+  }
 
-        HANDLE hOutFile = CreateFileW(wideName, GENERIC_WRITE, 0, NULL,
-          CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  BOOL ok = TRUE;
+  UINT64 offset = 0;
+  *changed = FALSE;
 
-        if (hOutFile == INVALID_HANDLE_VALUE) {
-          WriteStdErr("Warning: Cannot create ");
-          WriteStdErrLine(winPath);
-          CpioFree(wideName);
-          CpioNewcReaderFinish(reader, &error);
-          continue;
-        }
+  while (offset < entry->fileSize) {
+    DWORD got = CpioReaderRead(reader, archiveChunk, COMPARE_CHUNK_SIZE, error);
+    if (got == 0) {
+      CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "Archive truncated in entry data");
+      ok = FALSE;
+      break;
+    }
 
-        char buffer[8192];
-        DWORD bytesRead;
-        while ((bytesRead = CpioNewcReaderRead(reader, buffer, sizeof(buffer), &error)) > 0) {
-          DWORD bytesWritten;
-          WriteFile(hOutFile, buffer, bytesRead, &bytesWritten, NULL);
-        }
+    DWORD fileGot = 0;
+    if (!ReadFile(hFile, fileChunk, got, &fileGot, NULL)) {
+      fileGot = 0;
+    }
+
+    if (fileGot != got || CpioCompareMemory(archiveChunk, fileChunk, got) != 0) {
+      LARGE_INTEGER position;
+      position.QuadPart = (LONGLONG)offset;
 
-        CloseHandle(hOutFile);
+      DWORD written;
+      ok = SetFilePointerEx(hFile, position, NULL, FILE_BEGIN) &&
+        WriteFile(hFile, archiveChunk, got, &written, NULL) && written == got;
+
+      if (ok) {
+        ok = CpioReaderCopyToHandle(reader, hFile, error) && SetEndOfFile(hFile);
+      }
+      else {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write entry data");
       }
 
-      CpioFree(wideName);
+      *changed = TRUE;
+      break;
     }
 
-    CpioNewcReaderDestroy(reader);
+    offset += got;
   }
 
-  if (verbose) {
-    WriteStdErrLine("Extraction complete");
+  SetFileMtime(hFile, entry->mtime);
+  CloseHandle(hFile);
+  return ok;
+}
+
+static SIZE_T FormatDecimal(char* output, UINT64 value) {
+  char digits[24];
+  SIZE_T count = 0;
+
+  do {
+    digits[count++] = (char)('0' + (value % 10));
+    value /= 10;
+  } while (value > 0);
+
+  for (SIZE_T i = 0; i < count; i++) {
+    output[i] = digits[count - 1 - i];
   }
+  output[count] = '\0';
+  return count;
+}
 
-  return 0;
+#define CHECKPOINT_MAGIC "CPIOCKP2"
+#define CHECKPOINT_INTERVAL_BYTES (256ULL * 1024 * 1024)
+#define CHECKPOINT_INTERVAL_FILES 1024
+#define CHECKPOINT_INTERVAL_MS 10000
+
+typedef struct {
+  BYTE magic[8];
+  UINT64 headerOffset;
+  UINT64 flushedOffset;
+  UINT64 membersDone;
+  UINT32 nameLength;
+  UINT32 checksum;
+} CheckpointRecord;
+
+typedef struct {
+  WCHAR* path;
+  WCHAR* tempPath;
+  CheckpointRecord record;
+  UINT64 membersSeen;
+  UINT64 lastOffset;
+  char name[CPIO_MAX_NAME_LENGTH];
+  CpioStringList* unflushed;
+  UINT64 bytesSinceSave;
+  ULONGLONG lastSave;
+  BOOL resumed;
+} Checkpoint;
+
+static UINT32 ChecksumCheckpoint(const CheckpointRecord* record, const char* name) {
+  CheckpointRecord copy = *record;
+  copy.checksum = 0;
+
+  UINT32 hash = 2166136261u;
+  const BYTE* bytes = (const BYTE*)&copy;
+  for (SIZE_T i = 0; i < sizeof(copy); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  for (UINT32 i = 0; i < record->nameLength; i++) {
+    hash = (hash ^ (BYTE)name[i]) * 16777619u;
+  }
+  return hash;
 }
 
-void mainCRTStartup(void) {
-  LPWSTR cmdLine = GetCommandLineW();
+static void ReleaseCheckpoint(Checkpoint* checkpoint) {
+  if (checkpoint->path) CpioFree(checkpoint->path);
+  if (checkpoint->tempPath) CpioFree(checkpoint->tempPath);
+  if (checkpoint->unflushed) CpioStringListDestroy(checkpoint->unflushed);
+  CpioZeroMemory(checkpoint, sizeof(Checkpoint));
+}
 
-  int argc;
-  LPWSTR* argv = CommandLineToArgvW(cmdLine, &argc);
+static BOOL InitCheckpoint(Checkpoint* checkpoint, const char* path) {
+  CpioZeroMemory(checkpoint, sizeof(Checkpoint));
 
-  BOOL createMode = FALSE;
-  BOOL extractMode = FALSE;
-  BOOL verbose = FALSE;
-  BOOL useOdc = FALSE;
+  SIZE_T len = CpioStringLength(path);
+  char* tempPath = (char*)CpioAlloc(len + 5);
+  if (!tempPath) return FALSE;
+  CpioCopyMemory(tempPath, path, len);
+  CpioCopyMemory(tempPath + len, ".tmp", 5);
+
+  checkpoint->path = CpioStringToWide(path);
+  checkpoint->tempPath = CpioStringToWide(tempPath);
+  checkpoint->unflushed = CpioStringListCreate();
+  CpioFree(tempPath);
+
+  if (!checkpoint->path || !checkpoint->tempPath || !checkpoint->unflushed) {
+    ReleaseCheckpoint(checkpoint);
+    return FALSE;
+  }
+
+  CpioCopyMemory(checkpoint->record.magic, CHECKPOINT_MAGIC, 8);
+  checkpoint->lastSave = GetTickCount64();
+  return TRUE;
+}
+
+static BOOL LoadCheckpoint(Checkpoint* checkpoint, BOOL* found) {
+  *found = FALSE;
+
+  HANDLE hFile = CreateFileW(checkpoint->path, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return GetLastError() == ERROR_FILE_NOT_FOUND;
+  }
+
+  CheckpointRecord record;
+  DWORD bytesRead = 0;
+  BOOL ok = ReadFile(hFile, &record, sizeof(record), &bytesRead, NULL) && bytesRead == sizeof(record) &&
+    CpioCompareMemory(record.magic, CHECKPOINT_MAGIC, 8) == 0 &&
+    record.nameLength > 0 && record.nameLength < CPIO_MAX_NAME_LENGTH;
+
+  if (ok) {
+    ok = ReadFile(hFile, checkpoint->name, record.nameLength, &bytesRead, NULL) &&
+      bytesRead == record.nameLength &&
+      ChecksumCheckpoint(&record, checkpoint->name) == record.checksum;
+  }
+
+  CloseHandle(hFile);
+
+  if (!ok) {
+    return FALSE;
+  }
+
+  checkpoint->name[record.nameLength] = '\0';
+  checkpoint->record = record;
+  *found = TRUE;
+  return TRUE;
+}
+
+static void FlushWrittenFiles(Checkpoint* checkpoint) {
+  CpioStringList* list = checkpoint->unflushed;
+
+  for (SIZE_T i = 0; i < list->count; i++) {
+    WCHAR* wideName = CpioStringToWide(list->items[i]);
+    if (!wideName) continue;
+
+    HANDLE hFile = CreateFileW(wideName, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (hFile != INVALID_HANDLE_VALUE) {
+      FlushFileBuffers(hFile);
+      CloseHandle(hFile);
+    }
+    CpioFree(wideName);
+  }
+
+  CpioStringList* fresh = CpioStringListCreate();
+  if (fresh) {
+    CpioStringListDestroy(list);
+    checkpoint->unflushed = fresh;
+  }
+}
+
+static BOOL SaveCheckpoint(Checkpoint* checkpoint) {
+  FlushWrittenFiles(checkpoint);
+
+  checkpoint->record.flushedOffset = checkpoint->lastOffset;
+  checkpoint->record.checksum = ChecksumCheckpoint(&checkpoint->record, checkpoint->name);
+
+  HANDLE hFile = CreateFileW(checkpoint->tempPath, GENERIC_WRITE, 0, NULL,
+    CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return FALSE;
+  }
+
+  DWORD written;
+  BOOL ok = WriteFile(hFile, &checkpoint->record, sizeof(CheckpointRecord), &written, NULL) &&
+    written == sizeof(CheckpointRecord) &&
+    WriteFile(hFile, checkpoint->name, checkpoint->record.nameLength, &written, NULL) &&
+    written == checkpoint->record.nameLength &&
+    FlushFileBuffers(hFile);
+
+  CloseHandle(hFile);
+
+  if (!ok || !MoveFileExW(checkpoint->tempPath, checkpoint->path,
+    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    DeleteFileW(checkpoint->tempPath);
+    return FALSE;
+  }
+
+  checkpoint->bytesSinceSave = 0;
+  checkpoint->lastSave = GetTickCount64();
+  return TRUE;
+}
+
+static void CheckpointAfterEntry(Checkpoint* checkpoint, const CpioEntry* entry, const char* writtenPath,
+  BOOL settled) {
+  checkpoint->membersSeen++;
+  checkpoint->lastOffset = entry->headerOffset;
+
+  if (settled) {
+    SIZE_T nameLength = CpioStringLength(entry->name);
+    CpioCopyMemory(checkpoint->name, entry->name, nameLength + 1);
+    checkpoint->record.nameLength = (UINT32)nameLength;
+    checkpoint->record.headerOffset = entry->headerOffset;
+    checkpoint->record.membersDone = checkpoint->membersSeen;
+  }
+
+  if (writtenPath) {
+    CpioStringListAdd(checkpoint->unflushed, writtenPath);
+    checkpoint->bytesSinceSave += entry->fileSize;
+  }
+
+  if (checkpoint->record.nameLength > 0 && (checkpoint->bytesSinceSave >= CHECKPOINT_INTERVAL_BYTES ||
+    checkpoint->unflushed->count >= CHECKPOINT_INTERVAL_FILES ||
+    GetTickCount64() - checkpoint->lastSave >= CHECKPOINT_INTERVAL_MS)) {
+    if (!SaveCheckpoint(checkpoint)) {
+      WriteStdErrLine("Warning: Failed to write checkpoint");
+    }
+  }
+}
+
+static BOOL ResumeFromCheckpoint(Checkpoint* checkpoint, CpioReader* reader, BOOL verbose) {
+  BOOL found = FALSE;
+  if (!LoadCheckpoint(checkpoint, &found)) {
+    WriteStdErrLine("Error: Checkpoint file is corrupt");
+    return FALSE;
+  }
+
+  if (!found) {
+    return TRUE;
+  }
+
+  CpioError error = { 0 };
+  CpioEntry entry;
+
+  if (!CpioReaderSeek(reader, checkpoint->record.headerOffset, &error) ||
+    !CpioReaderReadNext(reader, &entry, &error) ||
+    CpioStringCompare(entry.name, checkpoint->name) != 0) {
+    WriteStdErrLine("Error: Checkpoint does not match archive");
+    return FALSE;
+  }
+
+  checkpoint->resumed = TRUE;
+  checkpoint->membersSeen = checkpoint->record.membersDone;
+  checkpoint->lastOffset = checkpoint->record.flushedOffset;
+
+  if (verbose) {
+    char count[24];
+    FormatDecimal(count, checkpoint->record.membersDone);
+
+    WriteStdErr("Resuming after ");
+    WriteStdErr(entry.name);
+    WriteStdErr(" (");
+    WriteStdErr(count);
+    WriteStdErrLine(" members done)");
+  }
+
+  return TRUE;
+}
+
+typedef struct {
+  CpioDirCache* dirCache;
+  CpioLinkTable* links;
+  BYTE* compareBuffer;
+  BOOL resumed;
+  BOOL verifying;
+  UINT64 verifyAfter;
+  UINT64 verifyFiles;
+  UINT64 verifyBytes;
+  UINT32 corrupt;
+} ExtractState;
+
+static BOOL ExtractEntry(CpioReader* reader, const CpioEntry* entry, const ExtractOptions* options,
+  ExtractState* state, char* winPath, BOOL* written) {
+  BOOL verbose = options->verbose;
+  CpioError error = { 0 };
+
+  *written = FALSE;
+
+  if (CpioStringCompare(entry->name, ".") == 0 || CpioStringCompare(entry->name, CPIO_TOC_NAME) == 0) {
+    return TRUE;
+  }
+
+  const char* name = entry->name;
+  if (name[0] == '.' && name[1] == '/') {
+    name += 2;
+  }
+
+  if (name[0] == '\0') {
+    return TRUE;
+  }
+
+  if (!CpioMatcherMatch(options->matcher, name)) {
+    return TRUE;
+  }
+
+  SIZE_T j = 0;
+  for (SIZE_T i = 0; name[i] && j < CPIO_MAX_NAME_LENGTH - 1; i++) {
+    winPath[j++] = (name[i] == '/') ? '\\' : name[i];
+  }
+  winPath[j] = '\0';
+
+  WCHAR* wideName = CpioStringToWide(winPath);
+  if (!wideName) {
+    return TRUE;
+  }
+
+  if (entry->mode & CPIO_S_IFDIR) {
+    if (verbose) WriteStdErrLine(winPath);
+    CreateDirectoryW(wideName, NULL);
+    CpioFree(wideName);
+    return TRUE;
+  }
+
+  const CpioDirCacheEntry* existing = CpioDirCacheLookup(state->dirCache, winPath);
+  if (existing && (existing->attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    existing = NULL;
+  }
+
+  if (existing && state->resumed && existing->fileSize != entry->fileSize) {
+    existing = NULL;
+  }
+
+  BOOL unflushed = FALSE;
+  if (state->verifying && entry->headerOffset > state->verifyAfter) {
+    unflushed = TRUE;
+    state->verifyBytes += entry->fileSize;
+    if (++state->verifyFiles >= CHECKPOINT_INTERVAL_FILES || state->verifyBytes >= CHECKPOINT_INTERVAL_BYTES) {
+      state->verifying = FALSE;
+    }
+  }
+
+  if (existing) {
+    BOOL unchanged = options->update && !unflushed &&
+      existing->fileSize == entry->fileSize && existing->mtime == entry->mtime;
+    BOOL newer = options->keepNewer && !unflushed && existing->mtime >= entry->mtime;
+
+    if (unchanged || newer) {
+      if (verbose) {
+        WriteStdErr(winPath);
+        WriteStdErrLine(unchanged ? " (unchanged)" : " (existing file is newer)");
+      }
+      if (entry->fileSize > 0) CpioLinkTableCommit(state->links, entry, wideName, NULL);
+      CpioFree(wideName);
+      return TRUE;
+    }
+
+    if ((options->compareContent || unflushed) && existing->fileSize == entry->fileSize) {
+      BOOL ok = RewriteIfDifferent(reader, wideName, entry, state->compareBuffer,
+        state->compareBuffer + COMPARE_CHUNK_SIZE, written, &error);
+      if (ok) {
+        if (verbose) {
+          WriteStdErr(winPath);
+          WriteStdErrLine(*written ? "" : " (same content)");
+        }
+      }
+      else if (error.code == CPIO_ERROR_CHECKSUM) {
+        WriteStdErr("Error: ");
+        WriteStdErr(winPath);
+        WriteStdErr(": ");
+        WriteStdErrLine(error.message);
+        if (*written) DeleteFileW(wideName);
+        *written = FALSE;
+        state->corrupt++;
+      }
+      else {
+        WriteStdErr("Warning: Cannot update ");
+        WriteStdErr(winPath);
+        WriteStdErr(": ");
+        WriteStdErrLine(error.message);
+      }
+      if (ok && entry->fileSize > 0) CpioLinkTableCommit(state->links, entry, wideName, NULL);
+      CpioFree(wideName);
+      return ok;
+    }
+  }
+
+  if (verbose) WriteStdErrLine(winPath);
+
+  CreateParentDirectories(wideName);
+
+  BOOL linked = FALSE;
+  if (!CpioLinkTableResolve(state->links, entry, wideName, &linked, &error)) {
+    WriteStdErr("Warning: Cannot link ");
+    WriteStdErr(winPath);
+    WriteStdErr(": ");
+    WriteStdErrLine(error.message);
+  }
+
+  if (linked) {
+    CpioFree(wideName);
+    return TRUE;
+  }
+
+  HANDLE hOutFile = CreateFileW(wideName, GENERIC_WRITE, 0, NULL,
+    CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  if (hOutFile == INVALID_HANDLE_VALUE) {
+    WriteStdErr("Warning: Cannot create ");
+    WriteStdErrLine(winPath);
+    CpioFree(wideName);
+    return TRUE;
+  }
+
+  BOOL ok = CpioReaderCopyToHandle(reader, hOutFile, &error);
+  BOOL corrupt = !ok && error.code == CPIO_ERROR_CHECKSUM;
+  if (!ok) {
+    WriteStdErr(corrupt ? "Error: " : "Warning: Cannot write ");
+    WriteStdErr(winPath);
+    WriteStdErr(": ");
+    WriteStdErrLine(error.message);
+  }
+
+  if (options->preserveMtime) {
+    SetFileMtime(hOutFile, entry->mtime);
+  }
+
+  CloseHandle(hOutFile);
+
+  if (corrupt) {
+    DeleteFileW(wideName);
+    CpioFree(wideName);
+    state->corrupt++;
+    return FALSE;
+  }
+
+  if (ok && !CpioLinkTableCommit(state->links, entry, wideName, &error)) {
+    WriteStdErr("Warning: Cannot link to ");
+    WriteStdErr(winPath);
+    WriteStdErr(": ");
+    WriteStdErrLine(error.message);
+  }
+
+  CpioFree(wideName);
+  *written = TRUE;
+  return ok;
+}
+
+static BOOL RecoverFromDamage(CpioReader* reader, UINT32* damaged) {
+  CpioError error = { 0 };
+  UINT64 skippedStart = 0;
+  UINT64 skippedEnd = 0;
+  BOOL found = CpioReaderResync(reader, &skippedStart, &skippedEnd, &error);
+
+  if (skippedEnd <= skippedStart) {
+    return found;
+  }
+
+  (*damaged)++;
+
+  char number[24];
+  WriteStdErr("Warning: Skipped damaged bytes ");
+  FormatDecimal(number, skippedStart);
+  WriteStdErr(number);
+  WriteStdErr("-");
+  FormatDecimal(number, skippedEnd);
+  WriteStdErr(number);
+
+  if (found) {
+    WriteStdErrLine("");
+  }
+  else {
+    WriteStdErr(": ");
+    WriteStdErrLine(error.message);
+  }
+
+  return found;
+}
+
+static int ExtractArchive(const ExtractOptions* options) {
+  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
+  if (hStdin == INVALID_HANDLE_VALUE) {
+    WriteStdErrLine("Error: Cannot get stdin handle");
+    return 1;
+  }
+
+  CpioError error = { 0 };
+  CpioReader* reader = CpioReaderCreate(hStdin, FALSE, &error);
+
+  if (!reader) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    return 1;
+  }
+
+  BOOL verbose = options->verbose;
+
+  if (verbose) {
+    if (CpioReaderGetFormat(reader) == CPIO_FORMAT_ODC) {
+      WriteStdErrLine("Format: ODC");
+    }
+    else if (CpioReaderGetFormat(reader) == CPIO_FORMAT_CRC) {
+      WriteStdErrLine("Format: NewC CRC");
+    }
+    else {
+      WriteStdErrLine("Format: NewC");
+    }
+    if (reader->compression == CPIO_FORMAT_GZIP) WriteStdErrLine("Compression: gzip");
+    if (reader->compression == CPIO_FORMAT_PBZX) WriteStdErrLine("Compression: pbzx");
+    if (reader->compression == CPIO_FORMAT_ZSTD) WriteStdErrLine("Compression: zstd");
+  }
+
+  if (options->checkpointPath && reader->compression != CPIO_FORMAT_UNKNOWN && !CpioReaderIsSeekable(reader)) {
+    WriteStdErrLine("Error: --checkpoint is not supported for compressed archives");
+    CpioReaderDestroy(reader);
+    return 1;
+  }
+
+  ExtractState state = { 0 };
+  Checkpoint checkpoint = { 0 };
+  int exitCode = 0;
+
+  if (options->checkpointPath) {
+    if (!InitCheckpoint(&checkpoint, options->checkpointPath)) {
+      WriteStdErrLine("Error: Failed to initialize checkpoint");
+      CpioReaderDestroy(reader);
+      return 1;
+    }
+
+    if (!ResumeFromCheckpoint(&checkpoint, reader, verbose)) {
+      ReleaseCheckpoint(&checkpoint);
+      CpioReaderDestroy(reader);
+      return 1;
+    }
+    state.resumed = checkpoint.resumed;
+    state.verifying = checkpoint.resumed;
+    state.verifyAfter = checkpoint.record.flushedOffset;
+  }
+
+  if (options->update || options->keepNewer) {
+    state.dirCache = CpioDirCacheCreate();
+    if (!state.dirCache) {
+      WriteStdErrLine("Error: Failed to create directory cache");
+      ReleaseCheckpoint(&checkpoint);
+      CpioReaderDestroy(reader);
+      return 1;
+    }
+  }
+
+  state.links = CpioLinkTableCreate();
+  if (!state.links) {
+    WriteStdErrLine("Error: Failed to create hard link table");
+    CpioDirCacheDestroy(state.dirCache);
+    ReleaseCheckpoint(&checkpoint);
+    CpioReaderDestroy(reader);
+    return 1;
+  }
+
+  if (options->compareContent || (state.verifying && state.dirCache)) {
+    state.compareBuffer = (BYTE*)CpioAlloc(COMPARE_CHUNK_SIZE * 2);
+    if (!state.compareBuffer) {
+      WriteStdErrLine("Error: Failed to allocate compare buffer");
+      CpioLinkTableDestroy(state.links);
+      CpioDirCacheDestroy(state.dirCache);
+      ReleaseCheckpoint(&checkpoint);
+      CpioReaderDestroy(reader);
+      return 1;
+    }
+  }
+
+  CpioEntry entry;
+  char winPath[CPIO_MAX_NAME_LENGTH];
+
+  UINT32 damaged = 0;
+
+  for (;;) {
+    while (CpioReaderReadNext(reader, &entry, &error)) {
+      BOOL written = FALSE;
+      BOOL ok = ExtractEntry(reader, &entry, options, &state, winPath, &written);
+
+      if (options->checkpointPath && ok && CpioReaderFinish(reader, &error)) {
+        CheckpointAfterEntry(&checkpoint, &entry, written ? winPath : NULL, state.links->deferred == 0);
+      }
+    }
+
+    if (!options->recover || CpioReaderIsAtEnd(reader)) break;
+
+    if (!RecoverFromDamage(reader, &damaged)) break;
+  }
+
+  if (CpioReaderIsAtEnd(reader) && !CpioLinkTableFinish(state.links, &error)) {
+    WriteStdErr("Warning: Cannot create hard links: ");
+    WriteStdErrLine(error.message);
+  }
+
+  if (options->checkpointPath) {
+    if (CpioReaderIsAtEnd(reader)) {
+      FlushWrittenFiles(&checkpoint);
+      DeleteFileW(checkpoint.path);
+    }
+    else {
+      if (checkpoint.record.membersDone > 0) {
+        SaveCheckpoint(&checkpoint);
+      }
+      WriteStdErrLine("Error: Archive ended before trailer; rerun with the same checkpoint to resume");
+      exitCode = 1;
+    }
+    ReleaseCheckpoint(&checkpoint);
+  }
+
+  if (damaged > 0) {
+    WriteStdErrLine("Error: Archive is damaged; members in skipped regions were not extracted");
+    exitCode = 1;
+  }
+
+  if (state.corrupt > 0) {
+    WriteStdErrLine("Error: Members that failed checksum verification were not extracted");
+    exitCode = 1;
+  }
+
+  if (!CpioReaderFinishStream(reader, &error)) {
+    WriteStdErr("Error: Compressed archive is damaged: ");
+    WriteStdErrLine(error.message);
+    exitCode = 1;
+  }
+
+  if (state.compareBuffer) CpioFree(state.compareBuffer);
+  CpioLinkTableDestroy(state.links);
+  CpioDirCacheDestroy(state.dirCache);
+  CpioReaderDestroy(reader);
+
+  if (verbose && exitCode == 0) {
+    WriteStdErrLine("Extraction complete");
+  }
+
+  return exitCode;
+}
+
+static BOOL WritePadded(CpioWriter* writer, const char* text, SIZE_T width, BOOL alignRight, CpioError* error) {
+  static const char spaces[] = "                    ";
+  SIZE_T len = CpioStringLength(text);
+  SIZE_T pad = len < width ? width - len : 0;
+
+  if (alignRight && !CpioWriterWrite(writer, spaces, pad, error)) return FALSE;
+  if (!CpioWriterWrite(writer, text, len, error)) return FALSE;
+  if (!alignRight && !CpioWriterWrite(writer, spaces, pad, error)) return FALSE;
+  return TRUE;
+}
+
+static void FormatMode(char* output, UINT32 mode) {
+  switch (mode & CPIO_S_IFMT) {
+  case CPIO_S_IFDIR: output[0] = 'd'; break;
+  case CPIO_S_IFLNK: output[0] = 'l'; break;
+  case CPIO_S_IFCHR: output[0] = 'c'; break;
+  case CPIO_S_IFBLK: output[0] = 'b'; break;
+  case CPIO_S_IFIFO: output[0] = 'p'; break;
+  case CPIO_S_IFSOCK: output[0] = 's'; break;
+  default: output[0] = '-'; break;
+  }
+
+  const char* rwx = "rwxrwxrwx";
+  for (int i = 0; i < 9; i++) {
+    output[i + 1] = (mode & (0x100 >> i)) ? rwx[i] : '-';
+  }
+
+  if (mode & CPIO_S_ISUID) output[3] = (mode & CPIO_S_IXUSR) ? 's' : 'S';
+  if (mode & CPIO_S_ISGID) output[6] = (mode & CPIO_S_IXGRP) ? 's' : 'S';
+  if (mode & CPIO_S_ISVTX) output[9] = (mode & CPIO_S_IXOTH) ? 't' : 'T';
+  output[10] = '\0';
+}
+
+static void FormatTime(char* output, UINT32 unixTime) {
+  ULARGE_INTEGER uli;
+  uli.QuadPart = ((UINT64)unixTime + 11644473600ULL) * 10000000ULL;
+
+  FILETIME ft;
+  ft.dwLowDateTime = uli.LowPart;
+  ft.dwHighDateTime = uli.HighPart;
+
+  SYSTEMTIME st;
+  FileTimeToSystemTime(&ft, &st);
+
+  WORD parts[5] = { st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute };
+  const char separators[5] = { '-', '-', ' ', ':', '\0' };
+  SIZE_T pos = 0;
+
+  for (int i = 0; i < 5; i++) {
+    char digits[24];
+    SIZE_T len = FormatDecimal(digits, parts[i]);
+    if (i > 0 && len < 2) output[pos++] = '0';
+    for (SIZE_T k = 0; k < len; k++) output[pos++] = digits[k];
+    if (separators[i]) output[pos++] = separators[i];
+  }
+  output[pos] = '\0';
+}
+
+static BOOL WriteListEntry(CpioWriter* writer, BOOL longFormat, const char* name, UINT32 mode,
+  UINT32 nlink, UINT32 uid, UINT32 gid, UINT64 fileSize, UINT32 mtime, CpioError* error) {
+  if (longFormat) {
+    char field[32];
+
+    FormatMode(field, mode);
+    if (!CpioWriterWriteString(writer, field, error)) return FALSE;
+
+    FormatDecimal(field, nlink);
+    if (!WritePadded(writer, field, 4, TRUE, error)) return FALSE;
+    if (!CpioWriterWrite(writer, " ", 1, error)) return FALSE;
+
+    FormatDecimal(field, uid);
+    if (!WritePadded(writer, field, 8, FALSE, error)) return FALSE;
+    if (!CpioWriterWrite(writer, " ", 1, error)) return FALSE;
+
+    FormatDecimal(field, gid);
+    if (!WritePadded(writer, field, 8, FALSE, error)) return FALSE;
+
+    FormatDecimal(field, fileSize);
+    if (!WritePadded(writer, field, 12, TRUE, error)) return FALSE;
+    if (!CpioWriterWrite(writer, " ", 1, error)) return FALSE;
+
+    FormatTime(field, mtime);
+    if (!CpioWriterWriteString(writer, field, error)) return FALSE;
+    if (!CpioWriterWrite(writer, " ", 1, error)) return FALSE;
+  }
+
+  if (!CpioWriterWriteString(writer, name, error)) return FALSE;
+  return CpioWriterWrite(writer, "\r\n", 2, error);
+}
+
+typedef struct {
+  CpioWriter* writer;
+  CpioMatcher* matcher;
+  BOOL verbose;
+  CpioError* error;
+} ListContext;
+
+static BOOL ListScannedEntry(void* context, const CpioEntry* entry) {
+  ListContext* list = (ListContext*)context;
+
+  if (CpioStringCompare(entry->name, CPIO_TOC_NAME) == 0) return TRUE;
+  if (!CpioMatcherMatch(list->matcher, entry->name)) return TRUE;
+
+  return WriteListEntry(list->writer, list->verbose, entry->name, entry->mode, entry->nlink,
+    entry->uid, entry->gid, entry->fileSize, entry->mtime, list->error);
+}
+
+static int ListArchive(BOOL verbose, CpioMatcher* matcher, UINT32 jobs, BOOL recover) {
+  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
+  HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (hStdin == INVALID_HANDLE_VALUE || hStdout == INVALID_HANDLE_VALUE) {
+    WriteStdErrLine("Error: Cannot get standard handles");
+    return 1;
+  }
+
+  CpioError error = { 0 };
+  CpioReader* reader = CpioReaderCreate(hStdin, FALSE, &error);
+
+  if (!reader) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    return 1;
+  }
+
+  CpioWriter writer;
+  if (!CpioWriterInit(&writer, hStdout, 0)) {
+    WriteStdErrLine("Error: Failed to create output buffer");
+    CpioReaderDestroy(reader);
+    return 1;
+  }
+
+  int result = 0;
+  UINT32 damaged = 0;
+  BOOL outputOk = TRUE;
+
+  if (jobs > 1 && !recover) {
+    CpioError outputError = { 0 };
+    ListContext context = { &writer, matcher, verbose, &outputError };
+
+    if (!CpioScanArchive(reader, jobs, ListScannedEntry, &context, &error)) {
+      if (outputError.code != CPIO_SUCCESS) {
+        error = outputError;
+        outputOk = FALSE;
+      }
+      else {
+        result = 1;
+      }
+    }
+  }
+  else {
+    CpioSourceSetHeadersOnly(CpioReaderGetSource(reader), TRUE);
+
+    CpioEntry entry;
+
+    for (;;) {
+      while (outputOk && CpioReaderReadNext(reader, &entry, &error)) {
+        if (CpioStringCompare(entry.name, CPIO_TOC_NAME) == 0) continue;
+        if (!CpioMatcherMatch(matcher, entry.name)) continue;
+
+        outputOk = WriteListEntry(&writer, verbose, entry.name, entry.mode, entry.nlink,
+          entry.uid, entry.gid, entry.fileSize, entry.mtime, &error);
+      }
+
+      if (!outputOk || !recover || CpioReaderIsAtEnd(reader)) break;
+
+      if (!CpioWriterFlush(&writer, &error)) {
+        outputOk = FALSE;
+        break;
+      }
+      if (!RecoverFromDamage(reader, &damaged)) break;
+    }
+
+    if (outputOk && !CpioReaderIsAtEnd(reader)) {
+      result = 1;
+    }
+  }
+
+  CpioError streamError = { 0 };
+  BOOL streamOk = CpioReaderFinishStream(reader, &streamError);
+  CpioReaderDestroy(reader);
+
+  if (outputOk) {
+    outputOk = CpioWriterFlush(&writer, &error);
+  }
+  CpioWriterRelease(&writer);
+
+  if (!outputOk) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    return 1;
+  }
+
+  if (!streamOk) {
+    WriteStdErr("Error: Compressed archive is damaged: ");
+    WriteStdErrLine(streamError.message);
+    return 1;
+  }
+
+  if (result != 0) {
+    WriteStdErr("Error: Archive ended before trailer: ");
+    WriteStdErrLine(error.message[0] ? error.message : "unexpected end of input");
+  }
+  else if (damaged > 0) {
+    WriteStdErrLine("Error: Archive is damaged; members in skipped regions were not listed");
+    result = 1;
+  }
+
+  return result;
+}
+
+static void ReportMember(const char* label, const char* path) {
+  WriteStdErr(label);
+  WriteStdErrLine(path);
+}
+
+static UINT32 CompareManifests(const CpioManifest* expected, const CpioManifest* actual, BOOL verbose) {
+  UINT32 problems = 0;
+
+  for (const CpioManifestRecord* record = actual->first; record; record = record->nextInOrder) {
+    const CpioManifestRecord* prior = CpioManifestFind(expected, record->path);
+    if (!prior) {
+      ReportMember("Unexpected: ", record->path);
+      problems++;
+    }
+    else if (prior->fileSize != record->fileSize ||
+      CpioCompareMemory(prior->digest, record->digest, CPIO_SHA256_SIZE) != 0 ||
+      (prior->hasCrc32c && prior->crc32c != record->crc32c)) {
+      ReportMember("Mismatch: ", record->path);
+      problems++;
+    }
+    else if (verbose) {
+      ReportMember("  ok  ", record->path);
+    }
+  }
+
+  for (const CpioManifestRecord* record = expected->first; record; record = record->nextInOrder) {
+    if (!CpioManifestFind(actual, record->path)) {
+      ReportMember("Missing: ", record->path);
+      problems++;
+    }
+  }
+
+  return problems;
+}
+
+static BOOL HashMember(CpioReader* reader, CpioHasher* hasher, const CpioEntry* entry, BYTE* buffer,
+  CpioError* error) {
+  CpioHasherBegin(hasher, entry->name, entry->mtime, entry->inode);
+  if (entry->nlink > 1) {
+    CpioHasherLink(hasher, entry->devMajor, ((UINT64)entry->devMinor << 32) | entry->inode, NULL);
+  }
+
+  DWORD bytesRead;
+  error->code = CPIO_SUCCESS;
+  while ((bytesRead = CpioReaderRead(reader, buffer, CPIO_POOL_BUFFER_SIZE, error)) > 0) {
+    CpioHasherUpdate(hasher, buffer, bytesRead);
+  }
+
+  BOOL ok = error->code == CPIO_SUCCESS;
+  CpioHasherEnd(hasher, ok);
+  return ok;
+}
+
+static int VerifyArchive(const char* manifestPath, UINT32 jobs, BOOL verbose) {
+  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
+  HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (hStdin == INVALID_HANDLE_VALUE || hStdout == INVALID_HANDLE_VALUE) {
+    WriteStdErrLine("Error: Cannot get standard handles");
+    return 1;
+  }
+
+  CpioError error = { 0 };
+  CpioManifest* expected = NULL;
+  if (manifestPath) {
+    WCHAR* wideManifest = CpioStringToWide(manifestPath);
+    expected = CpioManifestCreate();
+    BOOL loaded = wideManifest && expected && CpioManifestLoad(expected, wideManifest, &error);
+    if (wideManifest) CpioFree(wideManifest);
+
+    if (!loaded) {
+      WriteStdErr("Error: Cannot load manifest ");
+      WriteStdErrLine(manifestPath);
+      CpioManifestDestroy(expected);
+      return 1;
+    }
+  }
+
+  CpioReader* reader = CpioReaderCreate(hStdin, FALSE, &error);
+  if (!reader) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    CpioManifestDestroy(expected);
+    return 1;
+  }
+
+  CpioHasher* hasher = CpioHasherCreate(jobs, &error);
+  CpioManifest* actual = CpioManifestCreate();
+  BYTE* buffer = CpioBufferPoolAcquire();
+  if (!hasher || !actual || !buffer) {
+    WriteStdErrLine("Error: Out of memory");
+    if (buffer) CpioBufferPoolRelease(buffer);
+    CpioManifestDestroy(actual);
+    CpioHasherDestroy(hasher);
+    CpioReaderDestroy(reader);
+    CpioManifestDestroy(expected);
+    return 1;
+  }
+
+  int result = 0;
+  CpioEntry entry;
+
+  while (CpioReaderReadNext(reader, &entry, &error)) {
+    if (CpioStringCompare(entry.name, CPIO_TOC_NAME) == 0) continue;
+    if ((entry.mode & CPIO_S_IFMT) != CPIO_S_IFREG) continue;
+
+    if (!HashMember(reader, hasher, &entry, buffer, &error)) {
+      WriteStdErr("Error: ");
+      WriteStdErr(entry.name);
+      WriteStdErr(": ");
+      WriteStdErrLine(error.message);
+      result = 1;
+    }
+  }
+
+  if (!CpioReaderIsAtEnd(reader)) {
+    WriteStdErr("Error: Archive ended before trailer: ");
+    WriteStdErrLine(error.message[0] ? error.message : "unexpected end of input");
+    result = 1;
+  }
+
+  if (!CpioReaderFinishStream(reader, &error)) {
+    WriteStdErr("Error: Compressed archive is damaged: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+
+  CpioBufferPoolRelease(buffer);
+  CpioReaderDestroy(reader);
+
+  if (!CpioHasherFinish(hasher, actual, &error)) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+  else if (expected) {
+    UINT32 problems = CompareManifests(expected, actual, verbose);
+    if (problems > 0) {
+      char number[24];
+      FormatDecimal(number, problems);
+      WriteStdErr("Error: ");
+      WriteStdErr(number);
+      WriteStdErrLine(" member(s) do not match the manifest");
+      result = 1;
+    }
+    else if (verbose && result == 0) {
+      WriteStdErrLine("Archive matches the manifest");
+    }
+  }
+  else if (!CpioManifestWrite(actual, hStdout, &error)) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+
+  CpioHasherDestroy(hasher);
+  CpioManifestDestroy(actual);
+  CpioManifestDestroy(expected);
+  return result;
+}
+
+static int ConvertArchive(CpioFormat format) {
+  HANDLE hStdin = GetStdHandle(STD_INPUT_HANDLE);
+  HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (hStdin == INVALID_HANDLE_VALUE || hStdout == INVALID_HANDLE_VALUE) {
+    WriteStdErrLine("Error: Cannot get standard handles");
+    return 1;
+  }
+
+  CpioError error = { 0 };
+  CpioReader* reader = CpioReaderCreate(hStdin, FALSE, &error);
+  if (!reader) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    return 1;
+  }
+
+  SetFilePointer(hStdout, 0, NULL, FILE_BEGIN);
+
+  int result = 0;
+  if (!CpioConvert(reader, hStdout, format, &error)) {
+    WriteStdErr("Error: Cannot convert archive: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+  else if (!CpioReaderFinishStream(reader, &error)) {
+    WriteStdErr("Error: Compressed archive is damaged: ");
+    WriteStdErrLine(error.message);
+    result = 1;
+  }
+
+  CpioReaderDestroy(reader);
+  return result;
+}
+
+static SIZE_T SplitBatchLine(char* line, char** fields, SIZE_T maxFields) {
+  SIZE_T count = 0;
+  char* p = line;
+
+  while (*p) {
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p || *p == '#') break;
+
+    if (count == maxFields) return maxFields + 1;
+
+    if (*p == '"') {
+      fields[count++] = ++p;
+      while (*p && *p != '"') p++;
+    }
+    else {
+      fields[count++] = p;
+      while (*p && *p != ' ' && *p != '\t') p++;
+    }
+
+    if (*p) *p++ = '\0';
+  }
+
+  return count;
+}
+
+static void FreeBatchJobs(CpioJob* jobs, SIZE_T count) {
+  for (SIZE_T i = 0; i < count; i++) {
+    if (jobs[i].archivePath) CpioFree(jobs[i].archivePath);
+    if (jobs[i].path) CpioFree(jobs[i].path);
+  }
+  CpioFree(jobs);
+}
+
+static int RunBatch(const char* batchPath, UINT32 threads, BOOL useOdc, BOOL preserveMtime, BOOL verbose) {
+  WCHAR* widePath = CpioStringToWide(batchPath);
+  HANDLE hFile = widePath ? CreateFileW(widePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) : INVALID_HANDLE_VALUE;
+  CpioFree(widePath);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    WriteStdErr("Error: Cannot open batch file ");
+    WriteStdErrLine(batchPath);
+    return 1;
+  }
+
+  CpioStringList* lines = ReadLinesFromHandle(hFile);
+  CloseHandle(hFile);
+
+  if (!lines) {
+    WriteStdErrLine("Error: Failed to read batch file");
+    return 1;
+  }
+
+  CpioJob* jobs = (CpioJob*)CpioAlloc(sizeof(CpioJob) * (lines->count + 1));
+  SIZE_T jobCount = 0;
+
+  if (!jobs) {
+    WriteStdErrLine("Error: Out of memory");
+    CpioStringListDestroy(lines);
+    return 1;
+  }
+
+  for (SIZE_T i = 0; i < lines->count; i++) {
+    char* fields[4];
+    SIZE_T fieldCount = SplitBatchLine(lines->items[i], fields, 3);
+    if (fieldCount == 0) continue;
+
+    CpioJob* job = &jobs[jobCount];
+    const char* archive = fields[1];
+    const char* path = fields[2];
+    BOOL valid = fieldCount == 3;
+
+    if (valid && CpioStringCompare(fields[0], "create") == 0) {
+      job->type = CPIO_JOB_CREATE;
+      archive = fields[2];
+      path = fields[1];
+    }
+    else if (valid && CpioStringCompare(fields[0], "extract") == 0) {
+      job->type = CPIO_JOB_EXTRACT;
+    }
+    else if (valid && CpioStringCompare(fields[0], "list") == 0) {
+      job->type = CPIO_JOB_LIST;
+    }
+    else {
+      valid = FALSE;
+    }
+
+    if (!valid) {
+      char number[24];
+      FormatDecimal(number, i + 1);
+      WriteStdErr("Error: Invalid batch job on line ");
+      WriteStdErrLine(number);
+      FreeBatchJobs(jobs, jobCount);
+      CpioStringListDestroy(lines);
+      return 1;
+    }
+
+    job->format = useOdc ? CPIO_FORMAT_ODC : CPIO_FORMAT_NEWC;
+    job->preserveMtime = preserveMtime;
+    job->archivePath = CpioStringToWide(archive);
+    job->path = CpioStringToWide(path);
+    jobCount++;
+
+    if (!job->archivePath || !job->path) {
+      WriteStdErrLine("Error: Out of memory");
+      FreeBatchJobs(jobs, jobCount);
+      CpioStringListDestroy(lines);
+      return 1;
+    }
+  }
+
+  CpioStringListDestroy(lines);
+
+  CpioError error = { 0 };
+  CpioBatch* batch = CpioBatchCreate(threads, &error);
+  if (!batch) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    FreeBatchJobs(jobs, jobCount);
+    return 1;
+  }
+
+  for (SIZE_T i = 0; i < jobCount; i++) {
+    CpioBatchSubmit(batch, &jobs[i]);
+  }
+
+  SIZE_T failed = CpioBatchWait(batch);
+  CpioBatchDestroy(batch);
+
+  static const char* verbs[] = { "create", "extract", "list" };
+
+  for (SIZE_T i = 0; i < jobCount; i++) {
+    const CpioJob* job = &jobs[i];
+    if (job->succeeded && !verbose) continue;
+
+    char* archive = CpioWideToString(job->archivePath);
+    WriteStdErr(job->succeeded ? "  ok   " : "Error: ");
+    WriteStdErr(verbs[job->type]);
+    WriteStdErr(" ");
+    WriteStdErr(archive ? archive : "?");
+
+    if (job->succeeded) {
+      WriteStdErrLine("");
+    }
+    else {
+      WriteStdErr(": ");
+      WriteStdErrLine(job->error.message);
+    }
+    CpioFree(archive);
+  }
+
+  FreeBatchJobs(jobs, jobCount);
+  return failed > 0 ? 1 : 0;
+}
+
+static BOOL HasParentReference(const char* name) {
+  for (const char* p = name; *p;) {
+    if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p[2] == '\0')) return TRUE;
+    while (*p && *p != '/') p++;
+    while (*p == '/') p++;
+  }
+  return FALSE;
+}
+
+static int PassThrough(const char* destDir, UINT32 threads, BOOL preserveMtime, BOOL verbose) {
+  CpioStringList* filenames = ReadFilenamesFromStdin();
+  if (!filenames) {
+    WriteStdErrLine("Error: Failed to read filenames from stdin");
+    return 1;
+  }
+
+  CpioJob* jobs = (CpioJob*)CpioAlloc(sizeof(CpioJob) * (filenames->count + 1));
+  CpioString* target = CpioStringCreate();
+  SIZE_T jobCount = 0;
+  int result = 0;
+
+  WCHAR* root = NULL;
+  if (jobs && target && CpioStringSet(target, destDir, CpioStringLength(destDir))) {
+    for (SIZE_T i = 0; i < target->length; i++) {
+      if (target->data[i] == '/') target->data[i] = '\\';
+    }
+    while (target->length > 1 && target->data[target->length - 1] == '\\') {
+      target->data[--target->length] = '\0';
+    }
+    root = CpioStringToWide(target->data);
+  }
+
+  if (!root) {
+    WriteStdErrLine("Error: Out of memory");
+    CpioStringDestroy(target);
+    CpioStringListDestroy(filenames);
+    if (jobs) CpioFree(jobs);
+    return 1;
+  }
+
+  SIZE_T rootLength = target->length;
+  CreateParentDirectories(root);
+  CreateDirectoryW(root, NULL);
+  CpioFree(root);
+
+  for (SIZE_T i = 0; i < filenames->count; i++) {
+    const char* filename = filenames->items[i];
+    char name[CPIO_MAX_NAME_LENGTH];
+
+    if (!CpioNormalizeArchivePath(filename, name, sizeof(name)) || CpioStringCompare(name, ".") == 0) {
+      continue;
+    }
+
+    const char* relative = name + 2;
+    if (relative[0] != '\0' && relative[1] == ':') {
+      relative += 2;
+      while (*relative == '/') relative++;
+    }
+    if (relative[0] == '\0') continue;
+
+    if (HasParentReference(relative)) {
+      WriteStdErr("Warning: Skipping path outside the destination ");
+      WriteStdErrLine(filename);
+      continue;
+    }
+
+    WCHAR* widePath = CpioStringToWide(filename);
+    if (!widePath) continue;
+
+    DWORD attrs = GetFileAttributesW(widePath);
+    if (attrs == INVALID_FILE_ATTRIBUTES) {
+      WriteStdErr("Warning: Cannot access ");
+      WriteStdErrLine(filename);
+      CpioFree(widePath);
+      continue;
+    }
+
+    target->data[rootLength] = '\0';
+    target->length = rootLength;
+    CpioStringAppendChar(target, '\\');
+    for (const char* p = relative; *p; p++) {
+      CpioStringAppendChar(target, (*p == '/') ? '\\' : *p);
+    }
+
+    WCHAR* wideTarget = CpioStringToWide(target->data);
+    if (!wideTarget) {
+      CpioFree(widePath);
+      result = 1;
+      break;
+    }
+
+    if (attrs & FILE_ATTRIBUTE_DIRECTORY) {
+      if (verbose) {
+        WriteStdErr("  dir  ");
+        WriteStdErrLine(relative);
+      }
+      CreateParentDirectories(wideTarget);
+      CreateDirectoryW(wideTarget, NULL);
+      CpioFree(wideTarget);
+      CpioFree(widePath);
+      continue;
+    }
+
+    CpioJob* job = &jobs[jobCount++];
+    job->type = CPIO_JOB_COPY;
+    job->preserveMtime = preserveMtime;
+    job->archivePath = widePath;
+    job->path = wideTarget;
+  }
+
+  CpioStringDestroy(target);
+  CpioStringListDestroy(filenames);
+
+  if (result != 0) {
+    WriteStdErrLine("Error: Out of memory");
+    FreeBatchJobs(jobs, jobCount);
+    return result;
+  }
+
+  CpioError error = { 0 };
+  CpioBatch* batch = CpioBatchCreate(threads, &error);
+  if (!batch) {
+    WriteStdErr("Error: ");
+    WriteStdErrLine(error.message);
+    FreeBatchJobs(jobs, jobCount);
+    return 1;
+  }
+
+  for (SIZE_T i = 0; i < jobCount; i++) {
+    CpioBatchSubmit(batch, &jobs[i]);
+  }
+
+  SIZE_T failed = CpioBatchWait(batch);
+  CpioBatchDestroy(batch);
+
+  for (SIZE_T i = 0; i < jobCount; i++) {
+    const CpioJob* job = &jobs[i];
+    if (job->succeeded && !verbose) continue;
+
+    char* source = CpioWideToString(job->archivePath);
+    WriteStdErr(job->succeeded ? "  file " : "Error: Cannot copy ");
+    WriteStdErr(source ? source : "?");
+
+    if (job->succeeded) {
+      WriteStdErrLine("");
+    }
+    else {
+      WriteStdErr(": ");
+      WriteStdErrLine(job->error.message);
+    }
+    CpioFree(source);
+  }
+
+  FreeBatchJobs(jobs, jobCount);
+  return failed > 0 ? 1 : 0;
+}
+
+void mainCRTStartup(void) {
+  LPWSTR cmdLine = GetCommandLineW();
+
+  int argc;
+  LPWSTR* argv = CommandLineToArgvW(cmdLine, &argc);
+
+  BOOL createMode = FALSE;
+  BOOL dedupe = FALSE;
+  BOOL gzip = FALSE;
+  int gzipLevel = CPIO_GZIP_DEFAULT_LEVEL;
+  BOOL pbzx = FALSE;
+  BOOL zstd = FALSE;
+  int zstdLevel = CPIO_ZSTD_DEFAULT_LEVEL;
+  BOOL zstdLong = FALSE;
+  BOOL seekable = FALSE;
+  BOOL extractMode = FALSE;
+  BOOL listMode = FALSE;
+  BOOL verifyMode = FALSE;
+  BOOL convertMode = FALSE;
+  char* passThroughDir = NULL;
+  CpioFormat convertFormat = CPIO_FORMAT_UNKNOWN;
+  BOOL verbose = FALSE;
+  BOOL useOdc = FALSE;
+  BOOL useCrc = FALSE;
+  BOOL writeToc = FALSE;
+  BOOL append = FALSE;
+  char* archivePath = NULL;
+  char* manifestPath = NULL;
+  char* hashManifestPath = NULL;
+  char* bomPath = NULL;
+  UINT32 jobs = 0;
+  BOOL recover = FALSE;
+  char* batchPath = NULL;
+  ExtractOptions extractOptions = { 0 };
+  CpioMatcher* matcher = NULL;
+  char* checkpointPath = NULL;
 
   for (int i = 1; i < argc; i++) {
     char arg[256];
@@ -489,14 +2324,175 @@ void mainCRTStartup(void) {
     else if (CpioStringCompare(arg, "-i") == 0 || CpioStringCompare(arg, "--extract") == 0) {
       extractMode = TRUE;
     }
+    else if (CpioStringCompare(arg, "-t") == 0 || CpioStringCompare(arg, "--list") == 0) {
+      listMode = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--verify") == 0) {
+      verifyMode = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--convert") == 0) {
+      convertMode = TRUE;
+    }
+    else if (CpioStringCompare(arg, "-p") == 0 || CpioStringStartsWith(arg, "--pass-through=")) {
+      if (arg[1] == 'p') {
+        if (i + 1 >= argc) {
+          WriteStdErrLine("Error: -p requires a destination directory\n");
+          ExitProcess(1);
+        }
+        passThroughDir = CpioWideToString(argv[++i]);
+      }
+      else {
+        passThroughDir = CpioWideToString(argv[i] + 15);
+      }
+    }
+    else if (CpioStringStartsWith(arg, "--to=")) {
+      const char* format = arg + 5;
+      if (CpioStringCompare(format, "newc") == 0) {
+        convertFormat = CPIO_FORMAT_NEWC;
+      }
+      else if (CpioStringCompare(format, "odc") == 0) {
+        convertFormat = CPIO_FORMAT_ODC;
+      }
+      else if (CpioStringCompare(format, "ustar") == 0) {
+        convertFormat = CPIO_FORMAT_USTAR;
+      }
+      else if (CpioStringCompare(format, "pax") == 0) {
+        convertFormat = CPIO_FORMAT_PAX;
+      }
+      else {
+        WriteStdErrLine("Error: --to must be newc, odc, ustar or pax\n");
+        ExitProcess(1);
+      }
+    }
+    else if (CpioStringCompare(arg, "-tv") == 0 || CpioStringCompare(arg, "-vt") == 0) {
+      listMode = TRUE;
+      verbose = TRUE;
+    }
     else if (CpioStringCompare(arg, "-v") == 0 || CpioStringCompare(arg, "--verbose") == 0) {
       verbose = TRUE;
     }
+    else if (CpioStringCompare(arg, "-m") == 0 || CpioStringCompare(arg, "--preserve-modification-time") == 0) {
+      extractOptions.preserveMtime = TRUE;
+    }
+    else if (CpioStringCompare(arg, "-j") == 0 || CpioStringStartsWith(arg, "--jobs=")) {
+      char value[32];
+      value[0] = '\0';
+
+      if (arg[1] == 'j' && i + 1 < argc) {
+        WideCharToMultiByte(CP_UTF8, 0, argv[++i], -1, value, sizeof(value), NULL, NULL);
+      }
+
+      if (!ParseUInt32(arg[1] == 'j' ? value : arg + 7, &jobs) || jobs == 0) {
+        WriteStdErrLine("Error: -j requires a positive thread count\n");
+        ExitProcess(1);
+      }
+    }
+    else if (CpioStringCompare(arg, "-A") == 0 || CpioStringCompare(arg, "--append") == 0) {
+      append = TRUE;
+    }
+    else if (CpioStringCompare(arg, "-F") == 0 || CpioStringStartsWith(arg, "--file=")) {
+      if (arg[1] == 'F') {
+        if (i + 1 >= argc) {
+          WriteStdErrLine("Error: -F requires an archive path\n");
+          ExitProcess(1);
+        }
+        archivePath = CpioWideToString(argv[++i]);
+      }
+      else {
+        archivePath = CpioWideToString(argv[i] + 7);
+      }
+    }
+    else if (CpioStringCompare(arg, "--recover") == 0) {
+      recover = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--toc") == 0) {
+      writeToc = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--dedupe") == 0) {
+      dedupe = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--gzip") == 0 || CpioStringStartsWith(arg, "--gzip=")) {
+      UINT32 level = CPIO_GZIP_DEFAULT_LEVEL;
+      if (arg[6] == '=' && (!ParseUInt32(arg + 7, &level) || level > 9)) {
+        WriteStdErrLine("Error: --gzip level must be between 0 and 9\n");
+        ExitProcess(1);
+      }
+      gzip = TRUE;
+      gzipLevel = (int)level;
+    }
+    else if (CpioStringCompare(arg, "--pbzx") == 0) {
+      pbzx = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--zstd") == 0 || CpioStringStartsWith(arg, "--zstd=")) {
+      UINT32 level = CPIO_ZSTD_DEFAULT_LEVEL;
+      if (arg[6] == '=' && (!ParseUInt32(arg + 7, &level) || level < 1 || level > CPIO_ZSTD_MAX_LEVEL)) {
+        WriteStdErrLine("Error: --zstd level must be between 1 and 9\n");
+        ExitProcess(1);
+      }
+      zstd = TRUE;
+      zstdLevel = (int)level;
+    }
+    else if (CpioStringCompare(arg, "--long") == 0) {
+      zstdLong = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--seekable") == 0) {
+      seekable = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--update") == 0) {
+      extractOptions.update = TRUE;
+    }
+    else if (CpioStringCompare(arg, "--keep-newer") == 0) {
+      extractOptions.keepNewer = TRUE;
+    }
+    else if (CpioStringStartsWith(arg, "--batch=")) {
+      batchPath = CpioWideToString(argv[i] + 8);
+    }
+    else if (CpioStringStartsWith(arg, "--since-manifest=")) {
+      manifestPath = CpioWideToString(argv[i] + 17);
+    }
+    else if (CpioStringStartsWith(arg, "--bom=")) {
+      bomPath = CpioWideToString(argv[i] + 6);
+    }
+    else if (CpioStringStartsWith(arg, "--manifest=")) {
+      hashManifestPath = CpioWideToString(argv[i] + 11);
+    }
+    else if (CpioStringStartsWith(arg, "--checkpoint=")) {
+      checkpointPath = CpioWideToString(argv[i] + 13);
+    }
+    else if (CpioStringCompare(arg, "--compare-content") == 0) {
+      extractOptions.update = TRUE;
+      extractOptions.compareContent = TRUE;
+    }
     else if (CpioStringStartsWith(arg, "--format=")) {
       const char* format = arg + 9;
       if (CpioStringCompare(format, "odc") == 0 || CpioStringCompare(format, "ODC") == 0) {
         useOdc = TRUE;
       }
+      else if (CpioStringCompare(format, "crc") == 0 || CpioStringCompare(format, "CRC") == 0) {
+        useCrc = TRUE;
+      }
+    }
+    else if (CpioStringStartsWith(arg, "--exclude=") || CpioStringStartsWith(arg, "--pattern-file=") ||
+      arg[0] != '-') {
+      char* fullArg = CpioWideToString(argv[i]);
+      BOOL ok = FALSE;
+
+      if (fullArg) {
+        if (CpioStringStartsWith(fullArg, "--exclude=")) {
+          ok = AddPattern(&matcher, fullArg + 10, TRUE);
+        }
+        else if (CpioStringStartsWith(fullArg, "--pattern-file=")) {
+          ok = AddPatternFile(&matcher, fullArg + 15);
+        }
+        else {
+          ok = AddPattern(&matcher, fullArg, FALSE);
+        }
+        CpioFree(fullArg);
+      }
+
+      if (!ok) {
+        ExitProcess(1);
+      }
     }
     else if (CpioStringCompare(arg, "-h") == 0 || CpioStringCompare(arg, "--help") == 0) {
       PrintUsage();
@@ -504,26 +2500,249 @@ void mainCRTStartup(void) {
     }
   }
 
-  if (!createMode && !extractMode) {
-    WriteStdErrLine("Error: Must specify -o (create) or -i (extract)\n");
+  if ((extractOptions.update || extractOptions.keepNewer || extractOptions.compareContent) && !extractMode) {
+    WriteStdErrLine("Error: --update, --keep-newer and --compare-content are only supported with -i\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (batchPath) {
+    if (createMode || extractMode || listMode || matcher || checkpointPath || writeToc || recover ||
+      append || archivePath || manifestPath || dedupe || gzip || pbzx || zstd || verifyMode ||
+      hashManifestPath || bomPath || convertMode || passThroughDir) {
+      WriteStdErrLine("Error: --batch cannot be combined with -o, -i, -t, -p, --verify, --convert or their options\n");
+      PrintUsage();
+      ExitProcess(1);
+    }
+
+    ExitProcess(RunBatch(batchPath, jobs, useOdc, extractOptions.preserveMtime, verbose));
+  }
+
+  if (passThroughDir) {
+    if (createMode || extractMode || listMode || verifyMode || convertMode || matcher || checkpointPath ||
+      writeToc || recover || append || archivePath || manifestPath || dedupe || gzip || pbzx || zstd ||
+      hashManifestPath || bomPath) {
+      WriteStdErrLine("Error: -p only accepts -m, -j and -v\n");
+      PrintUsage();
+      ExitProcess(1);
+    }
+
+    int passThroughResult = PassThrough(passThroughDir, jobs, extractOptions.preserveMtime, verbose);
+    CpioFree(passThroughDir);
+    ExitProcess(passThroughResult);
+  }
+
+  if (convertFormat != CPIO_FORMAT_UNKNOWN && !convertMode) {
+    WriteStdErrLine("Error: --to is only supported with --convert\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (convertMode) {
+    if (createMode || extractMode || listMode || verifyMode || matcher || checkpointPath || writeToc ||
+      recover || append || archivePath || manifestPath || dedupe || gzip || pbzx || zstd ||
+      hashManifestPath || bomPath) {
+      WriteStdErrLine("Error: --convert only accepts --to\n");
+      PrintUsage();
+      ExitProcess(1);
+    }
+
+    if (convertFormat == CPIO_FORMAT_UNKNOWN) {
+      WriteStdErrLine("Error: --convert requires --to=newc, odc, ustar or pax\n");
+      PrintUsage();
+      ExitProcess(1);
+    }
+
+    ExitProcess(ConvertArchive(convertFormat));
+  }
+
+  if (verifyMode) {
+    if (createMode || extractMode || listMode || matcher || checkpointPath || writeToc || recover ||
+      append || archivePath || manifestPath || dedupe || gzip || pbzx || zstd || bomPath) {
+      WriteStdErrLine("Error: --verify only accepts --manifest, -j and -v\n");
+      PrintUsage();
+      ExitProcess(1);
+    }
+
+    int verifyResult = VerifyArchive(hashManifestPath, jobs, verbose);
+    if (hashManifestPath) CpioFree(hashManifestPath);
+    ExitProcess(verifyResult);
+  }
+
+  if (!createMode && !extractMode && !listMode) {
+    WriteStdErrLine("Error: Must specify -o (create), -i (extract), -t (list), -p (pass-through), --verify or --convert\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (createMode && (extractMode || listMode)) {
+    WriteStdErrLine("Error: Cannot combine -o with -i or -t\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (createMode && matcher) {
+    WriteStdErrLine("Error: Patterns are only supported with -i and -t\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (writeToc && (!createMode || useOdc)) {
+    WriteStdErrLine("Error: --toc is only supported with -o --format=newc\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if ((append || archivePath) && !createMode) {
+    WriteStdErrLine("Error: -A and -F are only supported with -o\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (dedupe && !createMode) {
+    WriteStdErrLine("Error: --dedupe is only supported with -o\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (gzip && !createMode) {
+    WriteStdErrLine("Error: --gzip is only supported with -o; compressed input is detected automatically\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (pbzx && (!createMode || useOdc)) {
+    WriteStdErrLine("Error: --pbzx is only supported with -o --format=newc; pbzx input is detected automatically\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (bomPath && (!createMode || useOdc || append)) {
+    WriteStdErrLine("Error: --bom is only supported with -o --format=newc and without -A\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (pbzx && gzip) {
+    WriteStdErrLine("Error: Cannot combine --gzip with --pbzx\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (zstd && !createMode) {
+    WriteStdErrLine("Error: --zstd is only supported with -o; compressed input is detected automatically\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (zstd && (gzip || pbzx)) {
+    WriteStdErrLine("Error: Cannot combine --zstd with --gzip or --pbzx\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if ((zstdLong || seekable) && !zstd) {
+    WriteStdErrLine("Error: --long and --seekable require --zstd\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (zstdLong && seekable) {
+    WriteStdErrLine("Error: Cannot combine --long with --seekable\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (seekable && useOdc) {
+    WriteStdErrLine("Error: --seekable is only supported with --format=newc\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if ((gzip || pbzx || zstd) && append) {
+    WriteStdErrLine("Error: Cannot append to a compressed archive\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (manifestPath && !createMode) {
+    WriteStdErrLine("Error: --since-manifest is only supported with -o\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (hashManifestPath && !createMode) {
+    WriteStdErrLine("Error: --manifest is only supported with -o and --verify\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (hashManifestPath && manifestPath) {
+    WriteStdErrLine("Error: Cannot combine --manifest with --since-manifest\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (append && !archivePath) {
+    WriteStdErrLine("Error: -A requires the archive to be named with -F\n");
+    PrintUsage();
+    ExitProcess(1);
+  }
+
+  if (recover && createMode) {
+    WriteStdErrLine("Error: --recover is only supported with -i and -t\n");
     PrintUsage();
     ExitProcess(1);
   }
 
-  if (createMode && extractMode) {
-    WriteStdErrLine("Error: Cannot specify both -o and -i\n");
+  if (checkpointPath && !extractMode) {
+    WriteStdErrLine("Error: --checkpoint is only supported with -i\n");
     PrintUsage();
     ExitProcess(1);
   }
 
   int exitCode;
   if (createMode) {
-    exitCode = CreateArchive(verbose, useOdc);
+    CreateOptions createOptions = { 0 };
+    createOptions.append = append;
+    createOptions.verbose = verbose;
+    createOptions.useOdc = useOdc;
+    createOptions.useCrc = useCrc;
+    createOptions.writeToc = writeToc;
+    createOptions.dedupe = dedupe;
+    createOptions.gzip = gzip;
+    createOptions.gzipLevel = gzipLevel;
+    createOptions.pbzx = pbzx;
+    createOptions.zstd = zstd;
+    createOptions.zstdLevel = zstdLevel;
+    createOptions.zstdMode = zstdLong ? CPIO_ZSTD_LONG : seekable ? CPIO_ZSTD_SEEKABLE : CPIO_ZSTD_FRAMED;
+    createOptions.jobs = jobs;
+    createOptions.manifestPath = manifestPath;
+    createOptions.hashManifestPath = hashManifestPath;
+    createOptions.bomPath = bomPath;
+    exitCode = CreateArchive(archivePath, &createOptions);
+  }
+  else if (listMode) {
+    exitCode = ListArchive(verbose, matcher, jobs, recover);
   }
   else {
-    exitCode = ExtractArchive(verbose);
+    extractOptions.verbose = verbose;
+    extractOptions.matcher = matcher;
+    extractOptions.checkpointPath = checkpointPath;
+    extractOptions.recover = recover;
+    if (extractOptions.update || extractOptions.keepNewer) {
+      extractOptions.preserveMtime = TRUE;
+    }
+    exitCode = ExtractArchive(&extractOptions);
   }
 
+  CpioMatcherDestroy(matcher);
+  if (checkpointPath) CpioFree(checkpointPath);
+  if (archivePath) CpioFree(archivePath);
+  if (manifestPath) CpioFree(manifestPath);
+  if (hashManifestPath) CpioFree(hashManifestPath);
+  if (bomPath) CpioFree(bomPath);
+
   LocalFree(argv);
   ExitProcess(exitCode);
 }
\ No newline at end of file
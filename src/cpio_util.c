@@ -32,6 +32,43 @@ void CpioCopyMemory(void* dest, const void* src, SIZE_T size) {
     }
 }
 
+typedef struct CpioPoolNode {
+    struct CpioPoolNode* next;
+} CpioPoolNode;
+
+static SRWLOCK poolLock = SRWLOCK_INIT;
+static CpioPoolNode* poolFree = NULL;
+static UINT32 poolFreeCount = 0;
+
+BYTE* CpioBufferPoolAcquire(void) {
+    AcquireSRWLockExclusive(&poolLock);
+    CpioPoolNode* node = poolFree;
+    if (node) {
+        poolFree = node->next;
+        poolFreeCount--;
+    }
+    ReleaseSRWLockExclusive(&poolLock);
+
+    if (node) return (BYTE*)node;
+    return (BYTE*)HeapAlloc(GetProcessHeap(), 0, CPIO_POOL_BUFFER_SIZE);
+}
+
+void CpioBufferPoolRelease(BYTE* buffer) {
+    if (!buffer) return;
+
+    AcquireSRWLockExclusive(&poolLock);
+    if (poolFreeCount < CPIO_POOL_MAX_FREE) {
+        CpioPoolNode* node = (CpioPoolNode*)buffer;
+        node->next = poolFree;
+        poolFree = node;
+        poolFreeCount++;
+        buffer = NULL;
+    }
+    ReleaseSRWLockExclusive(&poolLock);
+
+    if (buffer) CpioFree(buffer);
+}
+
 int CpioCompareMemory(const void* ptr1, const void* ptr2, SIZE_T size) {
     const unsigned char* p1 = (const unsigned char*)ptr1;
     const unsigned char* p2 = (const unsigned char*)ptr2;
@@ -376,13 +413,12 @@ BOOL CpioNormalizeArchivePath(const char* path, char* output, SIZE_T outputSize)
     return TRUE;
 }
 
-CpioFormat CpioDetectFormat(HANDLE hFile, CpioError* error) {
+CpioFormat CpioReadFormat(HANDLE hFile, BYTE* magic, CpioError* error) {
     if (hFile == INVALID_HANDLE_VALUE) {
         CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Invalid file handle");
         return CPIO_FORMAT_UNKNOWN;
     }
     
-    char magic[CPIO_MAGIC_SIZE];
     DWORD bytesRead;
     
     if (!ReadFile(hFile, magic, CPIO_MAGIC_SIZE, &bytesRead, NULL)) {
@@ -396,13 +432,26 @@ CpioFormat CpioDetectFormat(HANDLE hFile, CpioError* error) {
     
     if (CpioCompareMemory(magic, "070701", 6) == 0) {
         return CPIO_FORMAT_NEWC;
+    } else if (CpioCompareMemory(magic, "070702", 6) == 0) {
+        return CPIO_FORMAT_CRC;
     } else if (CpioCompareMemory(magic, "070707", 6) == 0) {
         return CPIO_FORMAT_ODC;
+    } else if (magic[0] == 0x1F && magic[1] == 0x8B && magic[2] == 8) {
+        return CPIO_FORMAT_GZIP;
+    } else if (CpioCompareMemory(magic, CPIO_PBZX_MAGIC, 4) == 0) {
+        return CPIO_FORMAT_PBZX;
+    } else if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+        return CPIO_FORMAT_ZSTD;
     }
     
     return CPIO_FORMAT_UNKNOWN;
 }
 
+CpioFormat CpioDetectFormat(HANDLE hFile, CpioError* error) {
+    BYTE magic[CPIO_MAGIC_SIZE];
+    return CpioReadFormat(hFile, magic, error);
+}
+
 void* memcpy(void* dest, const void* src, SIZE_T size) {
   return CpioCopyMemory(dest, src, size), dest;
 }
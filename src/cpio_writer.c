@@ -0,0 +1,100 @@
+#include "cpio.h"
+
+BOOL CpioWriterInit(CpioWriter* writer, HANDLE hFile, SIZE_T bufferSize) {
+    if (!writer || hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+    CpioZeroMemory(writer, sizeof(CpioWriter));
+    writer->hFile = hFile;
+
+    if (bufferSize == 0) {
+        bufferSize = CPIO_WRITER_BUFFER_SIZE;
+    }
+
+    writer->buffer = (BYTE*)CpioAlloc(bufferSize);
+    if (!writer->buffer) return FALSE;
+
+    writer->bufferSize = bufferSize;
+    return TRUE;
+}
+
+void CpioWriterRelease(CpioWriter* writer) {
+    if (!writer) return;
+
+    if (writer->buffer) {
+        CpioFree(writer->buffer);
+    }
+
+    CpioZeroMemory(writer, sizeof(CpioWriter));
+    writer->hFile = INVALID_HANDLE_VALUE;
+}
+
+static BOOL WriteThrough(CpioWriter* writer, const BYTE* data, SIZE_T size, CpioError* error) {
+    while (size > 0) {
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD bytesWritten;
+
+        if (!WriteFile(writer->hFile, data, chunk, &bytesWritten, NULL) || bytesWritten != chunk) {
+            writer->failed = TRUE;
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write output");
+            return FALSE;
+        }
+
+        data += chunk;
+        size -= chunk;
+    }
+
+    return TRUE;
+}
+
+BOOL CpioWriterFlush(CpioWriter* writer, CpioError* error) {
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL writer");
+        return FALSE;
+    }
+
+    if (writer->failed) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Output already failed");
+        return FALSE;
+    }
+
+    if (writer->bufferLength == 0) return TRUE;
+
+    BOOL ok = WriteThrough(writer, writer->buffer, writer->bufferLength, error);
+    writer->bufferLength = 0;
+    return ok;
+}
+
+BOOL CpioWriterWrite(CpioWriter* writer, const void* data, SIZE_T size, CpioError* error) {
+    if (!writer || (!data && size > 0)) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL parameter");
+        return FALSE;
+    }
+
+    if (writer->failed) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Output already failed");
+        return FALSE;
+    }
+
+    const BYTE* bytes = (const BYTE*)data;
+    writer->totalWritten += size;
+
+    if (writer->bufferLength + size <= writer->bufferSize) {
+        CpioCopyMemory(writer->buffer + writer->bufferLength, bytes, size);
+        writer->bufferLength += size;
+        return TRUE;
+    }
+
+    if (!CpioWriterFlush(writer, error)) return FALSE;
+
+    if (size >= writer->bufferSize) {
+        return WriteThrough(writer, bytes, size, error);
+    }
+
+    CpioCopyMemory(writer->buffer, bytes, size);
+    writer->bufferLength = size;
+    return TRUE;
+}
+
+BOOL CpioWriterWriteString(CpioWriter* writer, const char* str, CpioError* error) {
+    return CpioWriterWrite(writer, str, CpioStringLength(str), error);
+}
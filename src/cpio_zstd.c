@@ -0,0 +1,2014 @@
+#include "cpio.h"
+#include <intrin.h>
+
+#define ZSTD_MAGIC 0xFD2FB528
+#define ZSTD_SKIPPABLE_MAGIC 0x184D2A50
+#define ZSTD_SKIPPABLE_MASK 0xFFFFFFF0
+#define ZSTD_MIN_MATCH 4
+#define ZSTD_BLOCK_RAW 0
+#define ZSTD_BLOCK_RLE 1
+#define ZSTD_BLOCK_COMPRESSED 2
+#define ZSTD_LITERALS_RAW 0
+#define ZSTD_LITERALS_RLE 1
+#define ZSTD_LITERALS_COMPRESSED 2
+#define ZSTD_LITERALS_TREELESS 3
+#define ZSTD_MODE_PREDEFINED 0
+#define ZSTD_MODE_RLE 1
+#define ZSTD_MODE_FSE 2
+#define ZSTD_MODE_REPEAT 3
+#define ZSTD_HUFFMAN_MAX_BITS 11
+#define ZSTD_HUFFMAN_MIN_LITERALS 64
+#define ZSTD_WEIGHTS_MAX_LOG 6
+#define ZSTD_MAX_SEQUENCES (CPIO_ZSTD_BLOCK_SIZE / 3 + 1)
+#define ZSTD_HASH_SIZE (1 << CPIO_ZSTD_HASH_BITS)
+#define ZSTD_CHAIN_SIZE (1 << CPIO_ZSTD_CHAIN_LOG)
+#define ZSTD_LL 0
+#define ZSTD_OF 1
+#define ZSTD_ML 2
+
+typedef struct {
+    UINT32 chainLength;
+    UINT32 niceLength;
+    BOOL lazy;
+} ZstdLevel;
+
+static const ZstdLevel Levels[CPIO_ZSTD_MAX_LEVEL + 1] = {
+    { 1, 16, FALSE },
+    { 1, 16, FALSE },
+    { 2, 24, FALSE },
+    { 4, 32, TRUE },
+    { 8, 48, TRUE },
+    { 16, 64, TRUE },
+    { 32, 96, TRUE },
+    { 64, 128, TRUE },
+    { 128, 256, TRUE },
+    { 256, 512, TRUE },
+};
+
+static const UINT32 LitLengthBase[36] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+    8192, 16384, 32768, 65536
+};
+
+static const BYTE LitLengthBits[36] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+    13, 14, 15, 16
+};
+
+static const UINT32 MatchLengthBase[53] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+    19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+    35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+    4099, 8195, 16387, 32771, 65539
+};
+
+static const BYTE MatchLengthBits[53] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+    12, 13, 14, 15, 16
+};
+
+static const BYTE LitLengthCodes[64] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 20, 20, 21, 21, 21, 21,
+    22, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 23,
+    24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24
+};
+
+static const BYTE MatchLengthCodes[128] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 32, 33, 33, 34, 34, 35, 35, 36, 36, 36, 36, 37, 37, 37, 37,
+    38, 38, 38, 38, 38, 38, 38, 38, 39, 39, 39, 39, 39, 39, 39, 39,
+    40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40,
+    41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+    42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+    42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42
+};
+
+static const SHORT LitLengthDefault[36] = {
+    4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+    -1, -1, -1, -1
+};
+
+static const SHORT MatchLengthDefault[53] = {
+    1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+    -1, -1, -1, -1, -1
+};
+
+static const SHORT OffsetDefault[29] = {
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+typedef struct {
+    const SHORT* defaults;
+    UINT32 defaultMax;
+    UINT32 defaultLog;
+    UINT32 maxSymbol;
+    UINT32 maxLog;
+} ZstdSymbolKind;
+
+static const ZstdSymbolKind SymbolKinds[3] = {
+    { LitLengthDefault, 35, 6, 35, 9 },
+    { OffsetDefault, 28, 5, 31, 8 },
+    { MatchLengthDefault, 52, 6, 52, 9 },
+};
+
+static UINT32 HighBit(UINT32 value) {
+    unsigned long bit;
+    _BitScanReverse(&bit, value);
+    return (UINT32)bit;
+}
+
+static UINT32 GetLittleEndian32(const BYTE* p) {
+    return (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+static void PutLittleEndian32(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)value;
+    p[1] = (BYTE)(value >> 8);
+    p[2] = (BYTE)(value >> 16);
+    p[3] = (BYTE)(value >> 24);
+}
+
+static void PutLittleEndian24(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)value;
+    p[1] = (BYTE)(value >> 8);
+    p[2] = (BYTE)(value >> 16);
+}
+
+static SIZE_T MatchLength(const BYTE* a, const BYTE* b, SIZE_T maxLength) {
+    SIZE_T length = 0;
+
+    while (length + 8 <= maxLength) {
+        UINT64 diff = *(const UINT64*)(a + length) ^ *(const UINT64*)(b + length);
+        if (diff) {
+            unsigned long index;
+            _BitScanForward64(&index, diff);
+            return length + (index >> 3);
+        }
+        length += 8;
+    }
+
+    while (length < maxLength && a[length] == b[length]) length++;
+    return length;
+}
+
+static void CopyBytes(BYTE* dst, const BYTE* src, SIZE_T length) {
+    if (dst - src >= 8) {
+        while (length >= 8) {
+            *(UINT64*)dst = *(const UINT64*)src;
+            dst += 8;
+            src += 8;
+            length -= 8;
+        }
+    }
+    while (length--) *dst++ = *src++;
+}
+
+static UINT32 ResolveOffset(UINT32* reps, UINT32 offBase, UINT32 litLength) {
+    if (offBase > 3) {
+        reps[2] = reps[1];
+        reps[1] = reps[0];
+        reps[0] = offBase - 3;
+        return reps[0];
+    }
+
+    UINT32 index = offBase - 1 + (litLength == 0);
+    if (index == 0) return reps[0];
+
+    UINT32 offset = index == 3 ? reps[0] - 1 : reps[index];
+    if (index != 1) reps[2] = reps[1];
+    reps[1] = reps[0];
+    reps[0] = offset;
+    return offset;
+}
+
+typedef struct {
+    BYTE* start;
+    BYTE* ptr;
+    BYTE* end;
+    UINT64 bits;
+    UINT32 count;
+    BOOL overflow;
+} BitWriter;
+
+static void BitInit(BitWriter* w, BYTE* output, SIZE_T capacity) {
+    w->start = output;
+    w->ptr = output;
+    w->end = output + capacity;
+    w->bits = 0;
+    w->count = 0;
+    w->overflow = FALSE;
+}
+
+static void BitFlush(BitWriter* w) {
+    while (w->count >= 8) {
+        if (w->ptr < w->end) {
+            *w->ptr++ = (BYTE)w->bits;
+        } else {
+            w->overflow = TRUE;
+        }
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+static void BitAdd(BitWriter* w, UINT64 value, UINT32 count) {
+    if (w->count >= 32) BitFlush(w);
+    w->bits |= (value & (((UINT64)1 << count) - 1)) << w->count;
+    w->count += count;
+}
+
+static SIZE_T BitFinish(BitWriter* w) {
+    BitFlush(w);
+    if (w->count > 0) {
+        w->count = 8;
+        BitFlush(w);
+        w->count = 0;
+    }
+    return w->overflow ? 0 : (SIZE_T)(w->ptr - w->start);
+}
+
+static SIZE_T BitClose(BitWriter* w) {
+    BitAdd(w, 1, 1);
+    return BitFinish(w);
+}
+
+typedef struct {
+    const BYTE* start;
+    const BYTE* ptr;
+    UINT64 bits;
+    UINT32 consumed;
+} BitReader;
+
+static BOOL BitReaderInit(BitReader* r, const BYTE* data, SIZE_T length) {
+    if (length == 0 || data[length - 1] == 0) return FALSE;
+
+    r->start = data;
+    if (length >= 8) {
+        r->ptr = data + length - 8;
+        r->bits = *(const UINT64*)r->ptr;
+        r->consumed = 0;
+    } else {
+        r->ptr = data;
+        r->bits = 0;
+        for (SIZE_T i = 0; i < length; i++) {
+            r->bits |= (UINT64)data[i] << (i * 8);
+        }
+        r->consumed = (UINT32)(8 - length) * 8;
+    }
+
+    r->consumed += 8 - HighBit(data[length - 1]);
+    return TRUE;
+}
+
+static UINT32 BitPeek(const BitReader* r, UINT32 count) {
+    if (count == 0 || r->consumed >= 64) return 0;
+    return (UINT32)((r->bits << r->consumed) >> (64 - count));
+}
+
+static UINT32 BitRead(BitReader* r, UINT32 count) {
+    UINT32 value = BitPeek(r, count);
+    r->consumed += count;
+    return value;
+}
+
+static void BitReload(BitReader* r) {
+    if (r->consumed > 64) return;
+
+    if (r->ptr >= r->start + 8) {
+        r->ptr -= r->consumed >> 3;
+        r->consumed &= 7;
+    } else {
+        if (r->ptr == r->start) return;
+
+        SIZE_T bytes = r->consumed >> 3;
+        if (bytes > (SIZE_T)(r->ptr - r->start)) bytes = (SIZE_T)(r->ptr - r->start);
+        r->ptr -= bytes;
+        r->consumed -= (UINT32)bytes * 8;
+    }
+
+    r->bits = *(const UINT64*)r->ptr;
+}
+
+static BOOL BitFinished(const BitReader* r) {
+    return r->ptr == r->start && r->consumed == 64;
+}
+
+static BOOL SpreadSymbols(const SHORT* norm, UINT32 maxSymbol, UINT32 log, BYTE* symbols) {
+    UINT32 size = 1u << log;
+    UINT32 high = size - 1;
+
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        if (norm[s] == -1) symbols[high--] = (BYTE)s;
+    }
+
+    UINT32 step = (size >> 1) + (size >> 3) + 3;
+    UINT32 mask = size - 1;
+    UINT32 pos = 0;
+
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        for (SHORT i = 0; i < norm[s]; i++) {
+            symbols[pos] = (BYTE)s;
+            do {
+                pos = (pos + step) & mask;
+            } while (pos > high);
+        }
+    }
+
+    return pos == 0;
+}
+
+static BOOL BuildDecodeTable(CpioZstdFseEntry* table, const SHORT* norm, UINT32 maxSymbol, UINT32 log) {
+    BYTE symbols[512];
+    UINT32 next[64];
+
+    if (!SpreadSymbols(norm, maxSymbol, log, symbols)) return FALSE;
+
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        next[s] = norm[s] == -1 ? 1 : (UINT32)(norm[s] > 0 ? norm[s] : 0);
+    }
+
+    UINT32 size = 1u << log;
+    for (UINT32 u = 0; u < size; u++) {
+        UINT32 s = symbols[u];
+        UINT32 state = next[s]++;
+        UINT32 bits = log - HighBit(state);
+        table[u].symbol = (BYTE)s;
+        table[u].bits = (BYTE)bits;
+        table[u].base = (UINT16)((state << bits) - size);
+    }
+
+    return TRUE;
+}
+
+static UINT32 ReadForward(const BYTE* data, SIZE_T length, SIZE_T bitPos) {
+    UINT64 value = 0;
+    SIZE_T byte = bitPos >> 3;
+
+    for (UINT32 i = 0; i < 5 && byte + i < length; i++) {
+        value |= (UINT64)data[byte + i] << (i * 8);
+    }
+    return (UINT32)(value >> (bitPos & 7));
+}
+
+static BOOL ReadNormalized(const BYTE* data, SIZE_T length, SHORT* norm, UINT32 maxSymbol, UINT32 maxLog,
+                           UINT32* log, SIZE_T* consumed) {
+    if (length == 0) return FALSE;
+
+    SIZE_T bitLimit = length * 8;
+    UINT32 tableLog = (data[0] & 0xF) + 5;
+    if (tableLog > maxLog) return FALSE;
+
+    SIZE_T bitPos = 4;
+    INT32 remaining = (1 << tableLog) + 1;
+    INT32 threshold = 1 << tableLog;
+    UINT32 nbBits = tableLog + 1;
+    UINT32 symbol = 0;
+    BOOL previousZero = FALSE;
+
+    while (remaining > 1 && symbol <= maxSymbol) {
+        if (previousZero) {
+            UINT32 target = symbol;
+            UINT32 bits = ReadForward(data, length, bitPos);
+
+            while ((bits & 0xFFFF) == 0xFFFF) {
+                target += 24;
+                bitPos += 16;
+                if (bitPos > bitLimit) return FALSE;
+                bits = ReadForward(data, length, bitPos);
+            }
+            while ((bits & 3) == 3) {
+                target += 3;
+                bitPos += 2;
+                bits >>= 2;
+            }
+            target += bits & 3;
+            bitPos += 2;
+
+            if (target > maxSymbol || bitPos > bitLimit) return FALSE;
+            while (symbol < target) norm[symbol++] = 0;
+        }
+
+        UINT32 bits = ReadForward(data, length, bitPos);
+        INT32 max = (2 * threshold - 1) - remaining;
+        INT32 count;
+
+        if ((INT32)(bits & (threshold - 1)) < max) {
+            count = (INT32)(bits & (threshold - 1));
+            bitPos += nbBits - 1;
+        } else {
+            count = (INT32)(bits & (2 * threshold - 1));
+            if (count >= threshold) count -= max;
+            bitPos += nbBits;
+        }
+
+        count--;
+        remaining -= count < 0 ? -count : count;
+        norm[symbol++] = (SHORT)count;
+        previousZero = count == 0;
+
+        if (remaining < 1 || bitPos > bitLimit) return FALSE;
+        while (remaining < threshold) {
+            nbBits--;
+            threshold >>= 1;
+        }
+    }
+
+    if (remaining != 1) return FALSE;
+    while (symbol <= maxSymbol) norm[symbol++] = 0;
+
+    *log = tableLog;
+    *consumed = (bitPos + 7) >> 3;
+    return TRUE;
+}
+
+typedef struct {
+    UINT16 states[512];
+    INT32 deltaState[64];
+    UINT32 deltaBits[64];
+    UINT32 log;
+} FseEncodeTable;
+
+static void BuildEncodeTable(FseEncodeTable* table, const SHORT* norm, UINT32 maxSymbol, UINT32 log) {
+    BYTE symbols[512];
+    UINT32 cumulative[65];
+    UINT32 size = 1u << log;
+
+    SpreadSymbols(norm, maxSymbol, log, symbols);
+
+    cumulative[0] = 0;
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        cumulative[s + 1] = cumulative[s] + (norm[s] == -1 ? 1 : (UINT32)(norm[s] > 0 ? norm[s] : 0));
+    }
+
+    for (UINT32 u = 0; u < size; u++) {
+        table->states[cumulative[symbols[u]]++] = (UINT16)(size + u);
+    }
+
+    INT32 total = 0;
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        INT32 n = norm[s];
+        if (n == 0) {
+            table->deltaBits[s] = ((log + 1) << 16) - size;
+            table->deltaState[s] = 0;
+        } else if (n == -1 || n == 1) {
+            table->deltaBits[s] = (log << 16) - size;
+            table->deltaState[s] = total - 1;
+            total++;
+        } else {
+            UINT32 maxBitsOut = log - HighBit((UINT32)n - 1);
+            UINT32 minStatePlus = (UINT32)n << maxBitsOut;
+            table->deltaBits[s] = (maxBitsOut << 16) - minStatePlus;
+            table->deltaState[s] = total - n;
+            total += n;
+        }
+    }
+
+    table->log = log;
+}
+
+static UINT32 FseInitState(const FseEncodeTable* table, UINT32 symbol) {
+    UINT32 bits = (table->deltaBits[symbol] + (1 << 15)) >> 16;
+    UINT32 value = (bits << 16) - table->deltaBits[symbol];
+    return table->states[(INT32)(value >> bits) + table->deltaState[symbol]];
+}
+
+static void FseEncode(BitWriter* w, const FseEncodeTable* table, UINT32* state, UINT32 symbol) {
+    UINT32 bits = (*state + table->deltaBits[symbol]) >> 16;
+    BitAdd(w, *state, bits);
+    *state = table->states[(INT32)(*state >> bits) + table->deltaState[symbol]];
+}
+
+static void FseFlush(BitWriter* w, const FseEncodeTable* table, UINT32 state) {
+    BitAdd(w, state, table->log);
+}
+
+static UINT32 OptimalLog(UINT32 maxLog, SIZE_T total, UINT32 maxSymbol) {
+    INT32 maxBitsSource = (INT32)HighBit((UINT32)(total - 1)) - 2;
+    UINT32 minBitsSource = HighBit((UINT32)total) + 1;
+    UINT32 minBitsSymbols = HighBit(maxSymbol) + 2;
+    UINT32 minBits = minBitsSource < minBitsSymbols ? minBitsSource : minBitsSymbols;
+
+    INT32 log = (INT32)maxLog;
+    if (maxBitsSource < log) log = maxBitsSource;
+    if ((INT32)minBits > log) log = (INT32)minBits;
+    if (log < 5) log = 5;
+    if (log > (INT32)maxLog) log = (INT32)maxLog;
+    return (UINT32)log;
+}
+
+static BOOL Normalize(const UINT32* counts, UINT32 maxSymbol, SIZE_T total, UINT32 log, SHORT* norm) {
+    INT32 remaining = 1 << log;
+    UINT32 largest = 0;
+    INT32 largestNorm = 0;
+
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        UINT64 scaled = (UINT64)counts[s] << log;
+        if (counts[s] == 0) {
+            norm[s] = 0;
+        } else if (scaled < total) {
+            norm[s] = -1;
+            remaining--;
+        } else {
+            INT32 n = (INT32)((scaled + total / 2) / total);
+            norm[s] = (SHORT)n;
+            remaining -= n;
+            if (n > largestNorm) {
+                largestNorm = n;
+                largest = s;
+            }
+        }
+    }
+
+    if (largestNorm == 0) return FALSE;
+
+    while (remaining < 0) {
+        UINT32 pick = 0;
+        for (UINT32 s = 1; s <= maxSymbol; s++) {
+            if (norm[s] > norm[pick]) pick = s;
+        }
+        if (norm[pick] <= 1) return FALSE;
+        norm[pick]--;
+        remaining++;
+    }
+
+    norm[largest] = (SHORT)(norm[largest] + remaining);
+    return TRUE;
+}
+
+static SIZE_T WriteNormalized(BYTE* output, SIZE_T capacity, const SHORT* norm, UINT32 maxSymbol, UINT32 log) {
+    BitWriter w;
+    BitInit(&w, output, capacity);
+    BitAdd(&w, log - 5, 4);
+
+    INT32 remaining = (1 << log) + 1;
+    INT32 threshold = 1 << log;
+    UINT32 nbBits = log + 1;
+    UINT32 symbol = 0;
+    BOOL previousZero = FALSE;
+
+    while (symbol <= maxSymbol && remaining > 1) {
+        if (previousZero) {
+            UINT32 start = symbol;
+            while (symbol <= maxSymbol && norm[symbol] == 0) symbol++;
+            while (symbol >= start + 24) {
+                start += 24;
+                BitAdd(&w, 0xFFFF, 16);
+            }
+            while (symbol >= start + 3) {
+                start += 3;
+                BitAdd(&w, 3, 2);
+            }
+            BitAdd(&w, symbol - start, 2);
+        }
+
+        INT32 count = norm[symbol++];
+        INT32 max = (2 * threshold - 1) - remaining;
+        remaining -= count < 0 ? -count : count;
+        count++;
+        if (count >= threshold) count += max;
+
+        BitAdd(&w, (UINT32)count, nbBits - (count < max ? 1 : 0));
+        previousZero = count == 1;
+
+        while (remaining < threshold) {
+            nbBits--;
+            threshold >>= 1;
+        }
+    }
+
+    return BitFinish(&w);
+}
+
+static UINT32 Log2Fixed(UINT32 value) {
+    UINT32 bit = HighBit(value);
+    return bit * 256 + ((value << 8) >> bit) - 256;
+}
+
+static UINT64 EstimateCost(const UINT32* counts, UINT32 maxSymbol, const SHORT* norm, UINT32 log) {
+    UINT64 cost = 0;
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        if (!counts[s]) continue;
+        UINT32 n = norm[s] == -1 ? 1 : (UINT32)norm[s];
+        cost += (UINT64)counts[s] * (log * 256 - Log2Fixed(n));
+    }
+    return cost;
+}
+
+CpioZstdEncoder* CpioZstdEncoderCreate(int level) {
+    if (level < 1 || level > CPIO_ZSTD_MAX_LEVEL) return NULL;
+
+    CpioZstdEncoder* encoder = (CpioZstdEncoder*)CpioAlloc(sizeof(CpioZstdEncoder));
+    if (!encoder) return NULL;
+
+    encoder->chainLength = Levels[level].chainLength;
+    encoder->niceLength = Levels[level].niceLength;
+    encoder->lazy = Levels[level].lazy;
+    encoder->head = (UINT32*)CpioAlloc(sizeof(UINT32) * ZSTD_HASH_SIZE);
+    encoder->prev = (UINT32*)CpioAlloc(sizeof(UINT32) * ZSTD_CHAIN_SIZE);
+    encoder->sequences = (CpioZstdSequence*)CpioAlloc(sizeof(CpioZstdSequence) * ZSTD_MAX_SEQUENCES);
+    encoder->literals = (BYTE*)CpioAlloc(CPIO_ZSTD_BLOCK_SIZE);
+    encoder->codes = (BYTE*)CpioAlloc(ZSTD_MAX_SEQUENCES * 3);
+
+    if (!encoder->head || !encoder->prev || !encoder->sequences || !encoder->literals || !encoder->codes) {
+        CpioZstdEncoderDestroy(encoder);
+        return NULL;
+    }
+
+    return encoder;
+}
+
+void CpioZstdEncoderDestroy(CpioZstdEncoder* encoder) {
+    if (!encoder) return;
+
+    if (encoder->head) CpioFree(encoder->head);
+    if (encoder->prev) CpioFree(encoder->prev);
+    if (encoder->sequences) CpioFree(encoder->sequences);
+    if (encoder->literals) CpioFree(encoder->literals);
+    if (encoder->codes) CpioFree(encoder->codes);
+    CpioFree(encoder);
+}
+
+SIZE_T CpioZstdBound(SIZE_T length) {
+    return length + (length / CPIO_ZSTD_BLOCK_SIZE + 1) * 3 + 32;
+}
+
+static UINT32 Hash4(const BYTE* p) {
+    return (*(const UINT32*)p * 2654435761u) >> (32 - CPIO_ZSTD_HASH_BITS);
+}
+
+static void InsertUpTo(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length, SIZE_T target) {
+    for (SIZE_T pos = encoder->nextInsert; pos < target && pos + 4 <= length; pos++) {
+        UINT32 h = Hash4(data + pos);
+        encoder->prev[pos & (ZSTD_CHAIN_SIZE - 1)] = encoder->head[h];
+        encoder->head[h] = (UINT32)pos + 1;
+    }
+    if (target > encoder->nextInsert) encoder->nextInsert = target;
+}
+
+static UINT32 FindMatch(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length, SIZE_T pos, SIZE_T limit,
+                        UINT32* offset) {
+    InsertUpTo(encoder, data, length, pos);
+
+    UINT32 h = Hash4(data + pos);
+    UINT32 candidate = encoder->head[h];
+    encoder->prev[pos & (ZSTD_CHAIN_SIZE - 1)] = candidate;
+    encoder->head[h] = (UINT32)pos + 1;
+    encoder->nextInsert = pos + 1;
+
+    SIZE_T maxLength = limit - pos;
+    SIZE_T best = 0;
+    UINT32 chain = encoder->chainLength;
+
+    while (candidate && chain--) {
+        SIZE_T match = candidate - 1;
+        if (match >= pos || pos - match >= ZSTD_CHAIN_SIZE) break;
+
+        if (data[match + best] == data[pos + best]) {
+            SIZE_T len = MatchLength(data + match, data + pos, maxLength);
+            if (len > best) {
+                best = len;
+                *offset = (UINT32)(pos - match);
+                if (best >= encoder->niceLength || best == maxLength) break;
+            }
+        }
+
+        UINT32 next = encoder->prev[match & (ZSTD_CHAIN_SIZE - 1)];
+        if (next >= candidate) break;
+        candidate = next;
+    }
+
+    return (UINT32)best;
+}
+
+static UINT32 RepeatMatch(const BYTE* data, SIZE_T pos, SIZE_T limit, UINT32 rep) {
+    if (rep == 0 || rep > pos) return 0;
+    return (UINT32)MatchLength(data + pos - rep, data + pos, limit - pos);
+}
+
+static UINT32 OffsetBase(const UINT32* reps, UINT32 offset, UINT32 litLength) {
+    if (litLength > 0) {
+        if (offset == reps[0]) return 1;
+        if (offset == reps[1]) return 2;
+        if (offset == reps[2]) return 3;
+    } else {
+        if (offset == reps[1]) return 1;
+        if (offset == reps[2]) return 2;
+        if (reps[0] > 1 && offset == reps[0] - 1) return 3;
+    }
+    return offset + 3;
+}
+
+static void EmitSequence(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T anchor, SIZE_T pos, UINT32 length,
+                         UINT32 offset, UINT32* reps) {
+    UINT32 litLength = (UINT32)(pos - anchor);
+    CopyBytes(encoder->literals + encoder->literalCount, data + anchor, litLength);
+    encoder->literalCount += litLength;
+
+    CpioZstdSequence* sequence = &encoder->sequences[encoder->sequenceCount++];
+    sequence->litLength = litLength;
+    sequence->matchLength = length;
+    sequence->offBase = OffsetBase(reps, offset, litLength);
+    ResolveOffset(reps, sequence->offBase, litLength);
+}
+
+typedef struct {
+    const CpioZstdMatch* matches;
+    SIZE_T count;
+    SIZE_T index;
+    CpioZstdMatch current;
+    BOOL active;
+} LongMatches;
+
+static void NextLongMatch(LongMatches* lm) {
+    lm->active = lm->index < lm->count;
+    if (lm->active) lm->current = lm->matches[lm->index++];
+}
+
+static INT32 MatchGain(UINT32 length, UINT32 offset, const UINT32* reps) {
+    return (INT32)(length * 4) - (offset == reps[0] ? 0 : (INT32)HighBit(offset + 3));
+}
+
+static void ParseBlock(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length, SIZE_T start, SIZE_T end,
+                       LongMatches* lm, UINT32* reps) {
+    SIZE_T anchor = start;
+    SIZE_T pos = start;
+
+    encoder->sequenceCount = 0;
+    encoder->literalCount = 0;
+
+    while (pos < end) {
+        if (lm->active && lm->current.position < pos) {
+            SIZE_T skip = pos - lm->current.position;
+            if (skip + ZSTD_MIN_MATCH > lm->current.length) {
+                NextLongMatch(lm);
+                continue;
+            }
+            lm->current.position = (UINT32)pos;
+            lm->current.length -= (UINT32)skip;
+        }
+
+        SIZE_T limit = end;
+        if (lm->active && lm->current.position < end) {
+            if (lm->current.position == pos) {
+                UINT32 take = lm->current.length;
+                if (take > end - pos) take = (UINT32)(end - pos);
+                if (take < ZSTD_MIN_MATCH) break;
+
+                EmitSequence(encoder, data, anchor, pos, take, lm->current.offset, reps);
+                pos += take;
+                anchor = pos;
+                lm->current.position += take;
+                lm->current.length -= take;
+                if (lm->current.length < ZSTD_MIN_MATCH) NextLongMatch(lm);
+                continue;
+            }
+            limit = lm->current.position;
+        }
+
+        if (pos + ZSTD_MIN_MATCH > limit) {
+            if (limit == end) break;
+            pos = limit;
+            continue;
+        }
+
+        UINT32 offset = 0;
+        UINT32 best = FindMatch(encoder, data, length, pos, limit, &offset);
+        UINT32 rep = RepeatMatch(data, pos, limit, reps[0]);
+        if (rep >= ZSTD_MIN_MATCH && rep + 1 >= best) {
+            best = rep;
+            offset = reps[0];
+        }
+
+        if (best < ZSTD_MIN_MATCH) {
+            pos++;
+            continue;
+        }
+
+        while (encoder->lazy && best < encoder->niceLength && pos + 1 + ZSTD_MIN_MATCH <= limit) {
+            UINT32 offset2 = 0;
+            UINT32 best2 = FindMatch(encoder, data, length, pos + 1, limit, &offset2);
+            UINT32 rep2 = RepeatMatch(data, pos + 1, limit, reps[0]);
+            if (rep2 >= ZSTD_MIN_MATCH && rep2 + 1 >= best2) {
+                best2 = rep2;
+                offset2 = reps[0];
+            }
+
+            if (best2 < ZSTD_MIN_MATCH ||
+                MatchGain(best2, offset2, reps) <= MatchGain(best, offset, reps) + 4) {
+                break;
+            }
+            pos++;
+            best = best2;
+            offset = offset2;
+        }
+
+        EmitSequence(encoder, data, anchor, pos, best, offset, reps);
+        pos += best;
+        anchor = pos;
+    }
+
+    CopyBytes(encoder->literals + encoder->literalCount, data + anchor, end - anchor);
+    encoder->literalCount += end - anchor;
+}
+
+static UINT32 BuildHuffmanLengths(const UINT32* freq, UINT32 maxSymbol, BYTE* lengths) {
+    UINT32 symbols[256];
+    UINT32 weight[512];
+    UINT16 parent[512];
+    BYTE depth[512];
+    UINT32 n = 0;
+
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        lengths[s] = 0;
+        if (!freq[s]) continue;
+
+        UINT32 i = n++;
+        while (i > 0 && freq[symbols[i - 1]] > freq[s]) {
+            symbols[i] = symbols[i - 1];
+            i--;
+        }
+        symbols[i] = s;
+    }
+
+    for (UINT32 i = 0; i < n; i++) weight[i] = freq[symbols[i]];
+
+    UINT32 leaf = 0;
+    UINT32 node = n;
+    for (UINT32 next = n; next < 2 * n - 1; next++) {
+        UINT32 pick[2];
+        for (UINT32 k = 0; k < 2; k++) {
+            if (leaf < n && (node >= next || weight[leaf] <= weight[node])) {
+                pick[k] = leaf++;
+            } else {
+                pick[k] = node++;
+            }
+        }
+        weight[next] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = (UINT16)next;
+        parent[pick[1]] = (UINT16)next;
+    }
+
+    depth[2 * n - 2] = 0;
+    for (UINT32 i = 2 * n - 2; i-- > 0;) {
+        UINT32 d = depth[parent[i]] + 1;
+        depth[i] = (BYTE)(d > 32 ? 32 : d);
+    }
+
+    UINT32 total = 1u << ZSTD_HUFFMAN_MAX_BITS;
+    UINT32 kraft = 0;
+    for (UINT32 i = 0; i < n; i++) {
+        BYTE length = depth[i] > ZSTD_HUFFMAN_MAX_BITS ? ZSTD_HUFFMAN_MAX_BITS : depth[i];
+        lengths[symbols[i]] = length;
+        kraft += total >> length;
+    }
+
+    while (kraft > total) {
+        for (UINT32 i = 0; i < n && kraft > total; i++) {
+            BYTE* length = &lengths[symbols[i]];
+            if (*length < ZSTD_HUFFMAN_MAX_BITS) {
+                kraft -= total >> (*length + 1);
+                (*length)++;
+            }
+        }
+    }
+
+    while (kraft < total) {
+        for (UINT32 i = n; i-- > 0 && kraft < total;) {
+            BYTE* length = &lengths[symbols[i]];
+            while (*length > 1 && kraft + (total >> *length) <= total) {
+                kraft += total >> *length;
+                (*length)--;
+            }
+        }
+    }
+
+    UINT32 maxLength = 0;
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        if (lengths[s] > maxLength) maxLength = lengths[s];
+    }
+    return maxLength;
+}
+
+static SIZE_T EncodeWeightsFse(BYTE* output, SIZE_T capacity, const BYTE* weights, UINT32 count,
+                               const FseEncodeTable* table) {
+    BitWriter w;
+    BitInit(&w, output, capacity);
+
+    UINT32 states[2] = { 0, 0 };
+    BOOL started[2] = { FALSE, FALSE };
+
+    for (UINT32 i = count; i-- > 0;) {
+        UINT32 k = i & 1;
+        if (!started[k]) {
+            states[k] = FseInitState(table, weights[i]);
+            started[k] = TRUE;
+        } else {
+            FseEncode(&w, table, &states[k], weights[i]);
+        }
+    }
+
+    FseFlush(&w, table, states[1]);
+    FseFlush(&w, table, states[0]);
+    return BitClose(&w);
+}
+
+static BOOL DecodeWeightsFse(const BYTE* data, SIZE_T length, BYTE* weights, UINT32* count) {
+    SHORT norm[13];
+    UINT32 log;
+    SIZE_T used;
+    CpioZstdFseEntry table[1 << ZSTD_WEIGHTS_MAX_LOG];
+
+    if (!ReadNormalized(data, length, norm, 12, ZSTD_WEIGHTS_MAX_LOG, &log, &used) ||
+        !BuildDecodeTable(table, norm, 12, log)) {
+        return FALSE;
+    }
+
+    BitReader r;
+    if (!BitReaderInit(&r, data + used, length - used)) return FALSE;
+
+    UINT32 state1 = BitRead(&r, log);
+    UINT32 state2 = BitRead(&r, log);
+    BitReload(&r);
+
+    UINT32 n = 0;
+    for (;;) {
+        if (n + 2 > 255) return FALSE;
+
+        weights[n++] = table[state1].symbol;
+        state1 = table[state1].base + BitRead(&r, table[state1].bits);
+        BitReload(&r);
+        if (r.consumed > 64) {
+            weights[n++] = table[state2].symbol;
+            break;
+        }
+
+        weights[n++] = table[state2].symbol;
+        state2 = table[state2].base + BitRead(&r, table[state2].bits);
+        BitReload(&r);
+        if (r.consumed > 64) {
+            weights[n++] = table[state1].symbol;
+            break;
+        }
+    }
+
+    *count = n;
+    return TRUE;
+}
+
+static SIZE_T WriteHuffmanWeights(BYTE* output, SIZE_T capacity, const BYTE* weights, UINT32 count) {
+    SIZE_T directSize = count <= 128 ? 1 + (count + 1) / 2 : 0;
+
+    UINT32 counts[16] = { 0 };
+    UINT32 maxWeight = 0;
+    UINT32 distinct = 0;
+    for (UINT32 i = 0; i < count; i++) {
+        if (counts[weights[i]]++ == 0) distinct++;
+        if (weights[i] > maxWeight) maxWeight = weights[i];
+    }
+
+    BYTE fse[128];
+    SIZE_T fseSize = 0;
+
+    if (distinct > 1 && count >= 2) {
+        SHORT norm[16];
+        UINT32 log = OptimalLog(ZSTD_WEIGHTS_MAX_LOG, count, maxWeight);
+        FseEncodeTable table;
+
+        if (Normalize(counts, maxWeight, count, log, norm)) {
+            SIZE_T header = WriteNormalized(fse, sizeof(fse), norm, maxWeight, log);
+            BuildEncodeTable(&table, norm, maxWeight, log);
+            SIZE_T body = header ? EncodeWeightsFse(fse + header, sizeof(fse) - header, weights, count, &table) : 0;
+
+            BYTE check[256];
+            UINT32 checkCount = 0;
+            if (body && header + body < 128 &&
+                DecodeWeightsFse(fse, header + body, check, &checkCount) && checkCount == count &&
+                CpioCompareMemory(check, weights, count) == 0) {
+                fseSize = header + body;
+            }
+        }
+    }
+
+    if (fseSize && (directSize == 0 || fseSize + 1 < directSize)) {
+        if (fseSize + 1 > capacity) return 0;
+        output[0] = (BYTE)fseSize;
+        CpioCopyMemory(output + 1, fse, fseSize);
+        return fseSize + 1;
+    }
+
+    if (directSize == 0 || directSize > capacity) return 0;
+
+    output[0] = (BYTE)(127 + count);
+    for (UINT32 i = 0; i < count; i += 2) {
+        BYTE low = i + 1 < count ? weights[i + 1] : 0;
+        output[1 + i / 2] = (BYTE)((weights[i] << 4) | low);
+    }
+    return directSize;
+}
+
+static SIZE_T EncodeHuffmanStream(BYTE* output, SIZE_T capacity, const BYTE* data, SIZE_T length,
+                                  const UINT16* codes, const BYTE* lengths) {
+    BitWriter w;
+    BitInit(&w, output, capacity);
+
+    for (SIZE_T i = length; i-- > 0;) {
+        BitAdd(&w, codes[data[i]], lengths[data[i]]);
+    }
+    return BitClose(&w);
+}
+
+static SIZE_T WriteRawLiterals(BYTE* output, SIZE_T capacity, UINT32 type, const BYTE* data, SIZE_T length) {
+    SIZE_T header = length < 32 ? 1 : length < 4096 ? 2 : 3;
+    SIZE_T body = type == ZSTD_LITERALS_RLE ? 1 : length;
+    if (header + body > capacity) return 0;
+
+    if (header == 1) {
+        output[0] = (BYTE)(type | (length << 3));
+    } else if (header == 2) {
+        output[0] = (BYTE)(type | (1 << 2) | (length << 4));
+        output[1] = (BYTE)(length >> 4);
+    } else {
+        output[0] = (BYTE)(type | (3 << 2) | (length << 4));
+        output[1] = (BYTE)(length >> 4);
+        output[2] = (BYTE)(length >> 12);
+    }
+
+    CpioCopyMemory(output + header, data, body);
+    return header + body;
+}
+
+static SIZE_T EncodeLiterals(CpioZstdEncoder* encoder, BYTE* output, SIZE_T capacity) {
+    const BYTE* data = encoder->literals;
+    SIZE_T length = encoder->literalCount;
+
+    if (length == 0) return WriteRawLiterals(output, capacity, ZSTD_LITERALS_RAW, data, 0);
+
+    UINT32 freq[256] = { 0 };
+    for (SIZE_T i = 0; i < length; i++) freq[data[i]]++;
+
+    if (freq[data[0]] == length && length > 1) {
+        return WriteRawLiterals(output, capacity, ZSTD_LITERALS_RLE, data, length);
+    }
+    if (length < ZSTD_HUFFMAN_MIN_LITERALS) {
+        return WriteRawLiterals(output, capacity, ZSTD_LITERALS_RAW, data, length);
+    }
+
+    UINT32 maxSymbol = 255;
+    while (freq[maxSymbol] == 0) maxSymbol--;
+
+    BYTE lengths[256];
+    UINT16 codes[256];
+    BYTE weights[256];
+    UINT32 rankStart[ZSTD_HUFFMAN_MAX_BITS + 2] = { 0 };
+    UINT32 rankCount[ZSTD_HUFFMAN_MAX_BITS + 2] = { 0 };
+
+    UINT32 maxLength = BuildHuffmanLengths(freq, maxSymbol, lengths);
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        weights[s] = (BYTE)(lengths[s] ? maxLength + 1 - lengths[s] : 0);
+        rankCount[weights[s]]++;
+    }
+
+    UINT32 next = 0;
+    for (UINT32 w = 1; w <= maxLength; w++) {
+        rankStart[w] = next;
+        next += rankCount[w] << (w - 1);
+    }
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        UINT32 w = weights[s];
+        if (!w) continue;
+        codes[s] = (UINT16)(rankStart[w] >> (w - 1));
+        rankStart[w] += 1u << (w - 1);
+    }
+
+    BOOL single = length <= 1023;
+    SIZE_T header = single || length <= 1023 ? 3 : length <= 16383 ? 4 : 5;
+    SIZE_T limit = length + (length < 4096 ? 2 : 3);
+    if (limit > capacity) limit = capacity;
+    if (header + 1 >= limit) return 0;
+
+    BYTE* out = output + header;
+    SIZE_T room = limit - header;
+    SIZE_T tree = WriteHuffmanWeights(out, room, weights, maxSymbol);
+    SIZE_T size = tree;
+
+    if (tree && single) {
+        SIZE_T stream = EncodeHuffmanStream(out + size, room - size, data, length, codes, lengths);
+        size = stream ? size + stream : 0;
+    } else if (tree && room > tree + 6) {
+        SIZE_T segment = (length + 3) / 4;
+        SIZE_T jump = size;
+        size += 6;
+
+        for (UINT32 i = 0; i < 4 && size; i++) {
+            SIZE_T begin = segment * i;
+            SIZE_T count = i < 3 ? segment : length - segment * 3;
+            SIZE_T stream = EncodeHuffmanStream(out + size, room - size, data + begin, count, codes, lengths);
+            if (!stream || (i < 3 && stream > 0xFFFF)) {
+                size = 0;
+                break;
+            }
+            if (i < 3) {
+                out[jump + i * 2] = (BYTE)stream;
+                out[jump + i * 2 + 1] = (BYTE)(stream >> 8);
+            }
+            size += stream;
+        }
+    } else {
+        size = 0;
+    }
+
+    if (size == 0 || header + size >= limit) {
+        return WriteRawLiterals(output, capacity, ZSTD_LITERALS_RAW, data, length);
+    }
+
+    UINT64 value = ZSTD_LITERALS_COMPRESSED;
+    if (header == 3) {
+        value |= (UINT64)(single ? 0 : 1) << 2 | (UINT64)length << 4 | (UINT64)size << 14;
+    } else if (header == 4) {
+        value |= (UINT64)2 << 2 | (UINT64)length << 4 | (UINT64)size << 18;
+    } else {
+        value |= (UINT64)3 << 2 | (UINT64)length << 4 | (UINT64)size << 22;
+    }
+    for (SIZE_T i = 0; i < header; i++) {
+        output[i] = (BYTE)(value >> (i * 8));
+    }
+
+    return header + size;
+}
+
+static SIZE_T ChooseTable(FseEncodeTable* table, UINT32* mode, const UINT32* counts, SIZE_T total,
+                          const ZstdSymbolKind* kind, BYTE* output, SIZE_T capacity) {
+    UINT32 maxSymbol = kind->maxSymbol;
+    while (counts[maxSymbol] == 0) maxSymbol--;
+
+    UINT32 distinct = 0;
+    for (UINT32 s = 0; s <= maxSymbol; s++) {
+        if (counts[s]) distinct++;
+    }
+
+    SHORT norm[64];
+
+    if (distinct == 1) {
+        if (capacity < 1) return 0;
+        CpioZeroMemory(norm, sizeof(norm));
+        norm[maxSymbol] = 1;
+        BuildEncodeTable(table, norm, maxSymbol, 0);
+        *mode = ZSTD_MODE_RLE;
+        output[0] = (BYTE)maxSymbol;
+        return 1;
+    }
+
+    UINT64 predefinedCost = (UINT64)-1;
+    if (maxSymbol <= kind->defaultMax) {
+        predefinedCost = EstimateCost(counts, maxSymbol, kind->defaults, kind->defaultLog);
+    }
+
+    UINT32 log = OptimalLog(kind->maxLog, total, maxSymbol);
+    SIZE_T header = 0;
+    UINT64 customCost = (UINT64)-1;
+
+    if (Normalize(counts, maxSymbol, total, log, norm)) {
+        header = WriteNormalized(output, capacity, norm, maxSymbol, log);
+        if (header) customCost = EstimateCost(counts, maxSymbol, norm, log) + (UINT64)header * 8 * 256;
+    }
+
+    if (predefinedCost <= customCost) {
+        if (predefinedCost == (UINT64)-1) return 0;
+        BuildEncodeTable(table, kind->defaults, kind->defaultMax, kind->defaultLog);
+        *mode = ZSTD_MODE_PREDEFINED;
+        return (SIZE_T)-1;
+    }
+
+    BuildEncodeTable(table, norm, maxSymbol, log);
+    *mode = ZSTD_MODE_FSE;
+    return header;
+}
+
+static SIZE_T EncodeSequences(CpioZstdEncoder* encoder, BYTE* output, SIZE_T capacity) {
+    SIZE_T count = encoder->sequenceCount;
+    SIZE_T pos = 0;
+
+    if (capacity < 4) return 0;
+
+    if (count < 128) {
+        output[pos++] = (BYTE)count;
+    } else if (count < 0x7F00) {
+        output[pos++] = (BYTE)((count >> 8) + 128);
+        output[pos++] = (BYTE)count;
+    } else {
+        output[pos++] = 0xFF;
+        output[pos++] = (BYTE)(count - 0x7F00);
+        output[pos++] = (BYTE)((count - 0x7F00) >> 8);
+    }
+
+    if (count == 0) return pos;
+
+    const CpioZstdSequence* sequences = encoder->sequences;
+    BYTE* codes[3] = { encoder->codes, encoder->codes + ZSTD_MAX_SEQUENCES, encoder->codes + 2 * ZSTD_MAX_SEQUENCES };
+    UINT32 counts[3][64];
+    CpioZeroMemory(counts, sizeof(counts));
+
+    for (SIZE_T i = 0; i < count; i++) {
+        UINT32 ll = sequences[i].litLength;
+        UINT32 ml = sequences[i].matchLength - 3;
+        codes[ZSTD_LL][i] = (BYTE)(ll < 64 ? LitLengthCodes[ll] : HighBit(ll) + 19);
+        codes[ZSTD_OF][i] = (BYTE)HighBit(sequences[i].offBase);
+        codes[ZSTD_ML][i] = (BYTE)(ml < 128 ? MatchLengthCodes[ml] : HighBit(ml) + 36);
+        counts[ZSTD_LL][codes[ZSTD_LL][i]]++;
+        counts[ZSTD_OF][codes[ZSTD_OF][i]]++;
+        counts[ZSTD_ML][codes[ZSTD_ML][i]]++;
+    }
+
+    FseEncodeTable tables[3];
+    UINT32 modes[3];
+    SIZE_T modePos = pos++;
+
+    for (UINT32 k = 0; k < 3; k++) {
+        SIZE_T written = ChooseTable(&tables[k], &modes[k], counts[k], count, &SymbolKinds[k],
+                                     output + pos, capacity - pos);
+        if (written == 0) return 0;
+        if (written != (SIZE_T)-1) pos += written;
+    }
+    output[modePos] = (BYTE)((modes[ZSTD_LL] << 6) | (modes[ZSTD_OF] << 4) | (modes[ZSTD_ML] << 2));
+
+    BitWriter w;
+    BitInit(&w, output + pos, capacity - pos);
+
+    SIZE_T last = count - 1;
+    UINT32 stateML = FseInitState(&tables[ZSTD_ML], codes[ZSTD_ML][last]);
+    UINT32 stateOF = FseInitState(&tables[ZSTD_OF], codes[ZSTD_OF][last]);
+    UINT32 stateLL = FseInitState(&tables[ZSTD_LL], codes[ZSTD_LL][last]);
+
+    for (SIZE_T i = count; i-- > 0;) {
+        BYTE ll = codes[ZSTD_LL][i];
+        BYTE of = codes[ZSTD_OF][i];
+        BYTE ml = codes[ZSTD_ML][i];
+
+        if (i != last) {
+            FseEncode(&w, &tables[ZSTD_OF], &stateOF, of);
+            FseEncode(&w, &tables[ZSTD_ML], &stateML, ml);
+            FseEncode(&w, &tables[ZSTD_LL], &stateLL, ll);
+        }
+        BitAdd(&w, sequences[i].litLength - LitLengthBase[ll], LitLengthBits[ll]);
+        BitAdd(&w, sequences[i].matchLength - MatchLengthBase[ml], MatchLengthBits[ml]);
+        BitAdd(&w, sequences[i].offBase, of);
+    }
+
+    FseFlush(&w, &tables[ZSTD_ML], stateML);
+    FseFlush(&w, &tables[ZSTD_OF], stateOF);
+    FseFlush(&w, &tables[ZSTD_LL], stateLL);
+
+    SIZE_T stream = BitClose(&w);
+    return stream ? pos + stream : 0;
+}
+
+static BOOL IsSingleByte(const BYTE* data, SIZE_T length) {
+    for (SIZE_T i = 1; i < length; i++) {
+        if (data[i] != data[0]) return FALSE;
+    }
+    return TRUE;
+}
+
+static SIZE_T CompressBlock(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length, SIZE_T start, SIZE_T end,
+                            LongMatches* lm, UINT32* reps, BOOL last, BYTE* output, SIZE_T outputSize) {
+    SIZE_T size = end - start;
+    const BYTE* block = data + start;
+
+    if (outputSize < size + 3) return 0;
+
+    if (size > 1 && IsSingleByte(block, size)) {
+        PutLittleEndian24(output, (UINT32)(last | (ZSTD_BLOCK_RLE << 1) | (size << 3)));
+        output[3] = block[0];
+        return 4;
+    }
+
+    UINT32 savedReps[3] = { reps[0], reps[1], reps[2] };
+    ParseBlock(encoder, data, length, start, end, lm, reps);
+
+    SIZE_T literals = EncodeLiterals(encoder, output + 3, size);
+    SIZE_T sequences = literals ? EncodeSequences(encoder, output + 3 + literals, size - literals) : 0;
+    SIZE_T compressed = literals + sequences;
+
+    if (!literals || !sequences || compressed >= size) {
+        reps[0] = savedReps[0];
+        reps[1] = savedReps[1];
+        reps[2] = savedReps[2];
+        PutLittleEndian24(output, (UINT32)(last | (ZSTD_BLOCK_RAW << 1) | (size << 3)));
+        CpioCopyMemory(output + 3, block, size);
+        return size + 3;
+    }
+
+    PutLittleEndian24(output, (UINT32)(last | (ZSTD_BLOCK_COMPRESSED << 1) | (compressed << 3)));
+    return compressed + 3;
+}
+
+SIZE_T CpioZstdCompressBlocks(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length,
+                              const CpioZstdMatch* matches, SIZE_T matchCount, UINT32* reps, BOOL last,
+                              BYTE* output, SIZE_T outputSize) {
+    if (!encoder || !reps || (!data && length > 0)) return 0;
+
+    if (length == 0) {
+        if (!last) return 0;
+        if (outputSize < 3) return 0;
+        PutLittleEndian24(output, 1);
+        return 3;
+    }
+
+    CpioZeroMemory(encoder->head, sizeof(UINT32) * ZSTD_HASH_SIZE);
+    encoder->nextInsert = 0;
+
+    LongMatches lm;
+    lm.matches = matches;
+    lm.count = matches ? matchCount : 0;
+    lm.index = 0;
+    NextLongMatch(&lm);
+
+    SIZE_T total = 0;
+    for (SIZE_T start = 0; start < length; start += CPIO_ZSTD_BLOCK_SIZE) {
+        SIZE_T end = length - start > CPIO_ZSTD_BLOCK_SIZE ? start + CPIO_ZSTD_BLOCK_SIZE : length;
+        SIZE_T written = CompressBlock(encoder, data, length, start, end, &lm, reps, last && end == length,
+                                       output + total, outputSize - total);
+        if (written == 0) return 0;
+        total += written;
+    }
+
+    return total;
+}
+
+SIZE_T CpioZstdCompressFrame(CpioZstdEncoder* encoder, const BYTE* data, SIZE_T length, BYTE* output,
+                             SIZE_T outputSize) {
+    if (!encoder || !output || outputSize < 18) return 0;
+
+    SIZE_T pos = 0;
+    PutLittleEndian32(output, ZSTD_MAGIC);
+    pos += 4;
+
+    if (length < 256) {
+        output[pos++] = 0x24;
+        output[pos++] = (BYTE)length;
+    } else if (length < 65536 + 256) {
+        output[pos++] = 0x64;
+        output[pos++] = (BYTE)(length - 256);
+        output[pos++] = (BYTE)((length - 256) >> 8);
+    } else {
+        output[pos++] = 0xA4;
+        PutLittleEndian32(output + pos, (UINT32)length);
+        pos += 4;
+    }
+
+    UINT32 reps[3] = { 1, 4, 8 };
+    SIZE_T blocks = CpioZstdCompressBlocks(encoder, data, length, NULL, 0, reps, TRUE, output + pos,
+                                           outputSize - pos);
+    if (blocks == 0 || outputSize - pos - blocks < 4) return 0;
+    pos += blocks;
+
+    CpioXxh64 xxh;
+    CpioXxh64Init(&xxh, 0);
+    CpioXxh64Update(&xxh, data, length);
+    PutLittleEndian32(output + pos, (UINT32)CpioXxh64Digest(&xxh));
+    return pos + 4;
+}
+
+CpioZstdDecoder* CpioZstdDecoderCreate(HANDLE hInput, HANDLE hOutput) {
+    CpioZstdDecoder* decoder = (CpioZstdDecoder*)CpioAlloc(sizeof(CpioZstdDecoder));
+    if (!decoder) return NULL;
+
+    decoder->hInput = hInput;
+    decoder->hOutput = hOutput;
+    decoder->input = CpioBufferPoolAcquire();
+    decoder->block = (BYTE*)CpioAlloc(CPIO_ZSTD_BLOCK_SIZE + 8);
+    decoder->literals = (BYTE*)CpioAlloc(CPIO_ZSTD_BLOCK_SIZE + 8);
+
+    if (!decoder->input || !decoder->block || !decoder->literals) {
+        CpioZstdDecoderDestroy(decoder);
+        return NULL;
+    }
+
+    return decoder;
+}
+
+void CpioZstdDecoderDestroy(CpioZstdDecoder* decoder) {
+    if (!decoder) return;
+
+    if (decoder->input) CpioBufferPoolRelease(decoder->input);
+    if (decoder->block) CpioFree(decoder->block);
+    if (decoder->literals) CpioFree(decoder->literals);
+    if (decoder->window) CpioFree(decoder->window);
+    CpioFree(decoder);
+}
+
+BOOL CpioZstdDecoderPrime(CpioZstdDecoder* decoder, const BYTE* data, SIZE_T length) {
+    if (!decoder || decoder->inputLength + length > CPIO_POOL_BUFFER_SIZE) return FALSE;
+
+    CpioCopyMemory(decoder->input + decoder->inputLength, data, length);
+    decoder->inputLength += length;
+    return TRUE;
+}
+
+void CpioZstdDecoderReset(CpioZstdDecoder* decoder, HANDLE hOutput) {
+    decoder->hOutput = hOutput;
+    decoder->inputPos = 0;
+    decoder->inputLength = 0;
+    decoder->inputEnd = FALSE;
+}
+
+static BOOL FillInput(CpioZstdDecoder* decoder, CpioError* error) {
+    decoder->inputPos = 0;
+    decoder->inputLength = 0;
+
+    DWORD bytesRead = 0;
+    if (!ReadFile(decoder->hInput, decoder->input, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL)) {
+        DWORD lastError = GetLastError();
+        if (lastError != ERROR_BROKEN_PIPE && lastError != ERROR_HANDLE_EOF) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to read compressed data");
+            return FALSE;
+        }
+        bytesRead = 0;
+    }
+
+    if (bytesRead == 0) decoder->inputEnd = TRUE;
+    decoder->inputLength = bytesRead;
+    return TRUE;
+}
+
+static BOOL ReadInput(CpioZstdDecoder* decoder, BYTE* data, SIZE_T length, SIZE_T* bytesRead, CpioError* error) {
+    SIZE_T total = 0;
+
+    while (total < length) {
+        if (decoder->inputPos == decoder->inputLength) {
+            if (decoder->inputEnd) break;
+            if (!FillInput(decoder, error)) return FALSE;
+            continue;
+        }
+
+        SIZE_T take = decoder->inputLength - decoder->inputPos;
+        if (take > length - total) take = length - total;
+        if (data) CpioCopyMemory(data + total, decoder->input + decoder->inputPos, take);
+        decoder->inputPos += take;
+        total += take;
+    }
+
+    *bytesRead = total;
+    return TRUE;
+}
+
+static BOOL ReadExact(CpioZstdDecoder* decoder, BYTE* data, SIZE_T length, CpioError* error) {
+    SIZE_T got = 0;
+    if (!ReadInput(decoder, data, length, &got, error)) return FALSE;
+
+    if (got != length) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of zstd stream");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL Corrupt(CpioError* error) {
+    CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Corrupt zstd data");
+    return FALSE;
+}
+
+static BOOL BuildHuffmanTable(CpioZstdDecoder* decoder, BYTE* weights, UINT32 count) {
+    UINT32 total = 0;
+
+    if (count == 0 || count > 255) return FALSE;
+
+    for (UINT32 i = 0; i < count; i++) {
+        if (weights[i] > ZSTD_HUFFMAN_MAX_BITS) return FALSE;
+        if (weights[i]) total += 1u << (weights[i] - 1);
+    }
+    if (total == 0) return FALSE;
+
+    UINT32 log = HighBit(total) + 1;
+    if (log > ZSTD_HUFFMAN_MAX_BITS) return FALSE;
+
+    UINT32 rest = (1u << log) - total;
+    if (rest & (rest - 1)) return FALSE;
+    weights[count++] = (BYTE)(HighBit(rest) + 1);
+
+    UINT32 rankStart[ZSTD_HUFFMAN_MAX_BITS + 2] = { 0 };
+    UINT32 rankCount[ZSTD_HUFFMAN_MAX_BITS + 2] = { 0 };
+    for (UINT32 i = 0; i < count; i++) rankCount[weights[i]]++;
+
+    UINT32 next = 0;
+    for (UINT32 w = 1; w <= log; w++) {
+        rankStart[w] = next;
+        next += rankCount[w] << (w - 1);
+    }
+
+    for (UINT32 s = 0; s < count; s++) {
+        UINT32 w = weights[s];
+        if (!w) continue;
+
+        UINT32 span = 1u << (w - 1);
+        for (UINT32 i = 0; i < span; i++) {
+            decoder->huffman[rankStart[w] + i].symbol = (BYTE)s;
+            decoder->huffman[rankStart[w] + i].bits = (BYTE)(log + 1 - w);
+        }
+        rankStart[w] += span;
+    }
+
+    decoder->huffmanLog = log;
+    return TRUE;
+}
+
+static BOOL ReadHuffmanTree(CpioZstdDecoder* decoder, const BYTE* data, SIZE_T length, SIZE_T* used) {
+    BYTE weights[256];
+    UINT32 count = 0;
+
+    if (length < 1) return FALSE;
+
+    UINT32 header = data[0];
+    if (header >= 128) {
+        count = header - 127;
+        SIZE_T bytes = (count + 1) / 2;
+        if (1 + bytes > length) return FALSE;
+
+        for (UINT32 i = 0; i < count; i++) {
+            BYTE pair = data[1 + i / 2];
+            weights[i] = (BYTE)((i & 1) ? pair & 0xF : pair >> 4);
+        }
+        *used = 1 + bytes;
+    } else {
+        if (header == 0 || 1 + (SIZE_T)header > length) return FALSE;
+        if (!DecodeWeightsFse(data + 1, header, weights, &count)) return FALSE;
+        *used = 1 + header;
+    }
+
+    return BuildHuffmanTable(decoder, weights, count);
+}
+
+static BOOL DecodeHuffmanStream(const CpioZstdDecoder* decoder, const BYTE* data, SIZE_T length, BYTE* output,
+                                SIZE_T count) {
+    BitReader r;
+    if (!BitReaderInit(&r, data, length)) return FALSE;
+
+    const CpioZstdHufEntry* table = decoder->huffman;
+    UINT32 log = decoder->huffmanLog;
+    SIZE_T i = 0;
+
+    while (i + 4 <= count) {
+        BitReload(&r);
+        if (r.consumed > 64) return FALSE;
+
+        for (UINT32 k = 0; k < 4; k++) {
+            const CpioZstdHufEntry* entry = &table[BitPeek(&r, log)];
+            output[i++] = entry->symbol;
+            r.consumed += entry->bits;
+        }
+    }
+
+    while (i < count) {
+        BitReload(&r);
+        const CpioZstdHufEntry* entry = &table[BitPeek(&r, log)];
+        output[i++] = entry->symbol;
+        r.consumed += entry->bits;
+    }
+
+    BitReload(&r);
+    return BitFinished(&r);
+}
+
+static BOOL DecodeLiterals(CpioZstdDecoder* decoder, const BYTE* data, SIZE_T length, const BYTE** literals,
+                           SIZE_T* literalCount, SIZE_T* used) {
+    if (length < 1) return FALSE;
+
+    UINT32 type = data[0] & 3;
+    UINT32 format = (data[0] >> 2) & 3;
+
+    if (type == ZSTD_LITERALS_RAW || type == ZSTD_LITERALS_RLE) {
+        SIZE_T header;
+        SIZE_T size;
+
+        if (format == 0 || format == 2) {
+            header = 1;
+            size = data[0] >> 3;
+        } else if (format == 1) {
+            if (length < 2) return FALSE;
+            header = 2;
+            size = (data[0] >> 4) | ((SIZE_T)data[1] << 4);
+        } else {
+            if (length < 3) return FALSE;
+            header = 3;
+            size = (data[0] >> 4) | ((SIZE_T)data[1] << 4) | ((SIZE_T)data[2] << 12);
+        }
+
+        if (size > CPIO_ZSTD_BLOCK_SIZE) return FALSE;
+
+        if (type == ZSTD_LITERALS_RAW) {
+            if (header + size > length) return FALSE;
+            *literals = data + header;
+            *used = header + size;
+        } else {
+            if (header + 1 > length) return FALSE;
+            BYTE value = data[header];
+            for (SIZE_T i = 0; i < size; i++) decoder->literals[i] = value;
+            *literals = decoder->literals;
+            *used = header + 1;
+        }
+
+        *literalCount = size;
+        return TRUE;
+    }
+
+    SIZE_T header = format == 3 ? 5 : format == 2 ? 4 : 3;
+    UINT32 bits = format < 2 ? 10 : format == 2 ? 14 : 18;
+    UINT32 streams = format == 0 ? 1 : 4;
+    if (length < header) return FALSE;
+
+    UINT64 value = 0;
+    for (SIZE_T i = 0; i < header; i++) value |= (UINT64)data[i] << (i * 8);
+
+    SIZE_T size = (SIZE_T)((value >> 4) & ((1u << bits) - 1));
+    SIZE_T compressed = (SIZE_T)((value >> (4 + bits)) & ((1u << bits) - 1));
+    if (size > CPIO_ZSTD_BLOCK_SIZE || header + compressed > length) return FALSE;
+
+    const BYTE* p = data + header;
+    SIZE_T left = compressed;
+
+    if (type == ZSTD_LITERALS_COMPRESSED) {
+        SIZE_T tree;
+        if (!ReadHuffmanTree(decoder, p, left, &tree)) return FALSE;
+        p += tree;
+        left -= tree;
+    } else if (decoder->huffmanLog == 0) {
+        return FALSE;
+    }
+
+    if (streams == 1) {
+        if (!DecodeHuffmanStream(decoder, p, left, decoder->literals, size)) return FALSE;
+    } else {
+        if (left < 6) return FALSE;
+
+        SIZE_T sizes[4];
+        sizes[0] = p[0] | ((SIZE_T)p[1] << 8);
+        sizes[1] = p[2] | ((SIZE_T)p[3] << 8);
+        sizes[2] = p[4] | ((SIZE_T)p[5] << 8);
+        p += 6;
+        left -= 6;
+
+        if (sizes[0] + sizes[1] + sizes[2] > left) return FALSE;
+        sizes[3] = left - sizes[0] - sizes[1] - sizes[2];
+
+        SIZE_T segment = (size + 3) / 4;
+        if (segment * 3 > size) return FALSE;
+
+        for (UINT32 i = 0; i < 4; i++) {
+            SIZE_T count = i < 3 ? segment : size - segment * 3;
+            if (!DecodeHuffmanStream(decoder, p, sizes[i], decoder->literals + segment * i, count)) return FALSE;
+            p += sizes[i];
+        }
+    }
+
+    *literals = decoder->literals;
+    *literalCount = size;
+    *used = header + compressed;
+    return TRUE;
+}
+
+static BOOL ReadSequenceTable(CpioZstdDecoder* decoder, UINT32 kind, UINT32 mode, const BYTE* data, SIZE_T length,
+                              SIZE_T* pos) {
+    const ZstdSymbolKind* info = &SymbolKinds[kind];
+    CpioZstdFseEntry* table = decoder->tables[kind];
+
+    if (mode == ZSTD_MODE_PREDEFINED) {
+        if (!BuildDecodeTable(table, info->defaults, info->defaultMax, info->defaultLog)) return FALSE;
+        decoder->tableLogs[kind] = info->defaultLog;
+    } else if (mode == ZSTD_MODE_RLE) {
+        if (*pos >= length || data[*pos] > info->maxSymbol) return FALSE;
+        table[0].symbol = data[(*pos)++];
+        table[0].bits = 0;
+        table[0].base = 0;
+        decoder->tableLogs[kind] = 0;
+    } else if (mode == ZSTD_MODE_FSE) {
+        SHORT norm[64];
+        UINT32 log;
+        SIZE_T used;
+        if (!ReadNormalized(data + *pos, length - *pos, norm, info->maxSymbol, info->maxLog, &log, &used) ||
+            !BuildDecodeTable(table, norm, info->maxSymbol, log)) {
+            return FALSE;
+        }
+        decoder->tableLogs[kind] = log;
+        *pos += used;
+    } else if (!decoder->tableValid[kind]) {
+        return FALSE;
+    }
+
+    decoder->tableValid[kind] = TRUE;
+    return TRUE;
+}
+
+static BOOL DecodeSequences(CpioZstdDecoder* decoder, const BYTE* data, SIZE_T length, const BYTE* literals,
+                            SIZE_T literalCount, SIZE_T limit, SIZE_T* produced) {
+    if (length < 1) return FALSE;
+
+    SIZE_T count;
+    SIZE_T pos;
+    if (data[0] < 128) {
+        count = data[0];
+        pos = 1;
+    } else if (data[0] < 255) {
+        if (length < 2) return FALSE;
+        count = ((SIZE_T)(data[0] - 128) << 8) + data[1];
+        pos = 2;
+    } else {
+        if (length < 3) return FALSE;
+        count = data[1] + ((SIZE_T)data[2] << 8) + 0x7F00;
+        pos = 3;
+    }
+
+    BYTE* start = decoder->window + decoder->windowPos;
+    BYTE* out = start;
+    const BYTE* lit = literals;
+    const BYTE* litEnd = literals + literalCount;
+
+    if (count > 0) {
+        if (pos >= length) return FALSE;
+
+        UINT32 modes = data[pos++];
+        if (modes & 3) return FALSE;
+
+        if (!ReadSequenceTable(decoder, ZSTD_LL, modes >> 6, data, length, &pos) ||
+            !ReadSequenceTable(decoder, ZSTD_OF, (modes >> 4) & 3, data, length, &pos) ||
+            !ReadSequenceTable(decoder, ZSTD_ML, (modes >> 2) & 3, data, length, &pos)) {
+            return FALSE;
+        }
+
+        BitReader r;
+        if (!BitReaderInit(&r, data + pos, length - pos)) return FALSE;
+
+        const CpioZstdFseEntry* llTable = decoder->tables[ZSTD_LL];
+        const CpioZstdFseEntry* ofTable = decoder->tables[ZSTD_OF];
+        const CpioZstdFseEntry* mlTable = decoder->tables[ZSTD_ML];
+        UINT32 stateLL = BitRead(&r, decoder->tableLogs[ZSTD_LL]);
+        UINT32 stateOF = BitRead(&r, decoder->tableLogs[ZSTD_OF]);
+        UINT32 stateML = BitRead(&r, decoder->tableLogs[ZSTD_ML]);
+        BitReload(&r);
+
+        BYTE* outEnd = start + limit;
+
+        for (SIZE_T i = 0; i < count; i++) {
+            UINT32 llCode = llTable[stateLL].symbol;
+            UINT32 ofCode = ofTable[stateOF].symbol;
+            UINT32 mlCode = mlTable[stateML].symbol;
+            if (ofCode > 31) return FALSE;
+
+            UINT32 offBase = (1u << ofCode) + BitRead(&r, ofCode);
+            BitReload(&r);
+            UINT32 matchLength = MatchLengthBase[mlCode] + BitRead(&r, MatchLengthBits[mlCode]);
+            UINT32 litLength = LitLengthBase[llCode] + BitRead(&r, LitLengthBits[llCode]);
+            BitReload(&r);
+
+            if (i + 1 < count) {
+                stateLL = llTable[stateLL].base + BitRead(&r, llTable[stateLL].bits);
+                stateML = mlTable[stateML].base + BitRead(&r, mlTable[stateML].bits);
+                stateOF = ofTable[stateOF].base + BitRead(&r, ofTable[stateOF].bits);
+                BitReload(&r);
+            }
+            if (r.consumed > 64) return FALSE;
+
+            UINT32 offset = ResolveOffset(decoder->reps, offBase, litLength);
+
+            if (litLength > (SIZE_T)(litEnd - lit) || (SIZE_T)(outEnd - out) < (SIZE_T)litLength + matchLength) {
+                return FALSE;
+            }
+
+            CopyBytes(out, lit, litLength);
+            out += litLength;
+            lit += litLength;
+
+            if (offset == 0 || offset > (SIZE_T)(out - decoder->window)) return FALSE;
+            CopyBytes(out, out - offset, matchLength);
+            out += matchLength;
+        }
+
+        if (!BitFinished(&r)) return FALSE;
+    }
+
+    SIZE_T rest = (SIZE_T)(litEnd - lit);
+    if (rest > limit - (SIZE_T)(out - start)) return FALSE;
+    CopyBytes(out, lit, rest);
+    out += rest;
+
+    *produced = (SIZE_T)(out - start);
+    return TRUE;
+}
+
+static BOOL WriteOutput(CpioZstdDecoder* decoder, SIZE_T length, CpioError* error) {
+    const BYTE* data = decoder->window + decoder->windowPos;
+
+    CpioXxh64Update(&decoder->checksum, data, length);
+    decoder->windowPos += length;
+    decoder->frameOut += length;
+
+    while (length > 0) {
+        DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+        DWORD bytesWritten = 0;
+        if (!WriteFile(decoder->hOutput, data, chunk, &bytesWritten, NULL) || bytesWritten == 0) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Failed to write decompressed data");
+            return FALSE;
+        }
+        data += bytesWritten;
+        length -= bytesWritten;
+    }
+
+    return TRUE;
+}
+
+static BOOL PrepareWindow(CpioZstdDecoder* decoder, UINT64 windowSize, BOOL single, CpioError* error) {
+    SIZE_T capacity = (SIZE_T)windowSize;
+    if (!single) {
+        SIZE_T extra = (SIZE_T)(windowSize / 4);
+        if (extra < CPIO_POOL_BUFFER_SIZE) extra = CPIO_POOL_BUFFER_SIZE;
+        capacity += extra + CPIO_ZSTD_BLOCK_SIZE;
+    }
+    capacity += 8;
+
+    if (capacity > decoder->windowCapacity) {
+        if (decoder->window) CpioFree(decoder->window);
+        decoder->window = (BYTE*)CpioAlloc(capacity);
+        decoder->windowCapacity = decoder->window ? capacity : 0;
+        if (!decoder->window) {
+            CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+            return FALSE;
+        }
+    }
+
+    decoder->windowPos = 0;
+    decoder->windowSize = windowSize;
+    return TRUE;
+}
+
+static BOOL DecodeFrame(CpioZstdDecoder* decoder, CpioError* error) {
+    static const BYTE DictSizes[4] = { 0, 1, 2, 4 };
+    BYTE descriptor;
+    BYTE header[14];
+
+    if (!ReadExact(decoder, &descriptor, 1, error)) return FALSE;
+
+    UINT32 sizeFlag = descriptor >> 6;
+    BOOL single = (descriptor >> 5) & 1;
+    BOOL hasChecksum = (descriptor >> 2) & 1;
+    UINT32 dictFlag = descriptor & 3;
+
+    if (descriptor & 0x08) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "Invalid zstd frame header");
+        return FALSE;
+    }
+
+    SIZE_T sizeBytes = sizeFlag == 0 ? (single ? 1 : 0) : (SIZE_T)1 << sizeFlag;
+    SIZE_T need = (single ? 0 : 1) + DictSizes[dictFlag] + sizeBytes;
+    if (!ReadExact(decoder, header, need, error)) return FALSE;
+
+    const BYTE* p = header;
+    UINT64 windowSize = 0;
+
+    if (!single) {
+        UINT32 exponent = *p >> 3;
+        UINT64 base = (UINT64)1 << (10 + exponent);
+        windowSize = base + (base / 8) * (*p & 7);
+        p++;
+    }
+
+    UINT32 dictId = 0;
+    for (UINT32 i = 0; i < DictSizes[dictFlag]; i++) dictId |= (UINT32)*p++ << (i * 8);
+    if (dictId != 0) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "zstd dictionaries are not supported");
+        return FALSE;
+    }
+
+    UINT64 contentSize = 0;
+    for (SIZE_T i = 0; i < sizeBytes; i++) contentSize |= (UINT64)*p++ << (i * 8);
+    if (sizeFlag == 1) contentSize += 256;
+    if (single) windowSize = contentSize;
+
+    if (windowSize > ((UINT64)1 << CPIO_ZSTD_MAX_WINDOW_LOG)) {
+        CpioErrorSet(error, CPIO_ERROR_BAD_HEADER, "zstd window size is too large");
+        return FALSE;
+    }
+
+    if (!PrepareWindow(decoder, windowSize, single, error)) return FALSE;
+
+    SIZE_T blockMax = windowSize < CPIO_ZSTD_BLOCK_SIZE ? (SIZE_T)windowSize : CPIO_ZSTD_BLOCK_SIZE;
+    decoder->reps[0] = 1;
+    decoder->reps[1] = 4;
+    decoder->reps[2] = 8;
+    decoder->huffmanLog = 0;
+    decoder->tableValid[0] = decoder->tableValid[1] = decoder->tableValid[2] = FALSE;
+    decoder->frameOut = 0;
+    CpioXxh64Init(&decoder->checksum, 0);
+
+    for (;;) {
+        BYTE blockHeader[3];
+        if (!ReadExact(decoder, blockHeader, sizeof(blockHeader), error)) return FALSE;
+
+        UINT32 value = blockHeader[0] | ((UINT32)blockHeader[1] << 8) | ((UINT32)blockHeader[2] << 16);
+        BOOL last = value & 1;
+        UINT32 type = (value >> 1) & 3;
+        SIZE_T size = value >> 3;
+
+        if (!single && decoder->windowPos + blockMax > decoder->windowCapacity - 8) {
+            SIZE_T keep = (SIZE_T)decoder->windowSize;
+            CpioCopyMemory(decoder->window, decoder->window + decoder->windowPos - keep, keep);
+            decoder->windowPos = keep;
+        }
+
+        SIZE_T room = decoder->windowCapacity - 8 - decoder->windowPos;
+        SIZE_T limit = blockMax < room ? blockMax : room;
+        SIZE_T produced = 0;
+
+        if (type == ZSTD_BLOCK_RAW) {
+            if (size > limit) return Corrupt(error);
+            if (!ReadExact(decoder, decoder->window + decoder->windowPos, size, error)) return FALSE;
+            produced = size;
+        } else if (type == ZSTD_BLOCK_RLE) {
+            BYTE value8;
+            if (size > limit) return Corrupt(error);
+            if (!ReadExact(decoder, &value8, 1, error)) return FALSE;
+            for (SIZE_T i = 0; i < size; i++) decoder->window[decoder->windowPos + i] = value8;
+            produced = size;
+        } else if (type == ZSTD_BLOCK_COMPRESSED) {
+            const BYTE* literals;
+            SIZE_T literalCount;
+            SIZE_T used;
+
+            if (size > blockMax) return Corrupt(error);
+            if (!ReadExact(decoder, decoder->block, size, error)) return FALSE;
+            if (!DecodeLiterals(decoder, decoder->block, size, &literals, &literalCount, &used) ||
+                !DecodeSequences(decoder, decoder->block + used, size - used, literals, literalCount, limit,
+                                 &produced)) {
+                return Corrupt(error);
+            }
+        } else {
+            return Corrupt(error);
+        }
+
+        if (!WriteOutput(decoder, produced, error)) return FALSE;
+        if (last) break;
+    }
+
+    if ((single || sizeFlag != 0) && decoder->frameOut != contentSize) {
+        CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "zstd content size mismatch");
+        return FALSE;
+    }
+
+    if (hasChecksum) {
+        BYTE checksum[4];
+        if (!ReadExact(decoder, checksum, sizeof(checksum), error)) return FALSE;
+
+        if (GetLittleEndian32(checksum) != (UINT32)CpioXxh64Digest(&decoder->checksum)) {
+            CpioErrorSet(error, CPIO_ERROR_SIZE_MISMATCH, "zstd checksum mismatch");
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL CpioZstdDecoderRun(CpioZstdDecoder* decoder, CpioError* error) {
+    for (;;) {
+        BYTE magic[4];
+        SIZE_T got = 0;
+
+        if (!ReadInput(decoder, magic, sizeof(magic), &got, error)) return FALSE;
+        if (got == 0 && decoder->frames > 0) return TRUE;
+
+        if (got != sizeof(magic)) {
+            CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of zstd stream");
+            return FALSE;
+        }
+
+        UINT32 value = GetLittleEndian32(magic);
+
+        if ((value & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC) {
+            BYTE size[4];
+            if (!ReadExact(decoder, size, sizeof(size), error)) return FALSE;
+
+            UINT32 skip = GetLittleEndian32(size);
+            if (!ReadInput(decoder, NULL, skip, &got, error)) return FALSE;
+            if (got != skip) {
+                CpioErrorSet(error, CPIO_ERROR_IO, "Unexpected end of zstd stream");
+                return FALSE;
+            }
+            continue;
+        }
+
+        if (value != ZSTD_MAGIC) {
+            CpioErrorSet(error, CPIO_ERROR_BAD_MAGIC, "Invalid zstd frame");
+            return FALSE;
+        }
+
+        if (!DecodeFrame(decoder, error)) return FALSE;
+        decoder->frames++;
+    }
+}
@@ -0,0 +1,829 @@
+#include "cpio.h"
+#include <intrin.h>
+
+#define ZSTD_MAGIC 0xFD2FB528
+#define ZSTD_SEEKABLE_MAGIC 0x184D2A5E
+#define ZSTD_SEEK_FOOTER_MAGIC 0x8F92EAB1
+#define ZSTD_SEEK_FOOTER_SIZE 9
+#define ZSTD_SEEK_ENTRY_SIZE 12
+#define ZSTD_SEEK_CHECKSUM_FLAG 0x80
+#define ZSTD_MIN_FRAME_SIZE (1024 * 1024)
+#define ZSTD_WINDOW_SIZE ((UINT64)1 << CPIO_ZSTD_MAX_WINDOW_LOG)
+#define ZSTD_HISTORY_SEGMENTS ((UINT32)(ZSTD_WINDOW_SIZE / CPIO_ZSTD_JOB_SIZE))
+#define ZSTD_LDM_BUCKET_LOG 18
+#define ZSTD_LDM_BUCKET_SIZE 4
+#define ZSTD_LDM_MIN_MATCH 64
+#define ZSTD_LDM_MAX_MATCHES (CPIO_ZSTD_JOB_SIZE / ZSTD_LDM_MIN_MATCH + 1)
+
+static BOOL WriteAll(HANDLE hFile, const BYTE* data, SIZE_T length) {
+    while (length > 0) {
+        DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+        DWORD bytesWritten = 0;
+        if (!WriteFile(hFile, data, chunk, &bytesWritten, NULL) || bytesWritten == 0) {
+            return FALSE;
+        }
+        data += bytesWritten;
+        length -= bytesWritten;
+    }
+    return TRUE;
+}
+
+static BOOL ReadAll(HANDLE hFile, BYTE* data, SIZE_T length, SIZE_T* total) {
+    *total = 0;
+
+    while (*total < length) {
+        SIZE_T remaining = length - *total;
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+        DWORD bytesRead = 0;
+
+        if (!ReadFile(hFile, data + *total, chunk, &bytesRead, NULL)) {
+            return GetLastError() == ERROR_BROKEN_PIPE;
+        }
+        if (bytesRead == 0) break;
+        *total += bytesRead;
+    }
+    return TRUE;
+}
+
+static void PutLittleEndian32(BYTE* p, UINT32 value) {
+    p[0] = (BYTE)value;
+    p[1] = (BYTE)(value >> 8);
+    p[2] = (BYTE)(value >> 16);
+    p[3] = (BYTE)(value >> 24);
+}
+
+static UINT32 GetLittleEndian32(const BYTE* p) {
+    return (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+static SIZE_T MatchLength(const BYTE* a, const BYTE* b, SIZE_T maxLength) {
+    SIZE_T length = 0;
+
+    while (length + 8 <= maxLength) {
+        UINT64 diff = *(const UINT64*)(a + length) ^ *(const UINT64*)(b + length);
+        if (diff) {
+            unsigned long index;
+            _BitScanForward64(&index, diff);
+            return length + (index >> 3);
+        }
+        length += 8;
+    }
+
+    while (length < maxLength && a[length] == b[length]) length++;
+    return length;
+}
+
+static void WriterFail(CpioZstdWriter* writer, CpioErrorCode code, const char* message) {
+    AcquireSRWLockExclusive(&writer->lock);
+    if (!writer->failed) {
+        writer->failed = TRUE;
+        CpioErrorSet(&writer->error, code, message);
+    }
+    ReleaseSRWLockExclusive(&writer->lock);
+}
+
+static DWORD WINAPI CompressWorker(LPVOID param) {
+    CpioZstdWriter* writer = (CpioZstdWriter*)param;
+    CpioZstdEncoder* encoder = writer->encoders[InterlockedIncrement(&writer->nextEncoder) - 1];
+    SIZE_T bound = CpioZstdBound(CPIO_ZSTD_JOB_SIZE);
+
+    AcquireSRWLockExclusive(&writer->lock);
+
+    for (;;) {
+        while (!writer->shutdown && writer->taken == writer->submitted) {
+            SleepConditionVariableSRW(&writer->workReady, &writer->lock, INFINITE, 0);
+        }
+        if (writer->taken == writer->submitted) break;
+
+        CpioZstdJob* job = &writer->jobs[writer->taken++ % writer->jobCount];
+        ReleaseSRWLockExclusive(&writer->lock);
+
+        if (writer->mode == CPIO_ZSTD_LONG) {
+            job->outputLength = CpioZstdCompressBlocks(encoder, job->input, job->inputLength, job->matches,
+                                                       job->matchCount, job->reps, FALSE, job->output, bound);
+        } else {
+            job->outputLength = CpioZstdCompressFrame(encoder, job->input, job->inputLength, job->output, bound);
+        }
+
+        if (job->outputLength == 0) {
+            WriterFail(writer, CPIO_ERROR_IO, "Failed to compress archive stream");
+        }
+
+        AcquireSRWLockExclusive(&writer->lock);
+        job->done = TRUE;
+        WakeAllConditionVariable(&writer->workDone);
+    }
+
+    ReleaseSRWLockExclusive(&writer->lock);
+    return 0;
+}
+
+static BOOL FillJob(CpioZstdWriter* writer, CpioZstdJob* job, const CpioZstdJob* previous, BOOL* drained) {
+    SIZE_T carry = previous ? previous->available - previous->inputLength : 0;
+    if (carry > 0) CpioCopyMemory(job->input, previous->input + previous->inputLength, carry);
+    job->available = carry;
+
+    while (!*drained && job->available < CPIO_ZSTD_JOB_SIZE) {
+        DWORD bytesRead = 0;
+        if (!ReadFile(writer->hPipe, job->input + job->available, (DWORD)(CPIO_ZSTD_JOB_SIZE - job->available),
+                      &bytesRead, NULL)) {
+            if (GetLastError() != ERROR_BROKEN_PIPE) {
+                WriterFail(writer, CPIO_ERROR_IO, "Failed to read archive stream");
+                return FALSE;
+            }
+            bytesRead = 0;
+        }
+        if (bytesRead == 0) *drained = TRUE;
+        job->available += bytesRead;
+    }
+
+    job->inputLength = job->available;
+    return TRUE;
+}
+
+static void CutAtBoundary(CpioZstdWriter* writer, CpioZstdJob* job, UINT64 start) {
+    SIZE_T cut = 0;
+
+    AcquireSRWLockExclusive(&writer->lock);
+
+    while (writer->boundaryTaken < writer->boundaryCount && writer->boundaries[writer->boundaryTaken] <= start) {
+        writer->boundaryTaken++;
+    }
+
+    for (SIZE_T i = writer->boundaryTaken; i < writer->boundaryCount; i++) {
+        UINT64 offset = writer->boundaries[i] - start;
+        if (offset >= job->available) break;
+        cut = (SIZE_T)offset;
+        if (cut >= ZSTD_MIN_FRAME_SIZE) break;
+    }
+
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    if (cut > 0) job->inputLength = cut;
+}
+
+static const BYTE* RingAt(const CpioZstdWriter* writer, UINT64 position, SIZE_T* contiguous) {
+    SIZE_T offset = (SIZE_T)(position % CPIO_ZSTD_JOB_SIZE);
+    SIZE_T segment = (SIZE_T)((position / CPIO_ZSTD_JOB_SIZE) % writer->segmentCount);
+
+    *contiguous = CPIO_ZSTD_JOB_SIZE - offset;
+    return writer->ring + segment * CPIO_ZSTD_JOB_SIZE + offset;
+}
+
+static SIZE_T ExtendForward(const CpioZstdWriter* writer, UINT64 candidate, const BYTE* data, SIZE_T limit) {
+    SIZE_T length = 0;
+
+    while (length < limit) {
+        SIZE_T contiguous;
+        const BYTE* p = RingAt(writer, candidate + length, &contiguous);
+        SIZE_T span = limit - length < contiguous ? limit - length : contiguous;
+        SIZE_T matched = MatchLength(p, data + length, span);
+
+        length += matched;
+        if (matched < span) break;
+    }
+    return length;
+}
+
+static SIZE_T ExtendBackward(const CpioZstdWriter* writer, UINT64 candidate, UINT64 oldest, const BYTE* data,
+                             SIZE_T limit) {
+    SIZE_T length = 0;
+
+    while (length < limit && candidate - length > oldest) {
+        SIZE_T contiguous;
+        if (*RingAt(writer, candidate - length - 1, &contiguous) != data[-(INT64)length - 1]) break;
+        length++;
+    }
+    return length;
+}
+
+static void FindLongMatches(CpioZstdWriter* writer, CpioZstdJob* job, UINT64 index, UINT64 start) {
+    const BYTE* data = job->input;
+    SIZE_T length = job->inputLength;
+    UINT64 hash = writer->rolling;
+    UINT64 oldest = index + 1 >= writer->segmentCount ? (index + 1 - writer->segmentCount) * CPIO_ZSTD_JOB_SIZE : 0;
+    SIZE_T anchor = 0;
+
+    job->matchCount = 0;
+
+    for (SIZE_T i = 0; i < length; i++) {
+        hash = (hash << 1) + writer->gear[data[i]];
+        if ((hash >> 57) != 0) continue;
+
+        SIZE_T end = i + 1;
+        UINT64 position = start + end;
+        CpioZstdLdmEntry* bucket =
+            &writer->ldm[(SIZE_T)((hash >> 39) & ((1 << ZSTD_LDM_BUCKET_LOG) - 1)) * ZSTD_LDM_BUCKET_SIZE];
+
+        if (end > anchor && position >= ZSTD_LDM_MIN_MATCH) {
+            SIZE_T bestLength = 0;
+            SIZE_T bestBack = 0;
+            UINT64 bestOffset = 0;
+
+            for (UINT32 k = 0; k < ZSTD_LDM_BUCKET_SIZE; k++) {
+                UINT64 candidate = bucket[k].position;
+                if (candidate == 0 || bucket[k].checksum != hash || candidate <= oldest ||
+                    position - candidate >= ZSTD_WINDOW_SIZE) {
+                    continue;
+                }
+
+                SIZE_T back = ExtendBackward(writer, candidate, oldest, data + end, end - anchor);
+                SIZE_T forward = ExtendForward(writer, candidate, data + end, length - end);
+                if (back + forward > bestLength) {
+                    bestLength = back + forward;
+                    bestBack = back;
+                    bestOffset = position - candidate;
+                }
+            }
+
+            if (bestLength >= ZSTD_LDM_MIN_MATCH) {
+                CpioZstdMatch* match = &job->matches[job->matchCount++];
+                match->position = (UINT32)(end - bestBack);
+                match->length = (UINT32)bestLength;
+                match->offset = (UINT32)bestOffset;
+                anchor = end - bestBack + bestLength;
+            }
+        }
+
+        for (UINT32 k = ZSTD_LDM_BUCKET_SIZE - 1; k > 0; k--) {
+            bucket[k] = bucket[k - 1];
+        }
+        bucket[0].position = position;
+        bucket[0].checksum = hash;
+    }
+
+    writer->rolling = hash;
+}
+
+static BOOL RecordFrame(CpioZstdWriter* writer, const CpioZstdJob* job) {
+    if (writer->seekCount == writer->seekCapacity) {
+        SIZE_T capacity = writer->seekCapacity ? writer->seekCapacity * 2 : 256;
+        CpioZstdSeekEntry* entries = (CpioZstdSeekEntry*)CpioRealloc(writer->seekEntries,
+                                                                     capacity * sizeof(CpioZstdSeekEntry));
+        if (!entries) return FALSE;
+        writer->seekEntries = entries;
+        writer->seekCapacity = capacity;
+    }
+
+    CpioZstdSeekEntry* entry = &writer->seekEntries[writer->seekCount++];
+    entry->compressedSize = (UINT32)job->outputLength;
+    entry->decompressedSize = (UINT32)job->inputLength;
+    entry->checksum = GetLittleEndian32(job->output + job->outputLength - 4);
+    return TRUE;
+}
+
+static BOOL WriteTrailer(CpioZstdWriter* writer) {
+    if (writer->mode == CPIO_ZSTD_LONG) {
+        BYTE trailer[7] = { 1, 0, 0 };
+        PutLittleEndian32(trailer + 3, (UINT32)CpioXxh64Digest(&writer->checksum));
+        return WriteAll(writer->hOutput, trailer, sizeof(trailer));
+    }
+
+    if (writer->mode != CPIO_ZSTD_SEEKABLE) return TRUE;
+
+    SIZE_T size = writer->seekCount * ZSTD_SEEK_ENTRY_SIZE + ZSTD_SEEK_FOOTER_SIZE;
+    BYTE* table = (BYTE*)CpioAlloc(size + 8);
+    if (!table) return FALSE;
+
+    PutLittleEndian32(table, ZSTD_SEEKABLE_MAGIC);
+    PutLittleEndian32(table + 4, (UINT32)size);
+
+    BYTE* p = table + 8;
+    for (SIZE_T i = 0; i < writer->seekCount; i++) {
+        PutLittleEndian32(p, writer->seekEntries[i].compressedSize);
+        PutLittleEndian32(p + 4, writer->seekEntries[i].decompressedSize);
+        PutLittleEndian32(p + 8, writer->seekEntries[i].checksum);
+        p += ZSTD_SEEK_ENTRY_SIZE;
+    }
+
+    PutLittleEndian32(p, (UINT32)writer->seekCount);
+    p[4] = ZSTD_SEEK_CHECKSUM_FLAG;
+    PutLittleEndian32(p + 5, ZSTD_SEEK_FOOTER_MAGIC);
+
+    BOOL ok = WriteAll(writer->hOutput, table, size + 8);
+    CpioFree(table);
+    return ok;
+}
+
+static DWORD WINAPI DispatchJobs(LPVOID param) {
+    CpioZstdWriter* writer = (CpioZstdWriter*)param;
+    UINT64 filled = 0;
+    UINT64 written = 0;
+    UINT64 position = 0;
+    BOOL ended = FALSE;
+    BOOL drained = FALSE;
+
+    if (writer->mode == CPIO_ZSTD_LONG) {
+        BYTE header[6];
+        PutLittleEndian32(header, ZSTD_MAGIC);
+        header[4] = 0x04;
+        header[5] = (BYTE)((CPIO_ZSTD_MAX_WINDOW_LOG - 10) << 3);
+
+        if (!WriteAll(writer->hOutput, header, sizeof(header))) {
+            WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+        }
+    }
+
+    while (!writer->failed) {
+        CpioZstdJob* oldest = &writer->jobs[written % writer->jobCount];
+
+        AcquireSRWLockShared(&writer->lock);
+        BOOL ready = written < filled && oldest->done;
+        ReleaseSRWLockShared(&writer->lock);
+
+        if (ready) {
+            if (!WriteAll(writer->hOutput, oldest->output, oldest->outputLength)) {
+                WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+                break;
+            }
+            if (writer->mode == CPIO_ZSTD_SEEKABLE && !RecordFrame(writer, oldest)) {
+                WriterFail(writer, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+                break;
+            }
+            written++;
+            continue;
+        }
+
+        if (!ended && filled - written < writer->jobCount) {
+            CpioZstdJob* job = &writer->jobs[filled % writer->jobCount];
+            const CpioZstdJob* previous = filled > 0 ? &writer->jobs[(filled - 1) % writer->jobCount] : NULL;
+
+            job->input = writer->ring + (SIZE_T)(filled % writer->segmentCount) * CPIO_ZSTD_JOB_SIZE;
+            if (!FillJob(writer, job, previous, &drained)) break;
+            if (job->available == 0) {
+                ended = TRUE;
+                continue;
+            }
+
+            if (writer->mode == CPIO_ZSTD_SEEKABLE) {
+                CutAtBoundary(writer, job, position);
+            } else if (writer->mode == CPIO_ZSTD_LONG) {
+                FindLongMatches(writer, job, filled, position);
+                CpioXxh64Update(&writer->checksum, job->input, job->inputLength);
+
+                UINT32 first = filled == 0;
+                job->reps[0] = first ? 1 : 0;
+                job->reps[1] = first ? 4 : 0;
+                job->reps[2] = first ? 8 : 0;
+            }
+            position += job->inputLength;
+
+            AcquireSRWLockExclusive(&writer->lock);
+            job->done = FALSE;
+            writer->submitted++;
+            WakeConditionVariable(&writer->workReady);
+            ReleaseSRWLockExclusive(&writer->lock);
+
+            filled++;
+            continue;
+        }
+
+        if (written == filled) break;
+
+        AcquireSRWLockExclusive(&writer->lock);
+        while (!oldest->done) {
+            SleepConditionVariableSRW(&writer->workDone, &writer->lock, INFINITE, 0);
+        }
+        ReleaseSRWLockExclusive(&writer->lock);
+    }
+
+    if (!writer->failed && !WriteTrailer(writer)) {
+        WriterFail(writer, CPIO_ERROR_IO, "Failed to write compressed archive");
+    }
+
+    if (writer->failed) {
+        CloseHandle(writer->hPipe);
+        writer->hPipe = NULL;
+    }
+
+    AcquireSRWLockExclusive(&writer->lock);
+    writer->shutdown = TRUE;
+    WakeAllConditionVariable(&writer->workReady);
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    return 0;
+}
+
+static void InitGear(UINT64* gear) {
+    UINT64 state = 0x9E3779B97F4A7C15ull;
+
+    for (UINT32 i = 0; i < 256; i++) {
+        UINT64 z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+CpioZstdWriter* CpioZstdWriterCreate(HANDLE hOutput, int level, UINT32 threadCount, CpioZstdMode mode,
+                                     CpioError* error) {
+    if (hOutput == INVALID_HANDLE_VALUE || level < 1 || level > CPIO_ZSTD_MAX_LEVEL) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "Invalid zstd parameters");
+        return NULL;
+    }
+
+    if (threadCount == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors;
+    }
+    if (threadCount > CPIO_ZSTD_MAX_THREADS) {
+        threadCount = CPIO_ZSTD_MAX_THREADS;
+    }
+
+    CpioZstdWriter* writer = (CpioZstdWriter*)CpioAlloc(sizeof(CpioZstdWriter));
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    writer->hOutput = hOutput;
+    writer->mode = mode;
+    writer->threadCount = threadCount;
+    writer->jobCount = threadCount + 1;
+    writer->segmentCount = mode == CPIO_ZSTD_LONG ? ZSTD_HISTORY_SEGMENTS + writer->jobCount : writer->jobCount;
+    InitializeSRWLock(&writer->lock);
+    InitializeConditionVariable(&writer->workReady);
+    InitializeConditionVariable(&writer->workDone);
+    CpioXxh64Init(&writer->checksum, 0);
+
+    writer->ring = (BYTE*)CpioAlloc((SIZE_T)writer->segmentCount * CPIO_ZSTD_JOB_SIZE);
+    writer->jobs = (CpioZstdJob*)CpioAlloc(sizeof(CpioZstdJob) * writer->jobCount);
+    BOOL ok = writer->ring && writer->jobs;
+
+    for (UINT32 i = 0; ok && i < writer->jobCount; i++) {
+        CpioZstdJob* job = &writer->jobs[i];
+        job->output = (BYTE*)CpioAlloc(CpioZstdBound(CPIO_ZSTD_JOB_SIZE));
+        if (mode == CPIO_ZSTD_LONG) {
+            job->matches = (CpioZstdMatch*)CpioAlloc(sizeof(CpioZstdMatch) * ZSTD_LDM_MAX_MATCHES);
+        }
+        ok = job->output && (mode != CPIO_ZSTD_LONG || job->matches);
+    }
+
+    if (ok && mode == CPIO_ZSTD_LONG) {
+        writer->ldm = (CpioZstdLdmEntry*)CpioAlloc(sizeof(CpioZstdLdmEntry) *
+                                                   ((SIZE_T)ZSTD_LDM_BUCKET_SIZE << ZSTD_LDM_BUCKET_LOG));
+        InitGear(writer->gear);
+        ok = writer->ldm != NULL;
+    }
+
+    for (UINT32 i = 0; ok && i < threadCount; i++) {
+        writer->encoders[i] = CpioZstdEncoderCreate(level);
+        ok = writer->encoders[i] != NULL;
+    }
+
+    if (!ok) {
+        CpioZstdWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    if (!CreatePipe(&writer->hPipe, &writer->hInput, NULL, CPIO_POOL_BUFFER_SIZE)) {
+        CpioZstdWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create compression pipe");
+        return NULL;
+    }
+
+    for (UINT32 i = 0; i < threadCount; i++) {
+        writer->threads[writer->started] = CreateThread(NULL, 0, CompressWorker, writer, 0, NULL);
+        if (writer->threads[writer->started]) writer->started++;
+    }
+
+    writer->dispatcher = writer->started > 0 ? CreateThread(NULL, 0, DispatchJobs, writer, 0, NULL) : NULL;
+    if (!writer->dispatcher) {
+        CpioZstdWriterDestroy(writer);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start compression threads");
+        return NULL;
+    }
+
+    return writer;
+}
+
+HANDLE CpioZstdWriterGetHandle(const CpioZstdWriter* writer) {
+    return writer ? writer->hInput : INVALID_HANDLE_VALUE;
+}
+
+BOOL CpioZstdWriterMarkBoundary(CpioZstdWriter* writer, UINT64 offset) {
+    if (!writer || writer->mode != CPIO_ZSTD_SEEKABLE) return TRUE;
+
+    BOOL ok = TRUE;
+    AcquireSRWLockExclusive(&writer->lock);
+
+    if (writer->boundaryCount == writer->boundaryCapacity) {
+        if (writer->boundaryTaken > 0 && writer->boundaryTaken >= writer->boundaryCount / 2) {
+            SIZE_T keep = writer->boundaryCount - writer->boundaryTaken;
+            CpioCopyMemory(writer->boundaries, writer->boundaries + writer->boundaryTaken, keep * sizeof(UINT64));
+            writer->boundaryCount = keep;
+            writer->boundaryTaken = 0;
+        } else {
+            SIZE_T capacity = writer->boundaryCapacity ? writer->boundaryCapacity * 2 : 1024;
+            UINT64* boundaries = (UINT64*)CpioRealloc(writer->boundaries, capacity * sizeof(UINT64));
+            if (boundaries) {
+                writer->boundaries = boundaries;
+                writer->boundaryCapacity = capacity;
+            } else {
+                ok = FALSE;
+            }
+        }
+    }
+
+    if (ok) writer->boundaries[writer->boundaryCount++] = offset;
+
+    ReleaseSRWLockExclusive(&writer->lock);
+    return ok;
+}
+
+static void StopWriter(CpioZstdWriter* writer) {
+    if (writer->hInput) {
+        CloseHandle(writer->hInput);
+        writer->hInput = NULL;
+    }
+
+    if (writer->dispatcher) {
+        WaitForSingleObject(writer->dispatcher, INFINITE);
+        CloseHandle(writer->dispatcher);
+        writer->dispatcher = NULL;
+    }
+
+    AcquireSRWLockExclusive(&writer->lock);
+    writer->shutdown = TRUE;
+    WakeAllConditionVariable(&writer->workReady);
+    ReleaseSRWLockExclusive(&writer->lock);
+
+    if (writer->started > 0) {
+        WaitForMultipleObjects(writer->started, writer->threads, TRUE, INFINITE);
+        for (UINT32 i = 0; i < writer->started; i++) {
+            CloseHandle(writer->threads[i]);
+        }
+        writer->started = 0;
+    }
+}
+
+BOOL CpioZstdWriterFinish(CpioZstdWriter* writer, CpioError* error) {
+    if (!writer) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "NULL zstd writer");
+        return FALSE;
+    }
+
+    StopWriter(writer);
+
+    if (writer->failed) {
+        if (error) *error = writer->error;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CpioZstdWriterDestroy(CpioZstdWriter* writer) {
+    if (!writer) return;
+
+    StopWriter(writer);
+    if (writer->hPipe) CloseHandle(writer->hPipe);
+
+    for (UINT32 i = 0; i < writer->threadCount; i++) {
+        CpioZstdEncoderDestroy(writer->encoders[i]);
+    }
+
+    if (writer->jobs) {
+        for (UINT32 i = 0; i < writer->jobCount; i++) {
+            if (writer->jobs[i].output) CpioFree(writer->jobs[i].output);
+            if (writer->jobs[i].matches) CpioFree(writer->jobs[i].matches);
+        }
+        CpioFree(writer->jobs);
+    }
+
+    if (writer->ring) CpioFree(writer->ring);
+    if (writer->ldm) CpioFree(writer->ldm);
+    if (writer->boundaries) CpioFree(writer->boundaries);
+    if (writer->seekEntries) CpioFree(writer->seekEntries);
+    CpioFree(writer);
+}
+
+static DWORD WINAPI DecompressThread(LPVOID param) {
+    CpioZstdReader* zstd = (CpioZstdReader*)param;
+
+    if (!CpioZstdDecoderRun(zstd->decoder, &zstd->error)) {
+        zstd->failed = TRUE;
+    }
+
+    CloseHandle(zstd->hWrite);
+    zstd->hWrite = NULL;
+    return 0;
+}
+
+static BOOL ReadAt(HANDLE hFile, UINT64 offset, BYTE* data, SIZE_T length) {
+    LARGE_INTEGER distance;
+    SIZE_T got = 0;
+
+    distance.QuadPart = (LONGLONG)offset;
+    return SetFilePointerEx(hFile, distance, NULL, FILE_BEGIN) && ReadAll(hFile, data, length, &got) &&
+           got == length;
+}
+
+static BOOL ParseSeekTable(CpioZstdReader* zstd, UINT64 fileSize) {
+    BYTE footer[ZSTD_SEEK_FOOTER_SIZE];
+
+    if (fileSize < 8 + ZSTD_SEEK_FOOTER_SIZE ||
+        !ReadAt(zstd->hInput, fileSize - ZSTD_SEEK_FOOTER_SIZE, footer, sizeof(footer)) ||
+        GetLittleEndian32(footer + 5) != ZSTD_SEEK_FOOTER_MAGIC || (footer[4] & 0x7C) != 0) {
+        return FALSE;
+    }
+
+    UINT32 count = GetLittleEndian32(footer);
+    SIZE_T entrySize = (footer[4] & ZSTD_SEEK_CHECKSUM_FLAG) ? 12 : 8;
+    UINT64 size = (UINT64)count * entrySize + ZSTD_SEEK_FOOTER_SIZE;
+
+    if (count == 0 || size > 0xFFFFFFFF || size + 8 > fileSize) return FALSE;
+
+    BYTE* table = (BYTE*)CpioAlloc((SIZE_T)size + 8);
+    CpioZstdFrame* frames = (CpioZstdFrame*)CpioAlloc(sizeof(CpioZstdFrame) * count);
+    BOOL ok = table && frames && ReadAt(zstd->hInput, fileSize - size - 8, table, (SIZE_T)size + 8) &&
+              GetLittleEndian32(table) == ZSTD_SEEKABLE_MAGIC && GetLittleEndian32(table + 4) == size;
+
+    UINT64 compressed = 0;
+    UINT64 decompressed = 0;
+    const BYTE* p = table + 8;
+
+    for (UINT32 i = 0; ok && i < count; i++) {
+        frames[i].compressedOffset = compressed;
+        frames[i].decompressedOffset = decompressed;
+        compressed += GetLittleEndian32(p);
+        decompressed += GetLittleEndian32(p + 4);
+        p += entrySize;
+    }
+
+    ok = ok && compressed + size + 8 == fileSize;
+
+    if (table) CpioFree(table);
+    if (!ok) {
+        if (frames) CpioFree(frames);
+        return FALSE;
+    }
+
+    zstd->frames = frames;
+    zstd->frameCount = count;
+    return TRUE;
+}
+
+static void LoadSeekTable(CpioZstdReader* zstd) {
+    LARGE_INTEGER zero;
+    LARGE_INTEGER current;
+    LARGE_INTEGER size;
+
+    if (GetFileType(zstd->hInput) != FILE_TYPE_DISK || !GetFileSizeEx(zstd->hInput, &size)) return;
+
+    zero.QuadPart = 0;
+    if (!SetFilePointerEx(zstd->hInput, zero, &current, FILE_CURRENT)) return;
+
+    ParseSeekTable(zstd, (UINT64)size.QuadPart);
+    SetFilePointerEx(zstd->hInput, current, NULL, FILE_BEGIN);
+}
+
+CpioZstdReader* CpioZstdReaderCreate(HANDLE hInput, BOOL takeOwnership, const BYTE* prefix, SIZE_T prefixLength,
+                                     CpioError* error) {
+    if (hInput == INVALID_HANDLE_VALUE) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_HANDLE, "Invalid file handle");
+        return NULL;
+    }
+
+    CpioZstdReader* zstd = (CpioZstdReader*)CpioAlloc(sizeof(CpioZstdReader));
+    if (!zstd) {
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    zstd->hInput = hInput;
+    LoadSeekTable(zstd);
+
+    if (!CreatePipe(&zstd->hPipe, &zstd->hWrite, NULL, CPIO_POOL_BUFFER_SIZE)) {
+        CpioZstdReaderDestroy(zstd);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create decompression pipe");
+        return NULL;
+    }
+
+    zstd->decoder = CpioZstdDecoderCreate(hInput, zstd->hWrite);
+    if (!zstd->decoder || !CpioZstdDecoderPrime(zstd->decoder, prefix, prefixLength)) {
+        CpioZstdReaderDestroy(zstd);
+        CpioErrorSet(error, CPIO_ERROR_ALLOCATION_FAILED, "Out of memory");
+        return NULL;
+    }
+
+    zstd->thread = CreateThread(NULL, 0, DecompressThread, zstd, 0, NULL);
+    if (!zstd->thread) {
+        CpioZstdReaderDestroy(zstd);
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start decompression thread");
+        return NULL;
+    }
+
+    zstd->ownsInput = takeOwnership;
+    return zstd;
+}
+
+HANDLE CpioZstdReaderGetHandle(const CpioZstdReader* zstd) {
+    return zstd ? zstd->hPipe : INVALID_HANDLE_VALUE;
+}
+
+static UINT32 FindFrame(const CpioZstdReader* zstd, UINT64 offset) {
+    UINT32 low = 0;
+    UINT32 high = zstd->frameCount;
+
+    while (high - low > 1) {
+        UINT32 middle = low + (high - low) / 2;
+        if (zstd->frames[middle].decompressedOffset <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+UINT64 CpioZstdReaderFrameStart(const CpioZstdReader* zstd, UINT64 offset) {
+    if (!zstd || zstd->frameCount == 0) return 0;
+    return zstd->frames[FindFrame(zstd, offset)].decompressedOffset;
+}
+
+static void StopThread(CpioZstdReader* zstd) {
+    if (zstd->hPipe) {
+        CloseHandle(zstd->hPipe);
+        zstd->hPipe = NULL;
+    }
+
+    if (zstd->thread) {
+        WaitForSingleObject(zstd->thread, INFINITE);
+        CloseHandle(zstd->thread);
+        zstd->thread = NULL;
+    }
+}
+
+BOOL CpioZstdReaderRestart(CpioZstdReader* zstd, UINT64 offset, UINT64* frameStart, CpioError* error) {
+    if (!zstd || zstd->frameCount == 0) {
+        CpioErrorSet(error, CPIO_ERROR_INVALID_PARAMETER, "zstd stream has no seek table");
+        return FALSE;
+    }
+
+    const CpioZstdFrame* frame = &zstd->frames[FindFrame(zstd, offset)];
+
+    StopThread(zstd);
+    zstd->failed = FALSE;
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = (LONGLONG)frame->compressedOffset;
+    if (!SetFilePointerEx(zstd->hInput, distance, NULL, FILE_BEGIN)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to seek compressed archive");
+        return FALSE;
+    }
+
+    if (!CreatePipe(&zstd->hPipe, &zstd->hWrite, NULL, CPIO_POOL_BUFFER_SIZE)) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to create decompression pipe");
+        return FALSE;
+    }
+
+    CpioZstdDecoderReset(zstd->decoder, zstd->hWrite);
+
+    zstd->thread = CreateThread(NULL, 0, DecompressThread, zstd, 0, NULL);
+    if (!zstd->thread) {
+        CpioErrorSet(error, CPIO_ERROR_IO, "Failed to start decompression thread");
+        return FALSE;
+    }
+
+    *frameStart = frame->decompressedOffset;
+    return TRUE;
+}
+
+BOOL CpioZstdReaderFinish(CpioZstdReader* zstd, CpioError* error) {
+    if (!zstd) return TRUE;
+
+    if (zstd->hPipe) {
+        BYTE* buffer = CpioBufferPoolAcquire();
+        DWORD bytesRead = 0;
+
+        while (buffer && ReadFile(zstd->hPipe, buffer, CPIO_POOL_BUFFER_SIZE, &bytesRead, NULL) && bytesRead > 0) {
+        }
+        if (buffer) CpioBufferPoolRelease(buffer);
+    }
+
+    if (zstd->thread) {
+        WaitForSingleObject(zstd->thread, INFINITE);
+        CloseHandle(zstd->thread);
+        zstd->thread = NULL;
+    }
+
+    if (zstd->failed) {
+        if (error) *error = zstd->error;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CpioZstdReaderDestroy(CpioZstdReader* zstd) {
+    if (!zstd) return;
+
+    StopThread(zstd);
+
+    if (zstd->hWrite) CloseHandle(zstd->hWrite);
+    if (zstd->ownsInput) CloseHandle(zstd->hInput);
+    CpioZstdDecoderDestroy(zstd->decoder);
+    if (zstd->frames) CpioFree(zstd->frames);
+    CpioFree(zstd);
+}